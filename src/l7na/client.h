@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "shmipc.h"
+
+namespace Drives {
+
+/*! @brief Клиент демона (Daemon) в другом процессе: статус и команды Control через разделяемую память.
+ *
+ *  Чтение статуса - копирование из разделяемой памяти без системных вызовов. Команды ставятся в очередь демона,
+ *  который выполняет их через Control; вызов ждет результата не дольше SetCommandTimeout.
+ *  Библиотека клиента (l7naclient) не зависит от EtherCAT master и boost.
+ */
+class Client {
+public:
+    Client();
+    ~Client();
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    //! @brief Подключается к области демона. @return false, если демон не запущен или другой версии
+    bool Open(const std::string& shm_name);
+    void Close();
+
+    bool IsOpen() const { return m_region != NULL; }
+
+    //! @brief Демон публиковал статус не раньше timeout_ms назад.
+    bool IsDaemonAlive(uint32_t timeout_ms = 100) const;
+
+    //! @brief Копия статуса Control::GetStatusCopy(), опубликованная демоном.
+    SystemStatus GetStatusCopy() const;
+    //! @brief Копия Control::GetCycleTimeInfo(), опубликованная демоном.
+    CycleTimeInfo GetCycleTimeInfo() const;
+    //! @brief Номер версии статуса, увеличивается при каждой публикации.
+    uint64_t GetStatusVersion() const;
+
+    //! @brief Control::SetModeRun в процессе демона. @return false также при заполненной очереди и таймауте
+    bool SetModeRun(const Axis& axis, double pos /*deg*/, double vel /*deg/s*/);
+    //! @brief Control::SetModeIdle в процессе демона. @return false также при заполненной очереди и таймауте
+    bool SetModeIdle(const Axis& axis);
+
+    //! @brief Время ожидания результата команды [миллисекунды] (по умолчанию 1000).
+    void SetCommandTimeout(uint32_t timeout_ms) { m_command_timeout_ms = timeout_ms; }
+
+private:
+    bool execute(const ShmCommand& command);
+
+    ShmRegion*  m_region;
+    uint32_t    m_command_timeout_ms;
+};
+
+} // namespaces
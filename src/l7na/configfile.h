@@ -1,14 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <unordered_set>
-#include <unordered_map>
-#include <type_traits>
+#include <utility>
+#include <vector>
 
-#include <boost/lexical_cast.hpp>
 #include <boost/tuple/tuple.hpp>
-#include <boost/unordered_map.hpp>
-#include <boost/unordered_set.hpp>
 
 #include "exceptions.h"
 
@@ -26,29 +23,11 @@ public:
     // 1st - value, 2nd - value byte size
     typedef boost::tuple<int64_t, uint8_t> Value;
 
-    struct KeyHash
-        : public std::unary_function<KeyHash, std::size_t>
-    {
-        std::size_t operator()(const Key& k) const {
-            std::size_t seed = 0;
+    // Key-value pairs in file order
+    typedef std::vector<std::pair<Key, Value>> KeyValueDict;
 
-            boost::hash_combine(seed, boost::get<0>(k));
-            boost::hash_combine(seed, boost::get<1>(k));
-            boost::hash_combine(seed, boost::get<2>(k));
-
-            return seed;
-        }
-    };
-
-    struct KeyComp {
-        bool operator()(const Key& k1, const Key& k2) const {
-            return (boost::get<0>(k1) == boost::get<0>(k2))
-                    && (boost::get<1>(k1) == boost::get<1>(k2))
-                    && (boost::get<2>(k1) == boost::get<2>(k2));
-        }
-    };
-
-    typedef boost::unordered_map<Key, Value, KeyHash, KeyComp> KeyValueDict;
+    // Key packed into 40 bits: axis (16) | index (16) | sub index (8). Ordering matches Key ordering
+    static uint64_t PackKey(const Key& key);
 
     Storage();
 
@@ -66,9 +45,14 @@ public:
      * ...
      * KeyN=ValueM
      *
-     * \attention       Keys may recur. In this case all values of the same key are stored.
-     *                  Keys and values may be multiword.
-     *                  All the leading and trailing spaces are trimmed.
+     * Key is "axis:index:subindex" (index is hexadecimal, optionally with 0x prefix),
+     * value is "value:size" (size in bytes, 1..8).
+     *
+     * \attention       Keys may recur. In this case the last value of the key is stored, at the position
+     *                  of its last occurrence. Spaces around fields are ignored.
+     *
+     * The file is parsed in a single pass without per-line allocations. Parsed entries are
+     * dumped to the debug log.
      *
      * \param filepath  Path to the file to read.
      *
@@ -76,6 +60,15 @@ public:
      */
     void ReadFile(const std::string& filepath);
 
+    /*!
+     * \brief           Parse config text of the ReadFile() format
+     * \param data      Text to parse
+     * \param size      Text size in bytes
+     *
+     * \throw ConfigException
+     */
+    void ReadBuffer(const char* data, size_t size);
+
     bool IsEmpty() const;
 
     /*!
@@ -86,7 +79,7 @@ public:
     bool HasKey(const Key& key) const;
 
     /*!
-     * \brief       Get first value assosiated with the key
+     * \brief       Get the value assosiated with the key
      * \param key   Key to find
      * \return      Value
      */
@@ -94,12 +87,20 @@ public:
 
     /*!
      * \brief       Get all key-value pairs
-     * \return      Key-value dictionary
+     * \return      Key-value pairs in file order (the order in which they should be written to drives)
      */
     const KeyValueDict& GetWholeDict() const;
 
 private:
-    KeyValueDict m_kvdict;              //!< Key-value storage
+    //! Parses one line [begin, end). \return false for empty and comment lines
+    static bool parse_line(const char* begin, const char* end, int32_t linenum, Key& key, Value& val);
+
+    //! Sorts the lookup index and drops overridden duplicates
+    void build_index();
+
+    KeyValueDict m_kvdict;              //!< Key-value storage in file order
+    //! Lookup index sorted by packed key: packed key -> position in m_kvdict
+    std::vector<std::pair<uint64_t, uint32_t>> m_index;
 };
 
 bool ValueToBool(const Storage::Value& val);
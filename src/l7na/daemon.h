@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "drives.h"
+#include "shmipc.h"
+
+namespace Drives {
+
+/*! @brief Режим демона: доступ к Control из других процессов через разделяемую память (ShmRegion).
+ *
+ *  Мастером EtherCAT может владеть только один процесс. Демон создает область разделяемой памяти и запускает
+ *  поток, который раз в period_ns публикует статус Control и выполняет команды клиентов (Client). Поток обмена
+ *  Control при этом не меняется: демон - обычный клиент его API, и его поток можно держать на других ядрах.
+ */
+class Daemon {
+public:
+    /*! @brief Создает область разделяемой памяти и запускает поток демона.
+     *
+     *  @param  control     Система управления; должна существовать дольше демона
+     *  @param  shm_name    Имя объекта разделяемой памяти (например, "/l7na"). Существующий объект пересоздается,
+     *                      только если это область остановившегося демона; область работающего демона
+     *                      или чужой объект - исключение
+     *  @param  period_ns   Период публикации статуса и приема команд [наносекунды], обычно период цикла обмена
+     */
+    Daemon(Control& control, const std::string& shm_name, uint32_t period_ns);
+
+    //! @brief Останавливает поток и удаляет объект разделяемой памяти.
+    ~Daemon();
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+
+    //! @brief Выполнено команд клиентов с запуска.
+    uint64_t CommandCount() const;
+
+private:
+    void serve_loop();
+    //! Выполняет команды из кольца. @return Количество выполненных команд
+    uint32_t execute_commands();
+
+    Control&                        m_control;
+    const std::string               m_shm_name;
+    const uint32_t                  m_period_ns;
+    ShmRegion*                      m_region;
+    std::atomic<uint64_t>           m_commands;
+    std::atomic<bool>               m_stop;
+    std::unique_ptr<std::thread>    m_thread;
+};
+
+} // namespaces
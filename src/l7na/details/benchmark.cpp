@@ -0,0 +1,62 @@
+#include <ctime>
+#include <thread>
+
+#include "benchmark.h"
+
+namespace Drives {
+
+namespace {
+
+void write_json_string(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (const char c: value) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void BenchmarkReport::WriteJson(std::ostream& out) const {
+    char date[32];
+    const std::time_t now = std::time(NULL);
+    std::tm now_tm;
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", ::localtime_r(&now, &now_tm));
+
+    out << "{\n"
+        << "  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n"
+#else
+        << "    \"library_build_type\": \"debug\"\n"
+#endif
+        << "  },\n"
+        << "  \"benchmarks\": [";
+
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const Result& result = m_results[i];
+        const double real_time = result.iterations ? static_cast<double>(result.total_ns) / result.iterations : 0.0;
+        out << (i ? "," : "") << "\n    {\n"
+            << "      \"name\": ";
+        write_json_string(out, result.name);
+        out << ",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << result.iterations << ",\n"
+            << "      \"real_time\": " << real_time << ",\n"
+            << "      \"cpu_time\": " << real_time << ",\n"
+            << "      \"time_unit\": \"ns\",\n"
+            << "      \"items_per_second\": " << (real_time > 0.0 ? 1e9 / real_time : 0.0) << ",\n"
+            << "      \"p50_ns\": " << result.per_op.Percentile(0.5) << ",\n"
+            << "      \"p99_ns\": " << result.per_op.Percentile(0.99) << ",\n"
+            << "      \"max_ns\": " << result.per_op.max_ns << "\n"
+            << "    }";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+} // namespaces
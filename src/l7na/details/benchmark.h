@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "l7na/types.h"
+#include "cyclescheduler.h"
+#include "histogram.h"
+
+namespace Drives {
+
+//! @brief Не дает компилятору выбросить вычисление value как неиспользуемое
+inline void BenchmarkKeep(uint64_t value) {
+    asm volatile("" : : "r"(value) : "memory");
+}
+
+/*! @brief Замеры servobench (Control::RunBenchmarks) и их вывод в JSON.
+ *
+ *  JSON повторяет формат Google Benchmark (context, benchmarks[name, iterations, real_time, time_unit]),
+ *  поэтому результаты разных версий можно сравнивать его инструментами. Дополнительно выводятся перцентили
+ *  длительности одного вызова, оцененные по сериям вызовов.
+ */
+class BenchmarkReport {
+public:
+    struct Result {
+        std::string         name;
+        uint64_t            iterations;
+        uint64_t            total_ns;   //!< Время всех вызовов [наносекунды]
+        DurationHistogram   per_op;     //!< Длительность одного вызова (по сериям) [наносекунды]
+    };
+
+    //! @param  filter  Подстрока имени: замеры с другими именами пропускаются (пустая - все)
+    explicit BenchmarkReport(const std::string& filter)
+        : m_filter(filter)
+        , m_results()
+    {}
+
+    bool Enabled(const std::string& name) const {
+        return m_filter.empty() || name.find(m_filter) != std::string::npos;
+    }
+
+    /*! @brief Замер iterations вызовов func() сериями по batch вызовов.
+     *
+     *  Время каждой серии, деленное на batch, учитывается в гистограмме: при batch == 1 это задержка
+     *  отдельного вызова (с накладными расходами чтения часов), при больших batch - пропускная способность.
+     */
+    template<typename Func>
+    void Measure(const std::string& name, uint64_t iterations, uint64_t batch, Func func) {
+        MeasureWithSetup(name, iterations, batch, [](){}, func);
+    }
+
+    //! @brief То же, но перед каждой серией вызывается setup(), время которого не учитывается.
+    template<typename Setup, typename Func>
+    void MeasureWithSetup(const std::string& name, uint64_t iterations, uint64_t batch, Setup setup, Func func) {
+        if (! Enabled(name)) {
+            return;
+        }
+
+        HistogramRecorder recorder;
+        uint64_t total_ns = 0;
+        uint64_t done = 0;
+        for (; done < iterations; done += batch) {
+            setup();
+            const uint64_t start = CycleScheduler::Now();
+            for (uint64_t i = 0; i < batch; ++i) {
+                func();
+            }
+            const uint64_t elapsed = CycleScheduler::Now() - start;
+            total_ns += elapsed;
+            recorder.Record(elapsed / batch);
+        }
+
+        Result result{ name, done, total_ns, DurationHistogram() };
+        recorder.Snapshot(result.per_op);
+        m_results.push_back(result);
+    }
+
+    //! @brief Готовый результат: гистограмма длительностей одного вызова (по сериям)
+    void Add(const std::string& name, uint64_t iterations, uint64_t total_ns, const DurationHistogram& per_op) {
+        if (Enabled(name)) {
+            m_results.push_back({ name, iterations, total_ns, per_op });
+        }
+    }
+
+    const std::vector<Result>& Results() const {
+        return m_results;
+    }
+
+    void WriteJson(std::ostream& out) const;
+
+private:
+    const std::string   m_filter;
+    std::vector<Result> m_results;
+};
+
+} // namespaces
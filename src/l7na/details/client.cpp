@@ -0,0 +1,129 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "l7na/client.h"
+
+namespace Drives {
+
+namespace {
+
+constexpr uint32_t kResultPollUs = 20;
+
+uint64_t monotonic_ns() {
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+} // namespace
+
+Client::Client()
+    : m_region(NULL)
+    , m_command_timeout_ms(1000)
+{}
+
+Client::~Client() {
+    Close();
+}
+
+bool Client::Open(const std::string& shm_name) {
+    Close();
+
+    const int fd = ::shm_open(shm_name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    // Обращение к отображению за концом объекта - SIGBUS: размер проверяется до чтения заголовка
+    struct stat st;
+    if (::fstat(fd, &st) || st.st_size < static_cast<off_t>(sizeof(ShmRegion))) {
+        ::close(fd);
+        return false;
+    }
+    void* data = ::mmap(NULL, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == data) {
+        return false;
+    }
+
+    ShmRegion* region = static_cast<ShmRegion*>(data);
+    if (std::memcmp(region->magic, kShmRegionMagic, sizeof(kShmRegionMagic)) || region->version != kShmRegionVersion
+        || region->region_size != sizeof(ShmRegion)) {
+        ::munmap(data, sizeof(ShmRegion));
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    m_region = region;
+    return true;
+}
+
+void Client::Close() {
+    if (m_region) {
+        ::munmap(m_region, sizeof(ShmRegion));
+        m_region = NULL;
+    }
+}
+
+bool Client::IsDaemonAlive(uint32_t timeout_ms) const {
+    if (! m_region) {
+        return false;
+    }
+    const uint64_t heartbeat = m_region->heartbeat.load(std::memory_order_acquire);
+    return monotonic_ns() < heartbeat + static_cast<uint64_t>(timeout_ms) * 1000000;
+}
+
+SystemStatus Client::GetStatusCopy() const {
+    SystemStatus status = SystemStatus();
+    if (m_region) {
+        ShmLoadStatus(*m_region, &status, NULL);
+    }
+    return status;
+}
+
+CycleTimeInfo Client::GetCycleTimeInfo() const {
+    CycleTimeInfo timing = CycleTimeInfo();
+    if (m_region) {
+        ShmLoadStatus(*m_region, NULL, &timing);
+    }
+    return timing;
+}
+
+uint64_t Client::GetStatusVersion() const {
+    return m_region ? m_region->status_seq.load(std::memory_order_acquire) >> 1 : 0;
+}
+
+bool Client::SetModeRun(const Axis& axis, double pos, double vel) {
+    return execute({ SHM_COMMAND_RUN, axis, pos, vel });
+}
+
+bool Client::SetModeIdle(const Axis& axis) {
+    return execute({ SHM_COMMAND_IDLE, axis, 0.0, 0.0 });
+}
+
+bool Client::execute(const ShmCommand& command) {
+    if (! m_region) {
+        return false;
+    }
+    const uint64_t id = ShmPushCommand(*m_region, command);
+    if (! id) {
+        return false;
+    }
+
+    const uint64_t deadline = monotonic_ns() + static_cast<uint64_t>(m_command_timeout_ms) * 1000000;
+    bool ok = false;
+    while (! ShmLoadResult(*m_region, id, &ok)) {
+        if (monotonic_ns() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(kResultPollUs));
+    }
+    return ok;
+}
+
+} // namespaces
@@ -1,108 +1,233 @@
+#include <algorithm>
 #include <fstream>
-#include <iostream>
-
-#include <boost/algorithm/string/trim.hpp>
-#include <boost/algorithm/string/case_conv.hpp>
+#include <limits>
 
 #include "l7na/configfile.h"
+#include "l7na/logger.h"
 
 namespace Config {
 
+namespace {
+
+const char kKeyValueDelim = '=';
+const char kFieldDelim = ':';
+const char kCommentStart = '#';
+
+//! Max value byte size
+const uint8_t kMaxValueSize = 8;
+
+inline bool is_space(const char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline const char* skip_spaces(const char* pos, const char* end) {
+    while (pos != end && is_space(*pos)) {
+        ++pos;
+    }
+    return pos;
+}
+
+/*! Parses unsigned number in [pos, end) with the given base, skipping leading spaces.
+ *  \return Position after the number or nullptr if there are no digits or the number exceeds max_value.
+ */
+const char* parse_unsigned(const char* pos, const char* end, const uint32_t base, const uint64_t max_value,
+                           uint64_t& value) {
+    pos = skip_spaces(pos, end);
+    if (base == 16 && end - pos > 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X')) {
+        pos += 2;
+    }
+
+    const char* const digits_begin = pos;
+    value = 0;
+    for (; pos != end; ++pos) {
+        uint32_t digit = 0;
+        const char c = *pos;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            break;
+        }
+        if (digit > max_value || value > (max_value - digit) / base) {
+            return nullptr;
+        }
+        value = value * base + digit;
+    }
+
+    return pos == digits_begin ? nullptr : pos;
+}
+
+//! Parses signed decimal number in [pos, end), skipping leading spaces. \return Same as parse_unsigned()
+const char* parse_signed(const char* pos, const char* end, int64_t& value) {
+    pos = skip_spaces(pos, end);
+    const bool negative = pos != end && *pos == '-';
+    if (pos != end && (*pos == '-' || *pos == '+')) {
+        ++pos;
+    }
+
+    const uint64_t max_abs = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + (negative ? 1 : 0);
+    uint64_t abs_value = 0;
+    pos = parse_unsigned(pos, end, 10, max_abs, abs_value);
+    if (pos) {
+        value = negative ? static_cast<int64_t>(0 - abs_value) : static_cast<int64_t>(abs_value);
+    }
+    return pos;
+}
+
+//! Checks that only spaces remain before the expected delimiter (or the end if delim is 0)
+inline const char* expect(const char* pos, const char* end, const char delim) {
+    if (! pos) {
+        return nullptr;
+    }
+    pos = skip_spaces(pos, end);
+    if (delim == 0) {
+        return pos == end ? pos : nullptr;
+    }
+    return (pos != end && *pos == delim) ? pos + 1 : nullptr;
+}
+
+} // namespace
+
 Storage::Storage() = default;
 
-void Storage::ReadFile(const std::string& filepath) {
-    // Empty the key-value storage
-    m_kvdict.clear();
+uint64_t Storage::PackKey(const Key& key) {
+    return (static_cast<uint64_t>(boost::get<0>(key)) << 24)
+            | (static_cast<uint64_t>(boost::get<1>(key)) << 8)
+            | boost::get<2>(key);
+}
 
-    std::ifstream input(filepath);
+void Storage::ReadFile(const std::string& filepath) {
+    std::ifstream input(filepath, std::ios::binary);
     if (! input.good()) {
         BOOST_THROW_EXCEPTION(Exception("Failed to open file: ") << filepath);
     }
 
-    const char kKeyValueDelim = '=';
-    const char kFieldDelim = ':';
-    const char kCommentStart = '#';
-    std::string cur_line;
+    // The whole file is read at once: lines are parsed in place without copying
+    std::string buffer;
+    input.seekg(0, std::ios::end);
+    const std::streamoff file_size = input.tellg();
+    if (file_size > 0) {
+        buffer.resize(file_size);
+        input.seekg(0, std::ios::beg);
+        input.read(&buffer[0], file_size);
+    }
+    if (input.bad() || (file_size > 0 && input.gcount() != file_size)) {
+        BOOST_THROW_EXCEPTION(Exception("Failed to read file: ") << filepath);
+    }
+    input.close();
+
+    ReadBuffer(buffer.data(), buffer.size());
+}
+
+void Storage::ReadBuffer(const char* data, size_t size) {
+    // Empty the key-value storage
+    m_kvdict.clear();
+    m_index.clear();
+
+    const char* const data_end = data + size;
+    m_kvdict.reserve(std::count(data, data_end, '\n') + 1);
+
+    Key key;
+    Value val;
     int32_t linenum = 1;
-    while (std::getline(input, cur_line)) {
-        boost::algorithm::trim(cur_line);
-        if (cur_line.empty() || cur_line[0] == kCommentStart) {
-            continue;
-        }
-        const size_t kv_delim_pos = cur_line.find(kKeyValueDelim);
-        if (kv_delim_pos == std::string::npos) {
-            BOOST_THROW_EXCEPTION(Exception("No key-value delimiter found in line ") << linenum);
-            continue;
+    for (const char* line = data; line < data_end; ++linenum) {
+        const char* line_end = std::find(line, data_end, '\n');
+        if (parse_line(line, line_end, linenum, key, val)) {
+            m_kvdict.push_back(std::make_pair(key, val));
         }
+        line = line_end + 1;
+    }
 
-        // Process key
-        std::string key_str = cur_line.substr(0, kv_delim_pos);
-        boost::algorithm::trim(key_str);
-        // Find 1st key part
-        const size_t key1_delim_pos = cur_line.find(kFieldDelim);
-        if (key1_delim_pos == std::string::npos) {
-            BOOST_THROW_EXCEPTION(Exception("No 1st key delimiter found in line ") << linenum);
-            continue;
-        }
-        std::string key1_str = key_str.substr(0, key1_delim_pos);
-        boost::algorithm::trim(key1_str);
-        // Find 2nd key part
-        const size_t key2_delim_pos = cur_line.find(kFieldDelim, key1_delim_pos + 1);
-        if (key2_delim_pos == std::string::npos) {
-            BOOST_THROW_EXCEPTION(Exception("No 2nd key delimiter found in line ") << linenum);
-            continue;
-        }
-        std::string key2_str = key_str.substr(key1_delim_pos + 1, key2_delim_pos - key1_delim_pos - 1);
-        boost::algorithm::trim(key2_str);
-        // Find 3rd key part
-        std::string key3_str = key_str.substr(key2_delim_pos + 1);
-        boost::algorithm::trim(key3_str);
-
-        /* Process value
-         * @attention It's safe to pass values to substr with length [0, size].
-         * Here value is taken from find method which returns [0, size - 1] or npos.
-         * So value + 1 is [0, size] at maximum.
-         */
-        std::string val_str = cur_line.substr(kv_delim_pos + 1);
-        boost::algorithm::trim(val_str);
-        const size_t val1_delim_pos = val_str.find(kFieldDelim);
-        if (val1_delim_pos == std::string::npos) {
-            BOOST_THROW_EXCEPTION(Exception("No 1st value delimiter found in line ") << linenum);
-            continue;
-        }
-        std::string val1_str = val_str.substr(0, val1_delim_pos);
-        boost::algorithm::trim(val1_str);
-        std::string val2_str = val_str.substr(val1_delim_pos + 1);
-        boost::algorithm::trim(val2_str);
-
-        std::cerr << "Parsed: " << key1_str << " : " << key2_str << " : " <<  key3_str << " = " << val1_str << ":" << val2_str << std::endl;
-
-        // Result key-value
-        Key key;
-        try {
-            const uint16_t key1 = boost::lexical_cast<uint16_t>(key1_str);
-            const uint16_t key2 = std::strtoul(key2_str.c_str(), NULL, 16);
-            const uint16_t key3 = boost::lexical_cast<uint16_t>(key3_str);
-            key = boost::make_tuple(key1, key2, key3);
-        } catch (const boost::bad_lexical_cast&) {
-            BOOST_THROW_EXCEPTION(Exception("Invalid key detected at line number ") << linenum);
-        }
+    build_index();
 
-        Value val;
-        try {
-            const int64_t val1 = boost::lexical_cast<int64_t>(val1_str);
-            const uint8_t val2 = boost::lexical_cast<uint8_t>(val2_str);
-            val = boost::make_tuple(val1, val2);
-        } catch (const boost::bad_lexical_cast&) {
-            BOOST_THROW_EXCEPTION(Exception("Invalid value detected at line number ") << linenum);
-        }
+    for (const auto& kv: m_kvdict) {
+        LOG_DEBUG("Parsed: " << boost::get<0>(kv.first) << " : 0x" << std::hex << boost::get<1>(kv.first)
+                  << std::dec << " : " << static_cast<uint32_t>(boost::get<2>(kv.first)) << " = "
+                  << boost::get<0>(kv.second) << ":" << static_cast<uint32_t>(boost::get<1>(kv.second)));
+    }
+}
 
-        // The last read value with the same key is stored
-        m_kvdict[key] = val;
+bool Storage::parse_line(const char* begin, const char* end, int32_t linenum, Key& key, Value& val) {
+    begin = skip_spaces(begin, end);
+    if (begin == end || *begin == kCommentStart) {
+        return false;
+    }
+    if (std::find(begin, end, kKeyValueDelim) == end) {
+        BOOST_THROW_EXCEPTION(Exception("No key-value delimiter found in line ") << linenum);
+    }
 
-        ++linenum;
+    // Process key: axis:index(hex):sub index
+    uint64_t axis = 0;
+    uint64_t index = 0;
+    uint64_t subindex = 0;
+    const char* pos = begin;
+    pos = expect(parse_unsigned(pos, end, 10, std::numeric_limits<uint16_t>::max(), axis), end, kFieldDelim);
+    if (pos) {
+        pos = expect(parse_unsigned(pos, end, 16, std::numeric_limits<uint16_t>::max(), index), end, kFieldDelim);
+    }
+    if (pos) {
+        pos = expect(parse_unsigned(pos, end, 10, std::numeric_limits<uint8_t>::max(), subindex), end,
+                     kKeyValueDelim);
+    }
+    if (! pos) {
+        BOOST_THROW_EXCEPTION(Exception("Invalid key detected at line number ") << linenum);
+    }
+
+    // Process value: value:byte size
+    int64_t value = 0;
+    uint64_t value_size = 0;
+    pos = expect(parse_signed(pos, end, value), end, kFieldDelim);
+    if (pos) {
+        pos = expect(parse_unsigned(pos, end, 10, kMaxValueSize, value_size), end, 0);
+    }
+    if (! pos || value_size == 0) {
+        BOOST_THROW_EXCEPTION(Exception("Invalid value detected at line number ") << linenum);
+    }
+
+    key = boost::make_tuple(static_cast<uint16_t>(axis), static_cast<uint16_t>(index),
+                            static_cast<uint8_t>(subindex));
+    val = boost::make_tuple(value, static_cast<uint8_t>(value_size));
+    return true;
+}
+
+void Storage::build_index() {
+    m_index.reserve(m_kvdict.size());
+    for (uint32_t i = 0; i < m_kvdict.size(); ++i) {
+        m_index.push_back(std::make_pair(PackKey(m_kvdict[i].first), i));
+    }
+    // Equal keys are ordered by position after sorting, so the last occurrence is the last one in the group
+    std::sort(m_index.begin(), m_index.end());
+
+    const size_t parsed_count = m_index.size();
+    const auto last_it = std::unique(m_index.rbegin(), m_index.rend(),
+        [](const std::pair<uint64_t, uint32_t>& lhs, const std::pair<uint64_t, uint32_t>& rhs) {
+            return lhs.first == rhs.first;
+        });
+    m_index.erase(m_index.begin(), last_it.base());
+    if (m_index.size() == parsed_count) {
+        return;
+    }
+
+    // The last read value with the same key is stored at the position of its last occurrence
+    std::vector<bool> keep(m_kvdict.size(), false);
+    for (const auto& idx: m_index) {
+        keep[idx.second] = true;
+    }
+    std::vector<uint32_t> new_pos(m_kvdict.size(), 0);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < m_kvdict.size(); ++i) {
+        if (keep[i]) {
+            new_pos[i] = kept;
+            m_kvdict[kept++] = m_kvdict[i];
+        }
+    }
+    m_kvdict.resize(kept);
+    for (auto& idx: m_index) {
+        idx.second = new_pos[idx.second];
     }
-    input.close();
 }
 
 bool Storage::IsEmpty() const {
@@ -110,13 +235,16 @@ bool Storage::IsEmpty() const {
 }
 
 bool Storage::HasKey(const Key& key) const {
-    return m_kvdict.find(key) != m_kvdict.end();
+    const uint64_t packed = PackKey(key);
+    const auto it = std::lower_bound(m_index.begin(), m_index.end(), std::make_pair(packed, uint32_t(0)));
+    return it != m_index.end() && it->first == packed;
 }
 
 const Storage::Value& Storage::GetValue(const Key& key) const {
-    const auto& found_it = m_kvdict.find(key);
-    if (found_it != m_kvdict.end()) {
-        return found_it->second;
+    const uint64_t packed = PackKey(key);
+    const auto it = std::lower_bound(m_index.begin(), m_index.end(), std::make_pair(packed, uint32_t(0)));
+    if (it != m_index.end() && it->first == packed) {
+        return m_kvdict[it->second].second;
     }
 
     BOOST_THROW_EXCEPTION(Exception("GetValue(): key was not found"));
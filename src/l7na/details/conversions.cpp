@@ -0,0 +1,71 @@
+#include "conversions.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Drives {
+
+// Проверки на этапе компиляции: преобразования constexpr
+static_assert(PosDeg2Pulse(0.0, 600000) == kPulsesPerTurn, "PosDeg2Pulse: shortest path forward");
+static_assert(PosDeg2Pulse(300.0, 7400000) == 7165269, "PosDeg2Pulse: shortest path backward");
+static_assert(PosDeg2Pulse(50.0, -7400000) == -7194397, "PosDeg2Pulse: negative position");
+static_assert(PosDeg2TurnPulse(-90.0) == 3 * kPulsesPerTurn / 4, "PosDeg2TurnPulse: negative angle");
+static_assert(PosPulse2Deg(-kPulsesPerTurn / 4, false) == 270.0, "PosPulse2Deg: unsigned");
+static_assert(PosPulse2Deg(3 * kPulsesPerTurn / 4, true) == -90.0, "PosPulse2Deg: signed");
+
+void PosPulse2DegBatch(const int32_t* pos_pulse, double* pos_deg, size_t count, int32_t pos_offset, bool signed_deg) {
+    const int32_t flip = static_cast<int32_t>(signed_deg) * kPulsesPerHalfTurn;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i offset4 = _mm_set1_epi32(pos_offset);
+    const __m128i mask4 = _mm_set1_epi32(kPulsesTurnMask);
+    const __m128i flip4 = _mm_set1_epi32(flip);
+    const __m128d scale2 = _mm_set1_pd(kPulsesPerDegree);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pulse4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos_pulse + i));
+        const __m128i local4 = _mm_sub_epi32(
+            _mm_xor_si128(_mm_and_si128(_mm_sub_epi32(pulse4, offset4), mask4), flip4), flip4);
+        _mm_storeu_pd(pos_deg + i, _mm_div_pd(_mm_cvtepi32_pd(local4), scale2));
+        _mm_storeu_pd(pos_deg + i + 2, _mm_div_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(local4, local4)), scale2));
+    }
+#endif
+    for (; i < count; ++i) {
+        const int32_t local = ((pos_pulse[i] - pos_offset) & kPulsesTurnMask) ^ flip;
+        pos_deg[i] = static_cast<double>(local - flip) / kPulsesPerDegree;
+    }
+}
+
+int32_t PosDeg2PulseBatch(const double* pos_deg, int32_t* pos_pulse, size_t count, int32_t cur_pos_pulse) {
+    size_t i = 0;
+#ifdef __SSE2__
+    // Округление вниз через усечение в int32: пары со значением вне диапазона int32 переводятся поэлементно
+    const __m128d scale2 = _mm_set1_pd(kPulsesPerDegree);
+    const __m128d one2 = _mm_set1_pd(1.0);
+    const __m128d abs_mask2 = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m128d limit2 = _mm_set1_pd(2147483648.0);
+    const __m128i mask4 = _mm_set1_epi32(kPulsesTurnMask);
+    for (; i + 2 <= count; i += 2) {
+        const __m128d value2 = _mm_mul_pd(_mm_loadu_pd(pos_deg + i), scale2);
+        if (_mm_movemask_pd(_mm_cmplt_pd(_mm_and_pd(value2, abs_mask2), limit2)) != 0x3) {
+            pos_pulse[i] = PosDeg2TurnPulse(pos_deg[i]);
+            pos_pulse[i + 1] = PosDeg2TurnPulse(pos_deg[i + 1]);
+            continue;
+        }
+        const __m128d trunc2 = _mm_cvtepi32_pd(_mm_cvttpd_epi32(value2));
+        const __m128d floor2 = _mm_sub_pd(trunc2, _mm_and_pd(_mm_cmplt_pd(value2, trunc2), one2));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pos_pulse + i),
+                         _mm_and_si128(_mm_cvttpd_epi32(floor2), mask4));
+    }
+#endif
+    for (; i < count; ++i) {
+        pos_pulse[i] = PosDeg2TurnPulse(pos_deg[i]);
+    }
+    for (i = 0; i < count; ++i) {
+        cur_pos_pulse += WrapTurnDelta(static_cast<uint32_t>(pos_pulse[i]) - static_cast<uint32_t>(cur_pos_pulse));
+        pos_pulse[i] = cur_pos_pulse;
+    }
+    return cur_pos_pulse;
+}
+
+} // namespaces
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Drives {
+
+constexpr int32_t   kPulsesPerTurn      = 1048576; // 2^20
+constexpr int32_t   kDegPerTurn         = 360;
+constexpr double    kPulsesPerDegree    = 1048576.0 / 360.0;
+
+//! @brief Маска позиции в пределах оборота: kPulsesPerTurn - степень двойки
+constexpr int32_t   kPulsesTurnMask     = kPulsesPerTurn - 1;
+constexpr int32_t   kPulsesPerHalfTurn  = kPulsesPerTurn / 2;
+
+static_assert((kPulsesPerTurn & kPulsesTurnMask) == 0, "kPulsesPerTurn must be a power of two");
+
+//! @brief Наибольшее целое, не превосходящее value (|value| < 2^63)
+constexpr int64_t FloorToInt64(double value) {
+    return static_cast<int64_t>(value)
+        - static_cast<int64_t>(value < static_cast<double>(static_cast<int64_t>(value)));
+}
+
+//! @brief Позиция [импульсы энкодера] -> [0, kPulsesPerTurn)
+constexpr int32_t WrapTurnPulse(int64_t pos_pulse) {
+    return static_cast<int32_t>(pos_pulse & kPulsesTurnMask);
+}
+
+//! @brief Разность позиций [импульсы энкодера] -> [-kPulsesPerHalfTurn, kPulsesPerHalfTurn)
+constexpr int32_t WrapTurnDelta(uint32_t delta_pulse) {
+    return (static_cast<int32_t>(delta_pulse & kPulsesTurnMask) ^ kPulsesPerHalfTurn) - kPulsesPerHalfTurn;
+}
+
+/*! @brief Предел модуля позиции [градусы], принимаемой пакетными преобразованиями и API траекторий.
+ *
+ *  Позиция должна быть конечной и по модулю меньше kPosDegLimit: pos_deg * kPulsesPerDegree помещается в int64_t.
+ */
+constexpr double    kPosDegLimit        = 9.0e18 / kPulsesPerDegree;
+
+//! @brief Позиция [градусы] -> [импульсы энкодера] в пределах оборота [0, kPulsesPerTurn)
+constexpr int32_t PosDeg2TurnPulse(double pos_deg) {
+    return WrapTurnPulse(FloorToInt64(pos_deg * kPulsesPerDegree));
+}
+
+/*! @brief Позиция [градусы] -> ближайшая к cur_pos_pulse позиция [импульсы энкодера] с тем же углом.
+ *
+ *  Сдвиг от cur_pos_pulse не превышает полуоборота; ровно на полоборота ось поворачивает в отрицательную сторону.
+ */
+constexpr int32_t PosDeg2Pulse(double tgt_pos_deg, int32_t cur_pos_pulse) {
+    return cur_pos_pulse
+        + WrapTurnDelta(static_cast<uint32_t>(PosDeg2TurnPulse(tgt_pos_deg)) - static_cast<uint32_t>(cur_pos_pulse));
+}
+
+//! @brief Скорость [импульсы энкодера/с] -> [градусы/с]
+constexpr double VelPulse2Deg(int32_t vel_pulse) {
+    return static_cast<double>(vel_pulse) / kPulsesPerDegree;
+}
+
+/*! @brief Позиция [импульсы энкодера] -> [градусы] в пределах оборота.
+ *
+ *  @param  signed_deg  Результат в диапазоне [-180, 180) вместо [0, 360)
+ */
+constexpr double PosPulse2Deg(int32_t pos_pulse, bool signed_deg) {
+    // При signed_deg верхняя половина оборота переносится вниз заменой знакового бита полуоборота
+    return static_cast<double>(
+        (WrapTurnPulse(pos_pulse) ^ (static_cast<int32_t>(signed_deg) * kPulsesPerHalfTurn))
+        - static_cast<int32_t>(signed_deg) * kPulsesPerHalfTurn) / kPulsesPerDegree;
+}
+
+/*! @brief PosPulse2Deg(pos_pulse[i] - pos_offset, signed_deg) для массива позиций.
+ *
+ *  При наличии SSE2 позиции обрабатываются по четыре, результат совпадает с PosPulse2Deg побитно.
+ *  Используется для разбора телеметрии (записи циклов) и подготовки траекторий.
+ */
+void PosPulse2DegBatch(const int32_t* pos_pulse, double* pos_deg, size_t count, int32_t pos_offset, bool signed_deg);
+
+/*! @brief PosDeg2Pulse для последовательности позиций: каждая - ближайшая к предыдущей, первая - к cur_pos_pulse.
+ *
+ *  Углы переводятся в импульсы отдельным проходом без зависимостей (при наличии SSE2 - по два, с округлением
+ *  через int32; пары, не помещающиеся в int32, переводятся поэлементно), цепочка ближайших позиций затем
+ *  вычисляется целочисленно. |pos_deg[i]| должен быть меньше kPosDegLimit (значения не проверяются).
+ *  @return Последняя позиция (cur_pos_pulse при count == 0)
+ */
+int32_t PosDeg2PulseBatch(const double* pos_deg, int32_t* pos_pulse, size_t count, int32_t cur_pos_pulse);
+
+} // namespaces
@@ -0,0 +1,158 @@
+#include <time.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "cyclescheduler.h"
+
+namespace Drives {
+
+namespace {
+
+constexpr uint64_t kNsPerSec = 1000000000ULL;
+
+timespec ns2timespec(uint64_t ns) {
+    timespec ts;
+    ts.tv_sec = ns / kNsPerSec;
+    ts.tv_nsec = ns % kNsPerSec;
+    return ts;
+}
+
+} // namespace
+
+CycleScheduler::CycleScheduler(uint32_t period_ns, uint32_t spin_ns, OverrunPolicy policy)
+    : m_period_ns(period_ns)
+    , m_spin_ns(std::min(spin_ns, period_ns))
+    , m_policy(policy)
+    , m_wakeup_ns(0)
+    , m_phase_shift_ns(0)
+    , m_skipped(0)
+{}
+
+void CycleScheduler::Start() {
+    Start(Now());
+}
+
+void CycleScheduler::Start(uint64_t start_ns) {
+    m_wakeup_ns = start_ns;
+    m_phase_shift_ns = 0;
+    m_skipped = 0;
+}
+
+uint64_t CycleScheduler::WaitNext() {
+    m_wakeup_ns += m_period_ns + m_phase_shift_ns;
+    m_phase_shift_ns = 0;
+    m_skipped = 0;
+
+    if (OVERRUN_POLICY_SKIP == m_policy) {
+        // Опоздавший цикл не выполняется: пробуждение переносится на ближайший период сетки,
+        // чтобы после переполнения не было серии циклов подряд
+        const uint64_t now = Now();
+        if (now > m_wakeup_ns) {
+            m_skipped = (now - m_wakeup_ns) / m_period_ns + 1;
+            m_wakeup_ns += m_skipped * m_period_ns;
+        }
+    }
+
+    if (m_spin_ns) {
+        sleep_until(m_wakeup_ns - m_spin_ns);
+        while (Now() < m_wakeup_ns) {
+            // Активное ожидание последних микросекунд до пробуждения
+        }
+    } else {
+        sleep_until(m_wakeup_ns);
+    }
+
+    return m_wakeup_ns;
+}
+
+void CycleScheduler::AdjustPhase(int64_t shift_ns) {
+    m_phase_shift_ns += shift_ns;
+}
+
+uint64_t CycleScheduler::WakeupTime() const {
+    return m_wakeup_ns;
+}
+
+uint32_t CycleScheduler::Period() const {
+    return m_period_ns;
+}
+
+uint64_t CycleScheduler::Skipped() const {
+    return m_skipped;
+}
+
+uint64_t CycleScheduler::Now() {
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * kNsPerSec + ts.tv_nsec;
+}
+
+void CycleScheduler::sleep_until(uint64_t time_ns) {
+    const timespec ts = ns2timespec(time_ns);
+    // При прерывании сигналом продолжаем спать до того же абсолютного времени
+    while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+DcDriftCompensator::DcDriftCompensator(uint32_t period_ns)
+    : m_max_step_ns(std::max<int64_t>(period_ns / 1000, 1))
+    , m_diff_sum_ns(0)
+    , m_diff_count(0)
+    , m_total_adjust_ns(0)
+{}
+
+int64_t DcDriftCompensator::Update(uint64_t prev_app_time, uint32_t lo_ref_time) {
+    // Разность младших 32 бит корректна при переполнении, если часы расходятся менее чем на ~2 с
+    const int32_t diff_ns = static_cast<int32_t>(lo_ref_time - static_cast<uint32_t>(prev_app_time));
+    m_diff_sum_ns += diff_ns;
+    ++m_diff_count;
+
+    if (m_diff_count < kFilterCycles) {
+        return 0;
+    }
+
+    const int64_t avg_diff_ns = m_diff_sum_ns / m_diff_count;
+    m_diff_sum_ns = 0;
+    m_diff_count = 0;
+
+    const int64_t step_ns = std::max(-m_max_step_ns, std::min(m_max_step_ns, avg_diff_ns));
+    m_total_adjust_ns += step_ns;
+
+    return step_ns;
+}
+
+int64_t DcDriftCompensator::TotalAdjust() const {
+    return m_total_adjust_ns;
+}
+
+constexpr double DcBusShiftController::kProportionalGain;
+constexpr double DcBusShiftController::kIntegralGain;
+
+DcBusShiftController::DcBusShiftController(uint32_t period_ns)
+    : m_max_step_ns(std::max(period_ns / 100.0, 1.0))
+    , m_integral_ns(0.0)
+    , m_residue_ns(0.0)
+    , m_error_ns(0)
+{}
+
+int64_t DcBusShiftController::Update(uint64_t prev_app_time, uint32_t lo_ref_time) {
+    // Разность младших 32 бит корректна при переполнении, если часы расходятся менее чем на ~2 с
+    m_error_ns = static_cast<int32_t>(lo_ref_time - static_cast<uint32_t>(prev_app_time));
+
+    // Интеграл ограничен, чтобы после большого начального рассогласования не было длительного перерегулирования
+    m_integral_ns = std::max(-m_max_step_ns, std::min(m_max_step_ns, m_integral_ns + kIntegralGain * m_error_ns));
+    const double step_ns = std::max(-m_max_step_ns, std::min(m_max_step_ns, kProportionalGain * m_error_ns + m_integral_ns))
+                           + m_residue_ns;
+
+    const int64_t step = static_cast<int64_t>(std::llround(step_ns));
+    m_residue_ns = step_ns - step;
+    return step;
+}
+
+int32_t DcBusShiftController::Error() const {
+    return m_error_ns;
+}
+
+} // namespaces
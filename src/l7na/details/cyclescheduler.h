@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+
+#include "l7na/types.h"
+
+namespace Drives {
+
+/*! @brief Планировщик циклов потока обмена.
+ *
+ *  Пробуждения выполняются по абсолютному времени CLOCK_MONOTONIC (clock_nanosleep с TIMER_ABSTIME),
+ *  поэтому коррекции системного времени (NTP) не влияют на период. Опционально последние spin_ns
+ *  перед пробуждением поток ожидает в активном цикле, что уменьшает разброс задержки пробуждения.
+ *  Пробуждения, время которых прошло до вызова WaitNext, обрабатываются по политике OverrunPolicy.
+ */
+class CycleScheduler {
+public:
+    /*! @param  period_ns   Период цикла [наносекунды]
+     *  @param  spin_ns     Длительность активного ожидания перед пробуждением [наносекунды], 0 - не использовать
+     *  @param  policy      Поведение после опоздания
+     */
+    CycleScheduler(uint32_t period_ns, uint32_t spin_ns, OverrunPolicy policy = OVERRUN_POLICY_CATCH_UP);
+
+    //! @brief Начинает отсчет циклов от текущего момента.
+    void Start();
+
+    /*! @brief Начинает отсчет циклов от заданного момента.
+     *
+     *  @param  start_ns    Время начала отсчета [наносекунды CLOCK_MONOTONIC], может быть в прошлом
+     */
+    void Start(uint64_t start_ns);
+
+    /*! @brief Ожидает начала следующего цикла.
+     *
+     *  Если время пробуждения уже прошло, при OVERRUN_POLICY_CATCH_UP возвращается немедленно, при
+     *  OVERRUN_POLICY_SKIP прошедшие периоды пропускаются и ожидается ближайший следующий (см. Skipped()).
+     *
+     *  @return Запланированное время пробуждения [наносекунды CLOCK_MONOTONIC]
+     */
+    uint64_t WaitNext();
+
+    /*! @brief Сдвигает фазу следующих пробуждений (коррекция дрейфа относительно референсных часов DC).
+     *
+     *  @param  shift_ns    Сдвиг [наносекунды], положительный - пробуждаться позже
+     */
+    void AdjustPhase(int64_t shift_ns);
+
+    //! @brief Запланированное время последнего пробуждения [наносекунды CLOCK_MONOTONIC]
+    uint64_t WakeupTime() const;
+
+    uint32_t Period() const;
+
+    //! @brief Количество периодов, пропущенных последним вызовом WaitNext (OVERRUN_POLICY_SKIP)
+    uint64_t Skipped() const;
+
+    //! @brief Текущее время CLOCK_MONOTONIC [наносекунды]
+    static uint64_t Now();
+
+private:
+    static void sleep_until(uint64_t time_ns);
+
+    const uint32_t  m_period_ns;
+    const uint32_t  m_spin_ns;
+    const OverrunPolicy m_policy;
+    uint64_t        m_wakeup_ns;        //!< Время последнего запланированного пробуждения
+    int64_t         m_phase_shift_ns;   //!< Еще не примененный сдвиг фазы
+    uint64_t        m_skipped;          //!< Периоды, пропущенные последним WaitNext
+};
+
+/*! @brief Оценка дрейфа между часами хоста и референсными часами DC.
+ *
+ *  Накапливает разность младших 32 бит application time, отправленного в предыдущем цикле,
+ *  и времени референсных часов, полученного в текущем. Раз в kFilterCycles циклов выдает
+ *  ограниченную по величине коррекцию, которую нужно применить к фазе пробуждений и к application time.
+ */
+class DcDriftCompensator {
+public:
+    DcDriftCompensator(uint32_t period_ns);
+
+    /*! @brief Учитывает очередное измерение.
+     *
+     *  @param  prev_app_time   Application time, отправленный в предыдущем цикле [наносекунды]
+     *  @param  lo_ref_time     Младшие 32 бита времени референсных часов [наносекунды]
+     *
+     *  @return Коррекция [наносекунды], 0 - пока коррекция не требуется
+     */
+    int64_t Update(uint64_t prev_app_time, uint32_t lo_ref_time);
+
+    //! @brief Накопленная с начала работы коррекция [наносекунды]
+    int64_t TotalAdjust() const;
+
+private:
+    constexpr static uint32_t kFilterCycles = 256;
+
+    const int64_t   m_max_step_ns;      //!< Максимальная коррекция за одно окно фильтра
+    int64_t         m_diff_sum_ns;
+    uint32_t        m_diff_count;
+    int64_t         m_total_adjust_ns;
+};
+
+/*! @brief ПИ-регулятор application time по референсным часам DC (DC_SYNC_BUS_SHIFT).
+ *
+ *  Каждый цикл сравнивает application time, отправленный в предыдущем цикле, с временем референсных часов,
+ *  полученным в текущем, и выдает коррекцию, которую нужно применить к application time и (с обратным
+ *  знаком) к фазе пробуждений. Интегральная составляющая компенсирует постоянное расхождение частот часов:
+ *  в установившемся режиме коррекция равна дрейфу за цикл, а рассогласование стремится к нулю.
+ */
+class DcBusShiftController {
+public:
+    DcBusShiftController(uint32_t period_ns);
+
+    /*! @brief Учитывает очередное измерение.
+     *
+     *  @param  prev_app_time   Application time, отправленный в предыдущем цикле [наносекунды]
+     *  @param  lo_ref_time     Младшие 32 бита времени референсных часов [наносекунды]
+     *
+     *  @return Коррекция [наносекунды], положительная - референсные часы впереди
+     */
+    int64_t Update(uint64_t prev_app_time, uint32_t lo_ref_time);
+
+    //! @brief Рассогласование в последнем измерении [наносекунды]
+    int32_t Error() const;
+
+private:
+    constexpr static double kProportionalGain = 0.1;
+    constexpr static double kIntegralGain = 0.005;
+
+    const double    m_max_step_ns;      //!< Максимальная коррекция за цикл
+    double          m_integral_ns;
+    double          m_residue_ns;       //!< Дробная часть коррекции, переносимая в следующий цикл
+    int32_t         m_error_ns;
+};
+
+} // namespaces
@@ -0,0 +1,157 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+
+#include "l7na/daemon.h"
+#include "l7na/exceptions.h"
+#include "l7na/logger.h"
+#include "cyclescheduler.h"
+
+namespace Drives {
+
+DECLARE_EXCEPTION(Exception, common::Exception);
+
+namespace {
+
+/*! @brief Существующий объект shm_name используется: это область демона, процесс которого (owner_pid) жив,
+ *  или объект не является областью демона. Исчезнувший объект не используется.
+ */
+bool shm_in_use(const std::string& shm_name, int32_t* owner_pid) {
+    const int fd = ::shm_open(shm_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return errno != ENOENT;
+    }
+
+    bool in_use = true;
+    struct stat st;
+    if (! ::fstat(fd, &st) && st.st_size >= static_cast<off_t>(sizeof(ShmRegion))) {
+        void* data = ::mmap(NULL, sizeof(ShmRegion), PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED != data) {
+            const ShmRegion* region = static_cast<const ShmRegion*>(data);
+            if (! std::memcmp(region->magic, kShmRegionMagic, sizeof(region->magic))) {
+                *owner_pid = region->daemon_pid;
+                in_use = *owner_pid > 0 && (! ::kill(*owner_pid, 0) || EPERM == errno);
+            }
+            ::munmap(data, sizeof(ShmRegion));
+        }
+    }
+    ::close(fd);
+    return in_use;
+}
+
+} // namespace
+
+Daemon::Daemon(Control& control, const std::string& shm_name, uint32_t period_ns)
+    : m_control(control)
+    , m_shm_name(shm_name)
+    , m_period_ns(period_ns)
+    , m_region(NULL)
+    , m_commands(0)
+    , m_stop(false)
+    , m_thread()
+{
+    if (! period_ns) {
+        BOOST_THROW_EXCEPTION(Exception("Invalid daemon period: 0"));
+    }
+
+    // Область, с которой работают другой демон и его клиенты, не пересоздается: забирается только область
+    // остановившегося демона
+    int fd = ::shm_open(m_shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0 && EEXIST == errno) {
+        int32_t owner_pid = 0;
+        if (shm_in_use(m_shm_name, &owner_pid)) {
+            BOOST_THROW_EXCEPTION(Exception("Shared memory ") << m_shm_name << " is in use by running daemon, pid="
+                                  << owner_pid << " (0 - not a daemon region)");
+        }
+        LOG_WARN("Taking over shared memory " << m_shm_name << " of stopped daemon, pid=" << owner_pid);
+        ::shm_unlink(m_shm_name.c_str());
+        fd = ::shm_open(m_shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+    }
+    if (fd < 0) {
+        BOOST_THROW_EXCEPTION(Exception("Failed to create shared memory ") << m_shm_name << ": " << errno);
+    }
+    if (::ftruncate(fd, sizeof(ShmRegion))) {
+        const int err = errno;
+        ::close(fd);
+        ::shm_unlink(m_shm_name.c_str());
+        BOOST_THROW_EXCEPTION(Exception("Failed to allocate shared memory ") << m_shm_name << ": " << err);
+    }
+    void* data = ::mmap(NULL, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int err = errno;
+    ::close(fd);
+    if (MAP_FAILED == data) {
+        ::shm_unlink(m_shm_name.c_str());
+        BOOST_THROW_EXCEPTION(Exception("Failed to map shared memory ") << m_shm_name << ": " << err);
+    }
+
+    std::memset(data, 0, sizeof(ShmRegion));
+    m_region = static_cast<ShmRegion*>(data);
+    m_region->version = kShmRegionVersion;
+    m_region->region_size = sizeof(ShmRegion);
+    m_region->cycle_period_ns = m_period_ns;
+    m_region->daemon_pid = ::getpid();
+    ShmInitCommands(*m_region);
+    ShmStoreStatus(*m_region, m_control.GetStatusCopy(), m_control.GetCycleTimeInfo());
+    m_region->heartbeat.store(CycleScheduler::Now(), std::memory_order_relaxed);
+    // Сигнатура записывается последней: клиент, проверивший ее, видит подготовленную область
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_region->magic, kShmRegionMagic, sizeof(m_region->magic));
+
+    m_thread.reset(new std::thread(std::bind(&Daemon::serve_loop, this)));
+    LOG_INFO("Daemon serving shared memory " << m_shm_name << " every " << m_period_ns << " ns");
+}
+
+Daemon::~Daemon() {
+    m_stop.store(true, std::memory_order_release);
+    if (m_thread) {
+        m_thread->join();
+    }
+    ::munmap(m_region, sizeof(ShmRegion));
+    ::shm_unlink(m_shm_name.c_str());
+    LOG_INFO("Daemon stopped after " << m_commands.load(std::memory_order_relaxed) << " commands");
+}
+
+uint64_t Daemon::CommandCount() const {
+    return m_commands.load(std::memory_order_acquire);
+}
+
+void Daemon::serve_loop() {
+    CycleScheduler scheduler(m_period_ns, 0, OVERRUN_POLICY_SKIP);
+    scheduler.Start();
+    while (! m_stop.load(std::memory_order_acquire)) {
+        // Команды выполняются до публикации: статус сразу отражает принятые команды
+        execute_commands();
+        ShmStoreStatus(*m_region, m_control.GetStatusCopy(), m_control.GetCycleTimeInfo());
+        m_region->heartbeat.store(CycleScheduler::Now(), std::memory_order_release);
+        scheduler.WaitNext();
+    }
+}
+
+uint32_t Daemon::execute_commands() {
+    uint32_t count = 0;
+    ShmCommand command;
+    // Не больше одного кольца за период: поток клиентов не задерживает публикацию статуса
+    for (uint64_t id = 0; count < kShmCommandCapacity && (id = ShmPopCommand(*m_region, &command)); ++count) {
+        bool ok = false;
+        if (command.axis < AXIS_MIN || command.axis >= AXIS_MAX_COUNT) {
+            LOG_WARN("Daemon: invalid axis " << command.axis << " in command #" << id);
+        } else if (SHM_COMMAND_RUN == command.type) {
+            ok = m_control.SetModeRun(command.axis, command.pos, command.vel);
+        } else if (SHM_COMMAND_IDLE == command.type) {
+            ok = m_control.SetModeIdle(command.axis);
+        } else {
+            LOG_WARN("Daemon: unknown command type " << command.type << " in command #" << id);
+        }
+        ShmStoreResult(*m_region, id, ok);
+    }
+    m_commands.fetch_add(count, std::memory_order_release);
+    return count;
+}
+
+} // namespaces
@@ -1,30 +1,66 @@
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <alloca.h>
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <chrono>
 #include <functional>
 #include <algorithm>
 #include <map>
-#include <list>
+#include <sstream>
 #include <atomic>
+#include <future>
+#include <fstream>
+#include <vector>
+#include <limits>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/memory_order.hpp>
-#include <boost/thread/thread.hpp>
 #include <boost/chrono/chrono.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/log/attributes/current_thread_id.hpp>
+#include <boost/log/attributes/value_extraction.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/make_shared.hpp>
 
 #include "ecrt.h"
 
 #include "l7na/drives.h"
+#include "l7na/daemon.h"
+#include "l7na/client.h"
 #include "l7na/logger.h"
 #include "l7na/exceptions.h"
 #include "types_int.h"
 #include "axisparams.h"
+#include "seqlock.h"
+#include "spscring.h"
+#include "cyclescheduler.h"
+#include "histogram.h"
+#include "movemodetable.h"
+#include "pdolayout.h"
+#include "conversions.h"
+#include "trajectory.h"
+#include "recorder.h"
+#include "pdopublisher.h"
+#include "ecbackend.h"
+#include "benchmark.h"
+#include "mailbox.h"
 
 /*! @todo
  *  1. Failed to get reference clock time
@@ -37,57 +73,122 @@ namespace Drives {
 
 namespace fs = boost::filesystem;
 
-typedef boost::chrono::system_clock SysClock;
-
 DECLARE_EXCEPTION(Exception, common::Exception);
 DECLARE_EXCEPTION(TestFailedException, common::Exception);
 
 AxisStatus::AxisStatus()
-    : tgt_pos_deg(0.0)
-    , cur_pos_deg(0.0)
-    , dmd_pos_deg(0.0)
-    , tgt_vel_deg(0.0)
-    , cur_vel_deg(0.0)
-    , dmd_vel_deg(0.0)
-    , cur_pos_abs(0)
+    : cur_pos_abs(0)
     , cur_pos(0)
     , dmd_pos(0)
     , tgt_pos(0)
     , cur_vel(0)
     , dmd_vel(0)
     , tgt_vel(0)
-    , cur_torq(0)
+    , following_error(0)
+    , pos_offset(0)
     , state(AxisState::AXIS_OFF)
+    , cur_torq(0)
     , error_code(0)
     , cur_temperature(0)
     , ctrlword(0)
     , statusword(0)
     , mode(0)
+    , signed_pos_deg(false)
+    , params_pending(false)
+    , params_failures(0)
+    , traj_buffered(0)
+    , traj_underruns(0)
+    , traj_lookahead_ns(0)
 {}
 
+double AxisStatus::TgtPosDeg() const {
+    return PosPulse2Deg(tgt_pos - pos_offset, signed_pos_deg);
+}
+
+double AxisStatus::CurPosDeg() const {
+    return PosPulse2Deg(cur_pos - pos_offset, signed_pos_deg);
+}
+
+double AxisStatus::DmdPosDeg() const {
+    return PosPulse2Deg(dmd_pos - pos_offset, signed_pos_deg);
+}
+
+double AxisStatus::TgtVelDeg() const {
+    return VelPulse2Deg(tgt_vel);
+}
+
+double AxisStatus::CurVelDeg() const {
+    return VelPulse2Deg(cur_vel);
+}
+
+double AxisStatus::DmdVelDeg() const {
+    return VelPulse2Deg(dmd_vel);
+}
+
 bool AxisStatus::IsReady() const {
-    return state == AxisState::AXIS_IDLE || state == AxisState::AXIS_SCAN || state == AxisState::AXIS_POINT || state == AxisState::AXIS_ERROR;
+    return state == AxisState::AXIS_IDLE || state == AxisState::AXIS_SCAN || state == AxisState::AXIS_POINT
+           || state == AxisState::AXIS_TRACK || state == AxisState::AXIS_ERROR;
 }
 
 SystemStatus::SystemStatus() noexcept
-    : state(SystemState::SYSTEM_OFF)
+    : axis_count(0)
+    , pdo_layout(0)
+    , state(SystemState::SYSTEM_OFF)
     , reftime(0)
     , apptime(0)
     , dcsync(0)
+    , init_stage(INIT_STAGE_NONE)
+    , init_sdo_total(0)
+    , init_sdo_done(0)
+    , init_sdo_skipped(0)
+    , watchdog_trips(0)
 {}
 
 class Control::Impl {
 public:
     ~Impl() {
+        m_stop_flag.store(true, std::memory_order_relaxed);
+
+        // Поток инициализации мог запустить поток обмена: ждем его первым
+        if (m_init_thread) {
+            m_init_thread->join();
+            m_init_thread.reset();
+        }
+
         if (m_thread) {
-            m_stop_flag.store(true, std::memory_order_relaxed);
             m_thread->join();
             m_thread.reset();
         }
 
+        if (m_watchdog_thread) {
+            {
+                std::lock_guard<std::mutex> guard(m_watchdog_mutex);
+            }
+            m_watchdog_cv.notify_all();
+            m_watchdog_thread->join();
+            m_watchdog_thread.reset();
+        }
+
+        // Диспетчер доставляет оставшиеся события и завершается
+        if (m_event_thread) {
+            signal_event_fd();
+            m_event_thread->join();
+            m_event_thread.reset();
+        }
+        if (m_event_fd >= 0) {
+            ::close(m_event_fd);
+        }
+
+        // Дописываем очередь записи циклов
+        m_recorder.Close();
+        m_pdo_image.Close();
+
+        // Инициализация могла не завершиться (остановка во время ожидания OP)
+        finish_init(false);
+
         // Освобождаем мастер-объект
         if (m_master) {
-            ecrt_release_master(m_master);
+            m_ec.release_master(m_master);
             LOG_INFO("Master released");
         }
     }
@@ -95,80 +196,219 @@ public:
 protected:
     friend class Control;
 
-    Impl(const Config::Storage& config, const ParamsMode params_mode)
+    Impl(const Config::Storage& config, const ParamsMode params_mode, const ControlOptions& options)
         : m_config(config)
+        , m_options(resolve_options(options))
+        , m_axis_count(std::min<size_t>(options.slaves.size(), AXIS_MAX_COUNT))
+        , m_decode_fast_pdo(SelectFastPdoDecoder(options.pdo_layout))
+        , m_ec(SelectEcBackend(options.backend))
+        , m_app_time_offset_ns(0)
         , m_sdo_cfg()
         , m_sys_info{}
-        , m_sys_status{}
+        , m_sys_status()
+        , m_timing_info()
+        , m_histogram()
+        , m_timing_reset_request(false)
+        , m_histogram_reset_request(false)
         , m_stop_flag(false)
         , m_thread()
+        , m_init_thread()
+        , m_init_promise()
+        , m_init_future(m_init_promise.get_future().share())
+        , m_init_finished(false)
+        , m_init_sdo_total(0)
+        , m_init_sdo_done(0)
+        , m_init_sdo_skipped(0)
         , m_master(NULL)
-        , m_domain(NULL)
-        , m_domain_data(NULL)
+        , m_mailbox(m_ec)
+        , m_events()
+        , m_events_dropped(0)
+        , m_events_dropped_seen(0)
+        , m_events_pending(0)
+        , m_event_mask(0)
+        , m_event_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        , m_event_thread()
+        , m_subs()
+        , m_next_sub_id(1)
+        , m_heartbeat(0)
+        , m_watchdog_request(false)
+        , m_watchdog_thread()
     {
         m_move_modes[AZIMUTH_AXIS] = kAzimAutoMoveModeMap;
         m_move_modes[ELEVATION_AXIS] = kElevAutoMoveModeMap;
 
-        std::memset(m_pos_abs_usr_off, 0, AXIS_COUNT * sizeof(decltype(m_pos_abs_usr_off[0])));
-        std::memset(m_pos_abs_rel_off, 0, AXIS_COUNT * sizeof(decltype(m_pos_abs_rel_off[0])));
-
-        for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-            m_params_mode[axis] = params_mode;
-            m_cur_move_mode[axis] = kMoveModeInvalid;
+        std::fill(std::begin(m_domains), std::end(m_domains), static_cast<ec_domain_t*>(NULL));
+        std::fill(std::begin(m_domain_data), std::end(m_domain_data), static_cast<uint8_t*>(NULL));
+        std::memset(m_domain_state, 0, sizeof(m_domain_state));
+        m_record_fast_size = 0;
+        std::memset(&m_diag, 0, sizeof(m_diag));
+        m_record_slow_size = 0;
+
+        std::memset(m_pos_abs_usr_off, 0, AXIS_MAX_COUNT * sizeof(decltype(m_pos_abs_usr_off[0])));
+        std::memset(m_pos_abs_rel_off, 0, AXIS_MAX_COUNT * sizeof(decltype(m_pos_abs_rel_off[0])));
+
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            m_params_mode[axis].store(params_mode, std::memory_order_relaxed);
+            m_cur_move_mode[axis].store(kMoveModeInvalid, std::memory_order_relaxed);
+            m_params_txn_aborts[axis].store(0, std::memory_order_relaxed);
+            m_params_txn_aborts_seen[axis] = 0;
+            m_track_active[axis] = false;
+            m_traj_last_time_ns[axis] = 0;
+            m_traj_last_pos[axis] = 0;
+            m_traj_last_epoch[axis] = 0;
+            m_traj_epoch[axis] = 0;
+            m_traj_cleared_epoch[axis].store(0, std::memory_order_relaxed);
+            m_fault_event_pending[axis] = false;
+            m_fault_event_time_ns[axis] = 0;
+            m_cycles_cmd_start[axis] = 0;
         }
+        m_cycles_cur = 0;
 
         try {
+            if (m_options.slaves.empty() || m_options.slaves.size() > AXIS_MAX_COUNT) {
+                BOOST_THROW_EXCEPTION(Exception("Axis count must be in [1, ") << static_cast<int32_t>(AXIS_MAX_COUNT)
+                                      << "]: " << m_options.slaves.size());
+            }
+            if (m_options.cycle_period_ns < kMinCyclePeriodNs) {
+                BOOST_THROW_EXCEPTION(Exception("Cycle period is too small: ") << m_options.cycle_period_ns << " ns");
+            }
+            if (m_options.pdo_layout & ~static_cast<uint32_t>(PDO_LAYOUT_ALL)) {
+                BOOST_THROW_EXCEPTION(Exception("Unknown PDO layout flags: 0x") << std::hex << m_options.pdo_layout);
+            }
+            if (m_event_fd < 0) {
+                BOOST_THROW_EXCEPTION(Exception("Unable to create event fd: ") << errno);
+            }
+            if (! m_options.slow_pdo_divider) {
+                BOOST_THROW_EXCEPTION(Exception("Slow PDO divider must be positive"));
+            }
+            if (! m_options.ref_clock_sync_divider) {
+                BOOST_THROW_EXCEPTION(Exception("Reference clock sync divider must be positive"));
+            }
+            if (static_cast<uint32_t>(m_options.sync0_shift_ns) >= m_options.cycle_period_ns) {
+                BOOST_THROW_EXCEPTION(Exception("SYNC0 shift must be in [0, cycle period): ") << m_options.sync0_shift_ns << " ns");
+            }
+
+            const TrackLimits& track_limits = m_options.track_limits;
+            if (! (track_limits.max_vel_deg > 0.0 && track_limits.max_acc_deg > 0.0 && track_limits.max_jerk_deg > 0.0)) {
+                BOOST_THROW_EXCEPTION(Exception("Track limits must be positive: vel=") << track_limits.max_vel_deg
+                                      << " acc=" << track_limits.max_acc_deg << " jerk=" << track_limits.max_jerk_deg);
+            }
+            for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+                m_trackers[axis].Configure({ track_limits.max_vel_deg * kPulsesPerDegree
+                                             , track_limits.max_acc_deg * kPulsesPerDegree
+                                             , track_limits.max_jerk_deg * kPulsesPerDegree },
+                                           m_options.cycle_period_ns / 1e9);
+            }
+
+            const MailboxBudget& mailbox_budget = m_options.mailbox_budget;
+            if (! mailbox_budget.per_slave || mailbox_budget.per_slave > MailboxScheduler::kMaxOutstandingPerSlave
+                    || ! mailbox_budget.per_cycle) {
+                BOOST_THROW_EXCEPTION(Exception("Mailbox budget must be positive, per slave at most ")
+                                      << MailboxScheduler::kMaxOutstandingPerSlave << ": per_slave="
+                                      << mailbox_budget.per_slave << " per_cycle=" << mailbox_budget.per_cycle);
+            }
+            m_mailbox.Configure(m_axis_count, mailbox_budget);
+
+            for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+                const std::vector<DiagRegister>& diagnostics = m_options.slaves[axis].diagnostics;
+                if (diagnostics.size() > kMaxDiagRegisters) {
+                    BOOST_THROW_EXCEPTION(Exception("Too many diagnostic registers for axis ") << axis << ": "
+                                          << diagnostics.size() << " > " << kMaxDiagRegisters);
+                }
+                for (const DiagRegister& reg: diagnostics) {
+                    if ((1 != reg.size && 2 != reg.size && 4 != reg.size) || ! reg.period_ms) {
+                        BOOST_THROW_EXCEPTION(Exception("Invalid diagnostic register 0x") << std::hex << reg.index
+                                              << ":" << static_cast<uint32_t>(reg.subindex) << std::dec
+                                              << " for axis " << axis << ": size=" << static_cast<uint32_t>(reg.size)
+                                              << " period=" << reg.period_ms << " ms");
+                    }
+                }
+            }
+
+            // Статус этапа конфигурации: при ошибке конструктора он показывает, на каком этапе она произошла
+            SystemStatus init_status;
+            init_status.state = SystemState::SYSTEM_INIT;
+            init_status.init_stage = INIT_STAGE_SLAVE_CONFIG;
+            init_status.axis_count = m_axis_count;
+            init_status.pdo_layout = m_options.pdo_layout;
+            for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+                init_status.axes[axis].state = AxisState::AXIS_INIT;
+            }
+            m_sys_status.Store(init_status);
+
             // Создаем мастер-объект
-            m_master = ecrt_request_master(0);
+            m_master = m_ec.request_master(0);
 
             if (m_master) {
                 LOG_INFO("Master requested");
             } else {
                 BOOST_THROW_EXCEPTION(Exception("Unable to request master"));
             }
+            if (EC_BACKEND_SIM == m_options.backend) {
+                SimConfigureMaster(m_master, m_options.sim, m_options.cycle_period_ns);
+                LOG_INFO("Using simulated slaves");
+            }
 
-            // Создаем объект для обмена PDO в циклическом режиме.
-            m_domain = ecrt_master_create_domain(m_master);
-
-            if (m_domain) {
-                LOG_INFO("Process data domain created");
-            } else {
-                BOOST_THROW_EXCEPTION(Exception("Unable to create process data domain"));
+            // Создаем объекты для обмена PDO в циклическом режиме: быстрый домен и медленный домен диагностики.
+            for (int32_t domain = 0; domain < kDomainCount; ++domain) {
+                m_domains[domain] = m_ec.master_create_domain(m_master);
+                if (! m_domains[domain]) {
+                    BOOST_THROW_EXCEPTION(Exception("Unable to create process data domain #") << domain);
+                }
             }
 
+            LOG_INFO("Process data domains (" << static_cast<int32_t>(kDomainCount) << ") created");
+
             // Создаем объекты конфигурации подчиненных.
-            for (uint32_t d = 0; d < AXIS_COUNT; ++d) {
-                m_slave_cfg[d] = ecrt_master_slave_config(m_master, 0, d, 0x00007595, 0x00000000);
+            for (int32_t d = 0; d < m_axis_count; ++d) {
+                const SlaveConfig& slave = m_options.slaves[d];
+                m_slave_cfg[d] = m_ec.master_slave_config(m_master, slave.alias, slave.position, slave.vendor_id, slave.product_code);
             }
 
             bool all_slave_configs_ok = true;
-            for (uint32_t d = 0; d < AXIS_COUNT; ++d) {
-                all_slave_configs_ok |= (m_slave_cfg[d] != NULL);
+            for (int32_t d = 0; d < m_axis_count; ++d) {
+                all_slave_configs_ok &= (m_slave_cfg[d] != NULL);
             }
 
             if (all_slave_configs_ok) {
-                LOG_INFO("Slave configuration objects (" << AXIS_COUNT << ") created");
+                LOG_INFO("Slave configuration objects (" << m_axis_count << ") created");
             } else {
                 BOOST_THROW_EXCEPTION(Exception("Failed to create some slave configuration"));
             }
 
+            // SDO-запросы мастера адресуются абсолютной позицией в кольце, а не парой алиас/смещение
+            for (int32_t d = 0; d < m_axis_count; ++d) {
+                m_slave_ring_pos[d] = resolve_ring_position(d);
+            }
+
             // Конфигурируем PDO подчиненных
-            // TxPDO
-            ec_pdo_entry_info_t l7na_tx_channel[] = {
+            // TxPDO: данные для управления. Состав зависит от раскладки PDO
+            std::vector<ec_pdo_entry_info_t> l7na_tx_channel = {
                 {0x6041, 0, 16},    // Statusword
                 {0x6060, 0, 8},     // Actual mode of operation
                 {0x607A, 0, 32},    // Target position value
-                {0x6062, 0, 32},    // Demand position value
                 {0x6064, 0, 32},    // Actual position value
+                {0x606C, 0, 32},    // Actual velocity value
+            };
+            if (m_options.pdo_layout & PDO_LAYOUT_DEMAND) {
+                l7na_tx_channel.push_back({0x6062, 0, 32});    // Demand position value
+                l7na_tx_channel.push_back({0x606B, 0, 32});    // Demand velocity Value
+            }
+            if (m_options.pdo_layout & PDO_LAYOUT_FOLLOWING_ERROR) {
+                l7na_tx_channel.push_back({0x60F4, 0, 32});    // Following error actual value
+            }
+
+            // TxPDO: диагностика
+            ec_pdo_entry_info_t l7na_tx_diag_channel[] = {
                 {0x260D, 0, 32},    // Actual position value (absolute)
                 {0x603F, 0, 16},    // Error code
-                {0x606B, 0, 32},    // Demand velocity Value
-                {0x606C, 0, 32},    // Actual velocity value
                 {0x6077, 0, 16},    // Actual torque value
+                {0x2610, 0, 16},    // Drive temperature
             };
 
             ec_pdo_info_t l7na_tx_pdos[] = {
-                {0x1A00, sizeof(l7na_tx_channel)/sizeof(l7na_tx_channel[0]), l7na_tx_channel}
+                {0x1A00, static_cast<unsigned int>(l7na_tx_channel.size()), l7na_tx_channel.data()}
+                , {0x1A01, sizeof(l7na_tx_diag_channel)/sizeof(l7na_tx_diag_channel[0]), l7na_tx_diag_channel}
             };
 
             // RxPDO
@@ -188,62 +428,69 @@ protected:
             // { 0xFF - end marker}
             ec_sync_info_t l7na_syncs[] = {
                 {2, EC_DIR_OUTPUT, 1, l7na_rx_pdos, EC_WD_DISABLE},
-                {3, EC_DIR_INPUT, 1, l7na_tx_pdos, EC_WD_DISABLE},
+                {3, EC_DIR_INPUT, 2, l7na_tx_pdos, EC_WD_DISABLE},
                 {0xFF}
             };
 
             // Конфиугурируем PDO для подчиненных
-            for (uint32_t d = AXIS_MIN; d < AXIS_COUNT; ++d) {
-                if (ecrt_slave_config_pdos(m_slave_cfg[d], EC_END, l7na_syncs)) {
+            for (int32_t d = AXIS_MIN; d < m_axis_count; ++d) {
+                if (m_ec.slave_config_pdos(m_slave_cfg[d], EC_END, l7na_syncs)) {
                     BOOST_THROW_EXCEPTION(Exception("Failed to configure slave #") << d << " pdos");
                 }
             }
 
             LOG_INFO("Configuring slave PDOs and sync managers done");
 
-            static const ec_pdo_entry_reg_t kDomainPDOs[] = {
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x6040, 0, &m_offrw_ctrl[ELEVATION_AXIS]},        //!< Control word
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x6041, 0, &m_offro_status[ELEVATION_AXIS]},      //!< Status word
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x607A, 0, &m_offrw_tgt_pos[ELEVATION_AXIS]},     //!< Target position
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x6062, 0, &m_offro_dmd_pos[ELEVATION_AXIS]},     //!< Demand position
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x6064, 0, &m_offro_act_pos[ELEVATION_AXIS]},     //!< Actual position
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x60FF, 0, &m_offrw_tgt_vel[ELEVATION_AXIS]},     //!< Target velocity
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x606B, 0, &m_offro_dmd_vel[ELEVATION_AXIS]},     //!< Demand velocity
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x606C, 0, &m_offro_act_vel[ELEVATION_AXIS]},     //!< Actual velocity
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x260D, 0, &m_offro_act_pos_abs[ELEVATION_AXIS]}, //!< Actual position (absolute)
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x6060, 0, &m_offrw_act_mode[ELEVATION_AXIS]},    //!< Actual drive mode of operation
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x6077, 0, &m_offro_act_torq[ELEVATION_AXIS]},    //!< Actual torque
-                {0, ELEVATION_AXIS, 0x00007595, 0x00000000, 0x603F, 0, &m_offro_err_code[ELEVATION_AXIS]},    //!< Error code
-
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x6040, 0, &m_offrw_ctrl[AZIMUTH_AXIS]},          //!< Control word
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x6041, 0, &m_offro_status[AZIMUTH_AXIS]},        //!< Status word
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x607A, 0, &m_offrw_tgt_pos[AZIMUTH_AXIS]},       //!< Target position
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x6062, 0, &m_offro_dmd_pos[AZIMUTH_AXIS]},       //!< Demand position
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x6064, 0, &m_offro_act_pos[AZIMUTH_AXIS]},       //!< Actual position
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x60FF, 0, &m_offrw_tgt_vel[AZIMUTH_AXIS]},       //!< Target velocity
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x606B, 0, &m_offro_dmd_vel[AZIMUTH_AXIS]},       //!< Demand velocity
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x606C, 0, &m_offro_act_vel[AZIMUTH_AXIS]},       //!< Actual velocity
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x260D, 0, &m_offro_act_pos_abs[AZIMUTH_AXIS]},   //!< Actual position (absolute)
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x6060, 0, &m_offrw_act_mode[AZIMUTH_AXIS]},      //!< Actual drive mode of operation
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x6077, 0, &m_offro_act_torq[AZIMUTH_AXIS]},      //!< Actual torque
-                {0, AZIMUTH_AXIS,   0x00007595, 0x00000000, 0x603F, 0, &m_offro_err_code[AZIMUTH_AXIS]},      //!< Error code
-
-                {}
+            static const PdoEntryDesc kDomainPDOs[] = {
+                { kFastDomain, 0, 0x6040, 0, 16, &PdoOffsets::rw_ctrl },                                //!< Control word
+                { kFastDomain, 0, 0x6041, 0, 16, &PdoOffsets::ro_status },                              //!< Status word
+                { kFastDomain, 0, 0x607A, 0, 32, &PdoOffsets::rw_tgt_pos },                             //!< Target position
+                { kFastDomain, PDO_LAYOUT_DEMAND, 0x6062, 0, 32, &PdoOffsets::ro_dmd_pos },             //!< Demand position
+                { kFastDomain, 0, 0x6064, 0, 32, &PdoOffsets::ro_act_pos },                             //!< Actual position
+                { kFastDomain, 0, 0x60FF, 0, 32, &PdoOffsets::rw_tgt_vel },                             //!< Target velocity
+                { kFastDomain, PDO_LAYOUT_DEMAND, 0x606B, 0, 32, &PdoOffsets::ro_dmd_vel },             //!< Demand velocity
+                { kFastDomain, 0, 0x606C, 0, 32, &PdoOffsets::ro_act_vel },                             //!< Actual velocity
+                { kFastDomain, 0, 0x6060, 0, 8, &PdoOffsets::rw_act_mode },                             //!< Actual drive mode of operation
+                { kFastDomain, PDO_LAYOUT_FOLLOWING_ERROR, 0x60F4, 0, 32, &PdoOffsets::ro_follow_err }, //!< Following error
+                { kSlowDomain, 0, 0x260D, 0, 32, &PdoOffsets::ro_act_pos_abs },                         //!< Actual position (absolute)
+                { kSlowDomain, 0, 0x6077, 0, 16, &PdoOffsets::ro_act_torq },                            //!< Actual torque
+                { kSlowDomain, 0, 0x603F, 0, 16, &PdoOffsets::ro_err_code },                            //!< Error code
+                { kSlowDomain, 0, 0x2610, 0, 16, &PdoOffsets::ro_temperature },                         //!< Drive temperature
             };
 
-            // Регистируем PDO в домене
-            if (ecrt_domain_reg_pdo_entry_list(m_domain, kDomainPDOs)) {
-                BOOST_THROW_EXCEPTION(Exception("PDO entries registration failed"));
-            }
+            // Таблицы регистрации строятся по доменам и подчиненным: по записи на каждый объект каждой оси
+            for (int32_t domain = 0; domain < kDomainCount; ++domain) {
+                std::vector<ec_pdo_entry_reg_t> domain_regs;
+                domain_regs.reserve(m_axis_count * (sizeof(kDomainPDOs) / sizeof(kDomainPDOs[0])) + 1);
+                for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+                    const SlaveConfig& slave = m_options.slaves[axis];
+                    for (const PdoEntryDesc& desc: kDomainPDOs) {
+                        if (desc.domain == domain && (desc.layout & m_options.pdo_layout) == desc.layout) {
+                            domain_regs.push_back({ slave.alias, slave.position, slave.vendor_id, slave.product_code,
+                                                    desc.index, desc.subindex, &(m_pdo_off.*desc.offsets)[axis], NULL });
+                        }
+                    }
+                }
+                domain_regs.push_back(ec_pdo_entry_reg_t());
 
-            LOG_INFO("PDO entries registered in domain");
+                // Регистируем PDO в домене
+                if (m_ec.domain_reg_pdo_entry_list(m_domains[domain], domain_regs.data())) {
+                    BOOST_THROW_EXCEPTION(Exception("PDO entries registration failed for domain #") << domain);
+                }
 
-            // Читаем статическую информацию с подчиненных
-            if (! read_system_info()) {
-                BOOST_THROW_EXCEPTION(Exception("Read non-realtime system info failed"));
+                // Описание образа PDO для записи циклов: смещения пока относительно начала домена
+                for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+                    for (const PdoEntryDesc& desc: kDomainPDOs) {
+                        if (desc.domain == domain && (desc.layout & m_options.pdo_layout) == desc.layout) {
+                            const uint16_t offset = (m_pdo_off.*desc.offsets)[axis];
+                            m_record_entries.push_back({ desc.index, desc.subindex, static_cast<uint8_t>(axis), offset,
+                                                         desc.bits, static_cast<uint8_t>(domain) });
+                        }
+                    }
+                }
             }
 
-            LOG_INFO("Static system info read");
+            LOG_INFO("PDO entries registered in domains");
 
             // Создаем sdo_requests для доступа к sdo-данным во время realtime-работы
             if (! create_sdo_requests()) {
@@ -252,72 +499,24 @@ protected:
 
             LOG_INFO("Non-realtime data requests created");
 
-            prerealtime_slave_setup();
-
-            LOG_INFO("Pre-realtime slave setup done");
-
-            // Задаем предполагаемый интервал обмена данными
-            if (ecrt_master_set_send_interval(m_master, kCyclePeriodNs / 1000 /* us required here */)) {
-                BOOST_THROW_EXCEPTION(Exception("Failed to setup master send interval"));
-            }
-
-            ///////////////////////////////////////////////////////////////////
-            // Настраиваем DC-synchronization
-
-            // Выбираем референсные часы
-            if (int err = ecrt_master_select_reference_clock(m_master, m_slave_cfg[0])) {
-                BOOST_THROW_EXCEPTION(Exception("Failed to select reference clock. Error code: ") << err);
-            }
-
-            // Включаем и настраиваем синхронизацию на подчиненных
-            for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-                ecrt_slave_config_dc(m_slave_cfg[axis], 0x300, kCyclePeriodNs, 125000, 0, 0);
-            }
-
-            // Записываем начальное application time
-            supply_app_time();
-
-            ///////////////////////////////////////////////////////////////////
-
-            // "Включаем" мастер-объект
-            if (ecrt_master_activate(m_master)) {
-                BOOST_THROW_EXCEPTION(Exception("Master activation failed"));
-            }
-
-            LOG_INFO("Master activated");
-
-            if (! (m_domain_data = ecrt_domain_data(m_domain)) ) {
-                BOOST_THROW_EXCEPTION(Exception("Domain data initialization failed"));
-            }
-
-            LOG_INFO("Domain data registered");
-
-            m_thread.reset(new std::thread(std::bind(&Impl::CyclicPolling, this)));
-            sched_param param{5};
-            const int ret = ::pthread_setschedparam(m_thread->native_handle(), SCHED_RR, &param);
-            if (! ret) {
-                LOG_WARN("Setup scheduling params for polling thread OK");
-            } else {
-                LOG_WARN("Setup scheduling params for polling thread failed: " << ret);
-            }
+            // Записываем состояние системы до запуска потока инициализации: дальше статус публикуют только потоки
+            init_status.init_stage = INIT_STAGE_SDO_SETUP;
+            m_sys_status.Store(init_status);
 
-            LOG_INFO("Cyclic polling thread started");
+            // Настройка по SDO, активация и запуск потока обмена выполняются асинхронно
+            m_init_thread.reset(new std::thread(std::bind(&Impl::AsyncInit, this)));
 
-            // Записываем состояние системы
-            SystemStatus s;
-            s.state = SystemState::SYSTEM_INIT;
-            s.axes[AZIMUTH_AXIS].state = AxisState::AXIS_INIT;
-            s.axes[ELEVATION_AXIS].state = AxisState::AXIS_INIT;
-            m_sys_status.store(s);
+            LOG_INFO("Initialization thread started");
         } catch (const std::exception& ex) {
             LOG_ERROR(ex.what());
 
             // Записываем сотояние системы
-            SystemStatus s = m_sys_status.load(std::memory_order_acquire);
+            SystemStatus s = m_sys_status.Load();
             s.state = SystemState::SYSTEM_FATAL_ERROR;
             // @todo Возвращать строку ошибки
             // s.error_str = ex.what();
-            m_sys_status.store(s);
+            m_sys_status.Store(s);
+            finish_init(false);
         }
     }
 
@@ -332,7 +531,7 @@ protected:
     }
 
     bool SetModeRun(const Axis& axis, double pos /*deg*/, double vel /*deg/sec*/) {
-        const SystemStatus s = m_sys_status.load(std::memory_order_acquire);
+        const SystemStatus s = m_sys_status.Load();
         if (! is_system_ready(s)) {
             return false;
         }
@@ -341,30 +540,26 @@ protected:
             return false;
         }
 
-        std::list<TXCmd> txcmd_list;
-        MoveMode& axis_cur_move_mode = m_cur_move_mode[axis];
-        const MoveMode axis_old_move_mode = m_cur_move_mode[axis];
-        const MoveModeMap& axis_move_modes = m_move_modes[axis];
-        const ParamsMode& axis_params_mode = m_params_mode[axis];
+        // Сериализуем вызывающие потоки: у очереди команд один писатель
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        TXCmdBatch batch;
+        uint32_t params_txn_aborts = 0;
+        const MoveMode axis_old_move_mode = m_cur_move_mode[axis].load(std::memory_order_relaxed);
+        MoveMode axis_new_move_mode = axis_old_move_mode;
+        const MoveModeTable& axis_move_modes = m_move_mode_tables[axis];
+        const uint32_t old_mode_pos = axis_move_modes.Find(axis_old_move_mode);
+        const ParamsMode axis_params_mode = m_params_mode[axis].load(std::memory_order_relaxed);
 
         if (vel) {
             /* Устанавливаем параметры для движения на постоянной скорости.
              * Для этого выбираем режим с максимальным значением.
              */
             if (PARAMS_MODE_AUTOMATIC == axis_params_mode
-                    && ! axis_move_modes.empty()
-                    && axis_cur_move_mode != axis_move_modes.rbegin()->first) {
-                const AxisParams& params = axis_move_modes.rbegin()->second;
-                TXCmd txcmd(TXCmd::kSetParams);
-                for (const AxisParam& p: params) {
-                    if (kWriteSdoIndices.find(p.index) == kWriteSdoIndices.end()) {
-                        continue;
-                    }
-                    txcmd.param = p;
-                    txcmd_list.push_back(txcmd);
-                }
-
-                axis_cur_move_mode = axis_move_modes.rbegin()->first;
+                    && ! axis_move_modes.Empty()
+                    && old_mode_pos != axis_move_modes.Last()) {
+                params_txn_aborts = push_mode_params(axis, old_mode_pos, axis_move_modes.Last(), batch);
+                axis_new_move_mode = axis_move_modes.ModeAt(axis_move_modes.Last());
             }
 
             TXCmd txcmd(TXCmd::kCmd);
@@ -375,7 +570,7 @@ protected:
             txcmd.tgt_vel = vel_deg2pulse(vel);
             txcmd.tgt_pos = 0;
 
-            txcmd_list.push_back(txcmd);
+            batch.Push(txcmd);
         } else {
             // Current absolute position + user offset [pulses]
             const int32_t cur_pos_usr_pulse = s.axes[axis].cur_pos - m_pos_abs_rel_off[axis] - m_pos_abs_usr_off[axis];
@@ -388,18 +583,10 @@ protected:
 
             // Устанавливаем параметры для движения к указанной точке.
             if (PARAMS_MODE_AUTOMATIC == axis_params_mode) {
-                const MoveMode move_mode = get_move_mode(axis, pos_diff_deg);
-                if (move_mode != kMoveModeInvalid && axis_cur_move_mode != move_mode) {
-                    const AxisParams& params = axis_move_modes.at(move_mode);
-                    TXCmd txcmd(TXCmd::kSetParams);
-                    for (const AxisParam& p: params) {
-                        if (kWriteSdoIndices.find(p.index) == kWriteSdoIndices.end()) {
-                            continue;
-                        }
-                        txcmd.param = p;
-                        txcmd_list.push_back(txcmd);
-                    }
-                    axis_cur_move_mode = move_mode;
+                const uint32_t mode_pos = axis_move_modes.Select(pos_diff_deg);
+                if (mode_pos != MoveModeTable::kInvalidPos && old_mode_pos != mode_pos) {
+                    params_txn_aborts = push_mode_params(axis, old_mode_pos, mode_pos, batch);
+                    axis_new_move_mode = axis_move_modes.ModeAt(mode_pos);
                 }
             }
 
@@ -410,25 +597,244 @@ protected:
             txcmd.ctrlword = 0x2F;
             txcmd.op_mode = OP_MODE_POINT;
 
-            txcmd_list.push_back(txcmd);
+            batch.Push(txcmd);
 
             // Задаем следующую точку для позиционирования
             txcmd.ctrlword = 0x3F;
-            txcmd_list.push_back(txcmd);
+            batch.Push(txcmd);
         }
 
-        // Перемещаем содержимое списка команд в очередь под локом
-        {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            for (TXCmd& cmd: txcmd_list) {
-                m_tx_queues[axis].push_back(std::move(cmd));
+        if (! submit_batch(axis, batch)) {
+            return false;
+        }
+
+        if (axis_old_move_mode != axis_new_move_mode) {
+            m_cur_move_mode[axis].store(axis_new_move_mode, std::memory_order_relaxed);
+            commit_params(axis, batch, params_txn_aborts);
+        }
+
+        return true;
+    }
+
+    bool SetModeTrack(const Axis& axis, double pos /*deg*/) {
+        const SystemStatus s = m_sys_status.Load();
+        if (! is_system_ready(s)) {
+            return false;
+        }
+
+        if (! is_axis_valid(axis)) {
+            return false;
+        }
+
+        // Current absolute position + user offset [pulses]
+        const int32_t cur_pos_usr_pulse = s.axes[axis].cur_pos - m_pos_abs_rel_off[axis] - m_pos_abs_usr_off[axis];
+        // Target absolute position + user offset [pulses]
+        const int32_t tgt_pos_usr_pulse = pos_deg2pulse(pos, cur_pos_usr_pulse);
+
+        TXCmdBatch batch;
+        TXCmd txcmd(TXCmd::kCmd);
+        txcmd.ctrlword = 0xF;
+        txcmd.op_mode = OP_MODE_TRACK;
+        txcmd.tgt_pos = tgt_pos_usr_pulse + m_pos_abs_rel_off[axis] + m_pos_abs_usr_off[axis];
+        txcmd.tgt_vel = 0;
+        batch.Push(txcmd);
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return submit_batch(axis, batch);
+    }
+
+    bool SubmitTrajectory(const Axis& axis, const std::vector<TrajectoryPoint>& points) {
+        const SystemStatus s = m_sys_status.Load();
+        if (! is_system_ready(s)) {
+            return false;
+        }
+
+        if (! is_axis_valid(axis)) {
+            return false;
+        }
+
+        if (points.empty() || points.size() > kTrajQueueCapacity) {
+            LOG_WARN("SubmitTrajectory(axis=" << axis << ") invalid points count: " << points.size());
+            return false;
+        }
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        // Позиция в градусах переводится в ближайшие импульсы относительно предыдущей точки,
+        // а если переданные ранее точки уже пройдены - относительно текущей позиции оси
+        const bool pending = traj_pending(axis, s);
+        uint64_t last_time = pending ? m_traj_last_time_ns[axis] : 0;
+        int32_t last_pos = pending ? m_traj_last_pos[axis] : s.axes[axis].cur_pos;
+
+        std::vector<double> pos_deg;
+        pos_deg.reserve(points.size());
+        for (const TrajectoryPoint& point: points) {
+            if (point.time_ns <= last_time) {
+                LOG_WARN("SubmitTrajectory(axis=" << axis << ") points must be strictly increasing in time: " << point.time_ns);
+                return false;
+            }
+            if (! (std::abs(point.pos_deg) < kPosDegLimit)) {
+                LOG_WARN("SubmitTrajectory(axis=" << axis << ") invalid position: " << point.pos_deg);
+                return false;
+            }
+            pos_deg.push_back(point.pos_deg);
+            last_time = point.time_ns;
+        }
+
+        const int32_t usr_off = m_pos_abs_rel_off[axis] + m_pos_abs_usr_off[axis];
+        std::vector<int32_t> pos_pulse(points.size());
+        last_pos = PosDeg2PulseBatch(pos_deg.data(), pos_pulse.data(), points.size(), last_pos - usr_off) + usr_off;
+
+        // Точки и включающая их команда получают одно поколение: поток обмена начнет их обработку
+        // только при выполнении команды, а команды, поставленные раньше, этих точек не удалят
+        const uint64_t epoch = m_traj_epoch[axis] + 1;
+        std::vector<TrajectorySample> samples;
+        samples.reserve(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            samples.push_back({ points[i].time_ns, static_cast<double>(pos_pulse[i] + usr_off)
+                              , points[i].vel_deg * kPulsesPerDegree, epoch });
+        }
+
+        // Места проверяются заранее: точки без команды, включающей их, не ставятся
+        if (! m_tx_queues[axis].PushAvailable()) {
+            LOG_WARN("Command queue for axis=" << axis << " is full");
+            return false;
+        }
+        if (! m_traj_queues[axis].TryPushBatch(samples.data(), samples.size())) {
+            LOG_WARN("Trajectory queue for axis=" << axis << " is full");
+            return false;
+        }
+        m_traj_last_time_ns[axis] = last_time;
+        m_traj_last_pos[axis] = last_pos;
+        m_traj_last_epoch[axis] = epoch;
+
+        TXCmdBatch batch;
+        batch.Push(TXCmd(TXCmd::kStream));
+        const bool submitted = submit_batch(axis, batch);
+        assert(submitted);
+        (void) submitted;
+
+        return true;
+    }
+
+    bool MoveCoordinated(const std::vector<Axis>& axes, const std::vector<CoordinatedWaypoint>& path, bool blend) {
+        const SystemStatus s = m_sys_status.Load();
+        if (! is_system_ready(s)) {
+            return false;
+        }
+
+        uint32_t sync_axes = 0;
+        for (const Axis axis: axes) {
+            if (! is_axis_valid(axis)) {
+                return false;
+            }
+            if (sync_axes & (1U << axis)) {
+                LOG_WARN("MoveCoordinated() axis=" << axis << " is listed twice");
+                return false;
+            }
+            sync_axes |= 1U << axis;
+        }
+
+        if (axes.empty() || path.empty() || path.size() > kTrajQueueCapacity) {
+            LOG_WARN("MoveCoordinated() invalid axes count: " << axes.size() << " or path size: " << path.size());
+            return false;
+        }
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+
+        // Перемещение начинается после ранее переданных точек всех своих осей, но не раньше, чем поток обмена
+        // успеет включить его на всех осях
+        const size_t axis_count = axes.size();
+        uint64_t start_time = s.apptime + kCoordStartLeadCycles * m_options.cycle_period_ns;
+        std::vector<double> start(axis_count);
+        std::vector<double> waypoints(axis_count * path.size());
+        std::vector<double> pos_deg(path.size());
+        std::vector<int32_t> pos_pulse(path.size());
+        for (size_t i = 0; i < axis_count; ++i) {
+            const Axis axis = axes[i];
+            const bool pending = traj_pending(axis, s);
+            const int32_t last_pos = pending ? m_traj_last_pos[axis] : s.axes[axis].cur_pos;
+            if (pending) {
+                start_time = std::max(start_time, m_traj_last_time_ns[axis]);
+            }
+
+            // Позиции в градусах переводятся в ближайшие импульсы относительно предыдущей точки пути
+            const int32_t usr_off = m_pos_abs_rel_off[axis] + m_pos_abs_usr_off[axis];
+            for (size_t point = 0; point < path.size(); ++point) {
+                pos_deg[point] = path[point].pos_deg[axis];
+                if (! (std::abs(pos_deg[point]) < kPosDegLimit)) {
+                    LOG_WARN("MoveCoordinated() invalid position for axis=" << axis << ": " << pos_deg[point]);
+                    return false;
+                }
+            }
+            PosDeg2PulseBatch(pos_deg.data(), pos_pulse.data(), path.size(), last_pos - usr_off);
+
+            start[i] = last_pos;
+            for (size_t point = 0; point < path.size(); ++point) {
+                waypoints[point * axis_count + i] = pos_pulse[point] + usr_off;
+            }
+        }
+
+        const TrackLimits& limits = m_options.track_limits;
+        CoordinatedProfile profile;
+        if (! profile.Plan(start.data(), waypoints.data(), path.size(), axis_count,
+                           { limits.max_vel_deg * kPulsesPerDegree, limits.max_acc_deg * kPulsesPerDegree,
+                             limits.max_jerk_deg * kPulsesPerDegree }, blend)) {
+            return false;
+        }
+        if (! profile.Duration()) {
+            return true;
+        }
+
+        std::vector<double> times;
+        profile.SampleTimes(kCoordRampSamples, times);
+        for (const Axis axis: axes) {
+            if (m_traj_queues[axis].PushAvailable() < times.size() || ! m_tx_queues[axis].PushAvailable()) {
+                LOG_WARN("Trajectory queue for axis=" << axis << " can't take " << times.size() << " points");
+                return false;
             }
-            if (axis_old_move_mode != axis_cur_move_mode) {
-                const AxisParams& params = axis_move_modes.at(axis_cur_move_mode);
-                for (const AxisParam& p: params) {
-                    m_cur_params[axis][p.index] = p.value;
+        }
+
+        // У всех осей общие метки времени: оси проходят отрезки одновременно
+        std::vector<TrajectorySample> samples;
+        samples.reserve(times.size());
+        for (size_t i = 0; i < axis_count; ++i) {
+            const Axis axis = axes[i];
+            const uint64_t last_time = traj_pending(axis, s) ? m_traj_last_time_ns[axis] : 0;
+            const uint64_t epoch = m_traj_epoch[axis] + 1;
+            samples.clear();
+            for (const double time_s: times) {
+                const uint64_t time_ns = start_time + static_cast<uint64_t>(std::llround(time_s * 1e9));
+                // Первая точка совпадает с последней ранее переданной
+                if (time_ns <= last_time) {
+                    continue;
                 }
+                double pos = 0.0;
+                double vel = 0.0;
+                profile.Evaluate(i, (time_ns - start_time) / 1e9, pos, vel);
+                samples.push_back({ time_ns, pos, vel, epoch });
             }
+
+            const bool pushed = m_traj_queues[axis].TryPushBatch(samples.data(), samples.size());
+            assert(pushed);
+            (void) pushed;
+            if (! samples.empty()) {
+                m_traj_last_time_ns[axis] = samples.back().time_ns;
+                m_traj_last_pos[axis] = static_cast<int32_t>(std::lround(samples.back().pos));
+                m_traj_last_epoch[axis] = epoch;
+            }
+        }
+
+        // Команды включают перемещение: поток обмена выполняет их, когда они дошли до начала очередей всех осей
+        TXCmd txcmd(TXCmd::kStream);
+        txcmd.sync_axes = sync_axes;
+        txcmd.stream_start = start_time;
+        for (const Axis axis: axes) {
+            TXCmdBatch batch;
+            batch.Push(txcmd);
+            const bool submitted = submit_batch(axis, batch);
+            assert(submitted);
+            (void) submitted;
         }
 
         return true;
@@ -441,6 +847,9 @@ protected:
 
         std::lock_guard<std::mutex> guard(m_mutex);
         m_move_modes[axis][mode] = params;
+        m_move_mode_tables[axis].Compile(m_move_modes[axis], kWriteSdoIndices, m_write_sdos[axis]);
+        // Параметры текущего режима могли измениться: следующее переключение запишет полный набор
+        m_cur_move_mode[axis].store(kMoveModeInvalid, std::memory_order_relaxed);
         return true;
     }
 
@@ -450,7 +859,7 @@ protected:
         }
 
         std::lock_guard<std::mutex> guard(m_mutex);
-        m_params_mode[axis] = params_mode;
+        m_params_mode[axis].store(params_mode, std::memory_order_relaxed);
         return true;
     }
 
@@ -458,12 +867,12 @@ protected:
         if (! is_axis_valid(axis)) {
             return false;
         }
-        params_mode = m_params_mode[axis];
+        params_mode = m_params_mode[axis].load(std::memory_order_relaxed);
         return true;
     }
 
     bool SetAxisParams(const Axis& axis, const AxisParams& params) {
-        const SystemStatus s = m_sys_status.load(std::memory_order_acquire);
+        const SystemStatus s = m_sys_status.Load();
         if (! is_system_ready(s)) {
             return false;
         }
@@ -472,7 +881,7 @@ protected:
             return false;
         }
 
-        if (m_params_mode[axis] == PARAMS_MODE_AUTOMATIC) {
+        if (m_params_mode[axis].load(std::memory_order_relaxed) == PARAMS_MODE_AUTOMATIC) {
             LOG_WARN("SetAxisParams(axis=" << axis << ") skipped: 'Automatic' params mode is engaged");
             return false;
         }
@@ -481,84 +890,219 @@ protected:
             return false;
         }
 
-        TXCmd txcmd(TXCmd::kSetParams);
+        std::vector<SdoParam> sdo_params;
+        sdo_params.reserve(params.size());
+        for (const AxisParam& p: params) {
+            sdo_params.push_back({ m_write_sdos[axis].at(p.index), p.value, p.index, kWriteSdoIndices.at(p.index) });
+        }
 
         std::lock_guard<std::mutex> guard(m_mutex);
-        for (const AxisParam& p: params) {
-            txcmd.param = p;
-            m_tx_queues[axis].push_back(txcmd);
-            m_cur_params[axis][p.index] = p.value;
+        TXCmdBatch batch;
+        const uint32_t params_txn_aborts = push_changed_params(axis, sdo_params.data(), sdo_params.data() + sdo_params.size(), batch);
+        if (! submit_batch(axis, batch)) {
+            return false;
         }
 
+        commit_params(axis, batch, params_txn_aborts);
+        // Значения параметров больше не соответствуют ни одному режиму перемещения
+        m_cur_move_mode[axis].store(kMoveModeInvalid, std::memory_order_relaxed);
+
         return true;
     }
 
-    bool SetModeIdle(const Axis& axis) {
-        const SystemStatus s = m_sys_status.load(std::memory_order_acquire);
+    bool ReloadConfig(const Config::Storage& config) {
+        const SystemStatus s = m_sys_status.Load();
         if (! is_system_ready(s)) {
             return false;
         }
 
-        if (! is_axis_valid(axis)) {
-            return false;
-        }
-
-        TXCmd txcmd(TXCmd::kCmd);
-        txcmd.ctrlword = 0x6;
-        txcmd.op_mode = OP_MODE_IDLE;
-        txcmd.tgt_vel = 0;
-        txcmd.tgt_pos = 0;
-
         std::lock_guard<std::mutex> guard(m_mutex);
-        m_tx_queues[axis].push_back(txcmd);
 
-        return true;
-    }
+        // Записи, изменившиеся относительно примененной конфигурации, по осям
+        std::vector<SdoParam> changed[AXIS_MAX_COUNT];
+        uint32_t changed_count = 0;
+        for (const auto& kv: config.GetWholeDict()) {
+            const Config::Storage::Key& key = kv.first;
+            const Config::Storage::Value& val = kv.second;
+            const bool unchanged = m_config.HasKey(key)
+                    && boost::get<0>(m_config.GetValue(key)) == boost::get<0>(val)
+                    && boost::get<1>(m_config.GetValue(key)) == boost::get<1>(val);
+            if (unchanged) {
+                continue;
+            }
 
-    bool ResetFault(const Axis& axis) {
-        const SystemStatus s = m_sys_status.load(std::memory_order_acquire);
-        if (! is_system_ready(s)) {
-            return false;
-        }
+            if (! check_reload_entry(key, val)) {
+                return false;
+            }
 
-        if (! is_axis_valid(axis)) {
-            return false;
+            const uint16_t axis = boost::get<0>(key);
+            const uint16_t index = boost::get<1>(key);
+            changed[axis].push_back({ m_write_sdos[axis].at(index), boost::get<0>(val), index, kWriteSdoIndices.at(index) });
+            ++changed_count;
         }
 
-        // Set idle mode
-        TXCmd txcmd(TXCmd::kCmd);
-        txcmd.ctrlword = 0x6;
-        txcmd.op_mode = OP_MODE_IDLE;
-        txcmd.tgt_vel = 0;
-        txcmd.tgt_pos = 0;
+        // Пачки всех осей собираются и проверяются до передачи первой: конфигурация применяется целиком или никак
+        TXCmdBatch batches[AXIS_MAX_COUNT];
+        uint32_t params_txn_aborts[AXIS_MAX_COUNT] = {0};
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            if (changed[axis].empty()) {
+                continue;
+            }
 
-        std::lock_guard<std::mutex> guard(m_mutex);
-        m_tx_queues[axis].push_back(txcmd);
+            params_txn_aborts[axis] = push_changed_params(static_cast<Axis>(axis), changed[axis].data(),
+                                                          changed[axis].data() + changed[axis].size(), batches[axis]);
+            if (batches[axis].overflow) {
+                LOG_ERROR("ReloadConfig() failed: command batch for axis=" << axis << " exceeds "
+                          << kTXCmdBatchCapacity << " commands");
+                return false;
+            }
+            // Очереди пополняются только под m_mutex, поэтому проверенное место не исчезнет до передачи
+            if (m_tx_queues[axis].PushAvailable() < batches[axis].size) {
+                LOG_WARN("ReloadConfig() failed: command queue for axis=" << axis << " is full");
+                return false;
+            }
+        }
 
-        // Alarm/error reset
-        txcmd.ctrlword = 0x86;
-        txcmd.op_mode = OP_MODE_IDLE;
-        txcmd.tgt_vel = 0;
-        txcmd.tgt_pos = 0;
+        uint32_t written_count = 0;
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            if (changed[axis].empty()) {
+                continue;
+            }
 
-        m_tx_queues[axis].push_back(txcmd);
+            const bool submitted = submit_batch(static_cast<Axis>(axis), batches[axis]);
+            assert(submitted);
+            (void) submitted;
+
+            commit_params(static_cast<Axis>(axis), batches[axis], params_txn_aborts[axis]);
+            m_cur_move_mode[axis].store(kMoveModeInvalid, std::memory_order_relaxed);
+            written_count += batches[axis].size;
+        }
 
+        m_config = config;
+        LOG_INFO("Config reloaded: " << changed_count << " entries changed, " << written_count << " parameters written");
         return true;
     }
 
-    const std::atomic<SystemStatus>& GetStatusRef() const {
-        return m_sys_status;
+    uint32_t Subscribe(uint32_t event_mask, const EventCallback& callback) {
+        if (! event_mask || (event_mask & ~static_cast<uint32_t>(EVENT_ALL)) || ! callback) {
+            LOG_WARN("Subscribe() failed: invalid event mask 0x" << std::hex << event_mask << " or empty callback");
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> guard(m_subs_mutex);
+        if (! m_event_thread) {
+            m_event_thread.reset(new std::thread(std::bind(&Impl::DispatchEvents, this)));
+        }
+
+        const uint32_t id = m_next_sub_id++;
+        m_subs.push_back({ id, event_mask, callback });
+        update_event_mask();
+        return id;
+    }
+
+    bool Unsubscribe(uint32_t subscription_id) {
+        {
+            std::lock_guard<std::mutex> guard(m_subs_mutex);
+            const auto it = std::find_if(m_subs.begin(), m_subs.end(), [subscription_id](const Subscription& sub) {
+                return sub.id == subscription_id;
+            });
+            if (it == m_subs.end()) {
+                LOG_WARN("Unsubscribe() failed: unknown subscription " << subscription_id);
+                return false;
+            }
+            m_subs.erase(it);
+            update_event_mask();
+        }
+
+        // Дожидаемся окончания доставки, которая могла начаться до удаления
+        if (m_event_thread && std::this_thread::get_id() != m_event_thread->get_id()) {
+            std::lock_guard<std::mutex> guard(m_dispatch_mutex);
+        }
+        return true;
+    }
+
+    bool SetModeIdle(const Axis& axis) {
+        const SystemStatus s = m_sys_status.Load();
+        if (! is_system_ready(s)) {
+            return false;
+        }
+
+        if (! is_axis_valid(axis)) {
+            return false;
+        }
+
+        TXCmdBatch batch;
+        TXCmd txcmd(TXCmd::kCmd);
+        txcmd.ctrlword = 0x6;
+        txcmd.op_mode = OP_MODE_IDLE;
+        txcmd.tgt_vel = 0;
+        txcmd.tgt_pos = 0;
+        batch.Push(txcmd);
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return submit_batch(axis, batch);
+    }
+
+    bool ResetFault(const Axis& axis) {
+        const SystemStatus s = m_sys_status.Load();
+        if (! is_system_ready(s)) {
+            return false;
+        }
+
+        if (! is_axis_valid(axis)) {
+            return false;
+        }
+
+        TXCmdBatch batch;
+
+        // Set idle mode
+        TXCmd txcmd(TXCmd::kCmd);
+        txcmd.ctrlword = 0x6;
+        txcmd.op_mode = OP_MODE_IDLE;
+        txcmd.tgt_vel = 0;
+        txcmd.tgt_pos = 0;
+        batch.Push(txcmd);
+
+        // Alarm/error reset
+        txcmd.ctrlword = 0x86;
+        txcmd.op_mode = OP_MODE_IDLE;
+        txcmd.tgt_vel = 0;
+        txcmd.tgt_pos = 0;
+        batch.Push(txcmd);
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return submit_batch(axis, batch);
     }
 
     SystemStatus GetStatusCopy() const {
-        return m_sys_status.load(std::memory_order_acquire);
+        return m_sys_status.Load();
+    }
+
+    bool GetAxisStatus(const Axis& axis, AxisStatus& status) const {
+        if (! is_axis_valid(axis)) {
+            return false;
+        }
+
+        m_sys_status.Read([&status, axis](const SystemStatus& sys) {
+            status = sys.axes[axis];
+        });
+
+        return true;
+    }
+
+    uint64_t GetStatusVersion() const {
+        return m_sys_status.Version();
     }
 
     const SystemInfo& GetSystemInfo() const {
-        // No need for mutex, as this data is written once in constructor
+        // No need for mutex, as this data is written once during initialization
         return m_sys_info;
     }
 
+    std::shared_future<bool> GetInitFuture() const {
+        return m_init_future;
+    }
+
     AxisParamIndexMap GetAvailableAxisParams(const Axis& /* axis */) const {
         return kWriteSdoIndices;
     }
@@ -582,317 +1126,814 @@ protected:
         return result;
     }
 
-    const std::atomic<CycleTimeInfo>& GetCycleTimeInfoRef() const {
-        return m_timing_info;
-    }
-
     CycleTimeInfo GetCycleTimeInfo() const {
-        return m_timing_info.load(std::memory_order_consume);
+        return m_timing_info.Load();
     }
 
     void ResetCycleTimeInfo() {
-        m_timing_info.store(CycleTimeInfo());
+        m_timing_reset_request.store(true, std::memory_order_release);
+    }
+
+    DiagnosticsSnapshot GetDiagnostics() const {
+        return m_diagnostics.Load();
+    }
+
+    uint64_t GetDiagnosticsVersion() const {
+        return m_diagnostics.Version();
+    }
+
+    const PdoImageRegion* GetPdoImage() const {
+        return m_pdo_image.Region();
+    }
+
+    CycleHistogram GetCycleHistogram() const {
+        CycleHistogram result;
+        m_histogram.Snapshot(result);
+        return result;
+    }
+
+    void ResetCycleHistogram() {
+        m_histogram_reset_request.store(true, std::memory_order_release);
+    }
+
+    /*! @brief Поток инициализации.
+     *
+     *  Настраивает подчиненных по SDO (параллельно по подчиненным), активирует мастер и запускает поток обмена.
+     *  До запуска потока обмена статус публикует только этот поток.
+     */
+    void AsyncInit() {
+        try {
+            slaves_sdo_setup();
+
+            LOG_INFO("Pre-realtime slave setup done");
+
+            if (m_stop_flag.load(std::memory_order_consume)) {
+                finish_init(false);
+                return;
+            }
+
+            publish_init_progress(INIT_STAGE_ACTIVATION);
+
+            // Задаем предполагаемый интервал обмена данными
+            if (m_ec.master_set_send_interval(m_master, m_options.cycle_period_ns / 1000 /* us required here */)) {
+                BOOST_THROW_EXCEPTION(Exception("Failed to setup master send interval"));
+            }
+
+            ///////////////////////////////////////////////////////////////////
+            // Настраиваем DC-synchronization
+
+            // Выбираем референсные часы
+            if (int err = m_ec.master_select_reference_clock(m_master, m_slave_cfg[0])) {
+                BOOST_THROW_EXCEPTION(Exception("Failed to select reference clock. Error code: ") << err);
+            }
+
+            // Включаем и настраиваем синхронизацию на подчиненных
+            for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+                m_ec.slave_config_dc(m_slave_cfg[axis], 0x300, m_options.cycle_period_ns, m_options.sync0_shift_ns, 0, 0);
+            }
+
+            // Application time отсчитывается от CLOCK_MONOTONIC: коррекции системного времени не сдвигают DC
+            m_app_time_offset_ns = static_cast<int64_t>(get_system_time()) - static_cast<int64_t>(CycleScheduler::Now());
+
+            // Записываем начальное application time
+            m_ec.master_application_time(m_master, get_app_time());
+
+            ///////////////////////////////////////////////////////////////////
+
+            // "Включаем" мастер-объект
+            if (m_ec.master_activate(m_master)) {
+                BOOST_THROW_EXCEPTION(Exception("Master activation failed"));
+            }
+
+            LOG_INFO("Master activated");
+
+            for (int32_t domain = 0; domain < kDomainCount; ++domain) {
+                if (! (m_domain_data[domain] = m_ec.domain_data(m_domains[domain])) ) {
+                    BOOST_THROW_EXCEPTION(Exception("Domain data initialization failed for domain #") << domain);
+                }
+            }
+
+            LOG_INFO("Domain data registered");
+
+            // Файл и очередь записи циклов создаются до блокировки памяти
+            if (! m_options.record_path.empty()) {
+                open_recorder();
+            }
+            if (m_options.pdo_image || ! m_options.pdo_image_shm.empty()) {
+                open_pdo_image();
+            }
+
+            // Блокируем память процесса до запуска потока, чтобы в цикле не было page faults
+            if (m_options.lock_memory) {
+                if (! ::mlockall(MCL_CURRENT | MCL_FUTURE)) {
+                    LOG_INFO("Process memory locked");
+                } else {
+                    LOG_WARN("Failed to lock process memory: " << errno);
+                }
+            }
+
+            publish_init_progress(INIT_STAGE_OPERATIONAL_WAIT);
+
+            m_thread.reset(new std::thread(std::bind(&Impl::CyclicPolling, this)));
+            if (m_options.watchdog_cycles) {
+                m_watchdog_thread.reset(new std::thread(std::bind(&Impl::WatchCyclicPolling, this)));
+            }
+
+            LOG_INFO("Cyclic polling thread started");
+        } catch (const std::exception& ex) {
+            LOG_ERROR(ex.what());
+
+            SystemStatus s = m_sys_status.Load();
+            s.state = SystemState::SYSTEM_FATAL_ERROR;
+            m_sys_status.Store(s);
+            finish_init(false);
+        }
     }
 
     void CyclicPolling() {
+        setup_realtime_thread();
+
         bool op_state = false;
         uint64_t cycles_total = 0;
+        m_cycles_cur = 0;
+        std::fill(m_cycles_cmd_start, m_cycles_cmd_start + AXIS_MAX_COUNT, 0);
 
-        SysClock::time_point wakeup_time = SysClock::now();
+        CycleScheduler scheduler(m_options.cycle_period_ns, m_options.spin_ns, m_options.overrun_policy);
+        DcDriftCompensator dc_drift(m_options.cycle_period_ns);
+        DcBusShiftController dc_bus_shift(m_options.cycle_period_ns);
+        // Ожидание OP ограничено: иначе future инициализации никогда не завершится
+        const uint64_t op_timeout_cycles = (static_cast<uint64_t>(m_options.op_timeout_ms) * 1000000
+                                            + m_options.cycle_period_ns - 1) / m_options.cycle_period_ns;
+        scheduler.Start();
 
         while (! op_state && ! m_stop_flag.load(std::memory_order_consume)) {
-            wakeup_time += boost::chrono::nanoseconds(kCyclePeriodNs);
-            boost::this_thread::sleep_until(wakeup_time);
+            const uint64_t wakeup_time = scheduler.WaitNext();
 
             // Получаем данные от подчиненных
-            ecrt_master_receive(m_master);
-            ecrt_domain_process(m_domain);
+            m_ec.master_receive(m_master);
+            bool all_domains_up = true;
+            for (int32_t domain = 0; domain < kDomainCount; ++domain) {
+                m_ec.domain_process(m_domains[domain]);
+                // Получаем статус домена
+                m_ec.domain_state(m_domains[domain], &m_domain_state[domain]);
+                all_domains_up &= (m_domain_state[domain].wc_state == EC_WC_COMPLETE);
+            }
 
             ++cycles_total;
 
-            // Получаем статус домена
-            ecrt_domain_state(m_domain, &m_domain_state);
-
             // Получаем статус подчиненных
-            ec_slave_config_state_t slave_cfg_state[AXIS_COUNT];
-            for (uint32_t d = 0; d < AXIS_COUNT; ++d) {
-                ecrt_slave_config_state(m_slave_cfg[d], &slave_cfg_state[d]);
+            ec_slave_config_state_t slave_cfg_state[AXIS_MAX_COUNT];
+            for (int32_t d = 0; d < m_axis_count; ++d) {
+                m_ec.slave_config_state(m_slave_cfg[d], &slave_cfg_state[d]);
             }
 
             bool all_slaves_up = true;
-            for (uint32_t d = 0; d < AXIS_COUNT; ++d) {
-                all_slaves_up |= slave_cfg_state[d].operational;
+            for (int32_t d = 0; d < m_axis_count; ++d) {
+                all_slaves_up &= slave_cfg_state[d].operational;
             }
 
-            if (m_domain_state.wc_state == EC_WC_COMPLETE && all_slaves_up) {
+            if (all_domains_up && all_slaves_up) {
                 LOG_INFO("Domain is up at " << cycles_total << " cycles");
                 op_state = true;
-            } else if (cycles_total % 10000 == 0) {
-                //! @todo выход из цикла и сообщение об ошибке
-                LOG_WARN("Domain is NOT up at " << cycles_total << " cycles. Domain state=" << m_domain_state.wc_state
-                         << ", slave0 state=" << uint32_t(slave_cfg_state[0].al_state)
-                         << ", slave1 state=" << uint32_t(slave_cfg_state[1].al_state)
-                         );
+                finish_init(true);
+            } else if ((op_timeout_cycles && cycles_total >= op_timeout_cycles) || cycles_total % 10000 == 0) {
+                std::ostringstream slave_states;
+                for (int32_t d = 0; d < m_axis_count; ++d) {
+                    slave_states << ", slave" << d << " state=" << uint32_t(slave_cfg_state[d].al_state);
+                }
+                if (op_timeout_cycles && cycles_total >= op_timeout_cycles) {
+                    LOG_ERROR("Domain is NOT up in " << m_options.op_timeout_ms << " ms. Domain state="
+                              << m_domain_state[kFastDomain].wc_state << "/" << m_domain_state[kSlowDomain].wc_state
+                              << slave_states.str());
+
+                    // Поток обмена завершается: систему можно только освободить
+                    SystemStatus s = m_sys_status.Load();
+                    s.state = SystemState::SYSTEM_FATAL_ERROR;
+                    m_sys_status.Store(s);
+                    finish_init(false);
+                    return;
+                }
+                LOG_WARN("Domain is NOT up at " << cycles_total << " cycles. Domain state="
+                         << m_domain_state[kFastDomain].wc_state << "/" << m_domain_state[kSlowDomain].wc_state
+                         << slave_states.str());
             }
 
             // Добавляем команды на синхронизацию времени
-            supply_app_time();
-            ecrt_master_sync_reference_clock(m_master);
-            ecrt_master_sync_slave_clocks(m_master);
-            ecrt_master_sync_monitor_queue(m_master);
+            queue_dc_sync(wakeup_time + m_app_time_offset_ns, cycles_total);
 
             // Send queued data
-            ecrt_domain_queue(m_domain);     // Помечаем данные как готовые к отправке
-            ecrt_master_send(m_master);      // Отправляем все датаграммы, помещенные в очередь
+            for (int32_t domain = 0; domain < kDomainCount; ++domain) {
+                m_ec.domain_queue(m_domains[domain]);   // Помечаем данные как готовые к отправке
+            }
+            m_ec.master_send(m_master);                 // Отправляем все датаграммы, помещенные в очередь
         }
 
-        // Устанавливаем статус системы в IDLE
-        SystemStatus s = m_sys_status.load(std::memory_order_acquire);
-        s.state = SystemState::SYSTEM_OK;
-        s.axes[AZIMUTH_AXIS].state = AxisState::AXIS_IDLE;
-        s.axes[ELEVATION_AXIS].state = AxisState::AXIS_IDLE;
-        m_sys_status.store(s);
+        // Устанавливаем статус системы в IDLE.
+        // Поток - единственный писатель статуса, поэтому дальше работаем с локальной копией.
+        SystemStatus sys = m_sys_status.Load();
+        sys.state = SystemState::SYSTEM_OK;
+        sys.init_stage = INIT_STAGE_DONE;
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            sys.axes[axis].state = AxisState::AXIS_IDLE;
+        }
+        m_sys_status.Store(sys);
 
         cycles_total = 0;
-        SysClock::time_point last_start_time = {}, start_time = {}, end_time = {};
+        // Медленный домен отправлен на последнем цикле ожидания
+        bool slow_domain_queued = true;
+        // Очередная отправка медленного домена отложена: бюджет времени цикла исчерпан
+        bool slow_domain_due = false;
+        // Циклов подряд, завершившихся позже срока
+        uint32_t missed_deadlines = 0;
+        const uint64_t noncritical_budget_ns = m_options.noncritical_budget_ns
+            ? m_options.noncritical_budget_ns : m_options.cycle_period_ns / 2;
+        uint64_t last_start_time = 0;
+        uint64_t prev_app_time = 0;
+        // Монитор синхронизации опрашивается раз в sync_monitor_divider циклов, между опросами оценка сохраняется
+        bool sync_monitor_queued = false;
+        uint32_t dcsync = 0;
+        CycleTimeInfo timing_info;
+        m_histogram.Reset(CycleScheduler::Now());
 
         while (! m_stop_flag.load(std::memory_order_consume)) {
-            end_time = SysClock::now();
-            wakeup_time += boost::chrono::nanoseconds(kCyclePeriodNs);
-            boost::this_thread::sleep_until(wakeup_time);
-
-            // Cycle time info gathering
-            CycleTimeInfo timing_info = m_timing_info.load(std::memory_order_consume);
-            start_time = SysClock::now();
-            timing_info.latency_ns = (start_time - wakeup_time).count();
-            timing_info.period_ns = (start_time - last_start_time).count();
-            timing_info.exec_ns = (end_time - last_start_time).count();
-            last_start_time = start_time;
-
-            if (timing_info.latency_ns > timing_info.latency_max_ns) {
-                timing_info.latency_max_ns = timing_info.latency_ns;
-            }
-            if (timing_info.latency_ns < timing_info.latency_min_ns) {
-                timing_info.latency_min_ns = timing_info.latency_ns;
+            const uint64_t wakeup_time = scheduler.WaitNext();
+            const uint64_t start_time = CycleScheduler::Now();
+            if (scheduler.Skipped()) {
+                m_histogram.CountSkipped(scheduler.Skipped());
             }
-            if (timing_info.period_ns > timing_info.period_max_ns) {
-                timing_info.period_max_ns = timing_info.period_ns;
-            }
-            if (timing_info.period_ns < timing_info.period_min_ns) {
-                timing_info.period_min_ns = timing_info.period_ns;
+
+            // Запросы на сброс статистики выполняет сам поток: он единственный писатель
+            if (m_timing_reset_request.exchange(false, std::memory_order_acquire)) {
+                timing_info = CycleTimeInfo();
             }
-            if (timing_info.exec_ns > timing_info.exec_max_ns) {
-                timing_info.exec_max_ns = timing_info.exec_ns;
+            if (m_histogram_reset_request.exchange(false, std::memory_order_acquire)) {
+                m_histogram.Reset(start_time);
             }
-            if (timing_info.exec_ns < timing_info.exec_min_ns) {
-                timing_info.exec_min_ns = timing_info.exec_ns;
+
+            // Cycle time info gathering
+            timing_info.latency_ns = start_time - wakeup_time;
+            m_histogram.latency.Record(timing_info.latency_ns);
+            if (last_start_time) {
+                timing_info.period_ns = start_time - last_start_time;
+                m_histogram.period.Record(timing_info.period_ns);
             }
-            m_timing_info.store(timing_info);
+            last_start_time = start_time;
 
             // Получаем данные от подчиненных
-            ecrt_master_receive(m_master);
-            ecrt_domain_process(m_domain);
+            m_ec.master_receive(m_master);
+            m_ec.domain_process(m_domains[kFastDomain]);
 
             // Получаем статус домена
-            ecrt_domain_state(m_domain, &m_domain_state);
+            m_ec.domain_state(m_domains[kFastDomain], &m_domain_state[kFastDomain]);
+
+            // Медленный домен обрабатываем только на цикле после его отправки
+            const bool slow_domain_received = slow_domain_queued;
+            if (slow_domain_received) {
+                m_ec.domain_process(m_domains[kSlowDomain]);
+                m_ec.domain_state(m_domains[kSlowDomain], &m_domain_state[kSlowDomain]);
+            }
 
             // Получаем верхнюю оценку синхронизации
-            const uint32_t dcsync = ecrt_master_sync_monitor_process(m_master);
+            if (sync_monitor_queued) {
+                dcsync = m_ec.master_sync_monitor_process(m_master);
+            }
 
             // Получаем значение референсных часов
             uint32_t lo_ref_time = 0;
-            const int err = ecrt_master_reference_clock_time(m_master, &lo_ref_time);
+            const int err = m_ec.master_reference_clock_time(m_master, &lo_ref_time);
             if (err) {
-                // SystemStatus s = m_sys_status.load(std::memory_order_acquire);
-                // s.state = SystemState::SYSTEM_ERROR;
-                // m_sys_status.store(s);
+                // sys.state = SystemState::SYSTEM_ERROR;
                 // @todo save error code
             }
 
-            const uint64_t app_time = get_app_time();
+            // Подстраиваем фазу пробуждений и application time под референсные часы
+            if (! err && prev_app_time && (DC_SYNC_BUS_SHIFT == m_options.dc_sync_mode || m_options.dc_drift_compensation)) {
+                const int64_t drift_step_ns = DC_SYNC_BUS_SHIFT == m_options.dc_sync_mode
+                    ? dc_bus_shift.Update(prev_app_time, lo_ref_time) : dc_drift.Update(prev_app_time, lo_ref_time);
+                if (drift_step_ns) {
+                    // Референсные часы ушли вперед - application time догоняет их, а пробуждения происходят раньше
+                    m_app_time_offset_ns += drift_step_ns;
+                    scheduler.AdjustPhase(-drift_step_ns);
+                }
+            }
+
+            // Application time цикла привязан к запланированному пробуждению: одно значение для статуса и для
+            // подчиненных, без чтения часов и без дрожания задержки пробуждения
+            const uint64_t app_time = wakeup_time + m_app_time_offset_ns;
             const uint64_t ref_time = (app_time & 0xFFFFFFFF00000000UL) | lo_ref_time;
 
+            const uint64_t receive_end_time = CycleScheduler::Now();
+
             // Обрабатываем пришедшие данные
-            const SystemStatus s = process_received_data(cycles_total, app_time, ref_time, dcsync);
+            process_received_data(sys, slow_domain_received, app_time, ref_time, dcsync);
 
-            // Если есть новые команды - передаем их подчиненным
-            prepare_new_commands(s);
+            const uint64_t process_end_time = CycleScheduler::Now();
 
-            // Устанавливаем application-time
-            supply_app_time();
-            // Добавляем команды на синхронизацию времени
-            ecrt_master_sync_reference_clock(m_master);
-            ecrt_master_sync_slave_clocks(m_master);
-            // ВАЖНО: Кладет в очередь отправки запрос на получение от дочерних узлов значение регистра их оффсета от SystemTime.
-            ecrt_master_sync_monitor_queue(m_master);
+            // Сторожевой таймер: остановка осей после серии опозданий или зависания потока обмена
+            if (m_watchdog_request.exchange(false, std::memory_order_acquire)
+                    || (m_options.watchdog_cycles && missed_deadlines >= m_options.watchdog_cycles)) {
+                watchdog_halt(sys, app_time, missed_deadlines);
+                missed_deadlines = 0;
+            }
+
+            // Если есть новые команды - передаем их подчиненным.
+            // Некритичная работа откладывается, если на прием и обработку ушел весь бюджет
+            const bool defer_prepare = process_end_time - start_time > noncritical_budget_ns;
+            prepare_new_commands(sys, defer_prepare);
+
+            const uint64_t prepare_end_time = CycleScheduler::Now();
+            const bool defer_send = prepare_end_time - start_time > noncritical_budget_ns;
+
+            // Устанавливаем application-time и добавляем команды на синхронизацию времени
+            sync_monitor_queued = queue_dc_sync(app_time, cycles_total);
+            prev_app_time = app_time;
 
             // Отправляем данные подчиненным
-            ecrt_domain_queue(m_domain);
-            ecrt_master_send(m_master);
+            m_ec.domain_queue(m_domains[kFastDomain]);
+            slow_domain_due |= (cycles_total + 1) % m_options.slow_pdo_divider == 0;
+            slow_domain_queued = slow_domain_due && ! defer_send;
+            if (slow_domain_queued) {
+                m_ec.domain_queue(m_domains[kSlowDomain]);
+                slow_domain_due = false;
+            }
+            m_ec.master_send(m_master);
+
+            const uint64_t end_time = CycleScheduler::Now();
+            timing_info.exec_ns = end_time - start_time;
+            update_timing_info(timing_info);
+            m_timing_info.Store(timing_info);
+
+            m_histogram.exec.Record(timing_info.exec_ns);
+            m_histogram.receive.Record(receive_end_time - start_time);
+            m_histogram.process.Record(process_end_time - receive_end_time);
+            m_histogram.prepare.Record(prepare_end_time - process_end_time);
+            m_histogram.send.Record(end_time - prepare_end_time);
+            // Цикл "переполнен", если закончился позже запланированного начала следующего
+            const bool overrun = end_time > wakeup_time + m_options.cycle_period_ns;
+            m_histogram.CountCycle(end_time, overrun);
+            if (defer_prepare || (defer_send && slow_domain_due)) {
+                m_histogram.CountDeferred();
+            }
+            missed_deadlines = overrun ? missed_deadlines + 1 : 0;
+            m_heartbeat.store(cycles_total + 1, std::memory_order_release);
+            if (overrun) {
+                Event event = Event();
+                event.type = EVENT_OVERRUN;
+                event.axis = AXIS_NONE;
+                event.exec_ns = timing_info.exec_ns;
+                event.time_ns = app_time + kEpoch112000DiffNs;
+                push_event(event);
+            }
+            flush_events();
+
+            if (m_recorder.IsOpen()) {
+                record_cycle(cycles_total, app_time, timing_info, dcsync, slow_domain_received);
+            }
+            if (m_pdo_image.IsOpen()) {
+                publish_pdo_image(cycles_total, app_time, slow_domain_received);
+            }
 
             ++cycles_total;
         }
 
-        ecrt_master_receive(m_master);
-        ecrt_domain_process(m_domain);
+        m_ec.master_receive(m_master);
+        m_ec.domain_process(m_domains[kFastDomain]);
+        if (slow_domain_queued) {
+            m_ec.domain_process(m_domains[kSlowDomain]);
+        }
     }
 
 private:
-    bool read_system_info() {
-        SystemInfo sysinfo;
-
-        for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-            int result = 0;
-            size_t result_size = 0;
-            uint32_t abort_code;
-            const size_t kStrLen = 1024;
-            char str[kStrLen];
-            result |= ecrt_master_sdo_upload(m_master, axis, 0x2002, 0, reinterpret_cast<uint8_t*>(&(sysinfo.axes[axis].encoder_resolution)), sizeof(sysinfo.axes[axis].encoder_resolution), &result_size, &abort_code);
-
-            result |= ecrt_master_sdo_upload(m_master, axis, 0x1008, 0, reinterpret_cast<uint8_t*>(&str[0]), kStrLen, &result_size, &abort_code);
-            if (result_size) {
-                sysinfo.axes[axis].dev_name = std::string(str, result_size);
-                result_size = 0;
+    //! Описание образа PDO (быстрый домен, затем медленный) со смещениями зарегистрированных объектов
+    std::unique_ptr<RecordFileHeader> make_image_layout() const {
+        const size_t fast_size = m_ec.domain_size(m_domains[kFastDomain]);
+        const size_t slow_size = m_ec.domain_size(m_domains[kSlowDomain]);
+
+        std::unique_ptr<RecordFileHeader> layout(new RecordFileHeader());
+        layout->image_size = fast_size + slow_size;
+        layout->fast_image_size = fast_size;
+        layout->cycle_period_ns = m_options.cycle_period_ns;
+        layout->slow_pdo_divider = m_options.slow_pdo_divider;
+        layout->pdo_layout = m_options.pdo_layout;
+        layout->axis_count = m_axis_count;
+        layout->entry_count = std::min<size_t>(m_record_entries.size(), kRecordMaxPdoEntries);
+        for (uint32_t i = 0; i < layout->entry_count; ++i) {
+            layout->entries[i] = m_record_entries[i];
+            if (kSlowDomain == layout->entries[i].domain) {
+                layout->entries[i].offset += fast_size;
             }
+        }
+        return layout;
+    }
 
-            result |= ecrt_master_sdo_upload(m_master, axis, 0x1009, 0, reinterpret_cast<uint8_t*>(&str[0]), kStrLen, &result_size, &abort_code);
-            if (result_size) {
-                sysinfo.axes[axis].hw_version = std::string(str, result_size);
-                result_size = 0;
-            }
+    /*! @brief Создает файл записи циклов по зарегистрированным объектам PDO.
+     *
+     *  Образ записи - данные быстрого домена, за ними медленного. Запись - диагностика, поэтому ошибка
+     *  создания файла не прерывает инициализацию.
+     */
+    void open_recorder() {
+        const std::unique_ptr<RecordFileHeader> layout = make_image_layout();
+        if (layout->image_size > kRecordMaxImageSize || m_record_entries.size() > kRecordMaxPdoEntries) {
+            LOG_WARN("Cycle recording disabled: PDO image of " << layout->image_size << " bytes ("
+                     << m_record_entries.size() << " entries) doesn't fit a record");
+            return;
+        }
 
-            result |= ecrt_master_sdo_upload(m_master, axis, 0x100A, 0, reinterpret_cast<uint8_t*>(&str[0]), kStrLen, &result_size, &abort_code);
-            if (result_size) {
-                sysinfo.axes[axis].sw_version = std::string(str, result_size);
-                result_size = 0;
-            }
+        if (m_recorder.Open(m_options.record_path, *layout, m_options.record_capacity)) {
+            m_record_fast_size = layout->fast_image_size;
+            m_record_slow_size = layout->image_size - layout->fast_image_size;
+        } else {
+            LOG_WARN("Cycle recording disabled: failed to create " << m_options.record_path);
+        }
+    }
 
-            if (result) {
-                return false;
-            }
+    /*! @brief Создает область снимков образа PDO (ControlOptions::pdo_image).
+     *
+     *  В отличие от записи циклов, снимки - интерфейс для клиентов, поэтому ошибка прерывает инициализацию.
+     */
+    void open_pdo_image() {
+        const std::unique_ptr<RecordFileHeader> layout = make_image_layout();
+        if (layout->image_size > kPdoImageMaxSize || m_record_entries.size() > kRecordMaxPdoEntries) {
+            BOOST_THROW_EXCEPTION(Exception("PDO image of ") << layout->image_size << " bytes ("
+                                  << m_record_entries.size() << " entries) doesn't fit a snapshot");
+        }
+        if (! m_pdo_image.Open(m_options.pdo_image_shm, *layout)) {
+            BOOST_THROW_EXCEPTION(Exception("Failed to create PDO image region ") << m_options.pdo_image_shm);
+        }
+    }
+
+    //! Сохраняет цикл в очередь записи: копирование образа PDO без системных вызовов. Вызывается потоком обмена
+    void record_cycle(uint64_t cycle, uint64_t app_time, const CycleTimeInfo& timing, uint32_t dcsync,
+                      bool slow_received) {
+        CycleRecord* record = m_recorder.Claim();
+        if (! record) {
+            return;
         }
 
-        m_sys_info = sysinfo;
+        record->cycle = cycle;
+        record->app_time_ns = app_time;
+        record->latency_ns = timing.latency_ns;
+        record->period_ns = timing.period_ns;
+        record->exec_ns = timing.exec_ns;
+        record->dcsync = dcsync;
+        record->wc_state[kFastDomain] = m_domain_state[kFastDomain].wc_state;
+        record->wc_state[kSlowDomain] = m_domain_state[kSlowDomain].wc_state;
+        record->slow_received = slow_received;
+
+        uint8_t* image = CycleRecorder::Image(record);
+        std::memcpy(image, m_domain_data[kFastDomain], m_record_fast_size);
+        std::memcpy(image + m_record_fast_size, m_domain_data[kSlowDomain], m_record_slow_size);
+        m_recorder.Publish();
+    }
 
-        return true;
+    //! Публикует снимок образа PDO цикла. Вызывается потоком обмена
+    void publish_pdo_image(uint64_t cycle, uint64_t app_time, bool slow_received) {
+        PdoImageFrame frame = PdoImageFrame();
+        frame.cycle = cycle;
+        frame.app_time_ns = app_time;
+        frame.wc_state[kFastDomain] = m_domain_state[kFastDomain].wc_state;
+        frame.wc_state[kSlowDomain] = m_domain_state[kSlowDomain].wc_state;
+        frame.slow_received = slow_received;
+        m_pdo_image.Publish(frame, m_domain_data[kFastDomain], m_domain_data[kSlowDomain]);
     }
 
-    bool is_system_ready(const SystemStatus& s) const {
-        for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-            if (! s.axes[axis].IsReady()) {
-                return false;
-            }
+    //! Ставит событие в очередь диспетчера, если на его тип есть подписка. Вызывается потоком обмена
+    void push_event(const Event& event) {
+        if (! (m_event_mask.load(std::memory_order_relaxed) & event.type)) {
+            return;
+        }
+        Event* slot = m_events.PushClaim();
+        if (! slot) {
+            m_events_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
+        *slot = event;
+        m_events.PushClaimed();
+        ++m_events_pending;
+    }
 
-        return true;
+    /*! @brief Сравнивает состояние оси с предыдущим циклом и ставит в очередь обнаруженные события
+     *
+     *  @param  slow_received   На этом цикле пришли данные медленного домена (status.error_code актуален)
+     */
+    void detect_axis_events(int32_t axis, AxisState prev_state, uint16_t prev_statusword, const AxisStatus& status,
+                            bool slow_received, uint64_t time_ns) {
+        Event event = Event();
+        event.axis = static_cast<Axis>(axis);
+        event.state = status.state;
+        event.prev_state = prev_state;
+        event.statusword = status.statusword;
+        event.error_code = status.error_code;
+        event.time_ns = time_ns;
+
+        const uint16_t rising = status.statusword & ~prev_statusword;
+        const uint16_t falling = prev_statusword & ~status.statusword;
+        if (prev_state != status.state) {
+            event.type = EVENT_AXIS_STATE;
+            push_event(event);
+        }
+        if (rising & kStatusTargetReached) {
+            event.type = EVENT_TARGET_REACHED;
+            push_event(event);
+        }
+        // Бит Fault приходит в быстром домене, код ошибки - в медленном: событие ждет ближайшего обмена
+        // медленного домена, чтобы error_code соответствовал ошибке (или сброса ошибки до него)
+        if (rising & kStatusFault) {
+            m_fault_event_pending[axis] = true;
+            m_fault_event_time_ns[axis] = time_ns;
+        }
+        if (m_fault_event_pending[axis] && (slow_received || (falling & kStatusFault))) {
+            event.type = EVENT_FAULT_RAISED;
+            event.time_ns = m_fault_event_time_ns[axis];
+            push_event(event);
+            event.time_ns = time_ns;
+            m_fault_event_pending[axis] = false;
+        }
+        if (falling & kStatusFault) {
+            event.type = EVENT_FAULT_CLEARED;
+            push_event(event);
+        }
     }
 
-    bool is_axis_valid(const Axis& axis) const {
-        return (axis >= Axis::AXIS_MIN) && (axis < Axis::AXIS_COUNT);
+    //! Будит диспетчер, если за цикл появились события. Один системный вызов на цикл
+    void flush_events() {
+        if (m_events_pending) {
+            m_events_pending = 0;
+            signal_event_fd();
+        }
     }
 
-    static int32_t vel_deg2pulse(double vel_deg) {
-        const int32_t vel_pulse = static_cast<decltype(vel_pulse)>(vel_deg * kPulsesPerDegree);
-        return vel_pulse;
+    void signal_event_fd() {
+        const uint64_t one = 1;
+        if (::write(m_event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_RT_ERROR("Failed to signal event fd: {}", errno);
+        }
     }
 
-    static double vel_pulse2deg(int32_t vel_pulse) {
-        return static_cast<double>(vel_pulse) / kPulsesPerDegree;
+    //! Объединение масок всех подписок (под m_subs_mutex)
+    void update_event_mask() {
+        uint32_t mask = 0;
+        for (const Subscription& sub: m_subs) {
+            mask |= sub.mask;
+        }
+        m_event_mask.store(mask, std::memory_order_relaxed);
     }
 
-    static int32_t pos_deg2pulse(double tgt_pos_deg, int32_t cur_pos_pulse) {
-        const static int32_t kPulsesPerHalfTurn = kPulsesPerTurn / 2;
+    //! Поток-диспетчер: ждет сигнала потока обмена и вызывает callback'и подписок
+    void DispatchEvents() {
+        while (! m_stop_flag.load(std::memory_order_acquire)) {
+            pollfd pfd = { m_event_fd, POLLIN, 0 };
+            ::poll(&pfd, 1, kEventPollTimeoutMs);
 
-        // Нормализуем количество градусов к диапазону [0, 360)
-        tgt_pos_deg = std::fmod(tgt_pos_deg, static_cast<decltype(tgt_pos_deg)>(kDegPerTurn));
-        if (tgt_pos_deg < 0) {
-            tgt_pos_deg = static_cast<decltype(tgt_pos_deg)>(kDegPerTurn) + tgt_pos_deg;
+            uint64_t counter = 0;
+            if (::read(m_event_fd, &counter, sizeof(counter)) < 0 && errno != EAGAIN) {
+                LOG_ERROR("Failed to read event fd: " << errno);
+            }
+            deliver_events();
         }
+        deliver_events();
+    }
 
-        const int32_t local_tgt_pos_pulse = static_cast<decltype(local_tgt_pos_pulse)>(tgt_pos_deg * kPulsesPerDegree);
+    void deliver_events() {
+        std::lock_guard<std::mutex> dispatch_guard(m_dispatch_mutex);
 
-        int32_t res_pos_pulse = 0;
-        if (cur_pos_pulse >= 0) {
-            const int32_t local_cur_pos_pulse = cur_pos_pulse % kPulsesPerTurn;
-            const int32_t roundl_cur_pos_pulse = cur_pos_pulse - local_cur_pos_pulse;
+        const size_t count = m_events.Size();
+        if (count) {
+            std::vector<Subscription> subs;
+            {
+                std::lock_guard<std::mutex> guard(m_subs_mutex);
+                subs = m_subs;
+            }
 
-            if (local_tgt_pos_pulse >= local_cur_pos_pulse) {
-                if (local_tgt_pos_pulse - local_cur_pos_pulse >= kPulsesPerHalfTurn) {
-                    res_pos_pulse = roundl_cur_pos_pulse - kPulsesPerTurn + local_tgt_pos_pulse;
-                } else {
-                    res_pos_pulse = roundl_cur_pos_pulse + local_tgt_pos_pulse;
-                }
-            } else {
-                if (local_cur_pos_pulse - local_tgt_pos_pulse >= kPulsesPerHalfTurn) {
-                    res_pos_pulse = roundl_cur_pos_pulse + kPulsesPerTurn + local_tgt_pos_pulse;
-                } else {
-                    res_pos_pulse = roundl_cur_pos_pulse + local_tgt_pos_pulse;
+            for (size_t i = 0; i < count; ++i) {
+                const Event& event = m_events.At(i);
+                for (const Subscription& sub: subs) {
+                    if (! (sub.mask & event.type)) {
+                        continue;
+                    }
+                    try {
+                        sub.callback(event);
+                    } catch (const std::exception& ex) {
+                        LOG_ERROR("Event callback of subscription " << sub.id << " failed: " << ex.what());
+                    }
                 }
             }
-        } else {
-            const int32_t local_cur_pos_pulse = kPulsesPerTurn + (cur_pos_pulse % kPulsesPerTurn);
-            const int32_t roundl_cur_pos_pulse = cur_pos_pulse - local_cur_pos_pulse;
+            m_events.Pop(count);
+        }
 
-            if (local_tgt_pos_pulse >= local_cur_pos_pulse) {
-                if (local_tgt_pos_pulse - local_cur_pos_pulse >= kPulsesPerHalfTurn) {
-                    res_pos_pulse = roundl_cur_pos_pulse - kPulsesPerTurn + local_tgt_pos_pulse;
-                } else {
-                    res_pos_pulse = roundl_cur_pos_pulse + local_tgt_pos_pulse;
-                }
-            } else {
-                if (local_cur_pos_pulse - local_tgt_pos_pulse >= kPulsesPerHalfTurn) {
-                    res_pos_pulse = roundl_cur_pos_pulse + kPulsesPerTurn + local_tgt_pos_pulse;
-                } else {
-                    res_pos_pulse = roundl_cur_pos_pulse + local_tgt_pos_pulse;
+        const uint64_t dropped = m_events_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_events_dropped_seen) {
+            LOG_WARN("Event queue overflow: " << dropped - m_events_dropped_seen << " events dropped");
+            m_events_dropped_seen = dropped;
+        }
+    }
+
+    /*! @brief Абсолютная позиция подчиненного оси axis в кольце.
+     *  SlaveConfig::position отсчитывается от первого подчиненного с алиасом SlaveConfig::alias
+     *  (при нулевом алиасе - от начала кольца), а master_sdo_upload/download принимают абсолютную позицию.
+     */
+    uint16_t resolve_ring_position(int32_t axis) {
+        const SlaveConfig& slave = m_options.slaves[axis];
+        ec_master_info_t master_info;
+        if (int err = m_ec.master(m_master, &master_info)) {
+            BOOST_THROW_EXCEPTION(Exception("Failed to obtain master info, err=") << err);
+        }
+
+        uint32_t base = 0;
+        ec_slave_info_t slave_info;
+        if (slave.alias) {
+            for (base = 0; base < master_info.slave_count; ++base) {
+                if (! m_ec.master_get_slave(m_master, base, &slave_info) && slave_info.alias == slave.alias) {
+                    break;
                 }
             }
         }
 
-        return res_pos_pulse;
+        const uint32_t position = base + slave.position;
+        if (position >= master_info.slave_count || m_ec.master_get_slave(m_master, position, &slave_info)
+                || slave_info.vendor_id != slave.vendor_id || slave_info.product_code != slave.product_code) {
+            BOOST_THROW_EXCEPTION(Exception("Slave not found on the bus for axis=") << axis
+                                  << " alias=" << slave.alias << " position=" << slave.position
+                                  << " slave_count=" << master_info.slave_count);
+        }
+        return static_cast<uint16_t>(position);
     }
 
-    static double pos_pulse2deg(int32_t axis, int32_t pos_pulse) {
-        const bool is_pos_negative = (pos_pulse < 0);
-        const int32_t local_pos_pulse = pos_pulse % kPulsesPerTurn;
+    //! Читает статическую информацию оси axis в m_sys_info. Вызывается потоком настройки подчиненного
+    bool read_axis_info(int32_t axis) {
+        AxisInfo& info = m_sys_info.axes[axis];
+        const uint16_t position = m_slave_ring_pos[axis];
+
+        int result = 0;
+        size_t result_size = 0;
+        uint32_t abort_code;
+        const size_t kStrLen = 1024;
+        char str[kStrLen];
+        result |= m_ec.master_sdo_upload(m_master, position, 0x2002, 0, reinterpret_cast<uint8_t*>(&(info.encoder_resolution)), sizeof(info.encoder_resolution), &result_size, &abort_code);
+
+        result |= m_ec.master_sdo_upload(m_master, position, 0x1008, 0, reinterpret_cast<uint8_t*>(&str[0]), kStrLen, &result_size, &abort_code);
+        if (result_size) {
+            info.dev_name = std::string(str, result_size);
+            result_size = 0;
+        }
 
-        double local_pos_deg = static_cast<double>(local_pos_pulse) / kPulsesPerDegree;
-        if (is_pos_negative) {
-            local_pos_deg += static_cast<double>(kDegPerTurn); // [-360, 0) -> [0, 360)
+        result |= m_ec.master_sdo_upload(m_master, position, 0x1009, 0, reinterpret_cast<uint8_t*>(&str[0]), kStrLen, &result_size, &abort_code);
+        if (result_size) {
+            info.hw_version = std::string(str, result_size);
+            result_size = 0;
         }
-        if (Axis::ELEVATION_AXIS == axis && local_pos_deg >= 180.0) {
-            local_pos_deg -= static_cast<double>(kDegPerTurn); // [0, 360) -> [-180,180)
+
+        result |= m_ec.master_sdo_upload(m_master, position, 0x100A, 0, reinterpret_cast<uint8_t*>(&str[0]), kStrLen, &result_size, &abort_code);
+        if (result_size) {
+            info.sw_version = std::string(str, result_size);
+            result_size = 0;
         }
-        return local_pos_deg;
-    }
 
-    uint64_t get_app_time() {
-        const uint64_t since_epoch_ns = boost::chrono::system_clock::now().time_since_epoch().count();
-        const uint64_t since_1_1_2000_ns = since_epoch_ns - kEpoch112000DiffNs;
+        // Серийный номер нужен только для кэша параметров: его отсутствие не ошибка
+        if (m_ec.master_sdo_upload(m_master, position, 0x1018, 4, reinterpret_cast<uint8_t*>(&info.serial_number), sizeof(info.serial_number), &result_size, &abort_code)) {
+            info.serial_number = 0;
+        }
 
-        return since_1_1_2000_ns;
+        return ! result;
     }
 
-    void supply_app_time() {
-        const uint64_t app_time = get_app_time();
-        ecrt_master_application_time(m_master, app_time);
-    }
+    //! Настройка текущего (циклического) потока: политика планирования, привязка к ядру, стек.
+    void setup_realtime_thread() {
+        if (m_options.cpu_affinity >= 0) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(m_options.cpu_affinity, &cpuset);
+            const int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset);
+            if (! ret) {
+                LOG_INFO("Polling thread pinned to CPU " << m_options.cpu_affinity);
+            } else {
+                LOG_WARN("Failed to pin polling thread to CPU " << m_options.cpu_affinity << ": " << ret);
+            }
+        }
 
-    bool create_sdo_requests() {
-        for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-            // Temperature
-            m_temperature_sdo[axis] = ecrt_slave_config_create_sdo_request(m_slave_cfg[axis], 0x2610, 0, 2);
-            if (! m_temperature_sdo[axis]) {
-                return false;
+        if (m_options.sched_policy != SCHED_POLICY_OTHER) {
+            const int policy = (m_options.sched_policy == SCHED_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR;
+            sched_param param{m_options.sched_priority};
+            const int ret = ::pthread_setschedparam(::pthread_self(), policy, &param);
+            if (! ret) {
+                LOG_INFO("Setup scheduling params for polling thread OK");
+            } else {
+                LOG_WARN("Setup scheduling params for polling thread failed: " << ret);
             }
-            // @todo Вынести в настройки
-            ecrt_sdo_request_timeout(m_temperature_sdo[axis], 10000 /*ms*/);
+        }
 
+        if (m_options.stack_prefault_bytes) {
+            prefault_stack(m_options.stack_prefault_bytes);
+        }
+
+        // Буфер LOG_RT потока создается до начала цикла
+        common::RtLogRegisterThread();
+    }
+
+    //! Заранее отображаем страницы стека, чтобы первое обращение к ним не происходило в цикле.
+    static void __attribute__((noinline)) prefault_stack(uint32_t bytes) {
+        volatile uint8_t* stack = static_cast<volatile uint8_t*>(alloca(bytes));
+        for (uint32_t i = 0; i < bytes; i += kPageSize) {
+            stack[i] = 0;
+        }
+    }
+
+    static void update_timing_info(CycleTimeInfo& timing_info) {
+        if (timing_info.latency_ns > timing_info.latency_max_ns) {
+            timing_info.latency_max_ns = timing_info.latency_ns;
+        }
+        if (timing_info.latency_ns < timing_info.latency_min_ns) {
+            timing_info.latency_min_ns = timing_info.latency_ns;
+        }
+        if (timing_info.period_ns > timing_info.period_max_ns) {
+            timing_info.period_max_ns = timing_info.period_ns;
+        }
+        if (timing_info.period_ns && timing_info.period_ns < timing_info.period_min_ns) {
+            timing_info.period_min_ns = timing_info.period_ns;
+        }
+        if (timing_info.exec_ns > timing_info.exec_max_ns) {
+            timing_info.exec_max_ns = timing_info.exec_ns;
+        }
+        if (timing_info.exec_ns < timing_info.exec_min_ns) {
+            timing_info.exec_min_ns = timing_info.exec_ns;
+        }
+    }
+
+    bool is_system_ready(const SystemStatus& s) const {
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            if (! s.axes[axis].IsReady()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool is_axis_valid(const Axis& axis) const {
+        return (axis >= Axis::AXIS_MIN) && (axis < m_axis_count);
+    }
+
+    static int32_t vel_deg2pulse(double vel_deg) {
+        const int32_t vel_pulse = static_cast<decltype(vel_pulse)>(vel_deg * kPulsesPerDegree);
+        return vel_pulse;
+    }
+
+    //! @brief Ближайшая к cur_pos_pulse позиция [импульсы], соответствующая углу tgt_pos_deg
+    static int32_t pos_deg2pulse(double tgt_pos_deg, int32_t cur_pos_pulse) {
+        return PosDeg2Pulse(tgt_pos_deg, cur_pos_pulse);
+    }
+
+    //! Параметры с подставленными значениями, зависящими от периода цикла
+    static ControlOptions resolve_options(const ControlOptions& options) {
+        ControlOptions resolved = options;
+        if (resolved.sync0_shift_ns < 0) {
+            resolved.sync0_shift_ns = resolved.cycle_period_ns / 8;
+        }
+        return resolved;
+    }
+
+    //! Системное время в базе DC [наносекунды с 01.01.2000]
+    static uint64_t get_system_time() {
+        const uint64_t since_epoch_ns = boost::chrono::system_clock::now().time_since_epoch().count();
+        const uint64_t since_1_1_2000_ns = since_epoch_ns - kEpoch112000DiffNs;
+
+        return since_1_1_2000_ns;
+    }
+
+    //! Application time [наносекунды с 01.01.2000], монотонное
+    uint64_t get_app_time() const {
+        return CycleScheduler::Now() + m_app_time_offset_ns;
+    }
+
+    /*! @brief Передает application time и кладет в очередь отправки датаграммы синхронизации часов DC.
+     *
+     *  Референсные часы подстраиваются раз в ref_clock_sync_divider циклов (в DC_SYNC_BUS_SHIFT - никогда),
+     *  часы подчиненных - каждый цикл, монитор синхронизации опрашивается раз в sync_monitor_divider циклов.
+     *
+     *  @return В очередь положен запрос монитора синхронизации (его результат - в следующем цикле)
+     */
+    bool queue_dc_sync(const uint64_t app_time, const uint64_t cycle) {
+        m_ec.master_application_time(m_master, app_time);
+        if (DC_SYNC_MASTER_SHIFT == m_options.dc_sync_mode && cycle % m_options.ref_clock_sync_divider == 0) {
+            m_ec.master_sync_reference_clock(m_master);
+        }
+        m_ec.master_sync_slave_clocks(m_master);
+        // ВАЖНО: Кладет в очередь отправки запрос на получение от дочерних узлов значение регистра их оффсета от SystemTime.
+        const bool monitor = m_options.sync_monitor_divider && cycle % m_options.sync_monitor_divider == 0;
+        if (monitor) {
+            m_ec.master_sync_monitor_queue(m_master);
+        }
+        return monitor;
+    }
+
+    bool create_sdo_requests() {
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
             // Sdos for download
             std::map<uint16_t, ec_sdo_request_t*>& axis_write_sdos = m_write_sdos[axis];
             for (const std::pair<uint16_t, uint16_t> sdo_info: kWriteSdoIndices) {
                 const uint16_t& sdo_idx = sdo_info.first;
                 const uint16_t& sdo_data_size = sdo_info.second;
-                ec_sdo_request* sdo_req = ecrt_slave_config_create_sdo_request(m_slave_cfg[axis], sdo_idx, 0, sdo_data_size);
+                ec_sdo_request* sdo_req = m_ec.slave_config_create_sdo_request(m_slave_cfg[axis], sdo_idx, 0, sdo_data_size);
                 if (! sdo_req) {
                     LOG_ERROR("Failed to create sdo idx=" << sdo_idx);
                     return false;
@@ -902,318 +1943,1867 @@ private:
 
                 axis_write_sdos[sdo_idx] = sdo_req;
                 // @todo Вынести в настройки
-                ecrt_sdo_request_timeout(sdo_req, 10000 /*ms*/);
+                m_ec.sdo_request_timeout(sdo_req, 10000 /*ms*/);
             }
+
+            // Таблицы переходов между режимами ссылаются на созданные запросы
+            m_move_mode_tables[axis].Compile(m_move_modes[axis], kWriteSdoIndices, axis_write_sdos);
+
+            // Запросы опроса диагностики; первые опросы разнесены по циклам
+            const std::vector<DiagRegister>& diagnostics = m_options.slaves[axis].diagnostics;
+            for (size_t i = 0; i < diagnostics.size(); ++i) {
+                const DiagRegister& reg = diagnostics[i];
+                ec_sdo_request_t* sdo_req = m_ec.slave_config_create_sdo_request(m_slave_cfg[axis], reg.index, reg.subindex, reg.size);
+                if (! sdo_req) {
+                    LOG_ERROR("Failed to create diagnostic sdo idx=" << reg.index << ":" << static_cast<uint32_t>(reg.subindex));
+                    return false;
+                }
+                m_ec.sdo_request_timeout(sdo_req, kDiagSdoTimeoutMs);
+
+                DiagPoll& poll = m_diag_polls[axis][i];
+                poll.reg = reg;
+                poll.request.sdo = sdo_req;
+                poll.request.write = false;
+                poll.period_cycles = std::max<uint64_t>(1, static_cast<uint64_t>(reg.period_ms) * 1000000 / m_options.cycle_period_ns);
+                poll.next_cycle = axis * kMaxDiagRegisters + i;
+                poll.pending = false;
+
+                DiagValue& value = m_diag.values[axis][i];
+                value.index = reg.index;
+                value.subindex = reg.subindex;
+            }
+            m_diag.counts[axis] = diagnostics.size();
         }
+        m_diagnostics.Store(m_diag);
 
         return true;
     }
 
-    void prerealtime_slave_setup() {
-        uint32_t abort_code = 0;
+    /*! @brief Опрос диагностики: учитывает прочитанные значения и ставит в очередь очередные запросы.
+     *
+     *  Снимок публикуется, только если изменилось значение или признак valid хотя бы одного объекта.
+     *
+     *  @param  cycle       Номер цикла
+     *  @param  time_ns     Время цикла в базе SystemStatus::apptime
+     */
+    void poll_diagnostics(const uint64_t cycle, const uint64_t time_ns) {
+        bool changed = false;
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            bool axis_changed = false;
+            for (uint32_t i = 0; i < m_diag.counts[axis]; ++i) {
+                DiagPoll& poll = m_diag_polls[axis][i];
+                const MailboxRequest::State state = poll.request.state;
+                if (poll.pending && (MailboxRequest::kSuccess == state || MailboxRequest::kError == state)) {
+                    poll.pending = false;
+
+                    DiagValue& value = m_diag.values[axis][i];
+                    const bool valid = MailboxRequest::kSuccess == state;
+                    const int64_t new_value = valid ? read_diag_value(poll.reg, poll.request.sdo) : value.value;
+                    if (valid != value.valid || new_value != value.value) {
+                        if (! valid) {
+                            LOG_RT_WARN("Axis ({}) failed to read diagnostic index=0x{x}", axis, poll.reg.index);
+                        }
+                        value.valid = valid;
+                        value.value = new_value;
+                        value.time_ns = time_ns;
+                        axis_changed = true;
+                    }
+                }
+
+                if (! poll.pending && cycle >= poll.next_cycle) {
+                    poll.pending = m_mailbox.Submit(axis, MAILBOX_PRIORITY_DIAGNOSTICS, &poll.request);
+                    poll.next_cycle = cycle + poll.period_cycles;
+                }
+            }
+
+            if (axis_changed) {
+                Event event = Event();
+                event.type = EVENT_DIAGNOSTICS;
+                event.axis = static_cast<Axis>(axis);
+                event.time_ns = time_ns;
+                push_event(event);
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            m_diag.time_ns = time_ns;
+            m_diagnostics.Store(m_diag);
+        }
+    }
+
+    int64_t read_diag_value(const DiagRegister& reg, ec_sdo_request_t* sdo_req) {
+        const uint8_t* data = m_ec.sdo_request_data(sdo_req);
+        if (1 == reg.size) {
+            return reg.is_signed ? EC_READ_S8(data) : EC_READ_U8(data);
+        } else if (2 == reg.size) {
+            return reg.is_signed ? EC_READ_S16(data) : EC_READ_U16(data);
+        }
+        return reg.is_signed ? EC_READ_S32(data) : EC_READ_U32(data);
+    }
+
+    //! Запись файла конфигурации для одного подчиненного
+    struct SdoConfigEntry {
+        uint16_t    index;
+        uint8_t     subindex;
+        int32_t     value;
+        uint8_t     size;   //!< [байты]
+    };
+
+    /*! @brief Настройка подчиненных перед запуском обмена.
+     *
+     *  Записи файла конфигурации раскладываются по осям, каждый подчиненный настраивается своим потоком:
+     *  SDO-обмен с разными подчиненными идет параллельно. Пока потоки работают, публикуется прогресс.
+     */
+    void slaves_sdo_setup() {
+        std::vector<std::vector<SdoConfigEntry>> axis_entries(m_axis_count);
+
         const Config::Storage::KeyValueDict& cfg = m_config.GetWholeDict();
         for (auto pair_it = cfg.begin(); pair_it != cfg.end(); ++pair_it) {
             const Config::Storage::Key& key_tup = pair_it->first;
             const Config::Storage::Value& val_tup = pair_it->second;
 
-            const uint16_t axis = boost::get<0>(key_tup);
-            const uint16_t index = boost::get<1>(key_tup);
-            const uint8_t subindex = boost::get<2>(key_tup);
-            int32_t val = boost::get<0>(val_tup);
-            const uint8_t val_size = boost::get<1>(val_tup);
+            const uint16_t axis = boost::get<0>(key_tup);
+            if (axis >= m_axis_count) {
+                BOOST_THROW_EXCEPTION(Exception("Pre-realtime slave setup failed. No slave for axis ") << axis
+                                      << ", axis count=" << m_axis_count);
+            }
+            // Объекты SDO записываются значениями до 4 байт
+            if (boost::get<1>(val_tup) > sizeof(int32_t)) {
+                BOOST_THROW_EXCEPTION(Exception("Pre-realtime slave setup failed. Invalid value size ")
+                                      << static_cast<uint32_t>(boost::get<1>(val_tup)) << " for axis " << axis
+                                      << ", index 0x" << std::hex << boost::get<1>(key_tup));
+            }
+
+            axis_entries[axis].push_back({ boost::get<1>(key_tup), boost::get<2>(key_tup),
+                                           static_cast<int32_t>(boost::get<0>(val_tup)), boost::get<1>(val_tup) });
+        }
+
+        m_init_sdo_total = cfg.size();
+        publish_init_progress(INIT_STAGE_SDO_SETUP);
+
+        std::vector<std::future<void>> workers;
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            workers.push_back(std::async(std::launch::async, &Impl::slave_sdo_setup, this, axis, std::cref(axis_entries[axis])));
+        }
+
+        // Дожидаемся всех потоков, даже если какой-то завершился с ошибкой: они используют данные объекта
+        for (std::future<void>& worker: workers) {
+            while (worker.wait_for(std::chrono::milliseconds(static_cast<uint32_t>(kInitProgressPeriodMs))) != std::future_status::ready) {
+                publish_init_progress(INIT_STAGE_SDO_SETUP);
+            }
+        }
+        publish_init_progress(INIT_STAGE_SDO_SETUP);
+
+        for (std::future<void>& worker: workers) {
+            worker.get();
+        }
+        m_sys_info.axis_count = m_axis_count;
+
+        LOG_INFO("Slave SDO setup: " << m_init_sdo_total << " configuration entries, "
+                 << m_init_sdo_skipped.load(std::memory_order_relaxed) << " already up to date");
+    }
+
+    //! Настройка одного подчиненного: статическая информация, конфигурация, период интерполяции, смещение позиции
+    void slave_sdo_setup(int32_t axis, const std::vector<SdoConfigEntry>& entries) {
+        if (! read_axis_info(axis)) {
+            BOOST_THROW_EXCEPTION(Exception("Read non-realtime system info failed for axis=") << axis);
+        }
+
+        const uint16_t position = m_slave_ring_pos[axis];
+        uint32_t abort_code = 0;
+        for (const SdoConfigEntry& entry: entries) {
+            // Значение, уже записанное в подчиненном, не перезаписываем
+            int32_t cur_val = 0;
+            size_t result_size = 0;
+            const bool up_to_date = ! m_ec.master_sdo_upload(m_master, position, entry.index, entry.subindex,
+                                                             reinterpret_cast<uint8_t*>(&cur_val), entry.size,
+                                                             &result_size, &abort_code)
+                    && result_size == entry.size
+                    && ! std::memcmp(&cur_val, &entry.value, entry.size);
+
+            if (up_to_date) {
+                m_init_sdo_skipped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                int32_t val = entry.value;
+                const int result = m_ec.master_sdo_download(m_master, position, entry.index, entry.subindex,
+                                                            reinterpret_cast<uint8_t*>(&val), entry.size, &abort_code);
+                if (result) {
+                    BOOST_THROW_EXCEPTION(Exception("Pre-realtime slave setup failed. Key=") << axis << ":"
+                                          << entry.index << ":" << static_cast<uint16_t>(entry.subindex)
+                                          << " = "
+                                          << entry.value << ":" << static_cast<uint16_t>(entry.size)
+                                          << ", abort_code=" << abort_code);
+                }
+            }
+
+            // Добавляем в текущие значения 'значимых' параметров для оси
+            if (kWriteSdoIndices.find(entry.index) != kWriteSdoIndices.end()) {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_cur_params[axis][entry.index] = entry.value;
+            }
+
+            m_init_sdo_done.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /* Период интерполяции для режима Cyclic synchronous position: 0x60C2:01 - мантисса, 0x60C2:02 - порядок [с].
+         * Не все прошивки поддерживают этот объект, поэтому ошибка записи не критична.
+         */
+        uint32_t interpolation_period = m_options.cycle_period_ns;
+        int8_t interpolation_exp = -9;
+        while (interpolation_period > 0xFF && interpolation_period % 10 == 0) {
+            interpolation_period /= 10;
+            ++interpolation_exp;
+        }
+        if (interpolation_period <= 0xFF) {
+            uint8_t period_value = interpolation_period;
+            const bool written = ! m_ec.master_sdo_download(m_master, position, kInterpolationPeriodIdx, 1, &period_value, 1, &abort_code)
+                    && ! m_ec.master_sdo_download(m_master, position, kInterpolationPeriodIdx, 2,
+                                                  reinterpret_cast<uint8_t*>(&interpolation_exp), 1, &abort_code);
+            if (! written) {
+                LOG_WARN("Failed to set interpolation period for axis=" << axis << ", abort_code=" << abort_code);
+            }
+        } else {
+            LOG_WARN("Cycle period " << m_options.cycle_period_ns << " ns can't be set as interpolation period");
+        }
+
+        // Get absolute-relative position offset for axes
+        const int32_t rel_pos = upload_register(axis, 0x6064, 0);
+        const int32_t abs_pos = upload_register(axis, 0x260D, 0);
+        m_pos_abs_rel_off[axis] = (rel_pos % kPulsesPerTurn) - abs_pos;
+    }
+
+    int32_t upload_register(int32_t axis, uint16_t index, uint8_t subindex) {
+        uint32_t abort_code;
+        size_t result_size;
+        int32_t value;
+        const int err = m_ec.master_sdo_upload(m_master, m_slave_ring_pos[axis], index, subindex, reinterpret_cast<uint8_t*>(&value), sizeof(value), &result_size, &abort_code);
+        if (err) {
+            BOOST_THROW_EXCEPTION(Exception("Pre-realtime slave setup: failed to upload value for axis=") << axis
+                                  << " index=" << index << "/" << static_cast<uint16_t>(subindex)
+                                  << " abort_code=" << abort_code);
+        }
+
+        return value;
+    }
+
+    //! Публикует этап и прогресс инициализации. Вызывается только потоком инициализации до запуска потока обмена
+    void publish_init_progress(const InitStage stage) {
+        SystemStatus s = m_sys_status.Load();
+        s.init_stage = stage;
+        s.init_sdo_total = m_init_sdo_total;
+        s.init_sdo_done = m_init_sdo_done.load(std::memory_order_relaxed);
+        s.init_sdo_skipped = m_init_sdo_skipped.load(std::memory_order_relaxed);
+        m_sys_status.Store(s);
+    }
+
+    //! Завершает future инициализации (повторные вызовы игнорируются)
+    void finish_init(bool success) {
+        if (! m_init_finished.exchange(true)) {
+            m_init_promise.set_value(success);
+        }
+    }
+
+    /*! @brief Разбирает пришедшие данные в статус.
+     *
+     *  @param  slow_received   На этом цикле пришли данные медленного домена: иначе поля медленных PDO
+     *                          в sys остаются прежними
+     */
+    void process_received_data(SystemStatus& sys, bool slow_received, uint64_t apptime, uint64_t reftime, uint32_t dcsync) {
+
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            // sys - копия статуса прошлого цикла: с ней сравниваем новое состояние для событий
+            const AxisState prev_state = sys.axes[axis].state;
+            const uint16_t prev_statusword = sys.axes[axis].statusword;
+
+            // Читаем данные PDO для двигателя c индексом axis ядром разбора текущей раскладки
+            m_decode_fast_pdo(m_domain_data[kFastDomain], m_pdo_off, axis, sys.axes[axis]);
+
+            // Градусы вычисляет читатель статуса (AxisStatus::*Deg())
+            sys.axes[axis].pos_offset = m_pos_abs_rel_off[axis] + m_pos_abs_usr_off[axis];
+            sys.axes[axis].signed_pos_deg = m_options.slaves[axis].signed_pos_deg;
+
+            if (sys.axes[axis].mode == OP_MODE_POINT) {
+                sys.axes[axis].state = AxisState::AXIS_POINT;
+            } else if (sys.axes[axis].mode == OP_MODE_SCAN) {
+                sys.axes[axis].state = AxisState::AXIS_SCAN;
+            } else if (sys.axes[axis].mode == OP_MODE_TRACK) {
+                sys.axes[axis].state = AxisState::AXIS_TRACK;
+            } else if (sys.axes[axis].mode == OP_MODE_IDLE) {
+                sys.axes[axis].state = AxisState::AXIS_IDLE;
+            } else {
+                sys.axes[axis].state = AxisState::AXIS_ERROR;
+            }
+            if (slow_received) {
+                const uint8_t* slow_data = m_domain_data[kSlowDomain];
+                sys.axes[axis].cur_pos_abs = EC_READ_S32(slow_data + m_pdo_off.ro_act_pos_abs[axis]);
+                sys.axes[axis].cur_torq = EC_READ_S16(slow_data + m_pdo_off.ro_act_torq[axis]);
+                sys.axes[axis].error_code = EC_READ_U16(slow_data + m_pdo_off.ro_err_code[axis]);
+                sys.axes[axis].cur_temperature = EC_READ_S16(slow_data + m_pdo_off.ro_temperature[axis]);
+            }
+            // Код ошибки между обновлениями медленного домена берется последний полученный
+            if (sys.axes[axis].error_code) {
+                sys.axes[axis].state = AxisState::AXIS_ERROR;
+            }
+
+            // Отладочные данные
+            sys.axes[axis].params_mode = m_params_mode[axis].load(std::memory_order_relaxed);
+            sys.axes[axis].move_mode = m_cur_move_mode[axis].load(std::memory_order_relaxed);
+            sys.axes[axis].params_pending = m_params_txn[axis].active;
+            sys.axes[axis].params_failures = m_params_txn_aborts[axis].load(std::memory_order_relaxed);
+
+            const TrajectoryRing& traj_queue = m_traj_queues[axis];
+            const size_t traj_size = traj_queue.Size();
+            const uint64_t traj_end_time = traj_size ? traj_queue.At(traj_size - 1).time_ns + m_stream[axis].time_shift_ns : 0;
+            const uint64_t traj_time = apptime + kEpoch112000DiffNs;
+            sys.axes[axis].traj_buffered = traj_size;
+            sys.axes[axis].traj_lookahead_ns = traj_end_time > traj_time ? traj_end_time - traj_time : 0;
+            sys.axes[axis].traj_underruns = m_stream[axis].underruns;
+
+            detect_axis_events(axis, prev_state, prev_statusword, sys.axes[axis], slow_received, apptime + kEpoch112000DiffNs);
+        }
+
+        sys.reftime = reftime + kEpoch112000DiffNs;
+        sys.apptime = apptime + kEpoch112000DiffNs;
+        sys.dcsync = dcsync;
+        sys.axis_count = m_axis_count;
+        sys.pdo_layout = m_options.pdo_layout;
+
+        const bool any_axis_error = std::any_of(std::begin(sys.axes), std::begin(sys.axes) + m_axis_count, [](const AxisStatus& axis) {
+            return AxisState::AXIS_ERROR == axis.state;
+        });
+        if (! any_axis_error) {
+            sys.state = SystemState::SYSTEM_OK;
+        } else {
+            sys.state = SystemState::SYSTEM_ERROR;
+        }
+
+        m_sys_status.Store(sys);
+    }
+
+    /*! @brief Останавливает все оси по сторожевому таймеру потока обмена.
+     *
+     *  Очереди команд и траектории очищаются, приводам передается Quick stop (торможение с рампой
+     *  0x6085 и отключение). Начатая транзакция записи параметров продолжает отслеживаться.
+     */
+    void watchdog_halt(SystemStatus& sys, const uint64_t app_time, const uint32_t missed_deadlines) {
+        LOG_RT_ERROR("Watchdog: halting all axes, {} deadlines missed in a row", missed_deadlines);
+
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            EC_WRITE_U8 (m_domain_data[kFastDomain] + m_pdo_off.rw_act_mode[axis], OP_MODE_IDLE);
+            EC_WRITE_U16(m_domain_data[kFastDomain] + m_pdo_off.rw_ctrl[axis],     kCtrlQuickStop);
+            m_cur_move_mode[axis].store(kMoveModeInvalid, std::memory_order_relaxed);
+            leave_csp(axis, discard_commands(axis, m_tx_queues[axis].Size()));
+        }
+        ++sys.watchdog_trips;
+
+        Event event = Event();
+        event.type = EVENT_WATCHDOG;
+        event.axis = AXIS_NONE;
+        event.time_ns = app_time + kEpoch112000DiffNs;
+        push_event(event);
+    }
+
+    /*! @brief Поток сторожевого таймера: проверяет, что поток обмена завершает циклы.
+     *
+     *  Если за watchdog_cycles периодов не завершилось ни одного цикла, запрашивает остановку осей, которую
+     *  поток обмена выполнит в первом же цикле после возобновления работы.
+     */
+    void WatchCyclicPolling() {
+        const std::chrono::nanoseconds timeout(static_cast<uint64_t>(m_options.cycle_period_ns) * m_options.watchdog_cycles);
+        uint64_t last_heartbeat = 0;
+        bool stalled = false;
+
+        std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+        while (! m_watchdog_cv.wait_for(lock, timeout, [this]() { return m_stop_flag.load(std::memory_order_acquire); })) {
+            // Пока поток обмена ждет перехода подчиненных в OP, счетчик циклов равен 0
+            const uint64_t heartbeat = m_heartbeat.load(std::memory_order_acquire);
+            if (heartbeat && heartbeat == last_heartbeat) {
+                if (! stalled) {
+                    LOG_ERROR("Watchdog: cyclic polling thread completed no cycles in " << m_options.watchdog_cycles
+                              << " periods (cycle " << heartbeat << ")");
+                    m_watchdog_request.store(true, std::memory_order_release);
+                    stalled = true;
+                }
+            } else {
+                stalled = false;
+            }
+            last_heartbeat = heartbeat;
+        }
+    }
+
+    // Условием для "разрешения" работы с осью является
+    // 1) Нет ошибки по оси
+    // 2) Статус содержит флаг, что предыдущая команда принята прихода в точку принята.
+    // 3) Нет незавершенной транзакции записи параметров оси.
+    /*! @brief Передает подчиненным новые команды из очередей осей.
+     *
+     *  @param  defer_noncritical   Бюджет времени цикла исчерпан: передача мастеру запросов SDO
+     *                              откладывается до следующего цикла
+     */
+    void prepare_new_commands(const SystemStatus& sys, const bool defer_noncritical) {
+        // Уставка, записанная в этом цикле, применяется приводом по следующему SYNC0
+        const uint64_t setpoint_time = sys.apptime + m_options.cycle_period_ns;
+
+        // Состояние запросов SDO, выполнявшихся мастером с прошлого цикла
+        m_mailbox.Complete();
+
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            TXCmdRing& axis_queue = m_tx_queues[axis];
+
+            // Следим за выполнением ранее начатой транзакции записи параметров
+            if (m_params_txn[axis].active) {
+                poll_params_txn(axis, m_cycles_cur);
+            }
+
+            if (sys.axes[axis].mode == OP_MODE_POINT) {
+                if ((sys.axes[axis].statusword & 0x7) == 0x7) {
+                    if (m_cycles_cmd_start[axis]) {
+                        LOG_RT_DEBUG("Axis ({}) command data exchanged in {} cycles", axis, m_cycles_cur - m_cycles_cmd_start[axis]);
+                        m_cycles_cmd_start[axis] = 0;
+                    }
+                } else if ((sys.axes[axis].statusword & 0x8) == 0x8) { // Fault occurred
+                    // Proceed to be able to reset fault
+                    m_cycles_cmd_start[axis] = 0;
+                } else if (m_cycles_cmd_start[axis] && (m_cycles_cur - m_cycles_cmd_start[axis] > kMaxAxisReadyCycles)) {
+                    // Привод не подтвердил команду: сообщаем и передаем следующую, чтобы очередь не встала
+                    LOG_RT_ERROR("Axis ({}) command not acknowledged in {} cycles", axis, m_cycles_cur - m_cycles_cmd_start[axis]);
+                    Event event = Event();
+                    event.type = EVENT_COMMAND_TIMEOUT;
+                    event.axis = static_cast<Axis>(axis);
+                    event.state = sys.axes[axis].state;
+                    event.prev_state = sys.axes[axis].state;
+                    event.statusword = sys.axes[axis].statusword;
+                    event.error_code = sys.axes[axis].error_code;
+                    event.time_ns = sys.apptime;
+                    push_event(event);
+                    m_cycles_cmd_start[axis] = 0;
+                } else {
+                    continue;
+                }
+            }
+
+            const size_t queue_size = axis_queue.Size();
+            if (! queue_size) {
+                continue;
+            }
+
+            // If idle command queued - give it the highest priority
+            bool flush_queue = false;
+            for (size_t i = 0; i < queue_size; ++i) {
+                const TXCmd& txcmd = axis_queue.At(i);
+                if (txcmd.type == TXCmd::kCmd && txcmd.op_mode == OP_MODE_IDLE) {
+                    EC_WRITE_U8 (m_domain_data[kFastDomain] + m_pdo_off.rw_act_mode[axis], txcmd.op_mode);
+                    EC_WRITE_U16(m_domain_data[kFastDomain] + m_pdo_off.rw_ctrl[axis],     txcmd.ctrlword);
+                    m_cur_move_mode[axis].store(kMoveModeInvalid, std::memory_order_relaxed);
+                    flush_queue = true;
+                }
+            }
+            if (flush_queue) {
+                // Remove all commands from queue
+                m_cycles_cmd_start[axis] = 0;
+                leave_csp(axis, discard_commands(axis, queue_size));
+                continue;
+            }
+
+            // Команды, следующие за набором параметров, ждут подтверждения записи всего набора
+            if (m_params_txn[axis].active) {
+                continue;
+            }
+
+            const TXCmd& txcmd = axis_queue.Front();
+            if (TXCmd::kCmd == txcmd.type && txcmd.op_mode == OP_MODE_TRACK) {
+                start_tracking(axis, sys.axes[axis]);
+            } else if (TXCmd::kCmd == txcmd.type) {
+                leave_csp(axis, txcmd.epoch);
+                if (txcmd.op_mode == OP_MODE_IDLE) {
+                    EC_WRITE_U8 (m_domain_data[kFastDomain] + m_pdo_off.rw_act_mode[axis], txcmd.op_mode);
+                    EC_WRITE_U16(m_domain_data[kFastDomain] + m_pdo_off.rw_ctrl[axis],     txcmd.ctrlword);
+                } else if (txcmd.op_mode == OP_MODE_POINT) {
+                    EC_WRITE_U8 (m_domain_data[kFastDomain] + m_pdo_off.rw_act_mode[axis], txcmd.op_mode);
+                    EC_WRITE_U16(m_domain_data[kFastDomain] + m_pdo_off.rw_ctrl[axis],     txcmd.ctrlword);
+                    EC_WRITE_S32(m_domain_data[kFastDomain] + m_pdo_off.rw_tgt_pos[axis],  txcmd.tgt_pos);
+
+                    m_cycles_cmd_start[axis] = m_cycles_cur;
+                } else if (txcmd.op_mode == OP_MODE_SCAN) {
+                    EC_WRITE_U8 (m_domain_data[kFastDomain] + m_pdo_off.rw_act_mode[axis], txcmd.op_mode);
+                    EC_WRITE_U16(m_domain_data[kFastDomain] + m_pdo_off.rw_ctrl[axis],     txcmd.ctrlword);
+                    EC_WRITE_S32(m_domain_data[kFastDomain] + m_pdo_off.rw_tgt_vel[axis],  txcmd.tgt_vel);
+                }
+                // Удаляем команду из очереди
+                axis_queue.Pop();
+            } else if (TXCmd::kSetParams == txcmd.type) {
+                start_params_txn(axis, m_cycles_cur);
+            } else if (TXCmd::kStream == txcmd.type && txcmd.sync_axes) {
+                if (txcmd.stream_start == m_stream[axis].cancelled_start) {
+                    // Точки отмененного перемещения удаляются вместе с его командой
+                    stop_streaming(axis, txcmd.epoch + 1);
+                    axis_queue.Pop();
+                } else {
+                    start_coordinated(txcmd.sync_axes, txcmd.stream_start, sys, setpoint_time);
+                }
+            } else if (TXCmd::kStream == txcmd.type) {
+                start_streaming(axis, sys.axes[axis]);
+            } else {
+                assert(false);
+            }
+        }
+
+        // Очередная точка траектории для осей в режиме "Слежение"
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            if (! m_track_active[axis]) {
+                continue;
+            }
+            if ((sys.axes[axis].statusword & 0x8) == 0x8) { // Fault occurred
+                leave_csp(axis, 0);
+                continue;
+            }
+            const double tgt_pos = m_stream[axis].active ? stream_step(axis, setpoint_time - m_stream[axis].time_shift_ns)
+                                                         : m_trackers[axis].Step();
+            EC_WRITE_S32(m_domain_data[kFastDomain] + m_pdo_off.rw_tgt_pos[axis], static_cast<int32_t>(std::lround(tgt_pos)));
+        }
+
+        poll_diagnostics(m_cycles_cur, sys.apptime);
+
+        // Очередные запросы SDO - мастеру, в пределах бюджета mailbox
+        if (! defer_noncritical) {
+            m_mailbox.Issue(m_cycles_cur);
+        }
+
+        ++m_cycles_cur;
+    }
+
+    /*! @brief Обрабатывает идущие подряд в начале очереди команды режима "Слежение".
+     *
+     *  При входе в режим траектория начинается из текущих запрашиваемых приводом позиции и скорости,
+     *  поэтому переход из других режимов (в том числе на ходу) выполняется без скачка. Из нескольких
+     *  накопившихся команд действует последняя цель.
+     */
+    void start_tracking(const int32_t axis, const AxisStatus& status) {
+        TXCmdRing& axis_queue = m_tx_queues[axis];
+        JerkLimitedTracker& tracker = m_trackers[axis];
+
+        enter_csp(axis, status);
+        // Генератор траектории продолжает движение из последней точки потока уставок
+        stop_streaming(axis, axis_queue.Front().epoch);
+
+        while (! axis_queue.Empty()
+               && TXCmd::kCmd == axis_queue.Front().type
+               && OP_MODE_TRACK == axis_queue.Front().op_mode) {
+            tracker.SetTarget(axis_queue.Front().tgt_pos);
+            axis_queue.Pop();
+        }
+    }
+
+    /*! @brief Начинает движение по потоку уставок, переданному через SubmitTrajectory().
+     *
+     *  Сами точки уже лежат в m_traj_queues: команды kStream только включают обработку точек своего
+     *  и более ранних поколений.
+     */
+    void start_streaming(const int32_t axis, const AxisStatus& status) {
+        TXCmdRing& axis_queue = m_tx_queues[axis];
+
+        enter_csp(axis, status);
+        StreamState& stream = m_stream[axis];
+        if (! stream.active) {
+            stream.active = true;
+            stream.started = false;
+            stream.underrun = false;
+            stream.time_shift_ns = 0;
+        }
+
+        while (! axis_queue.Empty() && TXCmd::kStream == axis_queue.Front().type && ! axis_queue.Front().sync_axes) {
+            stream.epoch = std::max(stream.epoch, axis_queue.Front().epoch);
+            axis_queue.Pop();
+        }
+    }
+
+    /*! @brief Включает согласованное перемещение (MoveCoordinated) на всех его осях в одном цикле.
+     *
+     *  Перемещение ждет, пока его команда kStream окажется в начале очередей всех осей и у осей не останется
+     *  незавершенных транзакций записи параметров. Если к этому моменту время первой точки уже прошло, все
+     *  оси сдвигают метки времени точек на одну и ту же величину: перемещение начинается с начала, без скачка.
+     */
+    void start_coordinated(const uint32_t sync_axes, const uint64_t stream_start, const SystemStatus& sys,
+                           const uint64_t setpoint_time) {
+        uint64_t time_shift = setpoint_time > stream_start ? setpoint_time - stream_start : 0;
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            if (! (sync_axes & (1U << axis))) {
+                continue;
+            }
+            const TXCmdRing& axis_queue = m_tx_queues[axis];
+            if (m_params_txn[axis].active || axis_queue.Empty() || TXCmd::kStream != axis_queue.Front().type
+                || axis_queue.Front().sync_axes != sync_axes || axis_queue.Front().stream_start != stream_start) {
+                return;
+            }
+            // Продолжение предыдущего перемещения идет в его шкале времени
+            if (m_stream[axis].active && m_stream[axis].group) {
+                time_shift = m_stream[axis].time_shift_ns;
+            }
+        }
+
+        for (int32_t axis = AXIS_MIN; axis < m_axis_count; ++axis) {
+            if (! (sync_axes & (1U << axis))) {
+                continue;
+            }
+            enter_csp(axis, sys.axes[axis]);
+            StreamState& stream = m_stream[axis];
+            if (! stream.active) {
+                stream.active = true;
+                stream.started = false;
+                stream.underrun = false;
+                stream.time_shift_ns = time_shift;
+            }
+            stream.group = sync_axes;
+            stream.epoch = std::max(stream.epoch, m_tx_queues[axis].Front().epoch);
+            m_tx_queues[axis].Pop();
+        }
+    }
+
+    /*! @brief Удаляет count команд из начала очереди оси, не выполняя их.
+     *
+     *  Согласованные перемещения, включение которых удалено, отменяются и на остальных их осях: их команды
+     *  kStream там пропускаются вместе с точками.
+     *
+     *  @return Поколение, точки до которого относятся к удаленным командам (для leave_csp)
+     */
+    uint64_t discard_commands(const int32_t axis, const size_t count) {
+        TXCmdRing& axis_queue = m_tx_queues[axis];
+        uint64_t epoch = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const TXCmd& txcmd = axis_queue.At(i);
+            epoch = std::max(epoch, txcmd.epoch + 1);
+            if (TXCmd::kStream != txcmd.type || ! txcmd.sync_axes) {
+                continue;
+            }
+            for (int32_t other = AXIS_MIN; other < m_axis_count; ++other) {
+                if (other != axis && (txcmd.sync_axes & (1U << other))) {
+                    m_stream[other].cancelled_start = txcmd.stream_start;
+                }
+            }
+        }
+        axis_queue.Pop(count);
+        return epoch;
+    }
+
+    //! Включает режим Cyclic synchronous position, если он еще не включен
+    void enter_csp(const int32_t axis, const AxisStatus& status) {
+        if (m_track_active[axis]) {
+            return;
+        }
+
+        // Без запрашиваемых значений в PDO (PDO_LAYOUT_DEMAND) движение продолжается от текущих
+        if (status.mode == OP_MODE_IDLE) {
+            m_trackers[axis].Reset(status.cur_pos, 0.0);
+        } else if (m_options.pdo_layout & PDO_LAYOUT_DEMAND) {
+            m_trackers[axis].Reset(status.dmd_pos, status.dmd_vel);
+        } else {
+            m_trackers[axis].Reset(status.cur_pos, status.cur_vel);
+        }
+        EC_WRITE_U8 (m_domain_data[kFastDomain] + m_pdo_off.rw_act_mode[axis], OP_MODE_TRACK);
+        EC_WRITE_U16(m_domain_data[kFastDomain] + m_pdo_off.rw_ctrl[axis],     0xF);
+        m_track_active[axis] = true;
+    }
+
+    //! Выходит из режима Cyclic synchronous position, @param epoch см. stop_streaming
+    void leave_csp(const int32_t axis, const uint64_t epoch) {
+        m_track_active[axis] = false;
+        stop_streaming(axis, epoch);
+    }
+
+    /*! Прекращает движение по потоку уставок и удаляет включенные точки и точки поколений до epoch:
+     *  точки, поставленные после команды поколения epoch, остаются для следующих команд kStream.
+     *  Согласованное перемещение без одной из осей теряет смысл: остальные его оси тоже останавливаются.
+     */
+    void stop_streaming(const int32_t axis, uint64_t epoch) {
+        StreamState& stream = m_stream[axis];
+        const uint32_t group = stream.group;
+        stream.active = false;
+        stream.group = 0;
+
+        epoch = std::max(epoch, stream.epoch + 1);
+        TrajectoryRing& traj_queue = m_traj_queues[axis];
+        while (! traj_queue.Empty() && traj_queue.Front().epoch < epoch) {
+            traj_queue.Pop();
+        }
+        // Писатель больше не продолжает удаленные точки
+        if (m_traj_cleared_epoch[axis].load(std::memory_order_relaxed) < epoch - 1) {
+            m_traj_cleared_epoch[axis].store(epoch - 1, std::memory_order_release);
+        }
+
+        for (int32_t other = AXIS_MIN; other < m_axis_count; ++other) {
+            if (group & (1U << other) && m_stream[other].group == group) {
+                stop_streaming(other, 0);
+            }
+        }
+    }
+
+    /*! @brief Уставка потока на момент time [наносекунды с начала Epoch].
+     *
+     *  Между соседними точками позиция интерполируется кубическим полиномом Эрмита по позициям и скоростям.
+     *  Используются только точки, включенные командами kStream (поколения до stream.epoch).
+     *  До первой точки ось стоит на месте. Если точки закончились раньше времени (опустошение буфера),
+     *  генератор траектории плавно останавливает ось в последней точке; движение продолжится, когда
+     *  поступят точки с более поздними временами.
+     */
+    double stream_step(const int32_t axis, const uint64_t time) {
+        TrajectoryRing& queue = m_traj_queues[axis];
+        StreamState& stream = m_stream[axis];
+        JerkLimitedTracker& tracker = m_trackers[axis];
+
+        const auto enabled = [&queue, &stream](const size_t i) {
+            return i < queue.Size() && queue.At(i).epoch <= stream.epoch;
+        };
+
+        // Отбрасываем пройденные отрезки
+        while (enabled(1) && queue.At(1).time_ns <= time) {
+            queue.Pop();
+        }
+
+        if (enabled(1) && queue.Front().time_ns <= time) {
+            const TrajectorySample& p0 = queue.At(0);
+            const TrajectorySample& p1 = queue.At(1);
+            double pos = 0.0;
+            double vel = 0.0;
+            HermiteInterpolate(p0.pos, p0.vel, p1.pos, p1.vel, (p1.time_ns - p0.time_ns) / 1e9,
+                               (time - p0.time_ns) / static_cast<double>(p1.time_ns - p0.time_ns), pos, vel);
+            // Генератор траектории повторяет поток: при его остановке или смене режима движение продолжится без скачка
+            tracker.Reset(pos, vel);
+            stream.started = true;
+            stream.underrun = false;
+            return pos;
+        }
+
+        // Осталась только пройденная точка: останавливаемся в ней
+        if (enabled(0) && queue.Front().time_ns <= time && ! stream.underrun) {
+            tracker.SetTarget(queue.Front().pos);
+            stream.underrun = true;
+            if (stream.started) {
+                ++stream.underruns;
+            }
+        }
+
+        return tracker.Step();
+    }
+
+    /*! @brief Начинает транзакцию записи параметров оси.
+     *
+     *  Транзакцией считаются все идущие подряд в начале очереди команды kSetParams. Записи SDO для всех
+     *  параметров ставятся в очередь планировщика ациклического обмена одновременно: каждый параметр уже
+     *  сопоставлен своему заранее созданному запросу из m_write_sdos. Мастеру запросы передаются в пределах
+     *  бюджета mailbox. Если какой-то из запросов еще выполняется (например, после прерванной транзакции),
+     *  запуск откладывается до следующего цикла.
+     */
+    void start_params_txn(const int32_t axis, const uint64_t cycle) {
+        TXCmdRing& axis_queue = m_tx_queues[axis];
+        ParamsTxn& txn = m_params_txn[axis];
+
+        // Запросы прерванной транзакции, уже переданные мастеру, должны завершиться
+        for (const MailboxRequest& request: txn.requests) {
+            if (MailboxRequest::kBusy == request.state) {
+                return;
+            }
+        }
+
+        txn.size = 0;
+        size_t cmd_count = 0;
+        const size_t queue_size = axis_queue.Size();
+        for (; cmd_count < queue_size && TXCmd::kSetParams == axis_queue.At(cmd_count).type; ++cmd_count) {
+            const SdoParam& param = axis_queue.At(cmd_count).param;
+
+            // Повторная запись того же индекса в рамках транзакции: действует последнее значение
+            SdoParam* entry = std::find_if(txn.entries, txn.entries + txn.size, [&param](const SdoParam& e) {
+                return e.index == param.index;
+            });
+            if (entry == txn.entries + txn.size) {
+                assert(txn.size < kMaxParamsTxnSize);
+                ++txn.size;
+            }
+            *entry = param;
+        }
+
+        for (uint32_t i = 0; i < txn.size; ++i) {
+            if (EC_REQUEST_BUSY == m_ec.sdo_request_state(txn.entries[i].sdo_req)) {
+                return;
+            }
+        }
+
+        for (uint32_t i = 0; i < txn.size; ++i) {
+            const SdoParam& entry = txn.entries[i];
+            uint8_t* data = m_ec.sdo_request_data(entry.sdo_req);
+            if (1 == entry.size) {
+                EC_WRITE_S8(data, entry.value);
+            } else if (2 == entry.size) {
+                EC_WRITE_S16(data, entry.value);
+            } else if (4 == entry.size) {
+                EC_WRITE_S32(data, entry.value);
+            } else {
+                assert(false);
+            }
+
+            // Ставим в очередь запрос на запись SDO
+            MailboxRequest& request = txn.requests[i];
+            request.sdo = entry.sdo_req;
+            request.write = true;
+            const bool submitted = m_mailbox.Submit(axis, MAILBOX_PRIORITY_PARAMS, &request);
+            assert(submitted);
+            (void) submitted;
+        }
+
+        // Удаляем команды транзакции из очереди
+        axis_queue.Pop(cmd_count);
+
+        txn.start_cycle = cycle;
+        txn.active = true;
+    }
+
+    /*! @brief Проверяет состояние запросов активной транзакции записи параметров оси.
+     *
+     *  Транзакция завершается успешно, когда все запросы подтверждены подчиненным. При ошибке любого из
+     *  запросов или по истечении kParamsTxnTimeoutNs транзакция прерывается: текущий режим перемещения
+     *  сбрасывается (следующий SetModeRun запишет весь набор заново), а команды, ожидавшие этих
+     *  параметров, удаляются из очереди.
+     */
+    void poll_params_txn(const int32_t axis, const uint64_t cycle) {
+        ParamsTxn& txn = m_params_txn[axis];
+
+        uint32_t done_count = 0;
+        bool failed = false;
+        for (uint32_t i = 0; i < txn.size; ++i) {
+            const MailboxRequest::State state = txn.requests[i].state;
+            if (MailboxRequest::kSuccess == state) {
+                ++done_count;
+            } else if (MailboxRequest::kError == state) {
+                LOG_RT_ERROR("Axis ({}) failed to write param index=0x{x} value={}", axis, txn.entries[i].index,
+                             txn.entries[i].value);
+                failed = true;
+            }
+        }
+
+        const uint64_t elapsed_cycles = cycle - txn.start_cycle;
+        if (done_count == txn.size) {
+            LOG_RT_DEBUG("Axis ({}) {} params written in {} cycles", axis, txn.size, elapsed_cycles);
+            txn.active = false;
+            return;
+        }
+
+        if (! failed && elapsed_cycles * m_options.cycle_period_ns > kParamsTxnTimeoutNs) {
+            LOG_RT_ERROR("Axis ({}) params write timed out after {} cycles", axis, elapsed_cycles);
+            failed = true;
+        }
+
+        if (failed) {
+            m_cur_move_mode[axis].store(kMoveModeInvalid, std::memory_order_relaxed);
+            m_params_txn_aborts[axis].fetch_add(1, std::memory_order_release);
+
+            // Еще не переданные мастеру запросы не отправляются
+            for (uint32_t i = 0; i < txn.size; ++i) {
+                m_mailbox.Cancel(axis, &txn.requests[i]);
+            }
+
+            TXCmdRing& axis_queue = m_tx_queues[axis];
+            while (! axis_queue.Empty() && TXCmd::kCmd == axis_queue.Front().type) {
+                axis_queue.Pop();
+            }
+            txn.active = false;
+        }
+    }
+
+    bool check_axis_params(const AxisParams& params) {
+        for (const AxisParam& p: params) {
+            if (kWriteSdoIndices.find(p.index) == kWriteSdoIndices.end()) {
+                LOG_ERROR("Writing sdo index=" << std::hex << "0x" << p.index << " is not supported");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // TESTS
+
+    //! Выводит результат проверки в общем для тестов формате
+    static void report_test(bool ok, const std::string& name) {
+        std::cout << "Test " << name << ": " << (ok ? "OK" : "FAILED") << std::endl;
+    }
+
+    //! То же для сравнения с ожидаемым значением: при ошибке выводятся оба значения
+    static void report_test(int64_t result, int64_t expected, const std::string& name) {
+        if (result == expected) {
+            report_test(true, name);
+        } else {
+            std::cout << "Test " << name << ": FAILED (result=" << result
+                      << ", expect=" << expected << ")" << std::endl;
+        }
+    }
+
+    static void TEST_pos_deg2pulse() {
+        report_test(pos_deg2pulse(0, 0), 0, "Zero2zero");
+        report_test(pos_deg2pulse(0, 100000), 0, "Zero2zero2");
+        report_test(pos_deg2pulse(0, 600000), 1048576, "Zero2zero3");
+
+        report_test(pos_deg2pulse(300, 7400000), 7165269, "CurPosPulse>=0,LocalTgtPosPulse>=LocalCurPosPulse,LocalTgt2Cur>=HalfTurn");
+        report_test(pos_deg2pulse(50, 7400000), 7485667, "CurPosPulse>=0,LocalTgtPosPulse>=LocalCurPosPulse,LocalTgt2Cur<HalfTurn");
+
+        report_test(pos_deg2pulse(50, 8300000), 8534243, "CurPosPulse>=0,LocalTgtPosPulse<LocalCurPosPulse,LocalTgt2Cur>=HalfTurn");
+        report_test(pos_deg2pulse(300, 8300000), 8213845, "CurPosPulse>=0,LocalTgtPosPulse<LocalCurPosPulse,LocalTgt2Cur<HalfTurn");
+
+        report_test(pos_deg2pulse(300, -7300000), -7514795, "CurPosPulse<0,TgtPosPulse>=CurPosPulse,Tgt2Cur>=HalfTurn");
+        report_test(pos_deg2pulse(50, -7300000), -7194397, "CurPosPulse<0,TgtPosPulse>=CurPosPulse,Tgt2Cur<HalfTurn");
+
+        report_test(pos_deg2pulse(50, -7400000), -7194397, "CurPosPulse<0,TgtPosPulse<CurPosPulse,Tgt2Cur>=HalfTurn");
+        report_test(pos_deg2pulse(300, -7400000), -7514795, "CurPosPulse<0,TgtPosPulse<CurPosPulse,Tgt2Cur<HalfTurn");
+
+        // Пакетный перевод совпадает с последовательным
+        // 1e6 градусов не помещается в int32 импульсов: пара переводится поэлементно
+        const double batch_deg[] = { 300.0, 50.0, -90.0, 720.5, 1.0e6, 179.9, 0.0 };
+        const size_t batch_size = sizeof(batch_deg) / sizeof(batch_deg[0]);
+        int32_t batch_pulse[batch_size];
+        const int32_t batch_last = PosDeg2PulseBatch(batch_deg, batch_pulse, batch_size, -7400000);
+        int32_t serial_pulse = -7400000;
+        for (size_t i = 0; i < batch_size; ++i) {
+            serial_pulse = pos_deg2pulse(batch_deg[i], serial_pulse);
+            report_test(batch_pulse[i], serial_pulse, "Batch" + std::to_string(i));
+        }
+        report_test(batch_last, serial_pulse, "BatchLast");
+
+        // Пакетный перевод в градусы совпадает с поэлементным (в том числе хвост после векторной части)
+        const int32_t deg_pulse[] = { 0, 7165269, -7514795, kPulsesPerHalfTurn, -1, 8534243, 1048575 };
+        const size_t deg_size = sizeof(deg_pulse) / sizeof(deg_pulse[0]);
+        double batch_deg_out[deg_size];
+        for (const bool signed_deg: { false, true }) {
+            PosPulse2DegBatch(deg_pulse, batch_deg_out, deg_size, 100000, signed_deg);
+            bool same = true;
+            for (size_t i = 0; i < deg_size; ++i) {
+                same = same && batch_deg_out[i] == PosPulse2Deg(deg_pulse[i] - 100000, signed_deg);
+            }
+            report_test(same, signed_deg ? "Pulse2DegBatchSigned" : "Pulse2DegBatch");
+        }
+    }
+
+    static void TEST_move_mode_table() {
+        // Указатели на запросы в таблице только хранятся, поэтому подойдут любые различимые значения
+        const SdoReqMap sdos = {
+            { 0x2100, reinterpret_cast<ec_sdo_request_t*>(0x10) }
+            , { 0x2101, reinterpret_cast<ec_sdo_request_t*>(0x20) }
+            , { 0x6081, reinterpret_cast<ec_sdo_request_t*>(0x30) }
+        };
+        const AxisParamIndexMap sizes = { { 0x2100, 2 }, { 0x2101, 2 }, { 0x6081, 4 } };
+        const MoveModeMap modes = {
+            { 1, { { 0x2100, 10 }, { 0x2101, 20 }, { 0x6081, 1000 }, { 0x1234, 5 } } }
+            , { 5, { { 0x2100, 10 }, { 0x2101, 25 }, { 0x6081, 2000 } } }
+            , { 90, { { 0x2100, 10 }, { 0x2101, 25 }, { 0x6081, 2000 }, { 0x2100, 11 } } }
+        };
+
+        MoveModeTable table;
+        table.Compile(modes, sizes, sdos);
+
+        report_test(table.Size() == 3 && table.Last() == 2 && table.ModeAt(1) == 5, "MoveModeTableModes");
+        report_test(table.Find(5) == 1 && table.Find(6) == MoveModeTable::kInvalidPos, "MoveModeTableFind");
+        report_test(table.Select(0.5) == 0 && table.Select(1.0) == 1 && table.Select(89.9) == 2
+                    && table.Select(90.0) == MoveModeTable::kInvalidPos, "MoveModeTableSelect");
+
+        // Неизвестный индекс 0x1234 отброшен
+        const MoveModeTable::Range full = table.Full(0);
+        report_test(full.second - full.first == 3 && full.first[2].index == 0x6081 && full.first[2].size == 4
+                    && full.first[2].sdo_req == sdos.at(0x6081), "MoveModeTableFull");
+
+        const MoveModeTable::Range same = table.Transition(1, 1);
+        report_test(same.first == same.second, "MoveModeTableTransitionSame");
+
+        const MoveModeTable::Range t01 = table.Transition(0, 1);
+        report_test(t01.second - t01.first == 2 && t01.first[0].index == 0x2101 && t01.first[0].value == 25
+                    && t01.first[1].index == 0x6081 && t01.first[1].value == 2000, "MoveModeTableTransition");
+
+        // Повтор индекса в режиме: действует последнее значение
+        const MoveModeTable::Range t12 = table.Transition(1, 2);
+        report_test(t12.second - t12.first == 1 && t12.first[0].index == 0x2100 && t12.first[0].value == 11,
+                    "MoveModeTableTransitionDuplicate");
+    }
+
+    static void TEST_jerk_limited_tracker() {
+        struct Move {
+            double      start_vel;
+            double      target;
+            double      retarget_time;  // <0 - без смены цели
+            double      retarget;
+            const char* name;
+        };
+        const Move moves[] = {
+            { 0.0, 0.01, -1, 0, "TrackerTinyMove" }
+            , { 0.0, 1.0, -1, 0, "TrackerShortMove" }
+            , { 0.0, 90.0, -1, 0, "TrackerLongMove" }
+            , { -5.0, 10.0, -1, 0, "TrackerReverseStart" }
+            , { 0.0, 90.0, 3.0, -20.0, "TrackerRetarget" }
+        };
+
+        // Ограничения задаются в градусах, траектория рассчитывается в импульсах энкодера, как и в потоке обмена
+        const TrackLimits track_limits = { 10.0, 10.0, 50.0 };
+        const JerkLimitedTracker::Limits limits = { track_limits.max_vel_deg * kPulsesPerDegree
+                                                    , track_limits.max_acc_deg * kPulsesPerDegree
+                                                    , track_limits.max_jerk_deg * kPulsesPerDegree };
+        const double period_s = 0.01;
+        for (const Move& move: moves) {
+            JerkLimitedTracker tracker;
+            tracker.Configure(limits, period_s);
+            tracker.Reset(0.0, move.start_vel * kPulsesPerDegree);
+            tracker.SetTarget(move.target * kPulsesPerDegree);
+
+            double target = move.target * kPulsesPerDegree;
+            double overshoot = 0.0;
+            double prev_acc = 0.0;
+            bool limits_ok = true;
+            for (int32_t cycle = 0; cycle < 6000 && ! tracker.Settled(); ++cycle) {
+                if (move.retarget_time >= 0.0 && cycle == static_cast<int32_t>(move.retarget_time / period_s)) {
+                    target = move.retarget * kPulsesPerDegree;
+                    tracker.SetTarget(target);
+                }
+                tracker.Step();
+                const double dir = target >= 0.0 ? 1.0 : -1.0;
+                overshoot = std::max(overshoot, (tracker.Position() - target) * dir);
+                // Последний шаг (прилипание к цели) может снять остаток ускорения за один цикл
+                const double jerk = std::abs(tracker.Acceleration() - prev_acc) / period_s;
+                limits_ok = limits_ok && std::abs(tracker.Velocity()) <= limits.max_vel * (1 + 1e-9)
+                        && std::abs(tracker.Acceleration()) <= limits.max_acc * (1 + 1e-9)
+                        && (jerk <= limits.max_jerk * (1 + 1e-6) || tracker.Settled());
+                prev_acc = tracker.Acceleration();
+            }
+
+            const bool ok = tracker.Settled() && tracker.Position() == target && overshoot <= 1e-9 && limits_ok;
+            report_test(ok, move.name);
+        }
+    }
+
+    static void TEST_hermite_interpolate() {
+        const auto near = [](double a, double b) {
+            return std::abs(a - b) < 1e-9;
+        };
+
+        double pos = 0.0;
+        double vel = 0.0;
+        HermiteInterpolate(100.0, 10.0, 300.0, 30.0, 2.0, 0.0, pos, vel);
+        report_test(near(pos, 100.0) && near(vel, 10.0), "HermiteStart");
+        HermiteInterpolate(100.0, 10.0, 300.0, 30.0, 2.0, 1.0, pos, vel);
+        report_test(near(pos, 300.0) && near(vel, 30.0), "HermiteEnd");
+        // Равномерное движение интерполируется точно
+        HermiteInterpolate(100.0, 50.0, 200.0, 50.0, 2.0, 0.25, pos, vel);
+        report_test(near(pos, 125.0) && near(vel, 50.0), "HermiteLinear");
+    }
+
+    static void TEST_coordinated_profile() {
+        const CoordinatedProfile::Limits limits = { 10.0 * kPulsesPerDegree, 10.0 * kPulsesPerDegree,
+                                                    50.0 * kPulsesPerDegree };
+        const double dt = 0.001;
+
+        // Прямая: оси проходят отрезок одновременно, отношение перемещений постоянно
+        {
+            const double start[] = { 0.0, 0.0 };
+            const double waypoints[] = { 20.0 * kPulsesPerDegree, 10.0 * kPulsesPerDegree };
+            CoordinatedProfile profile;
+            bool line_ok = profile.Plan(start, waypoints, 1, 2, limits, true) && profile.Duration() > 0.0;
+            for (double t = 0.0; line_ok && t < profile.Duration(); t += dt) {
+                double pos[2], vel[2];
+                profile.Evaluate(0, t, pos[0], vel[0]);
+                profile.Evaluate(1, t, pos[1], vel[1]);
+                line_ok = std::abs(pos[0] - 2.0 * pos[1]) < 1e-6 && std::abs(vel[0] - 2.0 * vel[1]) < 1e-6;
+            }
+            report_test(line_ok, "CoordinatedLine");
+
+            double pos[2], vel[2];
+            profile.Evaluate(0, profile.Duration(), pos[0], vel[0]);
+            profile.Evaluate(1, profile.Duration(), pos[1], vel[1]);
+            report_test(pos[0] == waypoints[0] && pos[1] == waypoints[1] && ! vel[0] && ! vel[1],
+                        "CoordinatedEndpoints");
+        }
+
+        // Угол: со сопряжением путь короче и скорость в промежуточной точке не падает до нуля
+        const double start[] = { 0.0, 0.0 };
+        const double waypoints[] = { 10.0 * kPulsesPerDegree, 0.0, 10.0 * kPulsesPerDegree, 10.0 * kPulsesPerDegree };
+        CoordinatedProfile blended;
+        CoordinatedProfile stopped;
+        const bool planned = blended.Plan(start, waypoints, 2, 2, limits, true)
+                             && stopped.Plan(start, waypoints, 2, 2, limits, false);
+
+        bool limits_ok = planned;
+        double min_speed = limits.max_vel;
+        double prev_vel[2] = { 0.0, 0.0 };
+        for (double t = 0.0; limits_ok && t <= blended.Duration(); t += dt) {
+            double speed = 0.0;
+            for (size_t axis = 0; axis < 2; ++axis) {
+                double pos = 0.0;
+                double vel = 0.0;
+                blended.Evaluate(axis, t, pos, vel);
+                // Ускорение - по конечной разности скоростей, отсюда запас
+                limits_ok = limits_ok && std::abs(vel) <= limits.max_vel * (1 + 1e-9)
+                            && std::abs(vel - prev_vel[axis]) / dt <= limits.max_acc * 1.01;
+                prev_vel[axis] = vel;
+                speed += std::abs(vel);
+            }
+            if (t > blended.Ramp() && t < blended.Duration() - blended.Ramp()) {
+                min_speed = std::min(min_speed, speed);
+            }
+        }
+        report_test(limits_ok, "CoordinatedLimits");
+        report_test(planned && blended.Duration() < stopped.Duration() && min_speed > 0.1 * limits.max_vel,
+                    "CoordinatedBlend");
+
+        // Точки траектории воспроизводят профиль интерполяцией Эрмита с ошибкой меньше импульса
+        std::vector<double> times;
+        blended.SampleTimes(kCoordRampSamples, times);
+        double max_error = 0.0;
+        for (size_t i = 1; i < times.size(); ++i) {
+            const double duration = times[i] - times[i - 1];
+            for (size_t axis = 0; axis < 2; ++axis) {
+                double pos0, vel0, pos1, vel1;
+                blended.Evaluate(axis, times[i - 1], pos0, vel0);
+                blended.Evaluate(axis, times[i], pos1, vel1);
+                for (double frac = 0.125; frac < 1.0; frac += 0.125) {
+                    double pos, vel, exact, exact_vel;
+                    HermiteInterpolate(pos0, vel0, pos1, vel1, duration, frac, pos, vel);
+                    blended.Evaluate(axis, times[i - 1] + frac * duration, exact, exact_vel);
+                    max_error = std::max(max_error, std::abs(pos - exact));
+                }
+            }
+        }
+        report_test(times.size() > 2 && times.front() == 0.0 && times.back() == blended.Duration() && max_error < 1.0,
+                    "CoordinatedSampling");
+    }
+
+    static void TEST_overrun_policy() {
+        constexpr uint32_t kPeriodNs = 1000000;
+        // Сетка циклов начата в прошлом: к первому WaitNext поток опаздывает на 2.5 периода без реального ожидания
+        constexpr uint64_t kLateNs = 3 * kPeriodNs + kPeriodNs / 2;
+
+        // Пропускаются все прошедшие периоды, фаза сетки сохраняется
+        CycleScheduler skip(kPeriodNs, 0, OVERRUN_POLICY_SKIP);
+        const uint64_t skip_start = CycleScheduler::Now() - kLateNs;
+        skip.Start(skip_start);
+        const uint64_t skip_wakeup = skip.WaitNext();
+        report_test(skip.Skipped() >= 3 && (skip_wakeup - skip_start) % kPeriodNs == 0
+                    && CycleScheduler::Now() >= skip_wakeup, "OverrunPolicySkip");
+
+        // Без пропуска опоздавшие циклы начинаются сразу, один за другим
+        CycleScheduler catch_up(kPeriodNs, 0, OVERRUN_POLICY_CATCH_UP);
+        const uint64_t catch_up_start = CycleScheduler::Now() - kLateNs;
+        catch_up.Start(catch_up_start);
+        const uint64_t catch_up_wakeup = catch_up.WaitNext();
+        const uint64_t catch_up_next = catch_up.WaitNext();
+        report_test(0 == catch_up.Skipped() && catch_up_wakeup == catch_up_start + kPeriodNs
+                    && catch_up_next == catch_up_start + 2 * kPeriodNs, "OverrunPolicyCatchUp");
+    }
+
+    static void TEST_dc_bus_shift() {
+        constexpr uint32_t kPeriodNs = 1000000;
+        // Референсные часы спешат на 50 ppm и в начале опережают application time на 20 мкс,
+        // датаграмма доходит до них через 3 мкс после пробуждения
+        const auto ref_clock = [](uint64_t host_time) {
+            return static_cast<uint32_t>(20000 + std::llround((host_time + 3000) * (1.0 + 50e-6)));
+        };
+
+        DcBusShiftController controller(kPeriodNs);
+        uint64_t wakeup_time = kPeriodNs;
+        int64_t app_time_offset = 0;
+        int64_t phase_shift = 0;
+        uint64_t prev_wakeup_time = 0;
+        uint64_t prev_app_time = 0;
+        int32_t max_error = 0;
+        for (int32_t cycle = 0; cycle < 5000; ++cycle) {
+            wakeup_time += kPeriodNs + phase_shift;
+            phase_shift = 0;
+            if (prev_app_time) {
+                const int64_t step = controller.Update(prev_app_time, ref_clock(prev_wakeup_time));
+                app_time_offset += step;
+                phase_shift -= step;
+                if (cycle >= 4000) {
+                    max_error = std::max(max_error, std::abs(controller.Error()));
+                }
+            }
+            prev_wakeup_time = wakeup_time;
+            prev_app_time = wakeup_time + app_time_offset;
+        }
+
+        const bool ok = max_error <= 10;
+        report_test(ok, "DcBusShift");
+    }
+
+    static void TEST_mailbox_scheduler() {
+        // Запросы SDO без мастера: состояние выставляет тест
+        struct FakeSdo {
+            ec_request_state_t state;
+        };
+        EcBackend ec = EcBackend();
+        ec.sdo_request_state = [](ec_sdo_request_t* req) { return reinterpret_cast<FakeSdo*>(req)->state; };
+        ec.sdo_request_write = [](ec_sdo_request_t* req) { reinterpret_cast<FakeSdo*>(req)->state = EC_REQUEST_BUSY; };
+        ec.sdo_request_read = [](ec_sdo_request_t* req) { reinterpret_cast<FakeSdo*>(req)->state = EC_REQUEST_BUSY; };
+
+        FakeSdo sdos[6];
+        MailboxRequest requests[6];
+        for (int i = 0; i < 6; ++i) {
+            sdos[i].state = EC_REQUEST_UNUSED;
+            requests[i].sdo = reinterpret_cast<ec_sdo_request_t*>(&sdos[i]);
+            requests[i].write = true;
+        }
+        const auto complete = [&](int i) {
+            sdos[i].state = EC_REQUEST_SUCCESS;
+        };
+
+        MailboxScheduler mailbox(ec);
+        mailbox.Configure(3, { 1, 2 });
+
+        // Приоритет: запрос безопасности опережает поставленные раньше параметры того же подчиненного
+        mailbox.Submit(0, MAILBOX_PRIORITY_PARAMS, &requests[0]);
+        mailbox.Submit(0, MAILBOX_PRIORITY_PARAMS, &requests[1]);
+        mailbox.Submit(1, MAILBOX_PRIORITY_DIAGNOSTICS, &requests[2]);
+        mailbox.Submit(0, MAILBOX_PRIORITY_SAFETY, &requests[3]);
+        bool ok = ! mailbox.Submit(0, MAILBOX_PRIORITY_SAFETY, &requests[3]);
+        ok = ok && 2 == mailbox.Issue(0);
+        ok = ok && MailboxRequest::kBusy == requests[3].state && MailboxRequest::kBusy == requests[2].state
+             && MailboxRequest::kQueued == requests[0].state;
+        report_test(ok, "MailboxPriority");
+
+        // Бюджет на подчиненного: следующий запрос - только после завершения текущего
+        ok = 0 == mailbox.Issue(1);
+        complete(3);
+        complete(2);
+        mailbox.Complete();
+        ok = ok && MailboxRequest::kSuccess == requests[3].state && 1 == mailbox.Issue(2)
+             && MailboxRequest::kBusy == requests[0].state && 0 == mailbox.Outstanding(1);
+        report_test(ok, "MailboxPerSlaveBudget");
+
+        // Отмена еще не переданного запроса
+        mailbox.Cancel(0, &requests[1]);
+        ok = MailboxRequest::kIdle == requests[1].state && 0 == mailbox.Queued(0);
+        report_test(ok, "MailboxCancel");
+
+        // Обход по кругу: при бюджете в один запрос за цикл подчиненные чередуются,
+        // хотя у первого в очереди есть запросы и свободное место
+        complete(0);
+        mailbox.Complete();
+        mailbox.Configure(3, { 2, 1 });
+        for (int i = 0; i < 6; ++i) {
+            mailbox.Submit(i % 3, MAILBOX_PRIORITY_PARAMS, &requests[i]);
+        }
+        for (uint64_t cycle = 3; cycle < 6; ++cycle) {
+            ok = ok && 1 == mailbox.Issue(cycle);
+        }
+        ok = ok && 1 == mailbox.Outstanding(0) && 1 == mailbox.Outstanding(1) && 1 == mailbox.Outstanding(2);
+        report_test(ok, "MailboxRoundRobin");
+    }
+
+    static void TEST_config_storage() {
+        const std::string text = "# comment\n"
+                                 "1:0x2100:0 = 250:2\n"
+                                 "\n"
+                                 "  0 : 6081 : 0 = -70000 : 4\r\n"
+                                 "1:2100:0=300:2\n";
+        Config::Storage storage;
+        storage.ReadBuffer(text.data(), text.size());
+        const Config::Storage::KeyValueDict& dict = storage.GetWholeDict();
+        const Config::Storage::Key key_0x6081 = boost::make_tuple(0, 0x6081, 0);
+        const Config::Storage::Key key_0x2100 = boost::make_tuple(1, 0x2100, 0);
+        report_test(dict.size() == 2 && Config::Storage::PackKey(dict[0].first) == Config::Storage::PackKey(key_0x6081)
+                    && Config::Storage::PackKey(dict[1].first) == Config::Storage::PackKey(key_0x2100)
+                    && boost::get<0>(storage.GetValue(key_0x2100)) == 300
+                    && boost::get<0>(storage.GetValue(key_0x6081)) == -70000
+                    && boost::get<1>(storage.GetValue(key_0x6081)) == 4
+                    && ! storage.HasKey(boost::make_tuple(0, 0x2100, 0)), "ConfigStorageParse");
+
+        int32_t errors = 0;
+        for (const char* bad: { "0:2100:0 = 1", "0:2100:256 = 1:2", "0:2100 = 1:2", "0:2100:0 = 1:9" }) {
+            try {
+                storage.ReadBuffer(bad, std::strlen(bad));
+            } catch (const Config::Exception&) {
+                ++errors;
+            }
+        }
+        report_test(errors == 4, "ConfigStorageInvalid");
+    }
+
+    static void TEST_cycle_recorder() {
+        const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+        std::unique_ptr<RecordFileHeader> layout(new RecordFileHeader());
+        layout->image_size = 6;
+        layout->fast_image_size = 4;
+        layout->axis_count = 1;
+        layout->entry_count = 2;
+        layout->entries[0] = { 0x6064, 0, 0, 0, 32, kFastDomain };
+        layout->entries[1] = { 0x6077, 0, 0, 4, 16, kSlowDomain };
+
+        // Записей больше, чем ячеек: в файле остаются последние
+        const uint64_t kCapacity = 5;
+        const uint64_t kCount = 8;
+        CycleRecorder recorder;
+        bool opened = recorder.Open(path, *layout, kCapacity);
+        for (uint64_t cycle = 0; opened && cycle < kCount; ++cycle) {
+            CycleRecord* record = recorder.Claim();
+            if (! record) {
+                opened = false;
+                break;
+            }
+            record->cycle = cycle;
+            uint8_t* image = CycleRecorder::Image(record);
+            EC_WRITE_S32(image, -1000 * static_cast<int32_t>(cycle));
+            EC_WRITE_S16(image + 4, -static_cast<int16_t>(cycle));
+            recorder.Publish();
+        }
+        recorder.Close();
+
+        RecordFileReader reader;
+        bool ok = opened && reader.Open(path) && reader.FirstSeq() == kCount - kCapacity && reader.EndSeq() == kCount
+                && reader.Header().dropped_count.load() == 0;
+        for (uint64_t seq = kCount - kCapacity; ok && seq < kCount; ++seq) {
+            const CycleRecord& record = reader.Record(seq);
+            const uint8_t* image = RecordFileReader::Image(record);
+            ok = record.cycle == seq
+                    && RecordFileReader::ReadEntry(image, reader.Header().entries[0], true) == -1000 * static_cast<int64_t>(seq)
+                    && RecordFileReader::ReadEntry(image, reader.Header().entries[1], true) == -static_cast<int64_t>(seq);
+        }
+        reader.Close();
+        boost::filesystem::remove(path);
+        report_test(ok, "CycleRecorderRoundtrip");
+    }
+
+    static void TEST_sim_backend() {
+        ControlOptions options;
+        options.backend = EC_BACKEND_SIM;
+        options.cycle_period_ns = 1000000;
+        options.sched_policy = SCHED_POLICY_OTHER;
+        options.sim.step_ns = 10000000;     // Модель в 10 раз быстрее реального времени
+        options.pdo_image_shm = "/l7na_servotests_" + std::to_string(::getpid());
+        Control control(Config::Storage(), PARAMS_MODE_AUTOMATIC, options);
+
+        bool ok = control.GetInitFuture().get();
+        for (int32_t i = 0; ok && i < 100 && ! control.GetStatusCopy().axes[AZIMUTH_AXIS].IsReady(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        // "Target reached" выставляется и при включении привода, поэтому проверяется позиция
+        std::mutex mutex;
+        std::condition_variable reached_cv;
+        const auto reached = [&control]() {
+            return std::fabs(control.GetStatusCopy().axes[AZIMUTH_AXIS].CurPosDeg() - 10.0) < 0.01;
+        };
+        const uint32_t subscription = control.Subscribe(EVENT_TARGET_REACHED, [&](const Event&) {
+            std::lock_guard<std::mutex> guard(mutex);
+            reached_cv.notify_all();
+        });
+
+        ok = ok && subscription && control.SetModeRun(AZIMUTH_AXIS, 10.0, 0.0);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ok = ok && reached_cv.wait_for(lock, std::chrono::seconds(5), reached);
+        }
+        control.Unsubscribe(subscription);
+
+        const AxisStatus status = control.GetStatusCopy().axes[AZIMUTH_AXIS];
+        report_test(ok && AXIS_POINT == status.state && (status.statusword & kStatusTargetReached),
+                    "SimBackendPointMove");
 
-            const int result = ecrt_master_sdo_download(m_master, axis, index, subindex, reinterpret_cast<uint8_t*>(&val), val_size, &abort_code);
-            if (result) {
-                BOOST_THROW_EXCEPTION(Exception("Pre-realtime slave setup failed. Key=") << axis << ":"
-                                      << index << ":" << static_cast<uint16_t>(subindex)
-                                      << " = "
-                                      << val << ":" << val_size << ", abort_code=" << abort_code);
-            }
+        // Снимок образа PDO читается из разделяемой памяти так же, как из другого процесса
+        {
+            const PdoImageRegion* region = OpenPdoImage(options.pdo_image_shm.c_str());
+            const RecordPdoEntry* statusword = region ? PdoImageFindEntry(*region, AZIMUTH_AXIS, 0x6041, 0) : NULL;
+            const RecordPdoEntry* position = region ? PdoImageFindEntry(*region, AZIMUTH_AXIS, 0x6064, 0) : NULL;
+            uint8_t image[kPdoImageMaxSize];
+            PdoImageFrame frame = PdoImageFrame();
+            const bool copied = statusword && position && PdoImageCopy(*region, image, &frame);
+            report_test(copied && control.GetPdoImage() && frame.cycle > 0
+                        && status.statusword == PdoImageReadEntry(image, *statusword, false)
+                        && status.cur_pos == PdoImageReadEntry(image, *position, true), "SimBackendPdoImage");
+            ClosePdoImage(region);
+        }
 
-            // Добавляем в текущие значения 'значимых' параметров для оси
-            if (kWriteSdoIndices.find(index) != kWriteSdoIndices.end()) {
-                m_cur_params[axis][index] = val;
+        // Траектория, переданная сразу после команды другого режима, не теряется при выполнении этой команды
+        {
+            const SystemStatus start = control.GetStatusCopy();
+            const double start_deg = start.axes[AZIMUTH_AXIS].CurPosDeg();
+            const uint64_t time = start.apptime + 100000000;
+            const std::vector<TrajectoryPoint> points = {
+                { time, start_deg, 0.0 }, { time + 300000000, start_deg + 1.0, 5.0 }, { time + 600000000, start_deg + 2.0, 0.0 }
+            };
+            const auto arrived = [&control, start_deg]() {
+                return std::fabs(control.GetStatusCopy().axes[AZIMUTH_AXIS].CurPosDeg() - start_deg - 2.0) < 0.01;
+            };
+            bool stream_ok = control.SetModeRun(AZIMUTH_AXIS, start_deg, 0.0) && control.SubmitTrajectory(AZIMUTH_AXIS, points);
+            for (int32_t i = 0; stream_ok && i < 300 && ! arrived(); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
+            report_test(stream_ok && arrived() && start.axes[AZIMUTH_AXIS].traj_underruns
+                        == control.GetStatusCopy().axes[AZIMUTH_AXIS].traj_underruns, "SimBackendStreamAfterCommand");
         }
 
-        const auto uploadEthercatRegister = [this](uint16_t axis, uint16_t index, uint8_t subindex) -> int32_t {
-            uint32_t abort_code;
-            size_t result_size;
-            int32_t value;
-            const int err = ecrt_master_sdo_upload(m_master, axis, index, subindex, reinterpret_cast<uint8_t*>(&value), sizeof(value), &result_size, &abort_code);
-            if (err) {
-                BOOST_THROW_EXCEPTION(Exception("Pre-realtime slave setup: failed to upload value for axis=") << axis
-                                      << " index=" << index << "/" << static_cast<uint16_t>(subindex)
-                                      << " abort_code=" << abort_code);
+        // Согласованное перемещение двух осей по точкам траектории
+        {
+            const SystemStatus start = control.GetStatusCopy();
+            CoordinatedWaypoint waypoint = CoordinatedWaypoint();
+            waypoint.pos_deg[AZIMUTH_AXIS] = start.axes[AZIMUTH_AXIS].CurPosDeg() + 3.0;
+            waypoint.pos_deg[ELEVATION_AXIS] = start.axes[ELEVATION_AXIS].CurPosDeg() + 1.0;
+            const auto arrived = [&control, &waypoint]() {
+                const SystemStatus s = control.GetStatusCopy();
+                return std::fabs(s.axes[AZIMUTH_AXIS].CurPosDeg() - waypoint.pos_deg[AZIMUTH_AXIS]) < 0.01
+                       && std::fabs(s.axes[ELEVATION_AXIS].CurPosDeg() - waypoint.pos_deg[ELEVATION_AXIS]) < 0.01;
+            };
+            bool coord_ok = control.MoveCoordinated({ AZIMUTH_AXIS, ELEVATION_AXIS }, { waypoint });
+            for (int32_t i = 0; coord_ok && i < 500 && ! arrived(); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
-
-            return value;
-        };
-
-        // Get absolute-relative position offset for axes
-        for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-            const int32_t rel_pos = uploadEthercatRegister(axis, 0x6064, 0);
-            const int32_t abs_pos = uploadEthercatRegister(axis, 0x260D, 0);
-            m_pos_abs_rel_off[axis] = (rel_pos % kPulsesPerTurn) - abs_pos;
+            const SystemStatus s = control.GetStatusCopy();
+            report_test(coord_ok && arrived() && ! s.axes[AZIMUTH_AXIS].traj_underruns
+                        && ! s.axes[ELEVATION_AXIS].traj_underruns, "SimBackendCoordinatedMove");
         }
-    }
 
-    SystemStatus process_received_data(uint64_t cycle_num, uint64_t apptime, uint64_t reftime, uint32_t dcsync) {
-        SystemStatus sys = m_sys_status.load(std::memory_order_acquire);
-
-        for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-            // Читаем данные PDO для двигателя c индексом axis
-            sys.axes[axis].cur_pos = EC_READ_S32(m_domain_data + m_offro_act_pos[axis]);
-            sys.axes[axis].cur_pos_abs = EC_READ_S32(m_domain_data + m_offro_act_pos_abs[axis]);
+        // Нечисловые позиции отклоняются до перевода в импульсы
+        {
+            const SystemStatus start = control.GetStatusCopy();
+            const std::vector<TrajectoryPoint> points = {
+                { start.apptime + 100000000, std::numeric_limits<double>::quiet_NaN(), 0.0 }
+            };
+            CoordinatedWaypoint waypoint = CoordinatedWaypoint();
+            waypoint.pos_deg[ELEVATION_AXIS] = std::numeric_limits<double>::infinity();
+            report_test(! control.SubmitTrajectory(AZIMUTH_AXIS, points)
+                        && ! control.MoveCoordinated({ AZIMUTH_AXIS, ELEVATION_AXIS }, { waypoint }),
+                        "SimBackendInvalidPosition");
+        }
 
-            sys.axes[axis].tgt_pos = EC_READ_S32(m_domain_data + m_offrw_tgt_pos[axis]);
-            sys.axes[axis].dmd_pos = EC_READ_S32(m_domain_data + m_offro_dmd_pos[axis]);
-            sys.axes[axis].cur_vel = EC_READ_S32(m_domain_data + m_offro_act_vel[axis]);
-            sys.axes[axis].dmd_vel = EC_READ_S32(m_domain_data + m_offro_dmd_vel[axis]);
+        // Диагностика опрашивается по SDO с первых циклов работы
+        const auto diag_ready = [&control]() {
+            const DiagnosticsSnapshot diag = control.GetDiagnostics();
+            return diag.counts[ELEVATION_AXIS] == L7naDiagnostics().size() && diag.values[ELEVATION_AXIS][0].valid
+                   && 0x2605 == diag.values[ELEVATION_AXIS][0].index && 311 == diag.values[ELEVATION_AXIS][0].value
+                   && diag.values[ELEVATION_AXIS][0].time_ns > 0;
+        };
+        bool diag_ok = false;
+        for (int32_t i = 0; ! diag_ok && i < 200; ++i) {
+            diag_ok = diag_ready();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        // Ошибка рассогласования неподвижной оси (период опроса 100 мс) не меняется - время изменения прежнее
+        const uint64_t diag_time = control.GetDiagnostics().values[ELEVATION_AXIS][2].time_ns;
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        report_test(diag_ok && diag_time == control.GetDiagnostics().values[ELEVATION_AXIS][2].time_ns,
+                    "SimBackendDiagnostics");
 
-            sys.axes[axis].cur_pos_deg = pos_pulse2deg(axis, sys.axes[axis].cur_pos - m_pos_abs_rel_off[axis] - m_pos_abs_usr_off[axis]);
-            sys.axes[axis].tgt_pos_deg = pos_pulse2deg(axis, sys.axes[axis].tgt_pos - m_pos_abs_rel_off[axis] - m_pos_abs_usr_off[axis]);
-            sys.axes[axis].dmd_pos_deg = pos_pulse2deg(axis, sys.axes[axis].dmd_pos - m_pos_abs_rel_off[axis] - m_pos_abs_usr_off[axis]);
-            sys.axes[axis].cur_vel_deg = vel_pulse2deg(sys.axes[axis].cur_vel);
-            sys.axes[axis].dmd_vel_deg = vel_pulse2deg(sys.axes[axis].dmd_vel);
+        // Подчиненные не переходят в OP за op_timeout_ms: инициализация завершается ошибкой
+        {
+            ControlOptions op_options = options;
+            op_options.pdo_image_shm.clear();
+            op_options.op_timeout_ms = 50;
+            op_options.sim.op_delay_cycles = 1000000;
+            Control op_control(Config::Storage(), PARAMS_MODE_AUTOMATIC, op_options);
+            std::shared_future<bool> init = op_control.GetInitFuture();
+            const bool resolved = std::future_status::ready == init.wait_for(std::chrono::seconds(5));
+            report_test(resolved && ! init.get() && SystemState::SYSTEM_FATAL_ERROR == op_control.GetStatusCopy().state,
+                        "SimBackendOpTimeout");
+        }
 
-            sys.axes[axis].cur_torq = EC_READ_S16(m_domain_data + m_offro_act_torq[axis]);
-            sys.axes[axis].ctrlword = EC_READ_U16(m_domain_data + m_offrw_ctrl[axis]);
-            sys.axes[axis].statusword = EC_READ_U16(m_domain_data + m_offro_status[axis]);
-            sys.axes[axis].mode = EC_READ_S8(m_domain_data + m_offrw_act_mode[axis]);
-            if (sys.axes[axis].mode == OP_MODE_POINT) {
-                sys.axes[axis].state = AxisState::AXIS_POINT;
-            } else if (sys.axes[axis].mode == OP_MODE_SCAN) {
-                sys.axes[axis].state = AxisState::AXIS_SCAN;
-            } else if (sys.axes[axis].mode == OP_MODE_IDLE) {
-                sys.axes[axis].state = AxisState::AXIS_IDLE;
-            } else {
-                sys.axes[axis].state = AxisState::AXIS_ERROR;
-            }
-            sys.axes[axis].error_code = EC_READ_U16(m_domain_data + m_offro_err_code[axis]);
-            if (sys.axes[axis].error_code) {
-                sys.axes[axis].state = AxisState::AXIS_ERROR;
+        // Бит Fault приходит раньше кода ошибки (медленный домен), но событие передается уже с кодом
+        {
+            ControlOptions fault_options = options;
+            fault_options.pdo_image_shm.clear();
+            fault_options.sim.motor_time_constant_ns = 50000000;   // Двигатель заметно отстает от уставки
+            Config::Storage config;
+            const std::string window = "0:0x6065:0 = 10:4\n";    // Окно ошибки рассогласования 10 импульсов
+            config.ReadBuffer(window.data(), window.size());
+            Control fault_control(config, PARAMS_MODE_AUTOMATIC, fault_options);
+            bool fault_ok = fault_control.GetInitFuture().get();
+            for (int32_t i = 0; fault_ok && i < 100 && ! fault_control.GetStatusCopy().axes[AZIMUTH_AXIS].IsReady(); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
 
-            // Читаем данные sdo
-            ec_request_state_t sdo_req_state = ecrt_sdo_request_state(m_temperature_sdo[axis]);
-            if (sdo_req_state == EC_REQUEST_SUCCESS) {
-                sys.axes[axis].cur_temperature = EC_READ_S16(ecrt_sdo_request_data(m_temperature_sdo[axis]));
-                // @todo Вынести в настройки
-                if (cycle_num % 10000 == 0) {
-                    ecrt_sdo_request_read(m_temperature_sdo[axis]);
+            std::mutex fault_mutex;
+            std::condition_variable fault_cv;
+            bool raised = false;
+            Event fault_event = Event();
+            const uint32_t fault_subscription = fault_control.Subscribe(EVENT_FAULT_RAISED, [&](const Event& event) {
+                std::lock_guard<std::mutex> guard(fault_mutex);
+                if (! raised) {
+                    fault_event = event;
+                    raised = true;
                 }
-            } else if (sdo_req_state == EC_REQUEST_UNUSED) {
-                ecrt_sdo_request_read(m_temperature_sdo[axis]);
+                fault_cv.notify_all();
+            });
+            fault_ok = fault_ok && fault_subscription && fault_control.SetModeRun(AZIMUTH_AXIS, 90.0, 0.0);
+            {
+                std::unique_lock<std::mutex> lock(fault_mutex);
+                fault_ok = fault_ok && fault_cv.wait_for(lock, std::chrono::seconds(5), [&raised]() { return raised; });
             }
+            fault_control.Unsubscribe(fault_subscription);
+            // 0x8611 - код ошибки рассогласования модели
+            report_test(fault_ok && AZIMUTH_AXIS == fault_event.axis && 0x8611 == fault_event.error_code
+                        && (fault_event.statusword & kStatusFault), "SimBackendFaultEventCode");
+        }
+    }
 
-            // Отладочные данные
-            sys.axes[axis].params_mode = m_params_mode[axis];
-            sys.axes[axis].move_mode = m_cur_move_mode[axis];
+    //! Демон и клиент в одном процессе: статус и команды проходят через разделяемую память
+    static void TEST_shm_daemon() {
+        ControlOptions options;
+        options.backend = EC_BACKEND_SIM;
+        options.cycle_period_ns = 1000000;
+        options.sched_policy = SCHED_POLICY_OTHER;
+        options.sim.step_ns = 10000000;
+        Control control(Config::Storage(), PARAMS_MODE_AUTOMATIC, options);
+        bool ok = control.GetInitFuture().get();
+        for (int32_t i = 0; ok && i < 100 && ! control.GetStatusCopy().axes[AZIMUTH_AXIS].IsReady(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
 
-        sys.reftime = reftime + kEpoch112000DiffNs;
-        sys.apptime = apptime + kEpoch112000DiffNs;
-        sys.dcsync = dcsync;
+        const std::string shm_name = "/l7na_servotests_daemon_" + std::to_string(::getpid());
+        std::unique_ptr<Daemon> daemon(new Daemon(control, shm_name, options.cycle_period_ns));
+        Client client;
+        ok = ok && client.Open(shm_name) && client.IsDaemonAlive();
+        report_test(ok && client.GetStatusCopy().axis_count == control.GetStatusCopy().axis_count, "ShmDaemonStatus");
 
-        const bool any_axis_error = std::any_of(std::begin(sys.axes), std::end(sys.axes), [](const AxisStatus& axis) {
-            return AxisState::AXIS_ERROR == axis.state;
-        });
-        if (! any_axis_error) {
-            sys.state = SystemState::SYSTEM_OK;
-        } else {
-            sys.state = SystemState::SYSTEM_ERROR;
+        const auto reached = [&client]() {
+            return std::fabs(client.GetStatusCopy().axes[AZIMUTH_AXIS].CurPosDeg() - 5.0) < 0.01;
+        };
+        bool moved = ok && client.SetModeRun(AZIMUTH_AXIS, 5.0, 0.0);
+        for (int32_t i = 0; moved && i < 500 && ! reached(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
+        report_test(moved && reached() && client.GetCycleTimeInfo().period_max_ns > 0, "ShmDaemonSetModeRun");
 
-        m_sys_status.store(sys, std::memory_order_relaxed);
+        // Ошибка Control возвращается клиенту результатом команды
+        const bool rejected = ! client.SetModeRun(static_cast<Axis>(AXIS_MAX_COUNT), 0.0, 0.0);
+        report_test(rejected && client.SetModeIdle(AZIMUTH_AXIS) && daemon->CommandCount() == 3, "ShmDaemonCommands");
 
-        return sys;
+        // Область работающего демона второй демон не пересоздает
+        bool second_rejected = false;
+        try {
+            Daemon second(control, shm_name, options.cycle_period_ns);
+        } catch (const std::exception&) {
+            second_rejected = true;
+        }
+        report_test(second_rejected && client.IsDaemonAlive(), "ShmDaemonInUse");
+
+        daemon.reset();
+        Client late_client;
+        report_test(! late_client.Open(shm_name), "ShmDaemonStopped");
+
+        // Объект меньше ShmRegion клиент не отображает
+        const std::string short_name = shm_name + "_short";
+        const int short_fd = ::shm_open(short_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        const bool truncated = short_fd >= 0 && ! ::ftruncate(short_fd, 16);
+        if (short_fd >= 0) {
+            ::close(short_fd);
+        }
+        report_test(truncated && ! late_client.Open(short_name), "ShmClientTruncated");
+        ::shm_unlink(short_name.c_str());
     }
 
-    // @todo Записывать все команды для каждой оси в одну датаграмму
-    // Условием для "разрешения" работы с осью является
-    // 1) Нет ошибки по оси
-    // 2) Статус содержит флаг, что предыдущая команда принята прихода в точку принята.
-    // 3) Все SDO-запросы находятся НЕ в состоянии BUSY.
-    void prepare_new_commands(const SystemStatus& sys) {
-        static uint64_t cycles_cur = 0;                         // Номер текущего цикла в рамках работы
-        static uint64_t cycles_cmd_start[AXIS_COUNT] = {0};     // Номер цикла начала ожидания исполнения команды
+    /*! Impl на имитации подчиненных с остановленным потоком обмена: функции цикла вызываются напрямую
+     *  из текущего потока, который становится единственным писателем статуса и читателем очередей команд.
+     */
+    static std::unique_ptr<Impl> make_bench_impl(int32_t axis_count) {
+        ControlOptions options;
+        options.backend = EC_BACKEND_SIM;
+        options.cycle_period_ns = 1000000;
+        options.sched_policy = SCHED_POLICY_OTHER;
+        options.slaves.clear();
+        for (int32_t axis = AXIS_MIN; axis < axis_count; ++axis) {
+            options.slaves.push_back(L7naSlave(axis));
+        }
 
-        std::lock_guard<std::mutex> guard(m_mutex);
-        for (int32_t axis = AXIS_MIN; axis < AXIS_COUNT; ++axis) {
-            if (sys.axes[axis].mode == OP_MODE_POINT) {
-                if ((sys.axes[axis].statusword & 0x7) == 0x7) {
-                    if (cycles_cmd_start[axis]) {
-                        LOG_DEBUG("Axis (" << axis << ") command data exchanged in " << cycles_cur - cycles_cmd_start[axis] << " cycles");
-                        cycles_cmd_start[axis] = 0;
-                    }
-                } else if ((sys.axes[axis].statusword & 0x8) == 0x8) { // Fault occurred
-                    // Proceed to be able to reset fault
-                    cycles_cmd_start[axis] = 0;
-                } else if (cycles_cmd_start[axis] && (cycles_cur - cycles_cmd_start[axis] > kMaxAxisReadyCycles)) {
-                    // @todo Report error
-                    cycles_cmd_start[axis] = 0;
-                } else {
-                    continue;
-                }
-            }
+        std::unique_ptr<Impl> impl(new Impl(Config::Storage(), PARAMS_MODE_MANUAL, options));
+        bool ready = impl->m_init_future.get();
+        for (int32_t i = 0; ready && i < 100 && ! impl->is_system_ready(impl->m_sys_status.Load()); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ready = ready && impl->is_system_ready(impl->m_sys_status.Load());
+
+        impl->m_stop_flag.store(true, std::memory_order_relaxed);
+        if (impl->m_thread) {
+            impl->m_thread->join();
+            impl->m_thread.reset();
+        }
+        if (! ready) {
+            LOG_ERROR("Benchmark setup failed for " << axis_count << " axes");
+            impl.reset();
+        }
+        return impl;
+    }
 
-            if(! m_tx_queues[axis].size()) {
+    static void BENCH_process_received_data(BenchmarkReport& report) {
+        for (const int32_t axis_count: { 1, 2, 4, 8 }) {
+            const std::string name = "process_received_data/axes:" + std::to_string(axis_count);
+            if (! report.Enabled(name)) {
                 continue;
             }
+            std::unique_ptr<Impl> impl = make_bench_impl(axis_count);
+            if (! impl) {
+                continue;
+            }
+            SystemStatus sys = impl->m_sys_status.Load();
+            uint64_t app_time = sys.apptime - kEpoch112000DiffNs;
+            report.Measure(name, 200000, 1000, [&]() {
+                impl->process_received_data(sys, true, app_time, app_time, 0);
+                app_time += impl->m_options.cycle_period_ns;
+            });
+        }
+    }
 
-            // If idle command queued - give it the highest priority
-            bool flush_queue = false;
-            for (const TXCmd& txcmd: m_tx_queues[axis]) {
-                if (txcmd.type == TXCmd::kCmd && txcmd.op_mode == OP_MODE_IDLE) {
-                    EC_WRITE_U8 (m_domain_data + m_offrw_act_mode[axis], txcmd.op_mode);
-                    EC_WRITE_U16(m_domain_data + m_offrw_ctrl[axis],     txcmd.ctrlword);
-                    m_cur_move_mode[axis] = kMoveModeInvalid;
-                    flush_queue = true;
-                }
+    static void BENCH_prepare_new_commands(BenchmarkReport& report) {
+        for (const int32_t axis_count: { 2, 8 }) {
+            const std::string name = "prepare_new_commands/full_queues/axes:" + std::to_string(axis_count);
+            if (! report.Enabled(name)) {
+                continue;
             }
-            if (flush_queue) {
-                // Remove all commands from queue
-                m_tx_queues[axis].clear();
-                cycles_cmd_start[axis] = 0;
+            std::unique_ptr<Impl> impl = make_bench_impl(axis_count);
+            if (! impl) {
                 continue;
             }
-
-            TXCmd txcmd = m_tx_queues[axis].front();
-            if (TXCmd::kCmd == txcmd.type) {
-                if (txcmd.op_mode == OP_MODE_IDLE) {
-                    EC_WRITE_U8 (m_domain_data + m_offrw_act_mode[axis], txcmd.op_mode);
-                    EC_WRITE_U16(m_domain_data + m_offrw_ctrl[axis],     txcmd.ctrlword);
-                } else if (txcmd.op_mode == OP_MODE_POINT) {
-                    EC_WRITE_U8 (m_domain_data + m_offrw_act_mode[axis], txcmd.op_mode);
-                    EC_WRITE_U16(m_domain_data + m_offrw_ctrl[axis],     txcmd.ctrlword);
-                    EC_WRITE_S32(m_domain_data + m_offrw_tgt_pos[axis],  txcmd.tgt_pos);
-
-                    cycles_cmd_start[axis] = cycles_cur;
-                } else if (txcmd.op_mode == OP_MODE_SCAN) {
-                    EC_WRITE_U8 (m_domain_data + m_offrw_act_mode[axis], txcmd.op_mode);
-                    EC_WRITE_U16(m_domain_data + m_offrw_ctrl[axis],     txcmd.ctrlword);
-                    EC_WRITE_S32(m_domain_data + m_offrw_tgt_vel[axis],  txcmd.tgt_vel);
-                }
-                // Удаляем команду из очереди
-                m_tx_queues[axis].pop_front();
-            } else if (TXCmd::kSetParams == txcmd.type) {
-                bool axis_params_set = false;
-                std::map<uint16_t, ec_sdo_request*>& axis_write_sdos = m_write_sdos[axis];
-
-                //! @todo Контролировать выставление параметров осей
-                //! @todo Транзакционность выставления параметров осей
-                while(true) {
-                    // Такой индекс точно должен быть в мапе, мы ранее это проверяли
-                    ec_sdo_request* sdo_req = axis_write_sdos.at(txcmd.param.index);
-                    const ec_request_state_t sdo_state = ecrt_sdo_request_state(sdo_req);
-                    const uint16_t value_size = kWriteSdoIndices.at(txcmd.param.index);
-
-                    //! @todo Infinite loop if state is BUSY all the time
-                    if (EC_REQUEST_BUSY == sdo_state) {
-                        break;
+            const SystemStatus sys = impl->m_sys_status.Load();
+            double pos = 0.0;
+            // Перед каждым вызовом очереди всех осей заполняются (команда "в точку" - две записи очереди)
+            report.MeasureWithSetup(name, 20000, 1, [&]() {
+                for (int32_t axis = AXIS_MIN; axis < axis_count; ++axis) {
+                    while (impl->m_tx_queues[axis].Size() + 2 <= kCmdQueueCapacity
+                           && impl->SetModeRun(static_cast<Axis>(axis), pos, 0.0)) {
+                        pos = pos < 180.0 ? pos + 1.0 : 0.0;
                     }
+                }
+            }, [&]() {
+                impl->prepare_new_commands(sys, false);
+            });
+        }
+    }
 
-                    if (1 == value_size) {
-                        EC_WRITE_S8(ecrt_sdo_request_data(sdo_req), txcmd.param.value);
-                    } else if (2 == value_size) {
-                        EC_WRITE_S16(ecrt_sdo_request_data(sdo_req), txcmd.param.value);
-                    } else if (4 == value_size) {
-                        EC_WRITE_S32(ecrt_sdo_request_data(sdo_req), txcmd.param.value);
-                    } else {
-                        assert(false);
-                    }
-
-                    // Ставим в очередь запрос на запись SDO
-                    ecrt_sdo_request_write(sdo_req);
-
-                    // Устанавливаем флаг произошедшей записи
-                    axis_params_set = true;
-
-                    // Удаляем команду из очереди
-                    m_tx_queues[axis].pop_front();
+    static void BENCH_status_publication(BenchmarkReport& report) {
+        constexpr uint32_t kReadBatch = 100;
+        for (const uint32_t reader_count: { 1u, 4u, 16u }) {
+            const std::string suffix = "/readers:" + std::to_string(reader_count);
+            if (! report.Enabled("status_store" + suffix) && ! report.Enabled("status_load" + suffix)) {
+                continue;
+            }
 
-                    if(! m_tx_queues[axis].size()) {
-                        break;
+            SeqLock<SystemStatus> status;
+            std::atomic<bool> stop(false);
+            std::vector<std::unique_ptr<HistogramRecorder>> recorders;
+            std::vector<uint64_t> loads(reader_count, 0);
+            std::vector<uint64_t> load_ns(reader_count, 0);
+            std::vector<std::thread> readers;
+            for (uint32_t i = 0; i < reader_count; ++i) {
+                recorders.emplace_back(new HistogramRecorder());
+                readers.emplace_back([&, i]() {
+                    // Счетчики локальны для потока: соседние элементы loads/load_ns лежат в одной кэш-линии
+                    uint64_t checksum = 0;
+                    uint64_t local_loads = 0;
+                    uint64_t local_ns = 0;
+                    while (! stop.load(std::memory_order_relaxed)) {
+                        const uint64_t start = CycleScheduler::Now();
+                        for (uint32_t n = 0; n < kReadBatch; ++n) {
+                            checksum += status.Load().apptime;
+                        }
+                        const uint64_t elapsed = CycleScheduler::Now() - start;
+                        recorders[i]->Record(elapsed / kReadBatch);
+                        local_loads += kReadBatch;
+                        local_ns += elapsed;
                     }
+                    BenchmarkKeep(checksum);
+                    loads[i] = local_loads;
+                    load_ns[i] = local_ns;
+                });
+            }
 
-                    // Если следующая команда - установка параметра оси, то пытаемся ее обработать
-                    txcmd = m_tx_queues[axis].front();
-                    if (TXCmd::kSetParams != txcmd.type) {
-                        break;
-                    }
-                }
+            // Писатель публикует статус с периодом цикла 100 мкс: так читатели конкурируют с ним, как в работе
+            SystemStatus sys;
+            HistogramRecorder store_recorder;
+            uint64_t store_ns = 0;
+            constexpr uint32_t kStores = 10000;
+            CycleScheduler scheduler(100000, 0);
+            scheduler.Start();
+            for (uint32_t n = 0; n < kStores; ++n) {
+                scheduler.WaitNext();
+                sys.apptime = n;
+                const uint64_t start = CycleScheduler::Now();
+                status.Store(sys);
+                const uint64_t elapsed = CycleScheduler::Now() - start;
+                store_recorder.Record(elapsed);
+                store_ns += elapsed;
+            }
+            stop.store(true, std::memory_order_relaxed);
+            for (std::thread& reader: readers) {
+                reader.join();
+            }
 
-                // Выходим из цикла обработки осей, в случае, если мы записали хотя бы один параметр для оси,
-                // чтобы не писать информацию по другим осям в этом цикле
-                if (axis_params_set) {
-                    break;
+            DurationHistogram store_hist;
+            store_recorder.Snapshot(store_hist);
+            report.Add("status_store" + suffix, kStores, store_ns, store_hist);
+
+            // Гистограммы читателей объединяются
+            DurationHistogram load_hist;
+            uint64_t total_loads = 0;
+            uint64_t total_load_ns = 0;
+            for (uint32_t i = 0; i < reader_count; ++i) {
+                DurationHistogram reader_hist;
+                recorders[i]->Snapshot(reader_hist);
+                for (uint32_t b = 0; b < DurationHistogram::kBucketCount; ++b) {
+                    load_hist.counts[b] += reader_hist.counts[b];
                 }
-            } else {
-                assert(false);
+                load_hist.total += reader_hist.total;
+                load_hist.sum_ns += reader_hist.sum_ns;
+                load_hist.min_ns = std::min(load_hist.min_ns, reader_hist.min_ns);
+                load_hist.max_ns = std::max(load_hist.max_ns, reader_hist.max_ns);
+                total_loads += loads[i];
+                total_load_ns += load_ns[i];
             }
+            report.Add("status_load" + suffix, total_loads, total_load_ns, load_hist);
         }
-
-        ++cycles_cur;
     }
 
-    bool check_axis_params(const AxisParams& params) {
-        for (const AxisParam& p: params) {
-            if (kWriteSdoIndices.find(p.index) == kWriteSdoIndices.end()) {
-                LOG_ERROR("Writing sdo index=" << std::hex << "0x" << p.index << " is not supported");
-                return false;
-            }
+    static void BENCH_set_mode_run(BenchmarkReport& report) {
+        const std::string name = "SetModeRun/submit";
+        if (! report.Enabled(name)) {
+            return;
         }
-
-        return true;
+        std::unique_ptr<Impl> impl = make_bench_impl(AXIS_COUNT);
+        if (! impl) {
+            return;
+        }
+        double pos = 0.0;
+        // Очередь оси очищается перед каждым вызовом: замеряется только постановка команд
+        report.MeasureWithSetup(name, 100000, 1, [&impl]() {
+            TXCmdRing& queue = impl->m_tx_queues[AZIMUTH_AXIS];
+            queue.Pop(queue.Size());
+        }, [&]() {
+            impl->SetModeRun(AZIMUTH_AXIS, pos, 0.0);
+            pos = pos < 180.0 ? pos + 1.0 : 0.0;
+        });
     }
 
-    MoveMode get_move_mode(const Axis& axis, const double pos_diff_deg) {
-        MoveMode result = kMoveModeInvalid;
+    static void BENCH_pos_conversions(BenchmarkReport& report) {
+        volatile int64_t sink = 0;
+        double deg = 0.0;
+        int32_t pulse = -5 * kPulsesPerTurn;
+        report.Measure("pos_deg2pulse", 10000000, 1000, [&]() {
+            sink += pos_deg2pulse(deg, pulse);
+            deg += 0.37;
+            pulse += 1237;
+        });
+        report.Measure("pos_pulse2deg", 10000000, 1000, [&]() {
+            sink += static_cast<int64_t>(PosPulse2Deg(pulse, true));
+            pulse += 1237;
+        });
 
-        for (const auto& mm_pair: m_move_modes[axis]) {
-            const double mm_val = static_cast<double>(mm_pair.first);
-            if (pos_diff_deg < mm_val) {
-                result = mm_pair.first;
-                break;
-            }
+        // Пакетные преобразования: время перевода всего массива
+        const size_t kBatchSize = 1024;
+        std::vector<int32_t> pulses(kBatchSize);
+        std::vector<double> degs(kBatchSize);
+        for (size_t i = 0; i < kBatchSize; ++i) {
+            pulses[i] = pulse + static_cast<int32_t>(i) * 1237;
+            degs[i] = 0.37 * static_cast<double>(i);
         }
-
-        return result;
+        report.Measure("pos_deg2pulse_batch1024", 20000, 10, [&]() {
+            sink += PosDeg2PulseBatch(degs.data(), pulses.data(), kBatchSize, pulse);
+        });
+        report.Measure("pos_pulse2deg_batch1024", 20000, 10, [&]() {
+            PosPulse2DegBatch(pulses.data(), degs.data(), kBatchSize, 0, true);
+            sink += static_cast<int64_t>(degs[kBatchSize - 1]);
+        });
     }
 
+    static void BENCH_config_read_file(BenchmarkReport& report) {
+        constexpr uint32_t kLineCount = 100000;
+        const std::string name = "Config::Storage::ReadFile/lines:" + std::to_string(kLineCount);
+        if (! report.Enabled(name)) {
+            return;
+        }
 
-    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    // TESTS
+        const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+        {
+            std::ofstream file(path.c_str());
+            file << "# servobench config\n";
+            for (uint32_t i = 0; i < kLineCount; ++i) {
+                file << i % AXIS_MAX_COUNT << ":0x" << std::hex << (0x2000 + i / AXIS_MAX_COUNT % 0x4000) << std::dec
+                     << ":" << i % 4 << " = " << static_cast<int32_t>(i * 7) - 1000 << ":4\n";
+            }
+        }
+        report.Measure(name, 20, 1, [&path]() {
+            Config::Storage config;
+            config.ReadFile(path);
+        });
+        boost::filesystem::remove(path);
+    }
 
-    static void TEST_pos_deg2pulse() {
-        struct TestResultChecker {
-            void operator()(int32_t result, int32_t expected, const std::string& name) {
-                if (result == expected) {
-                    std::cout << "Test " << name << ": OK" << std::endl;
-                } else {
-                    std::cout << "Test " << name << ": FAILED (result=" << result
-                              << ", expect=" << expected << ")" << std::endl;
+    static void TEST_rt_log_format() {
+        common::RtLogRecord record;
+        record.format = "Axis ({}) index=0x{x} value={} ratio={} {} {}";
+        record.level = boost::log::trivial::info;
+        record.arg_count = 0;
+        common::FillRtLogArgs(record, ELEVATION_AXIS, uint16_t(0x60FF), int64_t(-70000), 0.5, "done");
+        report_test(common::FormatRtLogRecord(record) == "Axis (1) index=0x60ff value=-70000 ratio=0.5 done {}",
+                    "RtLogFormat");
+
+        // Время и поток записи - момент и поток вызова LOG_RT, а не фонового вывода
+        struct CaptureBackend : public boost::log::sinks::basic_sink_backend<boost::log::sinks::synchronized_feeding> {
+            void consume(const boost::log::record_view& rec) {
+                if (boost::log::extract<std::string>("Message", rec) == std::string("RT log call site 1")) {
+                    timestamp = boost::log::extract_or_default<boost::posix_time::ptime>("TimeStamp", rec, timestamp);
+                    thread_id = boost::log::extract_or_default<ThreadId>("ThreadID", rec, thread_id);
                 }
             }
-        };
 
-        TestResultChecker checker;
-        checker(pos_deg2pulse(0, 0), 0, "Zero2zero");
-        checker(pos_deg2pulse(0, 100000), 0, "Zero2zero2");
-        checker(pos_deg2pulse(0, 600000), 1048576, "Zero2zero3");
-
-        checker(pos_deg2pulse(300, 7400000), 7165269, "CurPosPulse>=0,LocalTgtPosPulse>=LocalCurPosPulse,LocalTgt2Cur>=HalfTurn");
-        checker(pos_deg2pulse(50, 7400000), 7485667, "CurPosPulse>=0,LocalTgtPosPulse>=LocalCurPosPulse,LocalTgt2Cur<HalfTurn");
-
-        checker(pos_deg2pulse(50, 8300000), 8534243, "CurPosPulse>=0,LocalTgtPosPulse<LocalCurPosPulse,LocalTgt2Cur>=HalfTurn");
-        checker(pos_deg2pulse(300, 8300000), 8213845, "CurPosPulse>=0,LocalTgtPosPulse<LocalCurPosPulse,LocalTgt2Cur<HalfTurn");
-
-        checker(pos_deg2pulse(300, -7300000), -7514795, "CurPosPulse<0,TgtPosPulse>=CurPosPulse,Tgt2Cur>=HalfTurn");
-        checker(pos_deg2pulse(50, -7300000), -7194397, "CurPosPulse<0,TgtPosPulse>=CurPosPulse,Tgt2Cur<HalfTurn");
+            using ThreadId = boost::log::attributes::current_thread_id::value_type;
+            boost::posix_time::ptime timestamp;
+            ThreadId thread_id;
+        };
+        const boost::shared_ptr<CaptureBackend> backend = boost::make_shared<CaptureBackend>();
+        const boost::shared_ptr<boost::log::sinks::synchronous_sink<CaptureBackend>> sink
+                = boost::make_shared<boost::log::sinks::synchronous_sink<CaptureBackend>>(backend);
+        boost::log::core::get()->add_sink(sink);
+
+        CaptureBackend::ThreadId caller_id;
+        boost::posix_time::ptime before, after;
+        std::thread caller([&]() {
+            caller_id = boost::log::aux::this_thread::get_id();
+            before = boost::posix_time::microsec_clock::local_time();
+            LOG_RT_WARN("RT log call site {}", 1);
+            after = boost::posix_time::microsec_clock::local_time();
+        });
+        caller.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        common::RtLogFlush();
+        boost::log::core::get()->remove_sink(sink);
+        report_test(backend->thread_id == caller_id && before <= backend->timestamp && backend->timestamp <= after,
+                    "RtLogCallSite");
+    }
 
-        checker(pos_deg2pulse(50, -7400000), -7194397, "CurPosPulse<0,TgtPosPulse<CurPosPulse,Tgt2Cur>=HalfTurn");
-        checker(pos_deg2pulse(300, -7400000), -7514795, "CurPosPulse<0,TgtPosPulse<CurPosPulse,Tgt2Cur<HalfTurn");
+    static void TEST_fast_pdo_decoder() {
+        uint8_t data[64] = {};
+        PdoOffsets off;
+        const int32_t axis = 1;
+        off.ro_act_pos[axis] = 0;
+        off.rw_tgt_pos[axis] = 4;
+        off.ro_act_vel[axis] = 8;
+        off.rw_ctrl[axis] = 12;
+        off.ro_status[axis] = 14;
+        off.rw_act_mode[axis] = 16;
+        off.ro_dmd_pos[axis] = 20;
+        off.ro_dmd_vel[axis] = 24;
+        off.ro_follow_err[axis] = 28;
+        EC_WRITE_S32(data + 0, -100);
+        EC_WRITE_S32(data + 4, 200);
+        EC_WRITE_S32(data + 8, -5);
+        EC_WRITE_U16(data + 12, 0xF);
+        EC_WRITE_U16(data + 14, 0x1237);
+        EC_WRITE_S8(data + 16, 8);
+        EC_WRITE_S32(data + 20, 150);
+        EC_WRITE_S32(data + 24, 7);
+        EC_WRITE_S32(data + 28, -3);
+
+        AxisStatus full;
+        SelectFastPdoDecoder(PDO_LAYOUT_ALL)(data, off, axis, full);
+        report_test(full.cur_pos == -100 && full.tgt_pos == 200 && full.cur_vel == -5 && full.ctrlword == 0xF
+                    && full.statusword == 0x1237 && full.mode == 8 && full.dmd_pos == 150 && full.dmd_vel == 7
+                    && full.following_error == -3, "FastPdoDecoderAll");
+
+        AxisStatus minimal;
+        minimal.following_error = 1;
+        minimal.dmd_pos = 1;
+        minimal.dmd_vel = 1;
+        SelectFastPdoDecoder(0)(data, off, axis, minimal);
+        report_test(minimal.cur_pos == -100 && minimal.cur_vel == -5 && minimal.dmd_pos == 0 && minimal.dmd_vel == 0
+                    && minimal.following_error == 0, "FastPdoDecoderMinimal");
     }
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1223,14 +3813,24 @@ private:
 
         OP_MODE_IDLE = 0,
         OP_MODE_POINT = 1,
-        OP_MODE_SCAN = 3
+        OP_MODE_SCAN = 3,
+        OP_MODE_TRACK = 8   //!< Cyclic synchronous position
+    };
+
+    //! Домены PDO: обмен быстрым доменом идет каждый цикл, медленным - раз в ControlOptions::slow_pdo_divider циклов
+    enum PdoDomain : int32_t {
+        kFastDomain = 0,
+        kSlowDomain,
+
+        kDomainCount
     };
 
     struct TXCmd {
         enum Type : int8_t {
             kTypeUnknown = -1,
             kSetParams,
-            kCmd
+            kCmd,
+            kStream     //!< Начать движение по точкам из очереди траектории оси
         };
 
         explicit TXCmd(const Type& t = kTypeUnknown)
@@ -1239,6 +3839,9 @@ private:
             , ctrlword(0)
             , op_mode(OP_MODE_INVALID)
             , type(t)
+            , sync_axes(0)
+            , stream_start(0)
+            , epoch(0)
         {}
 
         int32_t tgt_pos;
@@ -1246,43 +3849,237 @@ private:
         uint16_t ctrlword;
         OperationMode op_mode;
         Type type;
-        AxisParam param;
+        SdoParam param;
+        uint32_t sync_axes;     //!< kStream: маска осей, на которых движение включается в одном цикле (0 - только эта ось)
+        uint64_t stream_start;  //!< kStream с sync_axes: время первой точки согласованного перемещения
+        uint64_t epoch;         //!< Поколение очереди траектории оси на момент постановки команды (submit_batch)
     };
 
     Config::Storage                 m_config;       //!< Конфигурация двигателей, задаваемая пользователем
+    const ControlOptions            m_options;      //!< Параметры цикла обмена и потока реального времени
+    const int32_t                   m_axis_count;   //!< Количество осей (подчиненных)
+    const FastPdoDecoder            m_decode_fast_pdo;  //!< Ядро разбора быстрого домена для ControlOptions::pdo_layout
+    const EcBackend&                m_ec;           //!< Функции EtherCAT-мастера (ControlOptions::backend)
+    int64_t                         m_app_time_offset_ns;   //!< Смещение application time относительно CLOCK_MONOTONIC
     std::map<uint16_t, int64_t>     m_sdo_cfg;      //!< Конфигурация SDO
     SystemInfo                      m_sys_info;     //!< Структура с статической информацией о системе
-    std::atomic<SystemStatus>       m_sys_status;   //!< Структура с динамической информацией о системе
-    std::atomic<CycleTimeInfo>      m_timing_info;  //!< Структура с информацией о временных характеристиках работы
+    SeqLock<SystemStatus>           m_sys_status;   //!< Структура с динамической информацией о системе
+    SeqLock<CycleTimeInfo>          m_timing_info;  //!< Структура с информацией о временных характеристиках работы
+    CycleHistogramRecorder          m_histogram;    //!< Распределения временных характеристик работы
+    std::atomic<bool>               m_timing_reset_request;     //!< Запрос на сброс m_timing_info
+    std::atomic<bool>               m_histogram_reset_request;  //!< Запрос на начало нового окна m_histogram
 
     //! Данные для взаимодействия с потоком циклического взаимодействия с сервоусилителями
     std::atomic<bool>               m_stop_flag;    //!< Флаг остановки потока взаимодействия
     std::unique_ptr<std::thread>    m_thread;       //!< Поток циклического обмена данными со сервоусилителями
 
+    //! Асинхронная инициализация
+    std::unique_ptr<std::thread>    m_init_thread;      //!< Поток инициализации (AsyncInit)
+    std::promise<bool>              m_init_promise;
+    std::shared_future<bool>        m_init_future;      //!< Результат инициализации: true - система готова к работе
+    std::atomic<bool>               m_init_finished;    //!< m_init_promise уже выставлен
+    uint32_t                        m_init_sdo_total;   //!< Количество записей конфигурации
+    std::atomic<uint32_t>           m_init_sdo_done;    //!< Обработано записей конфигурации
+    std::atomic<uint32_t>           m_init_sdo_skipped; //!< Не записано записей: значение уже совпадало
+
     constexpr static uint64_t       kMaxAxisReadyCycles     = 8192;
     constexpr static uint64_t       kMaxDomainInitCycles    = 8192;
-    constexpr static int32_t        kPulsesPerTurn          = 1048576; // 2^20
-    constexpr static int32_t        kDegPerTurn             = 360;
-    constexpr static double         kPulsesPerDegree        = 1048576.0 / 360.0;
     constexpr static uint64_t       kEpoch112000DiffNs      = 946684800000000000ULL;
     constexpr static uint32_t       kCmdQueueCapacity       = 128;
-    constexpr static uint32_t       kCyclePeriodNs          = 10000000; // 10ms
+    constexpr static uint32_t       kPageSize               = 4096;
+    constexpr static uint32_t       kTXCmdBatchCapacity     = 32;
+    constexpr static uint32_t       kMinCyclePeriodNs       = 100000; // 100us
+    constexpr static uint16_t       kInterpolationPeriodIdx = 0x60C2;
+    constexpr static uint32_t       kTrajQueueCapacity      = 1024;
+    constexpr static uint32_t       kCoordStartLeadCycles   = 4;    //!< Запас до начала согласованного перемещения [циклы]
+    constexpr static uint32_t       kCoordRampSamples       = 8;    //!< Точек траектории на разгон согласованного перемещения
     constexpr static uint32_t       kRegPerDriveCount       = 12;
     constexpr static MoveMode       kMoveModeInvalid        = -1;
+    constexpr static uint32_t       kMaxParamsTxnSize       = 32;
+    constexpr static uint64_t       kParamsTxnTimeoutNs     = 12000000000ULL; // 12s, больше таймаута SDO-запроса
+    constexpr static uint32_t       kInitProgressPeriodMs   = 100;
+    constexpr static uint16_t       kCommObjectsFirstIdx    = 0x1000;
+    constexpr static uint16_t       kCommObjectsLastIdx     = 0x1FFF;
+    constexpr static uint32_t       kEventQueueCapacity     = 256;
+    constexpr static int            kEventPollTimeoutMs     = 100;
+    constexpr static uint16_t       kStatusFault            = 0x0008;   //!< Statusword, бит 3 "Fault"
+    constexpr static uint16_t       kStatusTargetReached    = 0x0400;   //!< Statusword, бит 10 "Target reached"
+    constexpr static uint16_t       kCtrlQuickStop          = 0x0002;   //!< Controlword, команда "Quick stop"
+    constexpr static uint32_t       kDiagSdoTimeoutMs       = 1000;
+
+    //! Пачка команд, добавляемая в очередь оси целиком
+    struct TXCmdBatch {
+        TXCmdBatch()
+            : size(0)
+            , overflow(false)
+        {}
+
+        void Push(const TXCmd& cmd) {
+            if (size < kTXCmdBatchCapacity) {
+                cmds[size++] = cmd;
+            } else {
+                overflow = true;
+            }
+        }
+
+        TXCmd       cmds[kTXCmdBatchCapacity];
+        uint32_t    size;
+        bool        overflow;
+    };
+
+    using TXCmdRing = SpscRing<TXCmd, kCmdQueueCapacity>;
+
+    /*! @brief Ставит команды в очередь оси (под m_mutex).
+     *
+     *  Команды получают следующее поколение очереди траектории: при выполнении они удаляют только точки,
+     *  переданные до них. После команды kCmd движение по ранее переданным точкам не продолжится, поэтому
+     *  следующая траектория начинается от текущей позиции оси.
+     */
+    bool submit_batch(const Axis& axis, const TXCmdBatch& batch) {
+        if (batch.overflow) {
+            LOG_ERROR("Command batch for axis=" << axis << " exceeds " << kTXCmdBatchCapacity << " commands");
+            return false;
+        }
+
+        TXCmdBatch stamped = batch;
+        const uint64_t epoch = m_traj_epoch[axis] + 1;
+        bool stops_streaming = false;
+        for (uint32_t i = 0; i < stamped.size; ++i) {
+            stamped.cmds[i].epoch = epoch;
+            stops_streaming |= TXCmd::kCmd == stamped.cmds[i].type;
+        }
+
+        if (! m_tx_queues[axis].TryPushBatch(stamped.cmds, stamped.size)) {
+            LOG_WARN("Command queue for axis=" << axis << " is full");
+            return false;
+        }
+        m_traj_epoch[axis] = epoch;
+        if (stops_streaming) {
+            m_traj_last_time_ns[axis] = 0;
+        }
+
+        return true;
+    }
+
+    //! Ранее переданные точки оси еще не пройдены и не удалены: следующие точки продолжают их (под m_mutex)
+    bool traj_pending(const Axis& axis, const SystemStatus& s) const {
+        return m_traj_last_time_ns[axis] > s.apptime
+               && m_traj_cleared_epoch[axis].load(std::memory_order_acquire) < m_traj_last_epoch[axis];
+    }
+
+    /*! @brief Проверяет, что измененную запись конфигурации можно применить без выхода из OP.
+     *
+     *  Во время обмена параметры записываются только заранее созданными SDO-запросами (kWriteSdoIndices).
+     *  Объекты коммуникационной области (0x1000-0x1FFF: раскладка PDO, синхронизация) меняются только вне OP.
+     */
+    bool check_reload_entry(const Config::Storage::Key& key, const Config::Storage::Value& val) const {
+        const uint16_t axis = boost::get<0>(key);
+        const uint16_t index = boost::get<1>(key);
+        const uint16_t subindex = boost::get<2>(key);
+        const uint16_t size = boost::get<1>(val);
+
+        if (axis >= m_axis_count) {
+            LOG_WARN("ReloadConfig() rejected: no slave for axis " << axis << ", axis count=" << m_axis_count);
+            return false;
+        }
+        if (index >= kCommObjectsFirstIdx && index <= kCommObjectsLastIdx) {
+            LOG_WARN("ReloadConfig() rejected: key " << axis << ":" << std::hex << index << std::dec << ":" << subindex
+                     << " is a communication object and can't be changed in OP");
+            return false;
+        }
+        const auto size_it = kWriteSdoIndices.find(index);
+        if (size_it == kWriteSdoIndices.end() || subindex != 0) {
+            LOG_WARN("ReloadConfig() rejected: key " << axis << ":" << std::hex << index << std::dec << ":" << subindex
+                     << " can't be written while running, restart is required");
+            return false;
+        }
+        if (size_it->second != size) {
+            LOG_WARN("ReloadConfig() rejected: key " << axis << ":" << std::hex << index << std::dec << ":" << subindex
+                     << " has size " << size << ", expected " << size_it->second);
+            return false;
+        }
+
+        return true;
+    }
+
+    /*! @brief Добавляет в пачку команды записи параметров из [begin, end), значения которых отличаются от текущих.
+     *
+     *  Если с момента предыдущего вызова какая-либо транзакция оси была прервана, значения в m_cur_params
+     *  могут не соответствовать подчиненному, и записываются все параметры.
+     *  Вызывается под m_mutex.
+     *
+     *  @return Значение счетчика прерванных транзакций, которое нужно передать в commit_params().
+     */
+    uint32_t push_changed_params(const Axis& axis, const SdoParam* begin, const SdoParam* end, TXCmdBatch& batch) {
+        const uint32_t aborts = m_params_txn_aborts[axis].load(std::memory_order_acquire);
+        const bool write_all = aborts != m_params_txn_aborts_seen[axis];
+        const AxisParamValueMap& cur_params = m_cur_params[axis];
+
+        TXCmd txcmd(TXCmd::kSetParams);
+        for (const SdoParam* p = begin; p != end; ++p) {
+            if (! write_all) {
+                const auto cur_it = cur_params.find(p->index);
+                if (cur_it != cur_params.end() && cur_it->second == p->value) {
+                    continue;
+                }
+            }
+            txcmd.param = *p;
+            batch.Push(txcmd);
+        }
+
+        return aborts;
+    }
 
+    /*! @brief Добавляет в пачку команды записи параметров для перехода между режимами перемещения.
+     *
+     *  Если текущий режим известен, записываются только параметры из скомпилированной таблицы переходов,
+     *  иначе - параметры нового режима, отличающиеся от текущих значений. Вызывается под m_mutex.
+     *
+     *  @return Значение счетчика прерванных транзакций, которое нужно передать в commit_params().
+     */
+    uint32_t push_mode_params(const Axis& axis, const uint32_t from_pos, const uint32_t to_pos, TXCmdBatch& batch) {
+        const MoveModeTable& table = m_move_mode_tables[axis];
+        if (MoveModeTable::kInvalidPos == from_pos) {
+            const MoveModeTable::Range params = table.Full(to_pos);
+            return push_changed_params(axis, params.first, params.second, batch);
+        }
+
+        TXCmd txcmd(TXCmd::kSetParams);
+        const MoveModeTable::Range params = table.Transition(from_pos, to_pos);
+        for (const SdoParam* p = params.first; p != params.second; ++p) {
+            txcmd.param = *p;
+            batch.Push(txcmd);
+        }
+
+        // Режим известен только если транзакции не прерывались, поэтому счетчик не изменился
+        return m_params_txn_aborts_seen[axis];
+    }
+
+    //! Запоминает значения параметров, переданных в очередь команд. Вызывается под m_mutex.
+    void commit_params(const Axis& axis, const TXCmdBatch& batch, const uint32_t params_txn_aborts) {
+        for (uint32_t i = 0; i < batch.size; ++i) {
+            if (TXCmd::kSetParams == batch.cmds[i].type) {
+                m_cur_params[axis][batch.cmds[i].param.index] = batch.cmds[i].param.value;
+            }
+        }
+        m_params_txn_aborts_seen[axis] = params_txn_aborts;
+    }
+
+    //! Сериализует пользовательские потоки (писателей очередей команд). Поток обмена его не захватывает.
     mutable std::mutex              m_mutex;
 
-    std::list<TXCmd>                m_tx_queues[AXIS_COUNT]; //!< Очереди команд по осям
+    TXCmdRing                       m_tx_queues[AXIS_MAX_COUNT]; //!< Очереди команд по осям (lock-free, без аллокаций)
+    uint64_t                        m_cycles_cur;   //!< Номер текущего цикла в рамках работы (поток обмена)
+    uint64_t                        m_cycles_cmd_start[AXIS_MAX_COUNT]; //!< Номер цикла начала ожидания исполнения команды
 
     //! Структуры для обмена данными по EtherCAT
     ec_master_t*                    m_master;
     ec_master_state_t               m_master_state;
-    ec_domain_t*                    m_domain;
-    ec_domain_state_t               m_domain_state;
-    uint8_t*                        m_domain_data;
-    ec_slave_config_t*              m_slave_cfg[AXIS_COUNT];
-
-    ec_sdo_request_t*               m_temperature_sdo[AXIS_COUNT];
+    ec_domain_t*                    m_domains[kDomainCount];
+    ec_domain_state_t               m_domain_state[kDomainCount];
+    uint8_t*                        m_domain_data[kDomainCount];
+    ec_slave_config_t*              m_slave_cfg[AXIS_MAX_COUNT];
+    uint16_t                        m_slave_ring_pos[AXIS_MAX_COUNT]; //!< Абсолютные позиции подчиненных в кольце (для SDO)
 
     /* SDO index -> SDO data size */
     const AxisParamIndexMap kWriteSdoIndices = {
@@ -1306,36 +4103,157 @@ private:
         , { 0x6083, 4 }
         , { 0x6084, 4 }
     };
-    using SdoReqMap = std::map<uint16_t, ec_sdo_request_t*>;
-    SdoReqMap                       m_write_sdos[AXIS_COUNT];
-
-    ParamsMode                      m_params_mode[AXIS_COUNT];
-
-    MoveModeMap                     m_move_modes[AXIS_COUNT];
-    MoveMode                        m_cur_move_mode[AXIS_COUNT];
-    AxisParamValueMap               m_cur_params[AXIS_COUNT];
-
-    //! Смещения в данных домена для параметров управления осями.
-    uint32_t                        m_offrw_ctrl[AXIS_COUNT];
-    uint32_t                        m_offro_status[AXIS_COUNT];
-    uint32_t                        m_offrw_tgt_pos[AXIS_COUNT];
-    uint32_t                        m_offro_dmd_pos[AXIS_COUNT];
-    uint32_t                        m_offro_act_pos[AXIS_COUNT];
-    uint32_t                        m_offrw_tgt_vel[AXIS_COUNT];
-    uint32_t                        m_offro_dmd_vel[AXIS_COUNT];
-    uint32_t                        m_offro_act_vel[AXIS_COUNT];
-    uint32_t                        m_offro_act_pos_abs[AXIS_COUNT];
-    uint32_t                        m_offrw_act_mode[AXIS_COUNT];
-    uint32_t                        m_offro_act_torq[AXIS_COUNT];
-    uint32_t                        m_offro_err_code[AXIS_COUNT];
+    SdoReqMap                       m_write_sdos[AXIS_MAX_COUNT];
+
+    std::atomic<ParamsMode>         m_params_mode[AXIS_MAX_COUNT];
+
+    MoveModeMap                     m_move_modes[AXIS_MAX_COUNT];
+    MoveModeTable                   m_move_mode_tables[AXIS_MAX_COUNT]; //!< Скомпилированные m_move_modes (под m_mutex)
+    std::atomic<MoveMode>           m_cur_move_mode[AXIS_MAX_COUNT];
+    AxisParamValueMap               m_cur_params[AXIS_MAX_COUNT];
+
+    //! Транзакция записи набора параметров оси. Используется только потоком обмена.
+    struct ParamsTxn {
+        ParamsTxn()
+            : size(0)
+            , start_cycle(0)
+            , active(false)
+        {}
+
+        SdoParam        entries[kMaxParamsTxnSize];
+        MailboxRequest  requests[kMaxParamsTxnSize];    //!< Запросы планировщика для entries
+        uint32_t        size;
+        uint64_t        start_cycle;    //!< Номер цикла, в котором запросы были поставлены в очередь
+        bool            active;         //!< Запросы отправлены, подтверждены не все
+    };
+    ParamsTxn                       m_params_txn[AXIS_MAX_COUNT];
+    MailboxScheduler                m_mailbox;          //!< Запросы SDO во время работы (только поток обмена)
+
+    //! Опрос диагностического объекта оси (SlaveConfig::diagnostics). Используется только потоком обмена.
+    struct DiagPoll {
+        DiagPoll()
+            : reg()
+            , request()
+            , period_cycles(1)
+            , next_cycle(0)
+            , pending(false)
+        {}
+
+        DiagRegister    reg;
+        MailboxRequest  request;
+        uint64_t        period_cycles;
+        uint64_t        next_cycle;     //!< Цикл, начиная с которого ставится следующий запрос
+        bool            pending;        //!< Запрос в планировщике, результат еще не учтен
+    };
+    DiagPoll                        m_diag_polls[AXIS_MAX_COUNT][kMaxDiagRegisters];
+    DiagnosticsSnapshot             m_diag;             //!< Текущая диагностика (пишет поток обмена)
+    SeqLock<DiagnosticsSnapshot>    m_diagnostics;      //!< Опубликованный снимок m_diag
+    std::atomic<uint32_t>           m_params_txn_aborts[AXIS_MAX_COUNT];        //!< Счетчик прерванных транзакций (пишет поток обмена)
+    uint32_t                        m_params_txn_aborts_seen[AXIS_MAX_COUNT];   //!< Значение счетчика, учтенное в m_cur_params (под m_mutex)
+
+    //! Смещения в данных доменов для объектов PDO осей
+    PdoOffsets                      m_pdo_off;
+
+    //! События для подписчиков (Subscribe): очередь пишет поток обмена, читает поток-диспетчер
+    struct Subscription {
+        uint32_t        id;
+        uint32_t        mask;       //!< Флаги EventType
+        EventCallback   callback;
+    };
+    SpscRing<Event, kEventQueueCapacity>    m_events;
+    std::atomic<uint64_t>           m_events_dropped;       //!< Потеряно событий: очередь заполнена (пишет поток обмена)
+    uint64_t                        m_events_dropped_seen;  //!< Значение счетчика, о котором уже сообщили (диспетчер)
+    uint32_t                        m_events_pending;       //!< Событий поставлено за текущий цикл (поток обмена)
+    bool                            m_fault_event_pending[AXIS_MAX_COUNT];  //!< EVENT_FAULT_RAISED ждет кода ошибки
+    uint64_t                        m_fault_event_time_ns[AXIS_MAX_COUNT];  //!< Время цикла, в котором поднялся бит Fault
+    std::atomic<uint32_t>           m_event_mask;           //!< Объединение масок подписок: события без подписчиков не ставятся
+    int                             m_event_fd;             //!< eventfd для пробуждения диспетчера
+    std::unique_ptr<std::thread>    m_event_thread;         //!< Поток-диспетчер (запускается первой подпиской)
+    std::mutex                      m_subs_mutex;           //!< Защищает m_subs и m_next_sub_id
+    std::mutex                      m_dispatch_mutex;       //!< Удерживается диспетчером на время вызова callback'ов
+    std::vector<Subscription>       m_subs;
+    uint32_t                        m_next_sub_id;
+
+    //! Сторожевой таймер потока обмена (ControlOptions::watchdog_cycles)
+    std::atomic<uint64_t>           m_heartbeat;            //!< Завершено циклов работы (пишет поток обмена)
+    std::atomic<bool>               m_watchdog_request;     //!< Поток обмена завис: остановить оси при возобновлении
+    std::unique_ptr<std::thread>    m_watchdog_thread;
+    std::mutex                      m_watchdog_mutex;       //!< Для ожидания m_watchdog_cv
+    std::condition_variable         m_watchdog_cv;          //!< Прерывает ожидание при остановке
+
+    //! Запись циклов обмена (ControlOptions::record_path)
+    CycleRecorder                   m_recorder;
+    std::vector<RecordPdoEntry>     m_record_entries;   //!< Объекты PDO образа записи, смещения относительно домена
+    size_t                          m_record_fast_size; //!< Размер образа быстрого домена [байты]
+    size_t                          m_record_slow_size; //!< Размер образа медленного домена [байты]
+    //! Снимки образа PDO для прямого доступа (ControlOptions::pdo_image)
+    PdoImagePublisher               m_pdo_image;
+
+    /*! @brief Описание регистрируемого объекта PDO: домен, флаги раскладки (PdoLayoutFlags), при которых объект
+     *  входит в PDO (0 - всегда), индекс, подындекс, размер [биты] и массив смещений по осям
+     */
+    struct PdoEntryDesc {
+        int32_t         domain;
+        uint32_t        layout;
+        uint16_t        index;
+        uint8_t         subindex;
+        uint8_t         bits;
+        unsigned int    (PdoOffsets::*offsets)[AXIS_MAX_COUNT];
+    };
+
+    //! Генераторы траектории режима "Слежение". Используются только потоком обмена.
+    JerkLimitedTracker              m_trackers[AXIS_MAX_COUNT];
+    bool                            m_track_active[AXIS_MAX_COUNT];
+
+    //! Точка траектории SubmitTrajectory() во внутренних единицах
+    struct TrajectorySample {
+        uint64_t    time_ns;    //!< [наносекунды с начала Epoch]
+        double      pos;        //!< [импульсы энкодера]
+        double      vel;        //!< [импульсы энкодера/с]
+        uint64_t    epoch;      //!< Поколение: совпадает с поколением команды kStream, включающей точку
+    };
+    using TrajectoryRing = SpscRing<TrajectorySample, kTrajQueueCapacity>;
+
+    //! Состояние движения по потоку уставок. Используется только потоком обмена.
+    struct StreamState {
+        StreamState()
+            : active(false)
+            , started(false)
+            , underrun(false)
+            , underruns(0)
+            , group(0)
+            , time_shift_ns(0)
+            , cancelled_start(0)
+            , epoch(0)
+        {}
+
+        bool        active;     //!< Уставки берутся из очереди траектории
+        bool        started;    //!< Интерполяция началась (время первой точки наступило)
+        bool        underrun;   //!< Точки закончились раньше времени
+        uint32_t    underruns;  //!< Количество опустошений буфера (за все время работы)
+        uint32_t    group;      //!< Маска осей согласованного перемещения (MoveCoordinated), 0 - ось движется одна
+        uint64_t    time_shift_ns;      //!< Сдвиг меток времени точек: перемещение включено позже своего начала
+        uint64_t    cancelled_start;    //!< Начало отмененного перемещения: его команда kStream пропускается
+        uint64_t    epoch;              //!< Последнее поколение точек, включенное командой kStream
+    };
+
+    TrajectoryRing                  m_traj_queues[AXIS_MAX_COUNT];  //!< Очереди точек траектории (писатель - под m_mutex)
+    StreamState                     m_stream[AXIS_MAX_COUNT];
+    uint64_t                        m_traj_last_time_ns[AXIS_MAX_COUNT];    //!< Время последней переданной точки (под m_mutex)
+    int32_t                         m_traj_last_pos[AXIS_MAX_COUNT];        //!< Позиция последней переданной точки (под m_mutex)
+    uint64_t                        m_traj_last_epoch[AXIS_MAX_COUNT];      //!< Поколение последней переданной точки (под m_mutex)
+    //! Поколение следующей команды оси (под m_mutex). Команда и точки, поставленные вместе с ней, получают одно поколение
+    uint64_t                        m_traj_epoch[AXIS_MAX_COUNT];
+    std::atomic<uint64_t>           m_traj_cleared_epoch[AXIS_MAX_COUNT];   //!< Точки до этого поколения удалены потоком обмена
 
     //! Пользовательские смещения коордиант [pulses] относительно абсолютных систем координат осей
-    int32_t                         m_pos_abs_usr_off[AXIS_COUNT];
-    int32_t                         m_pos_abs_rel_off[AXIS_COUNT];
+    int32_t                         m_pos_abs_usr_off[AXIS_MAX_COUNT];
+    int32_t                         m_pos_abs_rel_off[AXIS_MAX_COUNT];
 };
 
-Control::Control(const Config::Storage& config, const ParamsMode params_mode /*= PARAMS_MODE_AUTOMATIC*/)
-    : m_pimpl(new Control::Impl(config, params_mode))
+Control::Control(const Config::Storage& config, const ParamsMode params_mode /*= PARAMS_MODE_AUTOMATIC*/,
+                 const ControlOptions& options /*= ControlOptions()*/)
+    : m_pimpl(new Control::Impl(config, params_mode, options))
 {}
 
 Control::~Control() {
@@ -1349,6 +4267,18 @@ bool Control::SetModeRun(const Axis& axis, double pos, double vel) {
     return m_pimpl->SetModeRun(axis, pos, vel);
 }
 
+bool Control::SetModeTrack(const Axis& axis, double pos) {
+    return m_pimpl->SetModeTrack(axis, pos);
+}
+
+bool Control::SubmitTrajectory(const Axis& axis, const std::vector<TrajectoryPoint>& points) {
+    return m_pimpl->SubmitTrajectory(axis, points);
+}
+
+bool Control::MoveCoordinated(const std::vector<Axis>& axes, const std::vector<CoordinatedWaypoint>& path, bool blend) {
+    return m_pimpl->MoveCoordinated(axes, path, blend);
+}
+
 bool Control::AddMoveMode(const Axis& axis, const MoveMode& mode, const AxisParams& params) {
     return m_pimpl->AddMoveMode(axis, mode, params);
 }
@@ -1365,6 +4295,18 @@ bool Control::SetAxisParams(const Axis& axis, const AxisParams& params) {
     return m_pimpl->SetAxisParams(axis, params);
 }
 
+bool Control::ReloadConfig(const Config::Storage& config) {
+    return m_pimpl->ReloadConfig(config);
+}
+
+uint32_t Control::Subscribe(uint32_t event_mask, const EventCallback& callback) {
+    return m_pimpl->Subscribe(event_mask, callback);
+}
+
+bool Control::Unsubscribe(uint32_t subscription_id) {
+    return m_pimpl->Unsubscribe(subscription_id);
+}
+
 bool Control::SetModeIdle(const Axis& axis) {
     return m_pimpl->SetModeIdle(axis);
 }
@@ -1373,18 +4315,26 @@ bool Control::ResetFault(const Axis& axis) {
     return m_pimpl->ResetFault(axis);
 }
 
-const std::atomic<SystemStatus>& Control::GetStatusRef() const {
-    return m_pimpl->GetStatusRef();
-}
-
 SystemStatus Control::GetStatusCopy() const {
     return m_pimpl->GetStatusCopy();
 }
 
+bool Control::GetAxisStatus(const Axis& axis, AxisStatus& status) const {
+    return m_pimpl->GetAxisStatus(axis, status);
+}
+
+uint64_t Control::GetStatusVersion() const {
+    return m_pimpl->GetStatusVersion();
+}
+
 const SystemInfo& Control::GetSystemInfo() const {
     return m_pimpl->GetSystemInfo();
 }
 
+std::shared_future<bool> Control::GetInitFuture() const {
+    return m_pimpl->GetInitFuture();
+}
+
 AxisParamIndexMap Control::GetAvailableAxisParams(const Axis& axis) const {
     return m_pimpl->GetAvailableAxisParams(axis);
 }
@@ -1393,10 +4343,6 @@ AxisParams Control::GetCurAxisParams(const Axis& axis) const {
     return m_pimpl->GetCurAxisParams(axis);
 }
 
-const std::atomic<CycleTimeInfo> &Control::GetCycleTimeInfoRef() const {
-    return m_pimpl->GetCycleTimeInfoRef();
-}
-
 CycleTimeInfo Control::GetCycleTimeInfo() const {
     return m_pimpl->GetCycleTimeInfo();
 }
@@ -1405,8 +4351,52 @@ void Control::ResetCycleTimeInfo() {
     m_pimpl->ResetCycleTimeInfo();
 }
 
+DiagnosticsSnapshot Control::GetDiagnostics() const {
+    return m_pimpl->GetDiagnostics();
+}
+
+const PdoImageRegion* Control::GetPdoImage() const {
+    return m_pimpl->GetPdoImage();
+}
+
+uint64_t Control::GetDiagnosticsVersion() const {
+    return m_pimpl->GetDiagnosticsVersion();
+}
+
+CycleHistogram Control::GetCycleHistogram() const {
+    return m_pimpl->GetCycleHistogram();
+}
+
+void Control::ResetCycleHistogram() {
+    m_pimpl->ResetCycleHistogram();
+}
+
+void Control::RunBenchmarks(std::ostream& out, const std::string& filter) {
+    BenchmarkReport report(filter);
+    Control::Impl::BENCH_process_received_data(report);
+    Control::Impl::BENCH_prepare_new_commands(report);
+    Control::Impl::BENCH_status_publication(report);
+    Control::Impl::BENCH_set_mode_run(report);
+    Control::Impl::BENCH_pos_conversions(report);
+    Control::Impl::BENCH_config_read_file(report);
+    report.WriteJson(out);
+}
+
 void Control::RunStaticTests() {
     Control::Impl::TEST_pos_deg2pulse();
+    Control::Impl::TEST_move_mode_table();
+    Control::Impl::TEST_jerk_limited_tracker();
+    Control::Impl::TEST_hermite_interpolate();
+    Control::Impl::TEST_coordinated_profile();
+    Control::Impl::TEST_fast_pdo_decoder();
+    Control::Impl::TEST_overrun_policy();
+    Control::Impl::TEST_dc_bus_shift();
+    Control::Impl::TEST_mailbox_scheduler();
+    Control::Impl::TEST_config_storage();
+    Control::Impl::TEST_cycle_recorder();
+    Control::Impl::TEST_rt_log_format();
+    Control::Impl::TEST_sim_backend();
+    Control::Impl::TEST_shm_daemon();
 }
 
 } // namespaces
@@ -0,0 +1,45 @@
+#include "ecbackend.h"
+
+namespace Drives {
+
+const EcBackend& HardwareEcBackend() {
+    static const EcBackend kBackend = {
+        &ecrt_request_master
+        , &ecrt_release_master
+        , &ecrt_master
+        , &ecrt_master_get_slave
+        , &ecrt_master_create_domain
+        , &ecrt_master_slave_config
+        , &ecrt_master_select_reference_clock
+        , &ecrt_master_sdo_download
+        , &ecrt_master_sdo_upload
+        , &ecrt_master_activate
+        , &ecrt_master_set_send_interval
+        , &ecrt_master_send
+        , &ecrt_master_receive
+        , &ecrt_master_application_time
+        , &ecrt_master_sync_reference_clock
+        , &ecrt_master_sync_slave_clocks
+        , &ecrt_master_reference_clock_time
+        , &ecrt_master_sync_monitor_queue
+        , &ecrt_master_sync_monitor_process
+        , &ecrt_slave_config_pdos
+        , &ecrt_slave_config_dc
+        , &ecrt_slave_config_create_sdo_request
+        , &ecrt_slave_config_state
+        , &ecrt_domain_reg_pdo_entry_list
+        , &ecrt_domain_size
+        , &ecrt_domain_data
+        , &ecrt_domain_process
+        , &ecrt_domain_queue
+        , &ecrt_domain_state
+        , &ecrt_sdo_request_timeout
+        , &ecrt_sdo_request_data
+        , &ecrt_sdo_request_state
+        , &ecrt_sdo_request_write
+        , &ecrt_sdo_request_read
+    };
+    return kBackend;
+}
+
+} // namespaces
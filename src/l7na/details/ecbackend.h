@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ecrt.h>
+
+#include "l7na/types.h"
+
+namespace Drives {
+
+/*! @brief Функции EtherCAT-мастера, через которые работает Control.
+ *
+ *  Таблица указателей с сигнатурами ecrt_* (имя поля - имя функции без префикса): один и тот же код потока
+ *  обмена работает и с IgH EtherCAT master, и с имитацией подчиненных. Таблица выбирается один раз при
+ *  создании Control, вызов через нее - обычный непрямой вызов без виртуальных функций и проверок режима.
+ */
+struct EcBackend {
+    decltype(&ecrt_request_master)                      request_master;
+    decltype(&ecrt_release_master)                      release_master;
+    decltype(&ecrt_master)                              master;
+    decltype(&ecrt_master_get_slave)                    master_get_slave;
+    decltype(&ecrt_master_create_domain)                master_create_domain;
+    decltype(&ecrt_master_slave_config)                 master_slave_config;
+    decltype(&ecrt_master_select_reference_clock)       master_select_reference_clock;
+    decltype(&ecrt_master_sdo_download)                 master_sdo_download;
+    decltype(&ecrt_master_sdo_upload)                   master_sdo_upload;
+    decltype(&ecrt_master_activate)                     master_activate;
+    decltype(&ecrt_master_set_send_interval)            master_set_send_interval;
+    decltype(&ecrt_master_send)                         master_send;
+    decltype(&ecrt_master_receive)                      master_receive;
+    decltype(&ecrt_master_application_time)             master_application_time;
+    decltype(&ecrt_master_sync_reference_clock)         master_sync_reference_clock;
+    decltype(&ecrt_master_sync_slave_clocks)            master_sync_slave_clocks;
+    decltype(&ecrt_master_reference_clock_time)         master_reference_clock_time;
+    decltype(&ecrt_master_sync_monitor_queue)           master_sync_monitor_queue;
+    decltype(&ecrt_master_sync_monitor_process)         master_sync_monitor_process;
+    decltype(&ecrt_slave_config_pdos)                   slave_config_pdos;
+    decltype(&ecrt_slave_config_dc)                     slave_config_dc;
+    decltype(&ecrt_slave_config_create_sdo_request)     slave_config_create_sdo_request;
+    decltype(&ecrt_slave_config_state)                  slave_config_state;
+    decltype(&ecrt_domain_reg_pdo_entry_list)           domain_reg_pdo_entry_list;
+    decltype(&ecrt_domain_size)                         domain_size;
+    decltype(&ecrt_domain_data)                         domain_data;
+    decltype(&ecrt_domain_process)                      domain_process;
+    decltype(&ecrt_domain_queue)                        domain_queue;
+    decltype(&ecrt_domain_state)                        domain_state;
+    decltype(&ecrt_sdo_request_timeout)                 sdo_request_timeout;
+    decltype(&ecrt_sdo_request_data)                    sdo_request_data;
+    decltype(&ecrt_sdo_request_state)                   sdo_request_state;
+    decltype(&ecrt_sdo_request_write)                   sdo_request_write;
+    decltype(&ecrt_sdo_request_read)                    sdo_request_read;
+};
+
+//! @brief Функции IgH EtherCAT master (ecrt_*).
+const EcBackend& HardwareEcBackend();
+
+/*! @brief Имитация мастера и подчиненных L7NA в процессе.
+ *
+ *  request_master создает отдельный имитированный мастер; параметры модели задаются SimConfigureMaster
+ *  до активации. Подчиненные появляются при master_slave_config, объекты PDO и SDO - объекты их словаря.
+ */
+const EcBackend& SimEcBackend();
+
+//! @brief Параметры модели для мастера, полученного от SimEcBackend().request_master.
+void SimConfigureMaster(ec_master_t* master, const SimOptions& options, uint32_t cycle_period_ns);
+
+inline const EcBackend& SelectEcBackend(EcBackendType type) {
+    return EC_BACKEND_SIM == type ? SimEcBackend() : HardwareEcBackend();
+}
+
+} // namespaces
@@ -0,0 +1,82 @@
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#include "l7na/types.h"
+
+namespace Drives {
+
+constexpr uint32_t DurationHistogram::kSubBucketBits;
+constexpr uint32_t DurationHistogram::kSubBucketCount;
+constexpr uint32_t DurationHistogram::kMaxValueBits;
+constexpr uint32_t DurationHistogram::kBucketCount;
+
+DurationHistogram::DurationHistogram()
+    : total(0)
+    , sum_ns(0)
+    , min_ns(std::numeric_limits<decltype(min_ns)>::max())
+    , max_ns(0)
+{
+    std::memset(counts, 0, sizeof(counts));
+}
+
+uint32_t DurationHistogram::BucketIndex(uint64_t value_ns) {
+    if (value_ns < kSubBucketCount) {
+        return static_cast<uint32_t>(value_ns);
+    }
+
+    const uint32_t msb = 63 - __builtin_clzll(value_ns);
+    if (msb > kMaxValueBits) {
+        return kBucketCount - 1;
+    }
+
+    // Старший бит отбрасываем, следующие kSubBucketBits бит - номер интервала внутри октавы
+    const uint32_t octave = msb - kSubBucketBits;
+    const uint32_t sub_bucket = static_cast<uint32_t>(value_ns >> octave) - kSubBucketCount;
+
+    return kSubBucketCount + octave * kSubBucketCount + sub_bucket;
+}
+
+uint64_t DurationHistogram::BucketLowerBound(uint32_t index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+
+    const uint32_t octave = (index - kSubBucketCount) / kSubBucketCount;
+    const uint32_t sub_bucket = (index - kSubBucketCount) % kSubBucketCount;
+
+    return static_cast<uint64_t>(kSubBucketCount + sub_bucket) << octave;
+}
+
+uint64_t DurationHistogram::BucketUpperBound(uint32_t index) {
+    if (index + 1 >= kBucketCount) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    return BucketLowerBound(index + 1);
+}
+
+uint64_t DurationHistogram::Percentile(double quantile) const {
+    if (! total) {
+        return 0;
+    }
+
+    quantile = std::min(std::max(quantile, 0.0), 1.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * total)));
+
+    uint64_t accumulated = 0;
+    for (uint32_t i = 0; i < kBucketCount; ++i) {
+        accumulated += counts[i];
+        if (accumulated >= rank) {
+            return std::min(BucketUpperBound(i), max_ns);
+        }
+    }
+
+    return max_ns;
+}
+
+double DurationHistogram::Mean() const {
+    return total ? static_cast<double>(sum_ns) / total : 0.0;
+}
+
+} // namespaces
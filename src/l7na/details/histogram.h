@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <limits>
+
+#include "l7na/types.h"
+
+namespace Drives {
+
+/*! @brief Накопитель гистограммы длительностей для потока реального времени.
+ *
+ *  Record() и Reset() вызываются только одним потоком-писателем и не блокируются: счетчики -
+ *  атомарные переменные, обновляемые без read-modify-write. Snapshot() может вызываться из
+ *  любого потока; отдельные счетчики в снимке согласованы, снимок в целом - с точностью до одного цикла.
+ */
+class HistogramRecorder {
+public:
+    HistogramRecorder() {
+        Reset();
+    }
+
+    void Record(uint64_t value_ns) {
+        std::atomic<uint64_t>& bucket = m_counts[DurationHistogram::BucketIndex(value_ns)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_sum_ns.store(m_sum_ns.load(std::memory_order_relaxed) + value_ns, std::memory_order_relaxed);
+        if (value_ns < m_min_ns.load(std::memory_order_relaxed)) {
+            m_min_ns.store(value_ns, std::memory_order_relaxed);
+        }
+        if (value_ns > m_max_ns.load(std::memory_order_relaxed)) {
+            m_max_ns.store(value_ns, std::memory_order_relaxed);
+        }
+    }
+
+    void Reset() {
+        for (std::atomic<uint64_t>& bucket: m_counts) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        m_sum_ns.store(0, std::memory_order_relaxed);
+        m_min_ns.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        m_max_ns.store(0, std::memory_order_relaxed);
+    }
+
+    void Snapshot(DurationHistogram& result) const {
+        result.sum_ns = m_sum_ns.load(std::memory_order_relaxed);
+        result.min_ns = m_min_ns.load(std::memory_order_relaxed);
+        result.max_ns = m_max_ns.load(std::memory_order_relaxed);
+        // Общее количество считаем по интервалам, чтобы перцентили были согласованы с counts
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < DurationHistogram::kBucketCount; ++i) {
+            result.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            total += result.counts[i];
+        }
+        result.total = total;
+    }
+
+private:
+    std::atomic<uint64_t>   m_counts[DurationHistogram::kBucketCount];
+    std::atomic<uint64_t>   m_sum_ns;
+    std::atomic<uint64_t>   m_min_ns;
+    std::atomic<uint64_t>   m_max_ns;
+};
+
+//! @brief Набор гистограмм временных характеристик цикла обмена. Писатель - поток обмена.
+class CycleHistogramRecorder {
+public:
+    CycleHistogramRecorder()
+        : m_cycles(0)
+        , m_overruns(0)
+        , m_skipped_slots(0)
+        , m_deferred_cycles(0)
+        , m_window_start_ns(0)
+        , m_window_end_ns(0)
+    {}
+
+    void Reset(uint64_t now_ns) {
+        latency.Reset();
+        period.Reset();
+        exec.Reset();
+        receive.Reset();
+        process.Reset();
+        prepare.Reset();
+        send.Reset();
+        m_cycles.store(0, std::memory_order_relaxed);
+        m_overruns.store(0, std::memory_order_relaxed);
+        m_skipped_slots.store(0, std::memory_order_relaxed);
+        m_deferred_cycles.store(0, std::memory_order_relaxed);
+        m_window_start_ns.store(now_ns, std::memory_order_relaxed);
+        m_window_end_ns.store(now_ns, std::memory_order_relaxed);
+    }
+
+    //! @brief Завершает учет цикла
+    void CountCycle(uint64_t end_ns, bool overrun) {
+        m_cycles.store(m_cycles.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (overrun) {
+            m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        m_window_end_ns.store(end_ns, std::memory_order_relaxed);
+    }
+
+    //! @brief Учитывает периоды, пропущенные планировщиком после переполнения
+    void CountSkipped(uint64_t slots) {
+        m_skipped_slots.store(m_skipped_slots.load(std::memory_order_relaxed) + slots, std::memory_order_relaxed);
+    }
+
+    //! @brief Учитывает цикл, в котором некритичная работа отложена
+    void CountDeferred() {
+        m_deferred_cycles.store(m_deferred_cycles.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void Snapshot(CycleHistogram& result) const {
+        result.cycles = m_cycles.load(std::memory_order_relaxed);
+        result.overruns = m_overruns.load(std::memory_order_relaxed);
+        result.skipped_slots = m_skipped_slots.load(std::memory_order_relaxed);
+        result.deferred_cycles = m_deferred_cycles.load(std::memory_order_relaxed);
+        result.window_start_ns = m_window_start_ns.load(std::memory_order_relaxed);
+        result.window_end_ns = m_window_end_ns.load(std::memory_order_relaxed);
+        latency.Snapshot(result.latency);
+        period.Snapshot(result.period);
+        exec.Snapshot(result.exec);
+        receive.Snapshot(result.receive);
+        process.Snapshot(result.process);
+        prepare.Snapshot(result.prepare);
+        send.Snapshot(result.send);
+    }
+
+    HistogramRecorder latency;
+    HistogramRecorder period;
+    HistogramRecorder exec;
+    HistogramRecorder receive;
+    HistogramRecorder process;
+    HistogramRecorder prepare;
+    HistogramRecorder send;
+
+private:
+    std::atomic<uint64_t>   m_cycles;
+    std::atomic<uint64_t>   m_overruns;
+    std::atomic<uint64_t>   m_skipped_slots;
+    std::atomic<uint64_t>   m_deferred_cycles;
+    std::atomic<uint64_t>   m_window_start_ns;
+    std::atomic<uint64_t>   m_window_end_ns;
+};
+
+} // namespaces
@@ -41,6 +41,8 @@ void InitLogger(const logger::trivial::severity_level& level, const std::string&
     }
 
     logger::add_common_attributes();
+
+    SetRtLogLevel(level);
 }
 
 } // namespaces
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "mailbox.h"
+
+namespace Drives {
+
+constexpr uint32_t MailboxScheduler::kMaxOutstandingPerSlave;
+
+MailboxScheduler::MailboxScheduler(const EcBackend& ec)
+    : m_ec(ec)
+    , m_slave_count(0)
+    , m_budget({ 1, 1 })
+    , m_next_slave(0)
+{
+    std::memset(m_slaves, 0, sizeof(m_slaves));
+}
+
+void MailboxScheduler::Configure(int32_t slave_count, const MailboxBudget& budget) {
+    m_slave_count = std::min<int32_t>(slave_count, AXIS_MAX_COUNT);
+    m_budget.per_slave = std::max<uint32_t>(1, std::min(budget.per_slave, kMaxOutstandingPerSlave));
+    m_budget.per_cycle = std::max<uint32_t>(1, budget.per_cycle);
+}
+
+bool MailboxScheduler::Submit(int32_t slave, MailboxPriority priority, MailboxRequest* request) {
+    assert(slave >= 0 && slave < m_slave_count && priority < MAILBOX_PRIORITY_COUNT);
+    if (MailboxRequest::kQueued == request->state || MailboxRequest::kBusy == request->state) {
+        return false;
+    }
+
+    Queue& queue = m_slaves[slave].queues[priority];
+    request->state = MailboxRequest::kQueued;
+    request->next = NULL;
+    if (queue.tail) {
+        queue.tail->next = request;
+    } else {
+        queue.head = request;
+    }
+    queue.tail = request;
+    ++m_slaves[slave].queued_count;
+    return true;
+}
+
+void MailboxScheduler::Cancel(int32_t slave, MailboxRequest* request) {
+    if (MailboxRequest::kQueued != request->state) {
+        return;
+    }
+
+    Slave& s = m_slaves[slave];
+    for (Queue& queue: s.queues) {
+        MailboxRequest* prev = NULL;
+        for (MailboxRequest* cur = queue.head; cur; prev = cur, cur = cur->next) {
+            if (cur != request) {
+                continue;
+            }
+            (prev ? prev->next : queue.head) = cur->next;
+            if (queue.tail == cur) {
+                queue.tail = prev;
+            }
+            cur->next = NULL;
+            cur->state = MailboxRequest::kIdle;
+            --s.queued_count;
+            return;
+        }
+    }
+}
+
+void MailboxScheduler::Complete() {
+    for (int32_t i = 0; i < m_slave_count; ++i) {
+        Slave& slave = m_slaves[i];
+        for (uint32_t b = 0; b < slave.busy_count; ) {
+            MailboxRequest* request = slave.busy[b];
+            const ec_request_state_t state = m_ec.sdo_request_state(request->sdo);
+            if (EC_REQUEST_BUSY == state) {
+                ++b;
+                continue;
+            }
+            request->state = (EC_REQUEST_SUCCESS == state) ? MailboxRequest::kSuccess : MailboxRequest::kError;
+            slave.busy[b] = slave.busy[--slave.busy_count];
+        }
+    }
+}
+
+uint32_t MailboxScheduler::Issue(uint64_t cycle) {
+    if (! m_slave_count) {
+        return 0;
+    }
+
+    uint32_t issued = 0;
+    for (uint32_t priority = 0; priority < MAILBOX_PRIORITY_COUNT && issued < m_budget.per_cycle; ++priority) {
+        // Проходы по кругу: за проход каждому подчиненному - не более одного запроса класса
+        bool progress = true;
+        while (progress && issued < m_budget.per_cycle) {
+            progress = false;
+            for (int32_t k = 0; k < m_slave_count && issued < m_budget.per_cycle; ++k) {
+                Slave& slave = m_slaves[(m_next_slave + k) % m_slave_count];
+                Queue& queue = slave.queues[priority];
+                if (! queue.head || slave.busy_count >= m_budget.per_slave) {
+                    continue;
+                }
+
+                MailboxRequest* request = queue.head;
+                queue.head = request->next;
+                if (! queue.head) {
+                    queue.tail = NULL;
+                }
+                --slave.queued_count;
+                issue(slave, request, cycle);
+                ++issued;
+                progress = true;
+            }
+        }
+    }
+
+    m_next_slave = (m_next_slave + 1) % m_slave_count;
+    return issued;
+}
+
+uint32_t MailboxScheduler::Outstanding(int32_t slave) const {
+    return m_slaves[slave].busy_count;
+}
+
+uint32_t MailboxScheduler::Queued(int32_t slave) const {
+    return m_slaves[slave].queued_count;
+}
+
+void MailboxScheduler::issue(Slave& slave, MailboxRequest* request, uint64_t cycle) {
+    request->next = NULL;
+    request->state = MailboxRequest::kBusy;
+    request->issue_cycle = cycle;
+    if (request->write) {
+        m_ec.sdo_request_write(request->sdo);
+    } else {
+        m_ec.sdo_request_read(request->sdo);
+    }
+    slave.busy[slave.busy_count++] = request;
+}
+
+} // namespaces
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+
+#include "l7na/types.h"
+#include "ecbackend.h"
+
+namespace Drives {
+
+//! @brief Класс приоритета ациклического обмена: запросы более важного класса отправляются первыми
+enum MailboxPriority : uint8_t {
+    MAILBOX_PRIORITY_SAFETY,        //!< Запросы, влияющие на безопасность
+    MAILBOX_PRIORITY_PARAMS,        //!< Транзакции записи параметров осей
+    MAILBOX_PRIORITY_DIAGNOSTICS,   //!< Опрос диагностики
+
+    MAILBOX_PRIORITY_COUNT
+};
+
+/*! @brief Запрос SDO, выполняемый через MailboxScheduler.
+ *
+ *  Память запроса принадлежит владельцу (заранее выделяется вместе с ec_sdo_request_t), планировщик лишь
+ *  связывает запросы в очереди. Состояние меняет только планировщик, владелец его читает.
+ */
+struct MailboxRequest {
+    enum State : uint8_t {
+        kIdle,          //!< Не отправлялся
+        kQueued,        //!< Ждет очереди в планировщике
+        kBusy,          //!< Передан мастеру, выполняется
+        kSuccess,
+        kError
+    };
+
+    MailboxRequest()
+        : sdo(NULL)
+        , write(false)
+        , state(kIdle)
+        , issue_cycle(0)
+        , next(NULL)
+    {}
+
+    ec_sdo_request_t*   sdo;
+    bool                write;          //!< Запись (данные уже в ecrt_sdo_request_data), иначе чтение
+    State               state;
+    uint64_t            issue_cycle;    //!< Цикл, в котором запрос передан мастеру
+    MailboxRequest*     next;           //!< Следующий в очереди планировщика
+};
+
+/*! @brief Планировщик ациклического обмена (запросов SDO) во время работы.
+ *
+ *  Все запросы SDO потока обмена проходят через одну очередь с классами приоритета. Мастеру одновременно
+ *  передается не более budget.per_slave запросов на подчиненного и не более budget.per_cycle новых запросов
+ *  за цикл на всех подчиненных; внутри класса подчиненные обслуживаются по кругу, начиная каждый цикл со
+ *  следующего. Поэтому нагрузка на mailbox не зависит от того, сколько запросов накопилось, а задержка
+ *  запросов диагностики ограничена и растет линейно с количеством осей.
+ *
+ *  Используется только потоком обмена, без блокировок и выделения памяти.
+ */
+class MailboxScheduler {
+public:
+    //! Наибольшее MailboxBudget::per_slave
+    constexpr static uint32_t kMaxOutstandingPerSlave = 4;
+
+    explicit MailboxScheduler(const EcBackend& ec);
+
+    void Configure(int32_t slave_count, const MailboxBudget& budget);
+
+    /*! @brief Ставит запрос в очередь подчиненного slave.
+     *
+     *  @return false, если запрос уже в очереди или выполняется
+     */
+    bool Submit(int32_t slave, MailboxPriority priority, MailboxRequest* request);
+
+    /*! @brief Убирает запрос из очереди, если он еще не передан мастеру; состояние становится kIdle.
+     *
+     *  Выполняющийся запрос отменить нельзя: он завершится как обычно.
+     */
+    void Cancel(int32_t slave, MailboxRequest* request);
+
+    //! @brief Обновляет состояние выполняющихся запросов. Вызывается каждый цикл после приема данных.
+    void Complete();
+
+    /*! @brief Передает мастеру очередные запросы в пределах бюджета.
+     *
+     *  @param  cycle   Номер текущего цикла (MailboxRequest::issue_cycle)
+     *  @return Количество переданных запросов
+     */
+    uint32_t Issue(uint64_t cycle);
+
+    //! @brief Количество выполняющихся запросов подчиненного
+    uint32_t Outstanding(int32_t slave) const;
+
+    //! @brief Количество запросов в очереди подчиненного (всех классов)
+    uint32_t Queued(int32_t slave) const;
+
+private:
+    struct Queue {
+        MailboxRequest* head;
+        MailboxRequest* tail;
+    };
+
+    struct Slave {
+        Queue           queues[MAILBOX_PRIORITY_COUNT];
+        MailboxRequest* busy[kMaxOutstandingPerSlave];
+        uint32_t        busy_count;
+        uint32_t        queued_count;
+    };
+
+    void issue(Slave& slave, MailboxRequest* request, uint64_t cycle);
+
+    const EcBackend&    m_ec;
+    Slave               m_slaves[AXIS_MAX_COUNT];
+    int32_t             m_slave_count;
+    MailboxBudget       m_budget;
+    int32_t             m_next_slave;   //!< С какого подчиненного начинается обход в следующем цикле
+};
+
+} // namespaces
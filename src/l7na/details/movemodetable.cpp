@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include "movemodetable.h"
+
+namespace Drives {
+
+constexpr uint32_t MoveModeTable::kInvalidPos;
+
+MoveModeTable::MoveModeTable()
+    : m_modes()
+    , m_thresholds()
+    , m_params()
+    , m_offsets(1, 0)
+{}
+
+void MoveModeTable::Compile(const MoveModeMap& modes, const AxisParamIndexMap& sizes, const SdoReqMap& sdos) {
+    m_modes.clear();
+    m_thresholds.clear();
+    m_params.clear();
+    m_offsets.assign(1, 0);
+
+    // Записываемые параметры каждого режима: индекс -> параметр (при повторе индекса действует последний)
+    std::vector<std::map<uint16_t, SdoParam>> mode_params;
+    mode_params.reserve(modes.size());
+    for (const auto& mm_pair: modes) {
+        m_modes.push_back(mm_pair.first);
+        m_thresholds.push_back(static_cast<double>(mm_pair.first));
+
+        std::map<uint16_t, SdoParam> params;
+        for (const AxisParam& p: mm_pair.second) {
+            const auto size_it = sizes.find(p.index);
+            const auto sdo_it = sdos.find(p.index);
+            if (size_it == sizes.end() || sdo_it == sdos.end()) {
+                continue;
+            }
+            params[p.index] = { sdo_it->second, p.value, p.index, size_it->second };
+        }
+        mode_params.push_back(params);
+    }
+
+    for (const auto& params: mode_params) {
+        for (const auto& param_pair: params) {
+            m_params.push_back(param_pair.second);
+        }
+        m_offsets.push_back(m_params.size());
+    }
+
+    for (const auto& from_params: mode_params) {
+        for (const auto& to_params: mode_params) {
+            for (const auto& param_pair: to_params) {
+                const auto from_it = from_params.find(param_pair.first);
+                if (from_it == from_params.end() || from_it->second.value != param_pair.second.value) {
+                    m_params.push_back(param_pair.second);
+                }
+            }
+            m_offsets.push_back(m_params.size());
+        }
+    }
+}
+
+bool MoveModeTable::Empty() const {
+    return m_modes.empty();
+}
+
+uint32_t MoveModeTable::Size() const {
+    return m_modes.size();
+}
+
+uint32_t MoveModeTable::Find(const MoveMode mode) const {
+    const auto it = std::lower_bound(m_modes.begin(), m_modes.end(), mode);
+    if (it == m_modes.end() || *it != mode) {
+        return kInvalidPos;
+    }
+    return it - m_modes.begin();
+}
+
+MoveMode MoveModeTable::ModeAt(const uint32_t pos) const {
+    return m_modes[pos];
+}
+
+uint32_t MoveModeTable::Last() const {
+    return m_modes.empty() ? kInvalidPos : m_modes.size() - 1;
+}
+
+uint32_t MoveModeTable::Select(const double pos_diff_deg) const {
+    const auto it = std::upper_bound(m_thresholds.begin(), m_thresholds.end(), pos_diff_deg);
+    if (it == m_thresholds.end()) {
+        return kInvalidPos;
+    }
+    return it - m_thresholds.begin();
+}
+
+MoveModeTable::Range MoveModeTable::Full(const uint32_t pos) const {
+    return range(pos);
+}
+
+MoveModeTable::Range MoveModeTable::Transition(const uint32_t from, const uint32_t to) const {
+    return range(m_modes.size() + from * m_modes.size() + to);
+}
+
+MoveModeTable::Range MoveModeTable::range(const uint32_t offset_pos) const {
+    const SdoParam* data = m_params.data();
+    return Range(data + m_offsets[offset_pos], data + m_offsets[offset_pos + 1]);
+}
+
+} // namespaces
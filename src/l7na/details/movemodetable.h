@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <ecrt.h>
+
+#include "types_int.h"
+
+namespace Drives {
+
+using SdoReqMap = std::map<uint16_t, ec_sdo_request_t*>;
+
+//! @brief Параметр оси, сопоставленный заранее созданному SDO-запросу на запись
+struct SdoParam {
+    ec_sdo_request_t*   sdo_req;    //!< Запрос на запись данного индекса
+    int64_t             value;
+    uint16_t            index;
+    uint16_t            size;       //!< Размер значения [байты]
+};
+
+/*! @brief Скомпилированная таблица переходов между режимами перемещения оси.
+ *
+ *  Строится один раз по MoveModeMap (при создании Control и в AddMoveMode). Для каждого режима хранится
+ *  полный набор записываемых параметров, а для каждой пары (from, to) - только параметры, значения
+ *  которых в режиме to отличаются от режима from. Все наборы лежат в одном непрерывном массиве, параметры
+ *  уже сопоставлены SDO-запросам и размерам, поэтому переключение режима - это проход по массиву без
+ *  поиска в std::map.
+ *
+ *  Режимы адресуются позицией в таблице (по возрастанию MoveMode, т.е. порога перемещения).
+ */
+class MoveModeTable {
+public:
+    using Range = std::pair<const SdoParam*, const SdoParam*>;
+
+    constexpr static uint32_t kInvalidPos = UINT32_MAX;
+
+    MoveModeTable();
+
+    /*! @brief Перестраивает таблицу.
+     *
+     *  @param  modes   Режимы перемещения оси
+     *  @param  sizes   Записываемые SDO-индексы и размеры их значений. Остальные параметры игнорируются
+     *  @param  sdos    SDO-запросы на запись по индексам. Параметры без запроса игнорируются
+     */
+    void Compile(const MoveModeMap& modes, const AxisParamIndexMap& sizes, const SdoReqMap& sdos);
+
+    bool Empty() const;
+    uint32_t Size() const;
+
+    //! @brief Позиция режима в таблице. @return kInvalidPos, если режима нет.
+    uint32_t Find(const MoveMode mode) const;
+
+    //! @brief Режим в позиции pos < Size().
+    MoveMode ModeAt(const uint32_t pos) const;
+
+    //! @brief Позиция режима с максимальным порогом. @return kInvalidPos для пустой таблицы.
+    uint32_t Last() const;
+
+    /*! @brief Режим для перемещения на pos_diff_deg: первый режим, порог которого больше расстояния.
+     *  @return kInvalidPos, если расстояние превышает все пороги.
+     */
+    uint32_t Select(const double pos_diff_deg) const;
+
+    //! @brief Полный набор параметров режима в позиции pos.
+    Range Full(const uint32_t pos) const;
+
+    //! @brief Параметры, которые нужно записать при переходе из режима from в режим to.
+    Range Transition(const uint32_t from, const uint32_t to) const;
+
+private:
+    Range range(const uint32_t offset_pos) const;
+
+    std::vector<MoveMode>   m_modes;            //!< Режимы по возрастанию
+    std::vector<double>     m_thresholds;       //!< Пороги режимов [градусы]
+    std::vector<SdoParam>   m_params;           //!< Все наборы параметров подряд
+    //! Границы наборов в m_params: сначала Size() полных наборов, затем Size()*Size() переходов; плюс конец
+    std::vector<uint32_t>   m_offsets;
+};
+
+} // namespaces
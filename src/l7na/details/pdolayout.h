@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+#include <ecrt.h>
+
+#include "l7na/types.h"
+
+namespace Drives {
+
+/*! @brief Смещения в данных доменов для объектов PDO осей.
+ *
+ *  Массивы по осям хранятся подряд: при обработке одного параметра по всем осям данные лежат рядом.
+ *  Смещения объектов, не вошедших в раскладку PDO (PdoLayout), не заполняются.
+ */
+struct PdoOffsets {
+    unsigned int    rw_ctrl[AXIS_MAX_COUNT];
+    unsigned int    ro_status[AXIS_MAX_COUNT];
+    unsigned int    rw_tgt_pos[AXIS_MAX_COUNT];
+    unsigned int    ro_dmd_pos[AXIS_MAX_COUNT];
+    unsigned int    ro_act_pos[AXIS_MAX_COUNT];
+    unsigned int    rw_tgt_vel[AXIS_MAX_COUNT];
+    unsigned int    ro_dmd_vel[AXIS_MAX_COUNT];
+    unsigned int    ro_act_vel[AXIS_MAX_COUNT];
+    unsigned int    ro_act_pos_abs[AXIS_MAX_COUNT];
+    unsigned int    rw_act_mode[AXIS_MAX_COUNT];
+    unsigned int    ro_act_torq[AXIS_MAX_COUNT];
+    unsigned int    ro_err_code[AXIS_MAX_COUNT];
+    unsigned int    ro_temperature[AXIS_MAX_COUNT];
+    unsigned int    ro_follow_err[AXIS_MAX_COUNT];
+};
+
+/*! @brief Ядро разбора быстрого домена для раскладки Layout (набор флагов PdoLayoutFlags).
+ *
+ *  Раскладка - параметр шаблона, поэтому проверки флагов вычисляются при компиляции и для каждой раскладки
+ *  генерируется своя функция: фиксированная последовательность чтений без ветвлений по конфигурации.
+ *  Поля объектов, не вошедших в раскладку, обнуляются (см. SystemStatus::pdo_layout).
+ */
+template<uint32_t Layout>
+void DecodeFastPdo(const uint8_t* data, const PdoOffsets& off, int32_t axis, AxisStatus& status) {
+    status.cur_pos = EC_READ_S32(data + off.ro_act_pos[axis]);
+    status.tgt_pos = EC_READ_S32(data + off.rw_tgt_pos[axis]);
+    status.cur_vel = EC_READ_S32(data + off.ro_act_vel[axis]);
+    status.ctrlword = EC_READ_U16(data + off.rw_ctrl[axis]);
+    status.statusword = EC_READ_U16(data + off.ro_status[axis]);
+    status.mode = EC_READ_S8(data + off.rw_act_mode[axis]);
+
+    if (Layout & PDO_LAYOUT_DEMAND) {
+        status.dmd_pos = EC_READ_S32(data + off.ro_dmd_pos[axis]);
+        status.dmd_vel = EC_READ_S32(data + off.ro_dmd_vel[axis]);
+    } else {
+        status.dmd_pos = 0;
+        status.dmd_vel = 0;
+    }
+
+    if (Layout & PDO_LAYOUT_FOLLOWING_ERROR) {
+        status.following_error = EC_READ_S32(data + off.ro_follow_err[axis]);
+    } else {
+        status.following_error = 0;
+    }
+}
+
+using FastPdoDecoder = void (*)(const uint8_t* data, const PdoOffsets& off, int32_t axis, AxisStatus& status);
+
+//! @brief Ядро разбора быстрого домена для раскладки layout. Выбирается один раз при создании Control.
+inline FastPdoDecoder SelectFastPdoDecoder(uint32_t layout) {
+    static const FastPdoDecoder kDecoders[] = {
+        &DecodeFastPdo<0>
+        , &DecodeFastPdo<PDO_LAYOUT_DEMAND>
+        , &DecodeFastPdo<PDO_LAYOUT_FOLLOWING_ERROR>
+        , &DecodeFastPdo<PDO_LAYOUT_DEMAND | PDO_LAYOUT_FOLLOWING_ERROR>
+    };
+    static_assert(sizeof(kDecoders) / sizeof(kDecoders[0]) == PDO_LAYOUT_ALL + 1, "Decoder for each PDO layout required");
+
+    return kDecoders[layout & PDO_LAYOUT_ALL];
+}
+
+} // namespaces
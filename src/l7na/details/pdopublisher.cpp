@@ -0,0 +1,143 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "l7na/logger.h"
+#include "pdopublisher.h"
+
+namespace Drives {
+
+namespace {
+
+/*! @brief Существующий объект shm_name используется: это область снимков, процесс-публикатор которой
+ *  (owner_pid) жив, или объект не является областью снимков. Исчезнувший объект не используется.
+ */
+bool shm_in_use(const std::string& shm_name, int32_t* owner_pid) {
+    const int fd = ::shm_open(shm_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return errno != ENOENT;
+    }
+
+    bool in_use = true;
+    struct stat st;
+    if (! ::fstat(fd, &st) && st.st_size >= static_cast<off_t>(sizeof(PdoImageRegion))) {
+        void* data = ::mmap(NULL, sizeof(PdoImageRegion), PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED != data) {
+            const PdoImageRegion* region = static_cast<const PdoImageRegion*>(data);
+            if (! std::memcmp(region->magic, kPdoImageMagic, sizeof(region->magic))) {
+                *owner_pid = region->publisher_pid;
+                in_use = *owner_pid > 0 && (! ::kill(*owner_pid, 0) || EPERM == errno);
+            }
+            ::munmap(data, sizeof(PdoImageRegion));
+        }
+    }
+    ::close(fd);
+    return in_use;
+}
+
+} // namespace
+
+PdoImagePublisher::PdoImagePublisher()
+    : m_region(NULL)
+    , m_shm_name()
+    , m_fast_size(0)
+    , m_slow_size(0)
+{}
+
+PdoImagePublisher::~PdoImagePublisher() {
+    Close();
+}
+
+bool PdoImagePublisher::Open(const std::string& shm_name, const RecordFileHeader& layout) {
+    Close();
+
+    if (layout.image_size > kPdoImageMaxSize || layout.fast_image_size > layout.image_size
+        || layout.entry_count > kRecordMaxPdoEntries) {
+        LOG_ERROR("Invalid PDO image layout: image size=" << layout.image_size << ", entries=" << layout.entry_count);
+        return false;
+    }
+
+    void* data = NULL;
+    if (shm_name.empty()) {
+        data = new PdoImageRegion();
+    } else {
+        // Объект, снимки в котором публикует другой процесс, не пересоздается: его читатели продолжают работу
+        int fd = ::shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0 && EEXIST == errno) {
+            int32_t owner_pid = 0;
+            if (shm_in_use(shm_name, &owner_pid)) {
+                LOG_ERROR("Shared memory " << shm_name << " is in use by running publisher, pid=" << owner_pid
+                          << " (0 - not a PDO image region)");
+                return false;
+            }
+            LOG_WARN("Taking over shared memory " << shm_name << " of stopped publisher, pid=" << owner_pid);
+            ::shm_unlink(shm_name.c_str());
+            fd = ::shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        }
+        if (fd < 0) {
+            LOG_ERROR("Failed to create shared memory " << shm_name << ": " << errno);
+            return false;
+        }
+        if (::ftruncate(fd, sizeof(PdoImageRegion))) {
+            LOG_ERROR("Failed to allocate " << sizeof(PdoImageRegion) << " bytes of shared memory " << shm_name
+                      << ": " << errno);
+            ::close(fd);
+            ::shm_unlink(shm_name.c_str());
+            return false;
+        }
+        data = ::mmap(NULL, sizeof(PdoImageRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == data) {
+            LOG_ERROR("Failed to map shared memory " << shm_name << ": " << errno);
+            ::shm_unlink(shm_name.c_str());
+            return false;
+        }
+        std::memset(data, 0, sizeof(PdoImageRegion));
+        m_shm_name = shm_name;
+    }
+    m_region = static_cast<PdoImageRegion*>(data);
+
+    m_region->version = kPdoImageVersion;
+    m_region->region_size = sizeof(PdoImageRegion);
+    m_region->image_size = layout.image_size;
+    m_region->fast_image_size = layout.fast_image_size;
+    m_region->cycle_period_ns = layout.cycle_period_ns;
+    m_region->slow_pdo_divider = layout.slow_pdo_divider;
+    m_region->pdo_layout = layout.pdo_layout;
+    m_region->axis_count = layout.axis_count;
+    m_region->entry_count = layout.entry_count;
+    m_region->publisher_pid = ::getpid();
+    std::copy(layout.entries, layout.entries + layout.entry_count, m_region->entries);
+    m_region->publish_count.store(0, std::memory_order_relaxed);
+    // Сигнатура записывается последней: читатель, проверивший ее, видит заполненное описание
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_region->magic, kPdoImageMagic, sizeof(m_region->magic));
+
+    m_fast_size = layout.fast_image_size;
+    m_slow_size = layout.image_size - layout.fast_image_size;
+
+    LOG_INFO("Publishing PDO image of " << layout.image_size << " bytes"
+             << (m_shm_name.empty() ? std::string() : " to shared memory " + m_shm_name));
+    return true;
+}
+
+void PdoImagePublisher::Close() {
+    if (! m_region) {
+        return;
+    }
+    if (m_shm_name.empty()) {
+        delete m_region;
+    } else {
+        ::munmap(m_region, sizeof(PdoImageRegion));
+        ::shm_unlink(m_shm_name.c_str());
+        m_shm_name.clear();
+    }
+    m_region = NULL;
+}
+
+} // namespaces
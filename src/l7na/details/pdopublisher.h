@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "l7na/pdoimage.h"
+
+namespace Drives {
+
+/*! @brief Публикация снимков образа PDO (PdoImageRegion) потоком обмена.
+ *
+ *  Область создается один раз до запуска потока обмена: в куче или в разделяемой памяти POSIX. Публикация -
+ *  копирование образа в свободный буфер и два атомарных счетчика, без системных вызовов и ожидания читателей.
+ */
+class PdoImagePublisher {
+public:
+    PdoImagePublisher();
+    ~PdoImagePublisher();
+
+    PdoImagePublisher(const PdoImagePublisher&) = delete;
+    PdoImagePublisher& operator=(const PdoImagePublisher&) = delete;
+
+    /*! @brief Создает область снимков.
+     *
+     *  @param  shm_name    Имя объекта разделяемой памяти (пустая строка - область в памяти процесса).
+     *                      Существующий объект пересоздается, только если его публикатор (publisher_pid)
+     *                      завершился; объект работающего публикатора или чужой объект - ошибка.
+     *                      Объект удаляется (shm_unlink) при Close: уже открывшие его читатели сохраняют
+     *                      отображение, но новых снимков в нем не появится
+     *  @param  layout      Описание образа: используются поля image_size и далее, entries
+     */
+    bool Open(const std::string& shm_name, const RecordFileHeader& layout);
+
+    //! @brief Освобождает область. Объект разделяемой памяти удаляется (shm_unlink), новые читатели его не откроют
+    void Close();
+
+    bool IsOpen() const { return m_region != NULL; }
+
+    const PdoImageRegion* Region() const { return m_region; }
+
+    //! @brief Публикует образ цикла frame: fast_image_size байт fast, затем slow. Вызывается только потоком обмена
+    void Publish(const PdoImageFrame& frame, const uint8_t* fast, const uint8_t* slow) {
+        const uint64_t count = m_region->publish_count.load(std::memory_order_relaxed);
+        PdoImageBuffer& buffer = m_region->buffers[count % kPdoImageBufferCount];
+        const uint64_t seq = buffer.seq.load(std::memory_order_relaxed);
+
+        buffer.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        buffer.frame = frame;
+        std::memcpy(buffer.image, fast, m_fast_size);
+        std::memcpy(buffer.image + m_fast_size, slow, m_slow_size);
+        buffer.seq.store(seq + 2, std::memory_order_release);
+        m_region->publish_count.store(count + 1, std::memory_order_release);
+    }
+
+private:
+    PdoImageRegion* m_region;
+    std::string     m_shm_name;     //!< Имя объекта разделяемой памяти (пустое - область в куче)
+    uint32_t        m_fast_size;
+    uint32_t        m_slow_size;
+};
+
+} // namespaces
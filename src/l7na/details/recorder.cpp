@@ -0,0 +1,302 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+#include "l7na/logger.h"
+#include "recorder.h"
+
+namespace Drives {
+
+namespace {
+
+inline uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+constexpr uint32_t CycleRecorder::kRingCapacity;
+constexpr uint32_t CycleRecorder::kFlushPeriodMs;
+constexpr uint64_t CycleRecorder::kWindowBytes;
+
+CycleRecorder::CycleRecorder()
+    : m_ring()
+    , m_dropped(0)
+    , m_stop(false)
+    , m_thread()
+    , m_fd(-1)
+    , m_header(NULL)
+    , m_seq(0)
+    , m_page_size(::sysconf(_SC_PAGESIZE))
+    , m_window(NULL)
+    , m_window_len(0)
+    , m_window_records(NULL)
+    , m_window_first(0)
+    , m_window_end(0)
+{}
+
+CycleRecorder::~CycleRecorder() {
+    Close();
+}
+
+bool CycleRecorder::Open(const std::string& path, const RecordFileHeader& layout, uint64_t capacity) {
+    Close();
+
+    if (! capacity || layout.image_size > kRecordMaxImageSize || layout.entry_count > kRecordMaxPdoEntries) {
+        LOG_ERROR("Invalid record file layout: capacity=" << capacity << ", image size=" << layout.image_size);
+        return false;
+    }
+
+    const uint32_t record_size = align_up(sizeof(CycleRecord) + layout.image_size, 8);
+    const uint64_t file_size = kRecordFileHeaderSize + capacity * record_size;
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        LOG_ERROR("Failed to create record file " << path << ": " << errno);
+        return false;
+    }
+    // Место выделяется сразу: во время работы запись не упирается в нехватку места
+    const int alloc_err = ::posix_fallocate(m_fd, 0, file_size);
+    if (alloc_err) {
+        LOG_ERROR("Failed to allocate " << file_size << " bytes for record file " << path << ": " << alloc_err);
+        Close();
+        return false;
+    }
+
+    void* header = ::mmap(NULL, kRecordFileHeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (MAP_FAILED == header) {
+        LOG_ERROR("Failed to map record file " << path << ": " << errno);
+        Close();
+        return false;
+    }
+    m_header = static_cast<RecordFileHeader*>(header);
+
+    std::memset(static_cast<void*>(m_header), 0, kRecordFileHeaderSize);
+    std::memcpy(m_header->magic, kRecordFileMagic, sizeof(m_header->magic));
+    m_header->version = kRecordFileVersion;
+    m_header->header_size = kRecordFileHeaderSize;
+    m_header->record_size = record_size;
+    m_header->image_size = layout.image_size;
+    m_header->fast_image_size = layout.fast_image_size;
+    m_header->cycle_period_ns = layout.cycle_period_ns;
+    m_header->slow_pdo_divider = layout.slow_pdo_divider;
+    m_header->pdo_layout = layout.pdo_layout;
+    m_header->axis_count = layout.axis_count;
+    m_header->entry_count = layout.entry_count;
+    m_header->capacity = capacity;
+    std::copy(layout.entries, layout.entries + layout.entry_count, m_header->entries);
+    m_header->write_count.store(0, std::memory_order_release);
+    m_header->dropped_count.store(0, std::memory_order_release);
+
+    m_ring.reset(new SlotRing());
+    m_seq = 0;
+    m_dropped.store(0, std::memory_order_relaxed);
+    m_stop.store(false, std::memory_order_relaxed);
+    m_thread.reset(new std::thread(std::bind(&CycleRecorder::writer_loop, this)));
+
+    LOG_INFO("Recording cycles to " << path << ": " << capacity << " records of " << record_size << " bytes");
+    return true;
+}
+
+void CycleRecorder::Close() {
+    if (m_thread) {
+        m_stop.store(true, std::memory_order_release);
+        m_thread->join();
+        m_thread.reset();
+    }
+
+    unmap_window();
+    if (m_header) {
+        ::msync(m_header, kRecordFileHeaderSize, MS_SYNC);
+        ::munmap(m_header, kRecordFileHeaderSize);
+        m_header = NULL;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_ring.reset();
+}
+
+CycleRecord* CycleRecorder::Claim() {
+    Slot* slot = m_ring->PushClaim();
+    if (! slot) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    return &slot->record;
+}
+
+void CycleRecorder::Publish() {
+    m_ring->PushClaimed();
+}
+
+void CycleRecorder::writer_loop() {
+    while (! m_stop.load(std::memory_order_acquire)) {
+        flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(kFlushPeriodMs));
+    }
+    flush();
+}
+
+void CycleRecorder::flush() {
+    const size_t count = m_ring->Size();
+    const uint32_t record_size = m_header->record_size;
+    const uint32_t data_size = sizeof(CycleRecord) + m_header->image_size;
+
+    size_t written = 0;
+    for (; written < count; ++written) {
+        if (! map_window(m_seq)) {
+            break;
+        }
+        const uint64_t slot = m_seq % m_header->capacity;
+        std::memcpy(m_window_records + (slot - m_window_first) * record_size, &m_ring->At(written), data_size);
+        ++m_seq;
+    }
+    m_ring->Pop(count);
+
+    // Записи, которые не удалось перенести в файл, тоже потеряны
+    const uint64_t dropped = m_dropped.fetch_add(count - written, std::memory_order_relaxed) + (count - written);
+    m_header->dropped_count.store(dropped, std::memory_order_relaxed);
+    m_header->write_count.store(m_seq, std::memory_order_release);
+}
+
+bool CycleRecorder::map_window(uint64_t seq) {
+    const uint64_t slot = seq % m_header->capacity;
+    if (m_window && slot >= m_window_first && slot < m_window_end) {
+        return true;
+    }
+    unmap_window();
+
+    const uint32_t record_size = m_header->record_size;
+    const uint64_t window_records = std::max<uint64_t>(1, kWindowBytes / record_size);
+    const uint64_t first = slot / window_records * window_records;
+    const uint64_t end = std::min(first + window_records, m_header->capacity);
+
+    const uint64_t offset = kRecordFileHeaderSize + first * record_size;
+    const uint64_t map_offset = offset / m_page_size * m_page_size;
+    const size_t map_len = kRecordFileHeaderSize + end * record_size - map_offset;
+    void* window = ::mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, map_offset);
+    if (MAP_FAILED == window) {
+        LOG_ERROR("Failed to map record file window at " << map_offset << ": " << errno);
+        return false;
+    }
+
+    m_window = static_cast<uint8_t*>(window);
+    m_window_len = map_len;
+    m_window_records = m_window + (offset - map_offset);
+    m_window_first = first;
+    m_window_end = end;
+    return true;
+}
+
+void CycleRecorder::unmap_window() {
+    if (m_window) {
+        ::msync(m_window, m_window_len, MS_ASYNC);
+        ::munmap(m_window, m_window_len);
+        m_window = NULL;
+    }
+}
+
+RecordFileReader::RecordFileReader()
+    : m_fd(-1)
+    , m_data(NULL)
+    , m_size(0)
+{}
+
+RecordFileReader::~RecordFileReader() {
+    Close();
+}
+
+bool RecordFileReader::Open(const std::string& path) {
+    Close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(m_fd, &st) || static_cast<uint64_t>(st.st_size) < kRecordFileHeaderSize) {
+        Close();
+        return false;
+    }
+
+    void* data = ::mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (MAP_FAILED == data) {
+        Close();
+        return false;
+    }
+    m_data = static_cast<uint8_t*>(data);
+    m_size = st.st_size;
+
+    const RecordFileHeader& header = Header();
+    const bool valid = ! std::memcmp(header.magic, kRecordFileMagic, sizeof(header.magic))
+            && header.version == kRecordFileVersion
+            && header.header_size == kRecordFileHeaderSize
+            && header.record_size >= sizeof(CycleRecord) + header.image_size
+            && header.fast_image_size <= header.image_size
+            && header.entry_count <= kRecordMaxPdoEntries
+            && header.capacity && header.header_size + header.capacity * header.record_size <= m_size;
+    if (! valid) {
+        Close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        const RecordPdoEntry& entry = header.entries[i];
+        if (! entry.bits || entry.bits > 64 || entry.offset + (entry.bits + 7u) / 8 > header.image_size) {
+            Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void RecordFileReader::Close() {
+    if (m_data) {
+        ::munmap(m_data, m_size);
+        m_data = NULL;
+        m_size = 0;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+const RecordFileHeader& RecordFileReader::Header() const {
+    return *reinterpret_cast<const RecordFileHeader*>(m_data);
+}
+
+uint64_t RecordFileReader::FirstSeq() const {
+    const uint64_t end = EndSeq();
+    return end > Header().capacity ? end - Header().capacity : 0;
+}
+
+uint64_t RecordFileReader::EndSeq() const {
+    return Header().write_count.load(std::memory_order_acquire);
+}
+
+const CycleRecord& RecordFileReader::Record(uint64_t seq) const {
+    const RecordFileHeader& header = Header();
+    const uint8_t* record = m_data + header.header_size + (seq % header.capacity) * header.record_size;
+    return *reinterpret_cast<const CycleRecord*>(record);
+}
+
+const uint8_t* RecordFileReader::Image(const CycleRecord& record) {
+    return reinterpret_cast<const uint8_t*>(&record + 1);
+}
+
+int64_t RecordFileReader::ReadEntry(const uint8_t* image, const RecordPdoEntry& entry, bool is_signed) {
+    return RecordPdoEntryValue(image, entry, is_signed);
+}
+
+} // namespaces
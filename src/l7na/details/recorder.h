@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "l7na/recordfile.h"
+#include "spscring.h"
+
+namespace Drives {
+
+/*! @brief Запись каждого цикла обмена в файл формата RecordFileHeader.
+ *
+ *  Поток обмена заполняет запись прямо в ячейке lock-free очереди (Claim/Publish) - без системных вызовов
+ *  и аллокаций. Фоновый поток раз в kFlushPeriodMs переносит записи из очереди в файл, отображаемый в
+ *  память окнами по kWindowBytes: при mlockall(MCL_FUTURE) в памяти блокируется только текущее окно,
+ *  а не весь файл. Если файл не успевает за циклом, записи теряются и учитываются в dropped_count.
+ */
+class CycleRecorder {
+public:
+    CycleRecorder();
+    ~CycleRecorder();
+
+    CycleRecorder(const CycleRecorder&) = delete;
+    CycleRecorder& operator=(const CycleRecorder&) = delete;
+
+    /*! @brief Создает файл полного размера и запускает фоновый поток.
+     *
+     *  @param  layout      Заголовок с заполненными описанием образа и параметрами цикла
+     *                      (record_size, header_size, capacity и счетчики выставляются здесь)
+     *  @param  capacity    Количество хранимых записей
+     */
+    bool Open(const std::string& path, const RecordFileHeader& layout, uint64_t capacity);
+
+    //! @brief Останавливает фоновый поток, дописывает очередь и закрывает файл.
+    void Close();
+
+    bool IsOpen() const { return m_header != NULL; }
+
+    //! @brief Ячейка для записи цикла (вызывается только потоком обмена). @return NULL - очередь заполнена
+    CycleRecord* Claim();
+    //! @brief Публикует запись, полученную Claim().
+    void Publish();
+
+    //! @brief Образ PDO в ячейке записи.
+    static uint8_t* Image(CycleRecord* record) { return reinterpret_cast<uint8_t*>(record + 1); }
+
+private:
+    struct Slot {
+        CycleRecord record;
+        uint8_t     image[kRecordMaxImageSize];
+    };
+
+    constexpr static uint32_t kRingCapacity = 1024;
+    constexpr static uint32_t kFlushPeriodMs = 10;
+    constexpr static uint64_t kWindowBytes = 4 * 1024 * 1024;
+
+    using SlotRing = SpscRing<Slot, kRingCapacity>;
+
+    void writer_loop();
+    //! Переносит все записи из очереди в файл
+    void flush();
+    //! Отображает окно файла с ячейкой seq
+    bool map_window(uint64_t seq);
+    void unmap_window();
+
+    std::unique_ptr<SlotRing>   m_ring;
+    std::atomic<uint64_t>       m_dropped;      //!< Потеряно записей (пишет поток обмена)
+    std::atomic<bool>           m_stop;
+    std::unique_ptr<std::thread>    m_thread;
+
+    int                 m_fd;
+    RecordFileHeader*   m_header;       //!< Отображенный заголовок файла
+    uint64_t            m_seq;          //!< Номер следующей записи в файле
+    size_t              m_page_size;
+
+    //! Отображенное окно: ячейки [m_window_first, m_window_end)
+    uint8_t*            m_window;
+    size_t              m_window_len;
+    uint8_t*            m_window_records;   //!< Адрес ячейки m_window_first внутри окна
+    uint64_t            m_window_first;
+    uint64_t            m_window_end;
+};
+
+} // namespaces
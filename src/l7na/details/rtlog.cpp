@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/date_time/c_local_time_adjustor.hpp>
+#include <boost/date_time/posix_time/conversion.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/log/attributes/current_thread_id.hpp>
+#include <boost/log/attributes/mutable_constant.hpp>
+#include <boost/log/sources/record_ostream.hpp>
+#include <boost/log/sources/severity_logger.hpp>
+
+#include "l7na/logger.h"
+#include "spscring.h"
+
+#ifndef L7NA_DISABLE_LOGS
+
+namespace common {
+
+namespace {
+
+namespace logger = boost::log;
+
+constexpr uint32_t kRtLogBufferCapacity = 256;
+constexpr uint32_t kRtLogFlushPeriodMs = 5;
+
+using ThreadId = logger::attributes::current_thread_id::value_type;
+
+//! Буфер записей LOG_RT одного потока
+struct RtLogBuffer {
+    RtLogBuffer()
+        : ring()
+        , dropped(0)
+        , thread_id(logger::aux::this_thread::get_id())
+    {}
+
+    Drives::SpscRing<RtLogRecord, kRtLogBufferCapacity> ring;
+    std::atomic<uint64_t>   dropped;    //!< Потеряно записей (пишет поток-владелец)
+    const ThreadId          thread_id;  //!< Поток-владелец (буфер создается в нем)
+};
+
+//! Местное время для атрибута TimeStamp (как у local_clock из add_common_attributes)
+boost::posix_time::ptime ToLocalTime(uint64_t time_ns) {
+    const boost::posix_time::ptime utc = boost::posix_time::from_time_t(static_cast<std::time_t>(time_ns / 1000000000))
+            + boost::posix_time::microseconds((time_ns % 1000000000) / 1000);
+    return boost::date_time::c_local_adjustor<boost::posix_time::ptime>::utc_to_local(utc);
+}
+
+/*! Буферы всех потоков и фоновый поток вывода.
+ *
+ *  Буфер живет, пока поток-владелец работает или в нем есть невыведенные записи: владелец держит
+ *  shared_ptr в thread_local, а фоновый поток удаляет из списка только пустые буферы без владельца.
+ */
+class RtLogSink {
+public:
+    RtLogSink()
+        : m_logger()
+        , m_timestamp(boost::posix_time::ptime())
+        , m_thread_id(ThreadId())
+        , m_mutex()
+        , m_flush_mutex()
+        , m_buffers()
+        , m_dropped_reported(0)
+        , m_dropped_removed(0)
+        , m_stop(false)
+        , m_stop_cv()
+        , m_thread()
+    {
+        // Атрибуты источника имеют приоритет над одноименными глобальными атрибутами add_common_attributes()
+        m_logger.add_attribute("TimeStamp", m_timestamp);
+        m_logger.add_attribute("ThreadID", m_thread_id);
+    }
+
+    ~RtLogSink() {
+        if (m_thread) {
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_stop = true;
+            }
+            m_stop_cv.notify_all();
+            m_thread->join();
+        }
+        Flush();
+    }
+
+    static RtLogSink& Instance() {
+        // Логгер boost.log создается раньше и уничтожается позже: деструктор выводит оставшиеся записи
+        logger::trivial::logger::get();
+        static RtLogSink sink;
+        return sink;
+    }
+
+    std::shared_ptr<RtLogBuffer> Register() {
+        std::shared_ptr<RtLogBuffer> buffer = std::make_shared<RtLogBuffer>();
+
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_buffers.push_back(buffer);
+        if (! m_thread) {
+            m_thread.reset(new std::thread(&RtLogSink::run, this));
+        }
+        return buffer;
+    }
+
+    void Flush() {
+        // Читатель каждого буфера должен быть один
+        std::lock_guard<std::mutex> flush_guard(m_flush_mutex);
+
+        std::vector<std::shared_ptr<RtLogBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            // Буферы завершившихся потоков, которые уже выведены, больше не нужны
+            const auto removed_it = std::partition(m_buffers.begin(), m_buffers.end(),
+                                                   [](const std::shared_ptr<RtLogBuffer>& b) {
+                                                       return b.use_count() > 1 || ! b->ring.Empty();
+                                                   });
+            for (auto it = removed_it; it != m_buffers.end(); ++it) {
+                m_dropped_removed += (*it)->dropped.load(std::memory_order_relaxed);
+            }
+            m_buffers.erase(removed_it, m_buffers.end());
+            buffers = m_buffers;
+        }
+
+        uint64_t dropped = 0;
+        for (const std::shared_ptr<RtLogBuffer>& buffer: buffers) {
+            const size_t count = buffer->ring.Size();
+            for (size_t i = 0; i < count; ++i) {
+                const RtLogRecord& record = buffer->ring.At(i);
+                try {
+                    m_timestamp.set(ToLocalTime(record.time_ns));
+                    m_thread_id.set(buffer->thread_id);
+                    BOOST_LOG_SEV(m_logger, record.level) << FormatRtLogRecord(record);
+                } catch (const std::exception& e) {
+                    std::cerr << "[Error logging] " << e.what() << '\t' << record.format << std::endl;
+                }
+            }
+            buffer->ring.Pop(count);
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            dropped += m_dropped_removed;
+        }
+        if (dropped > m_dropped_reported) {
+            LOG_WARN("RT log: " << dropped - m_dropped_reported << " records dropped");
+            m_dropped_reported = dropped;
+        }
+    }
+
+    uint64_t Dropped() {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        uint64_t dropped = m_dropped_removed;
+        for (const std::shared_ptr<RtLogBuffer>& buffer: m_buffers) {
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        return dropped;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (! m_stop) {
+            m_stop_cv.wait_for(lock, std::chrono::milliseconds(kRtLogFlushPeriodMs));
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+
+    //! Источник записей LOG_RT (используется только под m_flush_mutex) и его атрибуты текущей записи
+    logger::sources::severity_logger<logger::trivial::severity_level> m_logger;
+    logger::attributes::mutable_constant<boost::posix_time::ptime> m_timestamp;
+    logger::attributes::mutable_constant<ThreadId> m_thread_id;
+
+    std::mutex                                  m_mutex;            //!< Защищает m_buffers, m_dropped_removed и m_stop
+    std::mutex                                  m_flush_mutex;      //!< Сериализует Flush()
+    std::vector<std::shared_ptr<RtLogBuffer>>   m_buffers;
+    uint64_t                                    m_dropped_reported; //!< Потерянные записи, о которых уже сообщили
+    uint64_t                                    m_dropped_removed;  //!< Потеряно записей в удаленных буферах
+    bool                                        m_stop;
+    std::condition_variable                     m_stop_cv;
+    std::unique_ptr<std::thread>                m_thread;
+};
+
+thread_local std::shared_ptr<RtLogBuffer> t_buffer;
+
+//! Уровень, ниже которого LOG_RT не ставит записи в буфер (задается InitLogger)
+std::atomic<int32_t> g_rt_min_level(logger::trivial::trace);
+
+} // namespace
+
+void SetRtLogLevel(const boost::log::trivial::severity_level& level) {
+    g_rt_min_level.store(level, std::memory_order_relaxed);
+}
+
+RtLogRecord* RtLogClaim(boost::log::trivial::severity_level level) {
+    if (level < g_rt_min_level.load(std::memory_order_relaxed)) {
+        return NULL;
+    }
+    if (! t_buffer) {
+        RtLogRegisterThread();
+    }
+
+    RtLogRecord* record = t_buffer->ring.PushClaim();
+    if (! record) {
+        t_buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    // clock_gettime(CLOCK_REALTIME) выполняется через vDSO, без системного вызова
+    timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    record->time_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    return record;
+}
+
+void RtLogPublish() {
+    t_buffer->ring.PushClaimed();
+}
+
+void RtLogRegisterThread() {
+    if (! t_buffer) {
+        t_buffer = RtLogSink::Instance().Register();
+    }
+}
+
+void RtLogFlush() {
+    RtLogSink::Instance().Flush();
+}
+
+uint64_t RtLogDropped() {
+    return RtLogSink::Instance().Dropped();
+}
+
+std::string FormatRtLogRecord(const RtLogRecord& record) {
+    std::string result;
+    uint32_t arg_idx = 0;
+    char buf[32];
+    for (const char* pos = record.format; *pos; ++pos) {
+        const bool is_dec = pos[0] == '{' && pos[1] == '}';
+        const bool is_hex = pos[0] == '{' && pos[1] == 'x' && pos[2] == '}';
+        if (! (is_dec || is_hex) || arg_idx >= record.arg_count) {
+            result.push_back(*pos);
+            continue;
+        }
+
+        const RtLogArg& arg = record.args[arg_idx++];
+        switch (arg.type) {
+            case RtLogArg::kInt:
+                std::snprintf(buf, sizeof(buf), is_hex ? "%llx" : "%lld", static_cast<long long>(arg.i));
+                result += buf;
+                break;
+            case RtLogArg::kUInt:
+                std::snprintf(buf, sizeof(buf), is_hex ? "%llx" : "%llu", static_cast<unsigned long long>(arg.u));
+                result += buf;
+                break;
+            case RtLogArg::kDouble:
+                std::snprintf(buf, sizeof(buf), "%g", arg.d);
+                result += buf;
+                break;
+            case RtLogArg::kStr:
+                result += arg.s ? arg.s : "(null)";
+                break;
+        }
+        pos += is_hex ? 2 : 1;
+    }
+
+    return result;
+}
+
+} // namespaces
+
+#endif
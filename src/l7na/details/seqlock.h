@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+
+namespace Drives {
+
+/*! @brief Примитив публикации данных "один писатель - много читателей" (seqlock).
+ *
+ *  Писатель (поток циклического обмена) никогда не ждет читателей: запись - это два инкремента счетчика
+ *  и копирование данных. Читатель копирует данные и повторяет попытку, если во время копирования
+ *  произошла запись (счетчик нечетный или изменился).
+ *
+ *  @attention Писатель должен быть ровно один. Тип T должен быть тривиально копируемым.
+ */
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires trivially copyable type");
+
+public:
+    SeqLock()
+        : m_seq(0)
+        , m_data()
+    {}
+
+    explicit SeqLock(const T& value)
+        : m_seq(0)
+        , m_data(value)
+    {}
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    //! @brief Публикует новое значение. Вызывается только писателем.
+    void Store(const T& value) {
+        const uint64_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&m_data, &value, sizeof(T));
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    //! @brief Возвращает согласованную копию последнего опубликованного значения.
+    T Load() const {
+        T result;
+        Read([&result](const T& data) {
+            std::memcpy(&result, &data, sizeof(T));
+        });
+        return result;
+    }
+
+    /*! @brief Согласованно читает часть данных.
+     *
+     *  @param  reader  Функтор, получающий ссылку на данные и копирующий из нее нужные поля.
+     *                  Может быть вызван несколько раз, поэтому не должен иметь побочных эффектов
+     *                  кроме записи в свой результат.
+     */
+    template<typename Reader>
+    void Read(Reader reader) const {
+        uint64_t seq_before = 0;
+        uint64_t seq_after = 0;
+        do {
+            seq_before = m_seq.load(std::memory_order_acquire);
+            if (seq_before & 1) {
+                continue;
+            }
+            reader(m_data);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq_after = m_seq.load(std::memory_order_relaxed);
+        } while ((seq_before & 1) || seq_before != seq_after);
+    }
+
+    //! @brief Номер версии данных (меняется при каждой записи).
+    uint64_t Version() const {
+        return m_seq.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    std::atomic<uint64_t>   m_seq;      //!< Счетчик записей: нечетный во время записи
+    T                       m_data;     //!< Опубликованные данные
+};
+
+} // namespaces
@@ -0,0 +1,812 @@
+#include <errno.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ecbackend.h"
+
+namespace Drives {
+
+namespace {
+
+constexpr uint32_t kSdoAbortNoObject    = 0x06020000;   //!< Объект отсутствует в словаре
+constexpr uint32_t kSdoAbortLength      = 0x06070010;   //!< Длина данных не соответствует объекту
+constexpr uint16_t kErrFollowingError   = 0x8611;       //!< Код ошибки: превышена ошибка рассогласования
+
+constexpr uint8_t  kAlStatePreOp        = 0x2;
+constexpr uint8_t  kAlStateOp           = 0x8;
+
+//! Состояния CiA402 (значения statusword без битов 9 "Remote" и 10 "Target reached")
+enum DriveState : uint16_t {
+    kSwitchOnDisabled   = 0x0040,
+    kReadyToSwitchOn    = 0x0031,
+    kSwitchedOn         = 0x0033,
+    kOperationEnabled   = 0x0037,
+    kFault              = 0x0008
+};
+
+constexpr uint16_t kStatusRemote            = 0x0200;
+constexpr uint16_t kStatusTargetReached     = 0x0400;
+constexpr uint16_t kCtrlNewSetpoint         = 0x0010;
+constexpr uint16_t kCtrlFaultReset          = 0x0080;
+
+constexpr int8_t   kModeProfilePosition     = 1;
+constexpr int8_t   kModeProfileVelocity     = 3;
+constexpr int8_t   kModeCyclicPosition      = 8;
+
+//! Числовой объект словаря: значение в порядке байт EtherCAT
+struct SimObject {
+    uint8_t     data[8];
+    uint8_t     size;
+};
+
+inline uint32_t object_key(uint16_t index, uint8_t subindex) {
+    return (static_cast<uint32_t>(index) << 8) | subindex;
+}
+
+inline int64_t read_object(const SimObject* obj, bool is_signed) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < obj->size; ++i) {
+        value |= static_cast<uint64_t>(obj->data[i]) << (8 * i);
+    }
+    if (is_signed && obj->size < 8 && (value >> (8 * obj->size - 1)) & 1) {
+        value |= ~uint64_t(0) << (8 * obj->size);
+    }
+    return static_cast<int64_t>(value);
+}
+
+inline void write_object(SimObject* obj, int64_t value) {
+    for (uint32_t i = 0; i < obj->size; ++i) {
+        obj->data[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+    }
+}
+
+/*! Подчиненный: словарь объектов, конфигурация PDO и модель привода.
+ *
+ *  Модель работает только с объектами словаря, поэтому PDO и SDO видят одни и те же значения.
+ */
+class SimSlave {
+public:
+    SimSlave(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code)
+        : alias(alias)
+        , position(position)
+        , vendor_id(vendor_id)
+        , product_code(product_code)
+        , m_objects()
+        , m_strings()
+        , m_pdo_entries()
+        , m_state(kSwitchOnDisabled)
+        , m_prev_ctrl(0)
+        , m_dmd_pos(0.0)
+        , m_dmd_vel(0.0)
+        , m_act_pos(0.0)
+        , m_act_vel(0.0)
+        , m_pp_target(0.0)
+    {
+        add_object(0x1018, 4, 4, 1000 + position);      // Serial number
+        add_object(0x2002, 0, 2, 20);                   // Encoder resolution [биты]
+        add_object(0x603F, 0, 2, 0);                    // Error code
+        add_object(0x6040, 0, 2, 0);                    // Controlword
+        add_object(0x6041, 0, 2, m_state | kStatusRemote);
+        add_object(0x6060, 0, 1, 0);                    // Mode of operation
+        add_object(0x6061, 0, 1, 0);                    // Mode of operation display
+        add_object(0x6062, 0, 4, 0);                    // Demand position
+        add_object(0x6064, 0, 4, 0);                    // Actual position
+        add_object(0x6065, 0, 4, 1048576);              // Following error window
+        add_object(0x6067, 0, 4, 100);                  // Position window
+        add_object(0x606B, 0, 4, 0);                    // Demand velocity
+        add_object(0x606C, 0, 4, 0);                    // Actual velocity
+        add_object(0x606D, 0, 2, 1000);                 // Velocity window
+        add_object(0x6077, 0, 2, 0);                    // Actual torque
+        add_object(0x607A, 0, 4, 0);                    // Target position
+        add_object(0x6081, 0, 4, 200000);               // Profile velocity
+        add_object(0x6083, 0, 4, 100000);               // Profile acceleration
+        add_object(0x6084, 0, 4, 100000);               // Profile deceleration
+        add_object(0x60C2, 1, 1, 1);                    // Interpolation period
+        add_object(0x60C2, 2, 1, -3);
+        add_object(0x60F4, 0, 4, 0);                    // Following error
+        add_object(0x60FF, 0, 4, 0);                    // Target velocity
+        add_object(0x260D, 0, 4, 0);                    // Actual position (absolute)
+        add_object(0x2610, 0, 2, 30);                   // Drive temperature
+        add_object(0x2603, 0, 2, 0);                    // Accumulated operation overload
+        add_object(0x2605, 0, 2, 311);                  // DC-link voltage
+        add_object(0x2614, 0, 2, 0);                    // Warning code
+
+        m_strings[object_key(0x1008, 0)] = "L7NA simulated servo drive";
+        m_strings[object_key(0x1009, 0)] = "sim";
+        m_strings[object_key(0x100A, 0)] = "1.0";
+
+        m_ctrl = Object(0x6040, 0);
+        m_status = Object(0x6041, 0);
+        m_mode = Object(0x6060, 0);
+        m_mode_display = Object(0x6061, 0);
+        m_tgt_pos = Object(0x607A, 0);
+        m_tgt_vel = Object(0x60FF, 0);
+        m_obj_dmd_pos = Object(0x6062, 0);
+        m_obj_dmd_vel = Object(0x606B, 0);
+        m_obj_act_pos = Object(0x6064, 0);
+        m_obj_act_vel = Object(0x606C, 0);
+        m_obj_act_pos_abs = Object(0x260D, 0);
+        m_follow_err = Object(0x60F4, 0);
+        m_torque = Object(0x6077, 0);
+        m_err_code = Object(0x603F, 0);
+    }
+
+    SimObject* Object(uint16_t index, uint8_t subindex) {
+        const auto it = m_objects.find(object_key(index, subindex));
+        return it != m_objects.end() ? &it->second : NULL;
+    }
+
+    bool ConfigurePdos(unsigned int n_syncs, const ec_sync_info_t syncs[]) {
+        m_pdo_entries.clear();
+        for (unsigned int i = 0; i < n_syncs && syncs[i].index != 0xFF; ++i) {
+            for (unsigned int p = 0; p < syncs[i].n_pdos; ++p) {
+                const ec_pdo_info_t& pdo = syncs[i].pdos[p];
+                for (unsigned int e = 0; e < pdo.n_entries; ++e) {
+                    const ec_pdo_entry_info_t& entry = pdo.entries[e];
+                    const SimObject* obj = Object(entry.index, entry.subindex);
+                    if (! obj || obj->size * 8 != entry.bit_length) {
+                        return false;
+                    }
+                    m_pdo_entries.push_back({ entry.index, entry.subindex, syncs[i].dir });
+                }
+            }
+        }
+        return true;
+    }
+
+    //! Первое вхождение объекта в конфигурацию PDO (порядок SyncManager'ов, как у IgH)
+    bool FindPdoEntry(uint16_t index, uint8_t subindex, ec_direction_t& dir) const {
+        for (const PdoEntry& entry: m_pdo_entries) {
+            if (entry.index == index && entry.subindex == subindex) {
+                dir = entry.dir;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int Upload(uint16_t index, uint8_t subindex, uint8_t* target, size_t target_size, size_t* result_size,
+               uint32_t* abort_code) {
+        const auto str_it = m_strings.find(object_key(index, subindex));
+        if (str_it != m_strings.end()) {
+            const size_t size = std::min(target_size, str_it->second.size());
+            std::memcpy(target, str_it->second.data(), size);
+            *result_size = size;
+            return 0;
+        }
+
+        const SimObject* obj = Object(index, subindex);
+        if (! obj) {
+            *abort_code = kSdoAbortNoObject;
+            return -EIO;
+        }
+        if (obj->size > target_size) {
+            return -EOVERFLOW;
+        }
+        std::memcpy(target, obj->data, obj->size);
+        *result_size = obj->size;
+        return 0;
+    }
+
+    //! Объекты производителя и профиля, которых нет в словаре, создаются при первой записи
+    int Download(uint16_t index, uint8_t subindex, const uint8_t* data, size_t data_size, uint32_t* abort_code) {
+        SimObject* obj = Object(index, subindex);
+        if (! obj && index >= 0x2000 && data_size && data_size <= sizeof(obj->data)) {
+            obj = &m_objects[object_key(index, subindex)];
+            obj->size = data_size;
+        }
+        if (! obj) {
+            *abort_code = kSdoAbortNoObject;
+            return -EIO;
+        }
+        if (obj->size != data_size) {
+            *abort_code = kSdoAbortLength;
+            return -EIO;
+        }
+        std::memcpy(obj->data, data, data_size);
+        return 0;
+    }
+
+    //! Шаг модели на dt секунд по командам из объектов RxPDO
+    void Step(double dt, double motor_time_constant) {
+        const uint16_t ctrl = read_object(m_ctrl, false);
+        const int8_t mode = read_object(m_mode, true);
+        update_state(ctrl);
+        const bool new_setpoint = (ctrl & kCtrlNewSetpoint) && ! (m_prev_ctrl & kCtrlNewSetpoint);
+        m_prev_ctrl = ctrl;
+
+        bool target_reached = false;
+        const double pos_window = read_object(Object(0x6067, 0), false);
+        if (kOperationEnabled != m_state) {
+            m_dmd_pos = m_act_pos;
+            m_dmd_vel = 0.0;
+            m_pp_target = m_act_pos;
+        } else if (kModeProfilePosition == mode) {
+            if (new_setpoint) {
+                m_pp_target = static_cast<int32_t>(read_object(m_tgt_pos, true));
+            }
+            step_profile_position(dt);
+            target_reached = m_dmd_pos == m_pp_target && std::fabs(m_pp_target - m_act_pos) <= pos_window;
+        } else if (kModeProfileVelocity == mode) {
+            const double tgt_vel = static_cast<int32_t>(read_object(m_tgt_vel, true));
+            m_dmd_vel = approach(m_dmd_vel, tgt_vel, profile_value(0x6083) * dt);
+            m_dmd_pos += m_dmd_vel * dt;
+            target_reached = std::fabs(tgt_vel - m_act_vel) <= read_object(Object(0x606D, 0), false);
+        } else if (kModeCyclicPosition == mode) {
+            const double tgt_pos = static_cast<int32_t>(read_object(m_tgt_pos, true));
+            m_dmd_vel = (tgt_pos - m_dmd_pos) / dt;
+            m_dmd_pos = tgt_pos;
+            target_reached = std::fabs(tgt_pos - m_act_pos) <= pos_window;
+        } else {
+            m_dmd_vel = 0.0;
+        }
+
+        // Двигатель отрабатывает запрашиваемую позицию с запаздыванием первого порядка
+        const double prev_vel = m_act_vel;
+        const double prev_pos = m_act_pos;
+        const double alpha = motor_time_constant > 0.0 ? 1.0 - std::exp(-dt / motor_time_constant) : 1.0;
+        m_act_pos += (m_dmd_pos - m_act_pos) * alpha;
+        m_act_vel = (m_act_pos - prev_pos) / dt;
+
+        const int32_t follow_err = static_cast<int32_t>(std::lround(m_dmd_pos - m_act_pos));
+        if (kOperationEnabled == m_state
+                && static_cast<uint32_t>(std::abs(follow_err)) > read_object(Object(0x6065, 0), false)) {
+            m_state = kFault;
+            write_object(m_err_code, kErrFollowingError);
+        }
+
+        // Момент - оценка по ускорению [0.1% номинального]
+        const double torque = (m_act_vel - prev_vel) / dt / kRatedAccel * 1000.0;
+
+        write_object(m_status, m_state | kStatusRemote | (target_reached ? kStatusTargetReached : 0));
+        write_object(m_mode_display, mode);
+        write_object(m_obj_dmd_pos, static_cast<int32_t>(std::lround(m_dmd_pos)));
+        write_object(m_obj_dmd_vel, static_cast<int32_t>(std::lround(m_dmd_vel)));
+        write_object(m_obj_act_pos, static_cast<int32_t>(std::lround(m_act_pos)));
+        write_object(m_obj_act_pos_abs, static_cast<int32_t>(std::lround(m_act_pos)));
+        write_object(m_obj_act_vel, static_cast<int32_t>(std::lround(m_act_vel)));
+        write_object(m_follow_err, follow_err);
+        write_object(m_torque, static_cast<int16_t>(std::max(-3000.0, std::min(3000.0, torque))));
+    }
+
+    const uint16_t  alias;
+    const uint16_t  position;
+    const uint32_t  vendor_id;
+    const uint32_t  product_code;
+
+private:
+    struct PdoEntry {
+        uint16_t        index;
+        uint8_t         subindex;
+        ec_direction_t  dir;
+    };
+
+    constexpr static double kRatedAccel = 10485760.0;   //!< Ускорение при номинальном моменте [импульсы/с^2]
+
+    void add_object(uint16_t index, uint8_t subindex, uint8_t size, int64_t value) {
+        SimObject& obj = m_objects[object_key(index, subindex)];
+        obj.size = size;
+        write_object(&obj, value);
+    }
+
+    double profile_value(uint16_t index) {
+        return std::max<double>(1.0, read_object(Object(index, 0), false));
+    }
+
+    static double approach(double value, double target, double max_step) {
+        return value + std::max(-max_step, std::min(max_step, target - value));
+    }
+
+    //! Переходы CiA402 по controlword. Переход в Operation enabled допускается из любого включенного состояния
+    void update_state(uint16_t ctrl) {
+        if (kFault == m_state) {
+            if ((ctrl & kCtrlFaultReset) && ! (m_prev_ctrl & kCtrlFaultReset)) {
+                m_state = kSwitchOnDisabled;
+                write_object(m_err_code, 0);
+            }
+            return;
+        }
+
+        if (! (ctrl & 0x02) || ! (ctrl & 0x04)) {
+            m_state = kSwitchOnDisabled;                // Disable voltage, Quick stop
+        } else if ((ctrl & 0x07) == 0x06) {
+            m_state = kReadyToSwitchOn;                 // Shutdown
+        } else if ((ctrl & 0x0F) == 0x07) {
+            m_state = kSwitchedOn;                      // Switch on
+        } else if ((ctrl & 0x0F) == 0x0F) {
+            m_state = kOperationEnabled;                // Enable operation
+        }
+    }
+
+    //! Profile position: трапециевидный профиль скорости к m_pp_target
+    void step_profile_position(double dt) {
+        const double max_vel = profile_value(0x6081);
+        const double acc = profile_value(0x6083);
+        const double dec = profile_value(0x6084);
+
+        const double err = m_pp_target - m_dmd_pos;
+        if (std::fabs(err) <= std::fabs(m_dmd_vel) * dt && std::fabs(m_dmd_vel) <= dec * dt) {
+            m_dmd_pos = m_pp_target;
+            m_dmd_vel = 0.0;
+            return;
+        }
+
+        // Скорость, с которой еще можно остановиться в цели
+        const double vel = std::min(max_vel, std::sqrt(2.0 * dec * std::fabs(err)));
+        const double tgt_vel = err > 0.0 ? vel : -vel;
+        m_dmd_vel = approach(m_dmd_vel, tgt_vel, (std::fabs(tgt_vel) > std::fabs(m_dmd_vel) ? acc : dec) * dt);
+        m_dmd_pos += m_dmd_vel * dt;
+    }
+
+    std::map<uint32_t, SimObject>   m_objects;      //!< Узлы map не перемещаются: на объекты хранятся указатели
+    std::map<uint32_t, std::string> m_strings;
+    std::vector<PdoEntry>           m_pdo_entries;
+
+    //! Объекты, с которыми работает модель
+    SimObject*  m_ctrl;
+    SimObject*  m_status;
+    SimObject*  m_mode;
+    SimObject*  m_mode_display;
+    SimObject*  m_tgt_pos;
+    SimObject*  m_tgt_vel;
+    SimObject*  m_obj_dmd_pos;
+    SimObject*  m_obj_dmd_vel;
+    SimObject*  m_obj_act_pos;
+    SimObject*  m_obj_act_vel;
+    SimObject*  m_obj_act_pos_abs;
+    SimObject*  m_follow_err;
+    SimObject*  m_torque;
+    SimObject*  m_err_code;
+
+    uint16_t    m_state;
+    uint16_t    m_prev_ctrl;
+    double      m_dmd_pos;
+    double      m_dmd_vel;
+    double      m_act_pos;
+    double      m_act_vel;
+    double      m_pp_target;
+};
+
+constexpr double SimSlave::kRatedAccel;
+
+//! Объект PDO в данных домена
+struct SimPdoLink {
+    SimObject*  object;
+    uint32_t    offset;
+    bool        output;     //!< RxPDO: данные домена переносятся в словарь при отправке
+};
+
+class SimMaster;
+
+struct SimDomain {
+    explicit SimDomain(SimMaster* master)
+        : master(master)
+        , links()
+        , data()
+        , size(0)
+        , queued(false)
+        , sent(false)
+        , received(false)
+        , state()
+    {}
+
+    SimMaster*                  master;
+    std::vector<SimPdoLink>     links;
+    std::vector<uint8_t>        data;
+    size_t                      size;
+    bool                        queued;
+    bool                        sent;
+    bool                        received;
+    ec_domain_state_t           state;
+};
+
+struct SimSdoRequest {
+    SimSlave*               slave;
+    uint16_t                index;
+    uint8_t                 subindex;
+    std::vector<uint8_t>    data;
+    ec_request_state_t      state;
+    bool                    write_pending;
+    bool                    read_pending;
+};
+
+struct SimSlaveConfig {
+    SimMaster*  master;
+    SimSlave*   slave;
+};
+
+/*! Мастер: подчиненные, домены и запросы SDO.
+ *
+ *  Один цикл обмена - master_send: данные RxPDO переносятся в словари, модели продвигаются на шаг;
+ *  master_receive и domain_process возвращают значения TxPDO. Запросы SDO выполняются за один цикл.
+ */
+class SimMaster {
+public:
+    SimMaster()
+        : m_options()
+        , m_step_s(0.0)
+        , m_slaves()
+        , m_configs()
+        , m_domains()
+        , m_requests()
+        , m_active(false)
+        , m_active_cycles(0)
+        , m_app_time(0)
+    {}
+
+    void Configure(const SimOptions& options, uint32_t cycle_period_ns) {
+        m_options = options;
+        m_step_s = (options.step_ns ? options.step_ns : cycle_period_ns) / 1e9;
+    }
+
+    SimDomain* CreateDomain() {
+        m_domains.emplace_back(new SimDomain(this));
+        return m_domains.back().get();
+    }
+
+    SimSlaveConfig* SlaveConfig(uint16_t alias, uint16_t position, uint32_t vendor_id, uint32_t product_code) {
+        SimSlave* slave = FindSlave(position);
+        if (! slave) {
+            m_slaves.emplace_back(new SimSlave(alias, position, vendor_id, product_code));
+            slave = m_slaves.back().get();
+        } else if (slave->alias != alias) {
+            return NULL;
+        }
+        m_configs.emplace_back(new SimSlaveConfig{ this, slave });
+        return m_configs.back().get();
+    }
+
+    SimSlave* FindSlave(uint16_t position) {
+        for (const std::unique_ptr<SimSlave>& slave: m_slaves) {
+            if (slave->position == position) {
+                return slave.get();
+            }
+        }
+        return NULL;
+    }
+
+    size_t SlaveCount() const {
+        return m_slaves.size();
+    }
+
+    int RegisterPdoEntries(SimDomain* domain, const ec_pdo_entry_reg_t* regs) {
+        if (m_active) {
+            return -EBUSY;
+        }
+        for (const ec_pdo_entry_reg_t* reg = regs; reg->index; ++reg) {
+            SimSlave* slave = FindSlave(reg->position);
+            ec_direction_t dir = EC_DIR_INVALID;
+            if (! slave || slave->alias != reg->alias || ! slave->FindPdoEntry(reg->index, reg->subindex, dir)) {
+                return -ENOENT;
+            }
+            SimObject* obj = slave->Object(reg->index, reg->subindex);
+            *reg->offset = domain->size;
+            if (reg->bit_position) {
+                *reg->bit_position = 0;
+            }
+            domain->links.push_back({ obj, static_cast<uint32_t>(domain->size), EC_DIR_OUTPUT == dir });
+            domain->size += obj->size;
+        }
+        return 0;
+    }
+
+    SimSdoRequest* CreateSdoRequest(SimSlave* slave, uint16_t index, uint8_t subindex, size_t size) {
+        m_requests.emplace_back(new SimSdoRequest{ slave, index, subindex, std::vector<uint8_t>(size), EC_REQUEST_UNUSED, false, false });
+        return m_requests.back().get();
+    }
+
+    int Activate() {
+        if (m_active) {
+            return -EBUSY;
+        }
+        if (m_step_s <= 0.0) {
+            return -EINVAL;
+        }
+        for (const std::unique_ptr<SimDomain>& domain: m_domains) {
+            domain->data.assign(domain->size, 0);
+        }
+        m_active = true;
+        m_active_cycles = 0;
+        return 0;
+    }
+
+    uint8_t* DomainData(SimDomain* domain) {
+        return m_active ? domain->data.data() : NULL;
+    }
+
+    void Send() {
+        if (! m_active) {
+            return;
+        }
+        for (const std::unique_ptr<SimDomain>& domain: m_domains) {
+            if (! domain->queued) {
+                continue;
+            }
+            for (const SimPdoLink& link: domain->links) {
+                if (link.output) {
+                    std::memcpy(link.object->data, domain->data.data() + link.offset, link.object->size);
+                }
+            }
+            domain->queued = false;
+            domain->sent = true;
+        }
+
+        if (IsOperational()) {
+            const double time_constant = m_options.motor_time_constant_ns / 1e9;
+            for (const std::unique_ptr<SimSlave>& slave: m_slaves) {
+                slave->Step(m_step_s, time_constant);
+            }
+        }
+        ++m_active_cycles;
+    }
+
+    void Receive() {
+        for (const std::unique_ptr<SimDomain>& domain: m_domains) {
+            domain->received = domain->sent;
+            domain->sent = false;
+        }
+        for (const std::unique_ptr<SimSdoRequest>& request: m_requests) {
+            if (request->write_pending) {
+                uint32_t abort_code = 0;
+                const int err = request->slave->Download(request->index, request->subindex, request->data.data(),
+                                                         request->data.size(), &abort_code);
+                request->state = err ? EC_REQUEST_ERROR : EC_REQUEST_SUCCESS;
+                request->write_pending = false;
+            } else if (request->read_pending) {
+                uint32_t abort_code = 0;
+                size_t result_size = 0;
+                const int err = request->slave->Upload(request->index, request->subindex, request->data.data(),
+                                                       request->data.size(), &result_size, &abort_code);
+                request->state = err ? EC_REQUEST_ERROR : EC_REQUEST_SUCCESS;
+                request->read_pending = false;
+            }
+        }
+    }
+
+    void ProcessDomain(SimDomain* domain) {
+        if (! domain->received) {
+            domain->state.wc_state = EC_WC_ZERO;
+            domain->state.working_counter = 0;
+            return;
+        }
+        for (const SimPdoLink& link: domain->links) {
+            if (! link.output) {
+                std::memcpy(domain->data.data() + link.offset, link.object->data, link.object->size);
+            }
+        }
+        domain->received = false;
+        domain->state.wc_state = IsOperational() ? EC_WC_COMPLETE : EC_WC_INCOMPLETE;
+        domain->state.working_counter = IsOperational() ? m_slaves.size() * 3 : 0;
+    }
+
+    bool IsOperational() const {
+        return m_active && m_active_cycles >= m_options.op_delay_cycles;
+    }
+
+    void SetApplicationTime(uint64_t app_time) {
+        m_app_time = app_time;
+    }
+
+    uint64_t ApplicationTime() const {
+        return m_app_time;
+    }
+
+private:
+    SimOptions                                  m_options;
+    double                                      m_step_s;       //!< Шаг модели [секунды]
+    std::vector<std::unique_ptr<SimSlave>>      m_slaves;
+    std::vector<std::unique_ptr<SimSlaveConfig>> m_configs;
+    std::vector<std::unique_ptr<SimDomain>>     m_domains;
+    std::vector<std::unique_ptr<SimSdoRequest>> m_requests;
+    bool                                        m_active;
+    uint32_t                                    m_active_cycles;
+    uint64_t                                    m_app_time;
+};
+
+inline SimMaster* sim(ec_master_t* master) { return reinterpret_cast<SimMaster*>(master); }
+inline SimDomain* sim(ec_domain_t* domain) { return reinterpret_cast<SimDomain*>(domain); }
+inline const SimDomain* sim(const ec_domain_t* domain) { return reinterpret_cast<const SimDomain*>(domain); }
+inline SimSlaveConfig* sim(ec_slave_config_t* sc) { return reinterpret_cast<SimSlaveConfig*>(sc); }
+inline const SimSlaveConfig* sim(const ec_slave_config_t* sc) { return reinterpret_cast<const SimSlaveConfig*>(sc); }
+inline SimSdoRequest* sim(ec_sdo_request_t* req) { return reinterpret_cast<SimSdoRequest*>(req); }
+
+ec_master_t* sim_request_master(unsigned int) {
+    return reinterpret_cast<ec_master_t*>(new SimMaster());
+}
+
+void sim_release_master(ec_master_t* master) {
+    delete sim(master);
+}
+
+int sim_master(ec_master_t* master, ec_master_info_t* master_info) {
+    std::memset(master_info, 0, sizeof(*master_info));
+    master_info->slave_count = sim(master)->SlaveCount();
+    master_info->link_up = 1;
+    master_info->app_time = sim(master)->ApplicationTime();
+    return 0;
+}
+
+int sim_master_get_slave(ec_master_t* master, uint16_t position, ec_slave_info_t* slave_info) {
+    const SimSlave* slave = sim(master)->FindSlave(position);
+    if (! slave) {
+        return -EINVAL;
+    }
+    std::memset(slave_info, 0, sizeof(*slave_info));
+    slave_info->position = slave->position;
+    slave_info->alias = slave->alias;
+    slave_info->vendor_id = slave->vendor_id;
+    slave_info->product_code = slave->product_code;
+    return 0;
+}
+
+ec_domain_t* sim_master_create_domain(ec_master_t* master) {
+    return reinterpret_cast<ec_domain_t*>(sim(master)->CreateDomain());
+}
+
+ec_slave_config_t* sim_master_slave_config(ec_master_t* master, uint16_t alias, uint16_t position, uint32_t vendor_id,
+                                           uint32_t product_code) {
+    return reinterpret_cast<ec_slave_config_t*>(sim(master)->SlaveConfig(alias, position, vendor_id, product_code));
+}
+
+int sim_master_select_reference_clock(ec_master_t*, ec_slave_config_t*) {
+    return 0;
+}
+
+int sim_master_sdo_download(ec_master_t* master, uint16_t position, uint16_t index, uint8_t subindex, uint8_t* data,
+                            size_t data_size, uint32_t* abort_code) {
+    SimSlave* slave = sim(master)->FindSlave(position);
+    return slave ? slave->Download(index, subindex, data, data_size, abort_code) : -EINVAL;
+}
+
+int sim_master_sdo_upload(ec_master_t* master, uint16_t position, uint16_t index, uint8_t subindex, uint8_t* target,
+                          size_t target_size, size_t* result_size, uint32_t* abort_code) {
+    SimSlave* slave = sim(master)->FindSlave(position);
+    return slave ? slave->Upload(index, subindex, target, target_size, result_size, abort_code) : -EINVAL;
+}
+
+int sim_master_activate(ec_master_t* master) {
+    return sim(master)->Activate();
+}
+
+int sim_master_set_send_interval(ec_master_t*, size_t) {
+    return 0;
+}
+
+void sim_master_send(ec_master_t* master) {
+    sim(master)->Send();
+}
+
+void sim_master_receive(ec_master_t* master) {
+    sim(master)->Receive();
+}
+
+void sim_master_application_time(ec_master_t* master, uint64_t app_time) {
+    sim(master)->SetApplicationTime(app_time);
+}
+
+void sim_master_sync_noop(ec_master_t*) {}
+
+//! Референсные часы идеально синхронизированы с application time
+int sim_master_reference_clock_time(ec_master_t* master, uint32_t* time) {
+    *time = static_cast<uint32_t>(sim(master)->ApplicationTime());
+    return 0;
+}
+
+uint32_t sim_master_sync_monitor_process(ec_master_t*) {
+    return 0;
+}
+
+int sim_slave_config_pdos(ec_slave_config_t* sc, unsigned int n_syncs, const ec_sync_info_t syncs[]) {
+    return sim(sc)->slave->ConfigurePdos(n_syncs, syncs) ? 0 : -ENOENT;
+}
+
+void sim_slave_config_dc(ec_slave_config_t*, uint16_t, uint32_t, int32_t, uint32_t, int32_t) {}
+
+ec_sdo_request_t* sim_slave_config_create_sdo_request(ec_slave_config_t* sc, uint16_t index, uint8_t subindex, size_t size) {
+    return reinterpret_cast<ec_sdo_request_t*>(sim(sc)->master->CreateSdoRequest(sim(sc)->slave, index, subindex, size));
+}
+
+void sim_slave_config_state(const ec_slave_config_t* sc, ec_slave_config_state_t* state) {
+    const bool operational = sim(sc)->master->IsOperational();
+    state->online = 1;
+    state->operational = operational;
+    state->al_state = operational ? kAlStateOp : kAlStatePreOp;
+}
+
+int sim_domain_reg_pdo_entry_list(ec_domain_t* domain, const ec_pdo_entry_reg_t* regs) {
+    return sim(domain)->master->RegisterPdoEntries(sim(domain), regs);
+}
+
+size_t sim_domain_size(const ec_domain_t* domain) {
+    return sim(domain)->size;
+}
+
+uint8_t* sim_domain_data(ec_domain_t* domain) {
+    return sim(domain)->master->DomainData(sim(domain));
+}
+
+void sim_domain_process(ec_domain_t* domain) {
+    sim(domain)->master->ProcessDomain(sim(domain));
+}
+
+void sim_domain_queue(ec_domain_t* domain) {
+    sim(domain)->queued = true;
+}
+
+void sim_domain_state(const ec_domain_t* domain, ec_domain_state_t* state) {
+    *state = sim(domain)->state;
+}
+
+void sim_sdo_request_timeout(ec_sdo_request_t*, uint32_t) {}
+
+uint8_t* sim_sdo_request_data(ec_sdo_request_t* req) {
+    return sim(req)->data.data();
+}
+
+ec_request_state_t sim_sdo_request_state(ec_sdo_request_t* req) {
+    return sim(req)->state;
+}
+
+void sim_sdo_request_write(ec_sdo_request_t* req) {
+    sim(req)->state = EC_REQUEST_BUSY;
+    sim(req)->write_pending = true;
+}
+
+void sim_sdo_request_read(ec_sdo_request_t* req) {
+    sim(req)->state = EC_REQUEST_BUSY;
+    sim(req)->read_pending = true;
+}
+
+} // namespace
+
+const EcBackend& SimEcBackend() {
+    static const EcBackend kBackend = {
+        &sim_request_master
+        , &sim_release_master
+        , &sim_master
+        , &sim_master_get_slave
+        , &sim_master_create_domain
+        , &sim_master_slave_config
+        , &sim_master_select_reference_clock
+        , &sim_master_sdo_download
+        , &sim_master_sdo_upload
+        , &sim_master_activate
+        , &sim_master_set_send_interval
+        , &sim_master_send
+        , &sim_master_receive
+        , &sim_master_application_time
+        , &sim_master_sync_noop
+        , &sim_master_sync_noop
+        , &sim_master_reference_clock_time
+        , &sim_master_sync_noop
+        , &sim_master_sync_monitor_process
+        , &sim_slave_config_pdos
+        , &sim_slave_config_dc
+        , &sim_slave_config_create_sdo_request
+        , &sim_slave_config_state
+        , &sim_domain_reg_pdo_entry_list
+        , &sim_domain_size
+        , &sim_domain_data
+        , &sim_domain_process
+        , &sim_domain_queue
+        , &sim_domain_state
+        , &sim_sdo_request_timeout
+        , &sim_sdo_request_data
+        , &sim_sdo_request_state
+        , &sim_sdo_request_write
+        , &sim_sdo_request_read
+    };
+    return kBackend;
+}
+
+void SimConfigureMaster(ec_master_t* master, const SimOptions& options, uint32_t cycle_period_ns) {
+    sim(master)->Configure(options, cycle_period_ns);
+}
+
+} // namespaces
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+namespace Drives {
+
+/*! @brief Ограниченная lock-free очередь "один писатель - один читатель" с предвыделенной памятью.
+ *
+ *  Писатель добавляет элементы пачкой: либо вся пачка попадает в очередь, либо (при нехватке места)
+ *  очередь не изменяется. Читатель может просматривать все видимые ему элементы, не извлекая их.
+ *
+ *  @attention Методы Push* вызываются только писателем, остальные (кроме Capacity) - только читателем.
+ *  Если писателей несколько, они должны быть сериализованы снаружи.
+ */
+template<typename T, uint32_t Capacity>
+class SpscRing {
+    static_assert(Capacity && ! (Capacity & (Capacity - 1)), "SpscRing capacity must be a power of 2");
+
+public:
+    SpscRing()
+        : m_head(0)
+        , m_tail(0)
+    {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    //! @brief Добавляет пачку элементов целиком. @return false, если места в очереди недостаточно.
+    bool TryPushBatch(const T* items, size_t count) {
+        const uint64_t head = m_head.load(std::memory_order_relaxed);
+        const uint64_t tail = m_tail.load(std::memory_order_acquire);
+        if (count > Capacity - (head - tail)) {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            m_items[(head + i) & kMask] = items[i];
+        }
+        m_head.store(head + count, std::memory_order_release);
+
+        return true;
+    }
+
+    bool TryPush(const T& item) {
+        return TryPushBatch(&item, 1);
+    }
+
+    //! @brief Свободное место для писателя: до следующего Push* может только увеличиться.
+    size_t PushAvailable() const {
+        return Capacity - (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire));
+    }
+
+    /*! @brief Следующий свободный элемент для заполнения на месте, без копирования.
+     *
+     *  Элемент становится виден читателю после PushClaimed(). @return NULL, если очередь заполнена.
+     */
+    T* PushClaim() {
+        const uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= Capacity) {
+            return NULL;
+        }
+        return &m_items[head & kMask];
+    }
+
+    //! @brief Публикует элемент, полученный PushClaim().
+    void PushClaimed() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //! @brief Количество элементов, доступных читателю.
+    size_t Size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_relaxed);
+    }
+
+    bool Empty() const {
+        return Size() == 0;
+    }
+
+    //! @brief i-й от начала очереди элемент, i < Size().
+    const T& At(size_t i) const {
+        return m_items[(m_tail.load(std::memory_order_relaxed) + i) & kMask];
+    }
+
+    const T& Front() const {
+        return At(0);
+    }
+
+    //! @brief Извлекает count элементов из начала очереди, count <= Size().
+    void Pop(size_t count = 1) {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    //! @brief Удаляет все видимые читателю элементы.
+    void Clear() {
+        m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    constexpr static uint64_t kMask = Capacity - 1;
+
+    constexpr static size_t kCacheLineSize = 64;
+
+    //! Позиции писателя и читателя разнесены по разным кэш-линиям
+    std::atomic<uint64_t>   m_head;                                             //!< Позиция записи (изменяет только писатель)
+    char                    m_head_pad[kCacheLineSize - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t>   m_tail;                                             //!< Позиция чтения (изменяет только читатель)
+    char                    m_tail_pad[kCacheLineSize - sizeof(std::atomic<uint64_t>)];
+    T                       m_items[Capacity];                                  //!< Предвыделенные элементы очереди
+};
+
+} // namespaces
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cmath>
+
+#include "trajectory.h"
+
+namespace Drives {
+
+namespace {
+
+//! Количество шагов поиска допустимого рывка делением пополам
+constexpr int32_t kJerkSearchSteps = 24;
+
+//! Допуск по позиции, в пределах которого траектория "прилипает" к цели
+constexpr double kSettlePosTolerance = 0.5;
+
+//! Моменты, отличающиеся меньше, считаются одним моментом выборки [с]
+constexpr double kSampleTimeTolerance = 1e-9;
+
+/*! Сглаженная ступенька разгона h(u) = 3u^2 - 2u^3 на [0, 1]: максимум производной 1.5, второй производной 6.
+ *  ramp_path(u) - ее интеграл u^3 - u^4 / 2 (путь разгона в долях rate * ramp_s).
+ */
+inline double ramp_vel(double u) {
+    return u * u * (3.0 - 2.0 * u);
+}
+
+inline double ramp_path(double u) {
+    return u * u * u * (1.0 - 0.5 * u);
+}
+
+} // namespace
+
+JerkLimitedTracker::JerkLimitedTracker()
+    : m_limits({ 1.0, 1.0, 1.0 })
+    , m_period_s(1.0)
+    , m_pos(0.0)
+    , m_vel(0.0)
+    , m_acc(0.0)
+    , m_target(0.0)
+{}
+
+void JerkLimitedTracker::Configure(const Limits& limits, double period_s) {
+    m_limits = limits;
+    m_period_s = period_s;
+}
+
+void JerkLimitedTracker::Reset(double pos, double vel) {
+    m_pos = pos;
+    m_vel = std::max(-m_limits.max_vel, std::min(m_limits.max_vel, vel));
+    m_acc = 0.0;
+    m_target = pos;
+}
+
+void JerkLimitedTracker::SetTarget(double target) {
+    m_target = target;
+}
+
+double JerkLimitedTracker::Step() {
+    if (Settled()) {
+        return m_pos;
+    }
+
+    // Переходим в систему координат, где цель находится впереди
+    double dist = m_target - m_pos;
+    const double dir = (dist > 0.0 || (dist == 0.0 && m_vel >= 0.0)) ? 1.0 : -1.0;
+    dist *= dir;
+    const double vel = m_vel * dir;
+    const double acc = m_acc * dir;
+
+    const double max_jerk = m_limits.max_jerk;
+    double jerk = -max_jerk;
+    if (is_feasible(dist, vel, acc, max_jerk)) {
+        jerk = max_jerk;
+    } else if (is_feasible(dist, vel, acc, -max_jerk)) {
+        double lo = -max_jerk;
+        double hi = max_jerk;
+        for (int32_t i = 0; i < kJerkSearchSteps; ++i) {
+            const double mid = (lo + hi) / 2;
+            if (is_feasible(dist, vel, acc, mid)) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        jerk = lo;
+    }
+
+    const StepResult next = try_step(vel, acc, jerk);
+    m_pos += dir * next.dist;
+    m_vel = dir * next.vel;
+    m_acc = dir * next.acc;
+
+    const double period_s = m_period_s;
+    if (std::abs(m_target - m_pos) <= kSettlePosTolerance
+            && std::abs(m_vel) <= max_jerk * period_s * period_s
+            && std::abs(m_acc) <= max_jerk * period_s) {
+        m_pos = m_target;
+        m_vel = 0.0;
+        m_acc = 0.0;
+    }
+
+    return m_pos;
+}
+
+bool JerkLimitedTracker::Settled() const {
+    return m_pos == m_target && m_vel == 0.0 && m_acc == 0.0;
+}
+
+JerkLimitedTracker::StepResult JerkLimitedTracker::try_step(double vel, double acc, double jerk) const {
+    const double t = m_period_s;
+    const double next_acc = std::max(-m_limits.max_acc, std::min(m_limits.max_acc, acc + jerk * t));
+    // Рывок с учетом ограничения ускорения
+    const double eff_jerk = (next_acc - acc) / t;
+
+    StepResult result;
+    result.dist = vel * t + acc * t * t / 2 + eff_jerk * t * t * t / 6;
+    result.vel = vel + acc * t + eff_jerk * t * t / 2;
+    result.acc = next_acc;
+    return result;
+}
+
+bool JerkLimitedTracker::is_feasible(double dist, double vel, double acc, double jerk) const {
+    const StepResult next = try_step(vel, acc, jerk);
+
+    // Должна оставаться возможность снять ускорение, не превысив максимальную скорость
+    const double vel_peak = next.acc > 0.0 ? next.vel + next.acc * next.acc / (2 * m_limits.max_jerk) : next.vel;
+    if (vel_peak > m_limits.max_vel) {
+        return false;
+    }
+
+    return next.dist + stopping_distance(next.vel, next.acc) <= dist;
+}
+
+double JerkLimitedTracker::stopping_distance(double vel, double acc) const {
+    if (vel < 0.0 || (vel == 0.0 && acc < 0.0)) {
+        return -stopping_distance(-vel, -acc);
+    }
+
+    const double max_acc = m_limits.max_acc;
+    const double max_jerk = m_limits.max_jerk;
+
+    /* Торможение: рывок -J до ускорения min_acc, участок постоянного ускорения min_acc,
+     * рывок +J до нулевого ускорения. Если торможение с max_acc не требуется - участка постоянного нет.
+     */
+    double min_acc = -max_acc;
+    double hold_time = (vel + acc * acc / (2 * max_jerk) - max_acc * max_acc / max_jerk) / max_acc;
+    if (hold_time < 0.0) {
+        min_acc = -std::sqrt(max_jerk * vel + acc * acc / 2);
+        hold_time = 0.0;
+    }
+    min_acc = std::min(min_acc, acc);
+
+    const double phases[3][2] = {
+        { -max_jerk, (acc - min_acc) / max_jerk }
+        , { 0.0, hold_time }
+        , { max_jerk, -min_acc / max_jerk }
+    };
+
+    double dist = 0.0;
+    for (const auto& phase: phases) {
+        const double jerk = phase[0];
+        double t = phase[1];
+        if (t <= 0.0) {
+            continue;
+        }
+
+        const double next_vel = vel + acc * t + jerk * t * t / 2;
+        const bool stops = next_vel < 0.0;
+        if (stops) {
+            // Скорость обнуляется внутри участка: ищем наименьший неотрицательный корень
+            if (jerk == 0.0) {
+                t = -vel / acc;
+            } else {
+                const double disc = std::sqrt(std::max(0.0, acc * acc - 2 * jerk * vel));
+                const double t1 = (-acc - disc) / jerk;
+                const double t2 = (-acc + disc) / jerk;
+                t = t1 >= 0.0 && (t2 < 0.0 || t1 < t2) ? t1 : std::max(0.0, t2);
+            }
+        }
+
+        dist += vel * t + acc * t * t / 2 + jerk * t * t * t / 6;
+        if (stops) {
+            break;
+        }
+        vel = next_vel;
+        acc += jerk * t;
+    }
+
+    return dist;
+}
+
+void HermiteInterpolate(double pos0, double vel0, double pos1, double vel1, double duration_s, double frac,
+                        double& pos, double& vel) {
+    const double s = frac;
+    const double s2 = s * s;
+    const double s3 = s2 * s;
+
+    pos = (2 * s3 - 3 * s2 + 1) * pos0 + (s3 - 2 * s2 + s) * duration_s * vel0
+            + (-2 * s3 + 3 * s2) * pos1 + (s3 - s2) * duration_s * vel1;
+    vel = (6 * s2 - 6 * s) * (pos0 - pos1) / duration_s + (3 * s2 - 4 * s + 1) * vel0 + (3 * s2 - 2 * s) * vel1;
+}
+
+CoordinatedProfile::CoordinatedProfile()
+    : m_axis_count(0)
+    , m_limits({ 1.0, 1.0, 1.0 })
+    , m_ramp_s(0.0)
+    , m_duration_s(0.0)
+    , m_start()
+    , m_delta()
+    , m_segments()
+{}
+
+bool CoordinatedProfile::Plan(const double* start, const double* waypoints, size_t waypoint_count, size_t axis_count,
+                              const Limits& limits, bool blend) {
+    if (! (limits.max_vel > 0.0 && limits.max_acc > 0.0 && limits.max_jerk > 0.0)) {
+        return false;
+    }
+
+    m_axis_count = axis_count;
+    m_limits = limits;
+    m_start.assign(start, start + axis_count);
+    m_delta.clear();
+    m_segments.clear();
+
+    // Отрезки без перемещения пропускаются; скорость отрезка ограничена осью с наибольшим перемещением
+    std::vector<double> rates;
+    const double* from = start;
+    for (size_t i = 0; i < waypoint_count; ++i) {
+        const double* to = waypoints + i * axis_count;
+        double max_delta = 0.0;
+        for (size_t axis = 0; axis < axis_count; ++axis) {
+            max_delta = std::max(max_delta, std::fabs(to[axis] - from[axis]));
+        }
+        if (max_delta > 0.0) {
+            for (size_t axis = 0; axis < axis_count; ++axis) {
+                m_delta.push_back(to[axis] - from[axis]);
+            }
+            rates.push_back(limits.max_vel / max_delta);
+        }
+        from = to;
+    }
+
+    // Короткие отрезки не успевают разогнаться: скорость ограничивается так, чтобы разгон и торможение
+    // помещались в отрезок (rate <= 1 / ramp). Меньшие скорости требуют разгона не дольше исходного,
+    // поэтому пересчитанная длительность разгона остается допустимой для ограниченных скоростей
+    m_ramp_s = ramp_for(rates, blend);
+    for (double& rate: rates) {
+        rate = std::min(rate, 1.0 / m_ramp_s);
+    }
+    m_ramp_s = ramp_for(rates, blend);
+
+    double time = 0.0;
+    m_duration_s = 0.0;
+    for (const double rate: rates) {
+        m_segments.push_back({ time, rate });
+        const double duration = 1.0 / rate + m_ramp_s;
+        m_duration_s = time + duration;
+        time += blend ? duration - m_ramp_s : duration;
+    }
+    return true;
+}
+
+double CoordinatedProfile::ramp_for(const std::vector<double>& rates, bool blend) const {
+    // Наибольшее изменение скорости оси за разгон: от 0 и до 0 на концах, при сопряжении - торможение
+    // одного отрезка вместе с разгоном следующего (оценка сверху - сумма модулей скоростей)
+    double max_dv = 0.0;
+    const size_t count = rates.size();
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t axis = 0; axis < m_axis_count; ++axis) {
+            double dv = std::fabs(m_delta[i * m_axis_count + axis]) * rates[i];
+            if (blend && i + 1 < count) {
+                dv += std::fabs(m_delta[(i + 1) * m_axis_count + axis]) * rates[i + 1];
+            }
+            max_dv = std::max(max_dv, dv);
+        }
+    }
+
+    // Ускорение ступеньки - 1.5 * dv / ramp, рывок - 6 * dv / ramp^2
+    const double ramp = std::max(1.5 * max_dv / m_limits.max_acc, std::sqrt(6.0 * max_dv / m_limits.max_jerk));
+    return ramp > 0.0 ? ramp : 1.0;
+}
+
+void CoordinatedProfile::SampleTimes(uint32_t ramp_samples, std::vector<double>& times) const {
+    times.clear();
+    times.push_back(0.0);
+    for (const Segment& segment: m_segments) {
+        const double end = segment.start_s + 1.0 / segment.rate + m_ramp_s;
+        for (uint32_t i = 0; i <= ramp_samples; ++i) {
+            const double offset = m_ramp_s * i / ramp_samples;
+            times.push_back(segment.start_s + offset);
+            times.push_back(end - m_ramp_s + offset);
+        }
+    }
+
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end(), [](double a, double b) {
+        return b - a < kSampleTimeTolerance;
+    }), times.end());
+}
+
+void CoordinatedProfile::Evaluate(size_t axis, double time_s, double& pos, double& vel) const {
+    pos = m_start[axis];
+    vel = 0.0;
+    for (size_t i = 0; i < m_segments.size(); ++i) {
+        const Segment& segment = m_segments[i];
+        const double delta = m_delta[i * m_axis_count + axis];
+        const double t = time_s - segment.start_s;
+        const double duration = 1.0 / segment.rate + m_ramp_s;
+        if (t <= 0.0) {
+            break;
+        }
+
+        // Доля пройденного отрезка и скорость ее изменения
+        double frac = 1.0;
+        double frac_rate = 0.0;
+        if (t < m_ramp_s) {
+            frac = segment.rate * m_ramp_s * ramp_path(t / m_ramp_s);
+            frac_rate = segment.rate * ramp_vel(t / m_ramp_s);
+        } else if (t < duration - m_ramp_s) {
+            frac = segment.rate * (t - 0.5 * m_ramp_s);
+            frac_rate = segment.rate;
+        } else if (t < duration) {
+            frac = 1.0 - segment.rate * m_ramp_s * ramp_path((duration - t) / m_ramp_s);
+            frac_rate = segment.rate * ramp_vel((duration - t) / m_ramp_s);
+        }
+        pos += delta * frac;
+        vel += delta * frac_rate;
+    }
+}
+
+} // namespaces
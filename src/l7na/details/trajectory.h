@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Drives {
+
+/*! @brief Генератор траектории на стороне хоста с ограничением скорости, ускорения и рывка.
+ *
+ *  Используется в режиме Cyclic synchronous position: каждый цикл вычисляет следующую точку траектории к
+ *  текущей цели. Цель можно менять в любой момент (в том числе во время движения) - траектория перестраивается
+ *  без остановки, скорость и ускорение остаются непрерывными.
+ *
+ *  На каждом цикле выбирается максимальный рывок, при котором после этого цикла еще можно остановиться
+ *  (с учетом ограничений ускорения и рывка) не дальше цели и не превысить максимальную скорость. Поэтому
+ *  траектория близка к оптимальной по времени S-кривой и не проскакивает цель.
+ *
+ *  Единицы измерения - любые согласованные (импульсы энкодера, секунды).
+ */
+class JerkLimitedTracker {
+public:
+    struct Limits {
+        double  max_vel;    //!< Максимальная скорость [ед./с]
+        double  max_acc;    //!< Максимальное ускорение [ед./с^2]
+        double  max_jerk;   //!< Максимальный рывок [ед./с^3]
+    };
+
+    JerkLimitedTracker();
+
+    //! @brief Задает ограничения и период вызова Step() [секунды].
+    void Configure(const Limits& limits, double period_s);
+
+    //! @brief Начинает траекторию из состояния (pos, vel) с нулевым ускорением. Цель совпадает с pos.
+    void Reset(double pos, double vel);
+
+    //! @brief Задает новую цель.
+    void SetTarget(double target);
+
+    //! @brief Вычисляет состояние траектории на следующий цикл. @return Новая позиция.
+    double Step();
+
+    double Position() const { return m_pos; }
+    double Velocity() const { return m_vel; }
+    double Acceleration() const { return m_acc; }
+    double Target() const { return m_target; }
+
+    //! @brief Траектория достигла цели и остановилась.
+    bool Settled() const;
+
+private:
+    //! Состояние после одного цикла с рывком jerk: (позиция, скорость, ускорение) относительно текущей позиции
+    struct StepResult {
+        double  dist;
+        double  vel;
+        double  acc;
+    };
+    StepResult try_step(double vel, double acc, double jerk) const;
+
+    //! Допустим ли цикл с рывком jerk при расстоянии до цели dist (все величины в направлении цели)
+    bool is_feasible(double dist, double vel, double acc, double jerk) const;
+
+    //! Путь до остановки из состояния (vel, acc) при торможении с ограничением ускорения и рывка
+    double stopping_distance(double vel, double acc) const;
+
+    Limits  m_limits;
+    double  m_period_s;
+
+    double  m_pos;
+    double  m_vel;
+    double  m_acc;
+    double  m_target;
+};
+
+/*! @brief Кубическая интерполяция Эрмита между точками (pos0, vel0) и (pos1, vel1).
+ *
+ *  @param  duration_s  Длительность отрезка [секунды]
+ *  @param  frac        Доля прошедшего времени отрезка, [0, 1]
+ *  @param  pos         Интерполированная позиция
+ *  @param  vel         Интерполированная скорость [ед./с]
+ */
+void HermiteInterpolate(double pos0, double vel0, double pos1, double vel1, double duration_s, double frac,
+                        double& pos, double& vel);
+
+/*! @brief Согласованное по времени перемещение нескольких осей по ломаной (Control::MoveCoordinated).
+ *
+ *  Каждый отрезок проходится по прямой в пространстве осей: все оси начинают и заканчивают его одновременно,
+ *  скорость движения вдоль отрезка ограничена осью с наибольшим перемещением. Профиль скорости отрезка -
+ *  трапеция с разгоном и торможением по сглаженной ступеньке (3u^2 - 2u^3) общей длительности ramp_s.
+ *  При сопряжении торможение отрезка совпадает по времени с разгоном следующего и перемещения складываются:
+ *  скорость оси плавно переходит от одного отрезка к другому без остановки в промежуточной точке, угол
+ *  срезается. Длительность разгона выбирается так, чтобы ускорение и рывок каждой оси не превышали
+ *  ограничений в том числе на стыках, а скорость - на всем пути.
+ *
+ *  Единицы измерения - любые согласованные (импульсы энкодера, секунды).
+ */
+class CoordinatedProfile {
+public:
+    using Limits = JerkLimitedTracker::Limits;
+
+    CoordinatedProfile();
+
+    /*! @brief Рассчитывает профиль.
+     *
+     *  @param  start       Начальные позиции осей (axis_count значений)
+     *  @param  waypoints   Точки пути: по axis_count значений на точку, waypoint_count точек
+     *  @param  blend       Проходить промежуточные точки без остановки
+     *  @return false, если ограничения не положительны
+     */
+    bool Plan(const double* start, const double* waypoints, size_t waypoint_count, size_t axis_count,
+              const Limits& limits, bool blend);
+
+    //! @brief Длительность перемещения [с] (0 - оси уже в конечной точке).
+    double Duration() const { return m_duration_s; }
+
+    //! @brief Длительность разгона и торможения [с].
+    double Ramp() const { return m_ramp_s; }
+
+    /*! @brief Моменты времени [с] от 0 до Duration(), в которых точки траектории с позицией и скоростью
+     *  воспроизводят профиль интерполяцией Эрмита: концы участков, разгоны - ramp_samples отрезками.
+     */
+    void SampleTimes(uint32_t ramp_samples, std::vector<double>& times) const;
+
+    //! @brief Позиция и скорость оси axis в момент time_s.
+    void Evaluate(size_t axis, double time_s, double& pos, double& vel) const;
+
+private:
+    struct Segment {
+        double  start_s;    //!< Начало отрезка от начала перемещения [с]
+        double  rate;       //!< Скорость прохождения отрезка на участке постоянной скорости [доли отрезка/с]
+    };
+
+    //! Длительность разгона, при которой скорости rates и сопряжение blend не нарушают ограничений
+    double ramp_for(const std::vector<double>& rates, bool blend) const;
+
+    size_t                  m_axis_count;
+    Limits                  m_limits;
+    double                  m_ramp_s;
+    double                  m_duration_s;
+    std::vector<double>     m_start;        //!< Начальные позиции осей
+    std::vector<double>     m_delta;        //!< Перемещения осей по отрезкам, по m_axis_count на отрезок
+    std::vector<Segment>    m_segments;
+};
+
+} // namespaces
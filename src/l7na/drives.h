@@ -4,9 +4,13 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <functional>
+#include <future>
+#include <ostream>
 
 #include "types.h"
 #include "configfile.h"
+#include "pdoimage.h"
 
 /*! @brief API системы управления двигателями метеорологической антенны ДМРЛ-3
  *
@@ -36,8 +40,9 @@
  *  возвращающей развернутый текущий статус системы.
  *
  *  При возникновении ошибки состояние системы становится STATE_ERROR. Поле error_code для двигателя, вызвавшего ошибку
- *  установлено в соответствующее значение. Для продолжения работы необходимо сначала перевести систему в STATE_IDLE
- *  соответствующим вызовом.
+ *  установлено в соответствующее значение. Код ошибки передается в медленных PDO, поэтому он может появиться в статусе
+ *  позже состояния ошибки (до ControlOptions::slow_pdo_divider циклов). Для продолжения работы необходимо сначала
+ *  перевести систему в STATE_IDLE соответствующим вызовом.
  *
  *  При завершении работы необходимо из любого режима вызвать метод Release(), который остановит двигатели
  *  и произведет необходимую деинициализацию.
@@ -54,9 +59,15 @@ class Control {
 public:
     /*! @brief Конструктор. Инициализирует систему управления.
      *
-     *  @param   cfg_file_path  Путь к файлу с конфигурацией системы (абсолютный или относительно текущей рабочей директории)
+     *  Конструктор не ждет обмена с подчиненными по SDO: чтение информации, запись конфигурации и активация
+     *  мастера выполняются асинхронно (этапы - SystemStatus::init_stage), завершение - GetInitFuture().
+     *
+     *  @param   config          Конфигурация системы
+     *  @param   params_mode     Режим выставления параметров двигателей
+     *  @param   options         Период цикла обмена и параметры потока реального времени
      */
-    Control(const Config::Storage& config, const ParamsMode params_mode = PARAMS_MODE_AUTOMATIC);
+    Control(const Config::Storage& config, const ParamsMode params_mode = PARAMS_MODE_AUTOMATIC,
+            const ControlOptions& options = ControlOptions());
 
     /*! @brief Деструктор. Приводит систему управления в первоначальное состояние/выключает систему управления.
      */
@@ -102,10 +113,72 @@ public:
      *  @param  vel                 Скорость, с которой двигатель вращается в режиме постоянной скорости
      *                              (это НЕ скорость с которой он перемещается в заданную позицию) [градусы/с]
      *
-     *  @return                     Флаг успешности операции
+     *  @return                     Флаг успешности операции. false также возвращается, если очередь команд оси
+     *                              заполнена: команды добавляются в очередь только целиком.
      */
     bool SetModeRun(const Axis& axis, double pos /*deg*/, double vel /*deg/s*/);
 
+    /*! @brief Переключает систему управления одной оси в режим "Слежение" и/или задает новую цель.
+     *
+     *  В этом режиме (Cyclic synchronous position) траектория к цели рассчитывается на стороне хоста с учетом
+     *  ControlOptions::track_limits, и каждый цикл в привод передается очередная точка. Цель можно менять
+     *  в любой момент, в том числе во время движения: ось перестраивает траекторию без остановки, без
+     *  ожидания подтверждения от привода и без записи параметров. При нескольких вызовах за один цикл
+     *  используется последняя цель.
+     *
+     *  @param  axis                Идентификатор двигателя
+     *  @param  pos                 Целевая позиция [градусы]
+     *
+     *  @return                     Флаг успешности операции. false также возвращается, если очередь команд оси
+     *                              заполнена.
+     */
+    bool SetModeTrack(const Axis& axis, double pos /*deg*/);
+
+    /*! @brief Передает точки траектории с метками времени и переключает ось в режим движения по ним.
+     *
+     *  Точки накапливаются в очереди оси (до 1024 точек), поток обмена каждый цикл интерполирует уставку
+     *  позиции (кубический полином Эрмита) на момент применения ее приводом и передает ее в режиме
+     *  Cyclic synchronous position. Поэтому моменты движения определяются метками времени, а не моментом вызова.
+     *  Точки можно досылать во время движения. Времена точек должны строго возрастать в том числе между вызовами.
+     *
+     *  Заполнение очереди и опустошения буфера во время движения отражаются в AxisStatus
+     *  (traj_buffered, traj_lookahead_ns, traj_underruns). При опустошении ось плавно останавливается
+     *  в последней точке. Любая другая команда движения (в том числе SetModeTrack) прекращает движение
+     *  по точкам и удаляет точки, переданные до нее; точки, переданные после нее, остаются и начинают
+     *  обрабатываться, когда до них дойдет очередь команд.
+     *
+     *  @param  axis                Идентификатор двигателя
+     *  @param  points              Точки траектории в шкале времени SystemStatus::apptime
+     *
+     *  @return                     Флаг успешности операции. Точки добавляются только все вместе: false
+     *                              возвращается в том числе, если места в очереди недостаточно или позиция
+     *                              какой-либо точки не конечна либо слишком велика.
+     */
+    bool SubmitTrajectory(const Axis& axis, const std::vector<TrajectoryPoint>& points);
+
+    /*! @brief Согласованное перемещение нескольких осей по точкам пути.
+     *
+     *  Отрезки между точками проходятся по прямой в пространстве осей (например, азимут/угол места):
+     *  скорость вдоль отрезка подбирается по оси с наибольшим перемещением с учетом ControlOptions::track_limits,
+     *  остальные оси замедляются так, чтобы все оси начали и закончили отрезок одновременно. При blend
+     *  промежуточные точки проходятся без остановки: торможение на одном отрезке совмещается с разгоном на
+     *  следующем (угол срезается), в последней точке оси останавливаются.
+     *
+     *  Перемещение передается осям как точки траектории (SubmitTrajectory) с общими метками времени, а поток
+     *  обмена включает его на всех осях в одном цикле. Если предыдущее перемещение этих осей еще не закончено,
+     *  новое начинается сразу после него. Любая другая команда движения оси прекращает перемещение.
+     *
+     *  @param  axes                Оси перемещения (без повторов)
+     *  @param  path                Точки пути; позиции осей переводятся в ближайшие к предыдущей точке
+     *  @param  blend               Проходить промежуточные точки без остановки
+     *
+     *  @return                     Флаг успешности операции. Перемещение передается только всем осям сразу:
+     *                              false возвращается в том числе, если в очереди какой-либо оси недостаточно места
+     *                              или позиция какой-либо точки не конечна либо слишком велика.
+     */
+    bool MoveCoordinated(const std::vector<Axis>& axes, const std::vector<CoordinatedWaypoint>& path,
+                         bool blend = true);
+
     /*! @brief Добавляем в систему новый режим работы по параметрам.
      *
      * @param axis          Идентификатор двигателя
@@ -131,6 +204,19 @@ public:
      */
     bool SetAxisParams(const Axis& axis, const AxisParams& params);
 
+    /*! @brief Применяет новую конфигурацию двигателей без остановки обмена.
+     *
+     *  Новая конфигурация сравнивается с примененной: записываются только изменившиеся параметры, значения
+     *  которых отличаются от текущих, через очереди команд осей (SDO-запросы потока обмена).
+     *  Если среди изменившихся есть записи, для которых нужен выход из OP (объекты коммуникационной области,
+     *  параметры без SDO-запроса), конфигурация отклоняется целиком и ничего не записывается.
+     *
+     *  @param  config              Новая конфигурация
+     *
+     *  @return                     Флаг успешности операции
+     */
+    bool ReloadConfig(const Config::Storage& config);
+
     /*! @brief Переключает систему управления одной оси в режим бездейсвтия.
      *
      *  @param  axis                Идентификатор двигателя
@@ -149,30 +235,118 @@ public:
     bool ResetFault(const Axis& axis);
 
     /*! @brief Получаем текущее состояние системы управления (динамически изменяемые)
+     *
+     *  Чтение никогда не блокирует поток циклического обмена: статус публикуется через seqlock,
+     *  читатель лишь повторяет копирование, если оно пересеклось с записью.
      *
      *  @return Структуру Status, заполненную актуальными данными.
      */
-    const std::atomic<SystemStatus>& GetStatusRef() const;
-
     SystemStatus GetStatusCopy() const;
 
+    /*! @brief Получаем текущее состояние одной оси без копирования статуса всей системы.
+     *
+     *  @param  axis                Идентификатор двигателя
+     *  @param  status              Структура, в которую записывается состояние оси
+     *
+     *  @return                     Флаг успешности операции
+     */
+    bool GetAxisStatus(const Axis& axis, AxisStatus& status) const;
+
+    /*! @brief Номер версии статуса, увеличивается с каждым циклом обмена.
+     *
+     *  Позволяет читателю не копировать статус, если он не изменился с прошлого чтения.
+     */
+    uint64_t GetStatusVersion() const;
+
     /*! @brief Получаем статические параметры системы (не изменяющиеся с течением времени).
      *
      *  @return Структуру SystemInfo, заполненную актуальными данными.
      */
     const SystemInfo& GetSystemInfo() const;
 
+    /*! @brief Результат асинхронной инициализации.
+     *
+     *  Становится готовым, когда все подчиненные перешли в OP (true) или инициализация не удалась (false),
+     *  в том числе если подчиненные не перешли в OP за ControlOptions::op_timeout_ms.
+     *  Данные GetSystemInfo() действительны после готовности future.
+     */
+    std::shared_future<bool> GetInitFuture() const;
+
     AxisParamIndexMap GetAvailableAxisParams(const Axis& axis) const;
     AxisParams GetCurAxisParams(const Axis& axis) const;
 
-    const std::atomic<CycleTimeInfo>& GetCycleTimeInfoRef() const;
+    using EventCallback = std::function<void(const Event&)>;
+
+    /*! @brief Подписка на события (изменение состояния оси, достижение цели, ошибка, переполнение цикла).
+     *
+     *  События обнаруживает поток обмена, а callback вызывается в отдельном потоке-диспетчере сразу после
+     *  цикла, в котором событие произошло: ожидание события не требует опроса статуса. Callback'и всех
+     *  подписок вызываются последовательно, поэтому долго блокироваться в них нельзя. Если диспетчер не
+     *  успевает, события теряются (сообщение в логе).
+     *
+     *  @param  event_mask          Набор флагов EventType
+     *  @param  callback            Обработчик событий
+     *
+     *  @return                     Идентификатор подписки (0 - ошибка)
+     */
+    uint32_t Subscribe(uint32_t event_mask, const EventCallback& callback);
+
+    /*! @brief Отменяет подписку. После возврата callback подписки больше не вызывается
+     *  (если Unsubscribe вызван не из самого callback'а).
+     */
+    bool Unsubscribe(uint32_t subscription_id);
+
+    /*! @brief Последние и экстремальные временные характеристики цикла обмена.
+     */
     CycleTimeInfo GetCycleTimeInfo() const;
+
+    /*! @brief Сбрасывает экстремальные значения CycleTimeInfo. Сброс выполняется в начале следующего цикла.
+     */
     void ResetCycleTimeInfo();
 
+    /*! @brief Диагностика осей, опрашиваемая по SDO (SlaveConfig::diagnostics).
+     *
+     *  Поток обмена публикует снимок только при изменении значений (событие EVENT_DIAGNOSTICS), чтение
+     *  не блокирует поток обмена.
+     */
+    DiagnosticsSnapshot GetDiagnostics() const;
+
+    //! @brief Номер версии снимка диагностики, увеличивается при каждом изменении.
+    uint64_t GetDiagnosticsVersion() const;
+
+    /*! @brief Снимки необработанного образа PDO (ControlOptions::pdo_image).
+     *
+     *  Область живет, пока существует Control; читается функциями PdoImageLatest/PdoImageCopy без блокировок.
+     *  @return NULL, если снимки не включены
+     */
+    const PdoImageRegion* GetPdoImage() const;
+
+    /*! @brief Распределения задержки пробуждения, периода, времени работы цикла и его этапов
+     *         (прием, обработка, подготовка команд, отправка), а также количество переполнений цикла.
+     *
+     *  Статистика накапливается с момента последнего вызова ResetCycleHistogram().
+     *  Перцентили вычисляются методом DurationHistogram::Percentile().
+     */
+    CycleHistogram GetCycleHistogram() const;
+
+    /*! @brief Начинает новое окно накопления статистики GetCycleHistogram(). Выполняется в начале следующего цикла.
+     */
+    void ResetCycleHistogram();
+
     /*! @brief Запускаем статические тесты, печатаем результат
      */
     static void RunStaticTests();
 
+    /*! @brief Замеры производительности горячего пути и API (servobench), результат в JSON.
+     *
+     *  Замеры выполняются на имитации подчиненных (EC_BACKEND_SIM) с остановленным потоком обмена: функции
+     *  цикла вызываются напрямую. Формат вывода совместим с Google Benchmark.
+     *
+     *  @param  out         Поток для JSON
+     *  @param  filter      Подстрока имени замера (пустая - все замеры)
+     */
+    static void RunBenchmarks(std::ostream& out, const std::string& filter = std::string());
+
 private:
     class Impl;
     std::unique_ptr<Impl> m_pimpl;
@@ -2,12 +2,26 @@
 
 #ifndef L7NA_DISABLE_LOGS
 
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 
 #include <boost/log/trivial.hpp>
 
+/*! Минимальный уровень логирования, вызовы ниже которого убираются при компиляции
+ *  (номер boost::log::trivial::severity_level: 0 - trace, 1 - debug, 2 - info, ...).
+ *  По умолчанию в release-сборках trace и debug не компилируются.
+ */
+#ifndef L7NA_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define L7NA_LOG_MIN_LEVEL 2
+#else
+#define L7NA_LOG_MIN_LEVEL 0
+#endif
+#endif
+
 #define LOG(messages, level)\
     {\
         try {\
@@ -17,19 +31,157 @@
         }\
     }
 
-#define LOG_TRACE(messages) LOG(messages, trace)
-#define LOG_DEBUG(messages) LOG(messages, debug)
-#define LOG_INFO(messages) LOG(messages, info)
-#define LOG_WARN(messages) LOG(messages, warning)
-#define LOG_ERROR(messages) LOG(messages, error)
-#define LOG_FATAL(messages) LOG(messages, fatal)
+//! Вызов с уровнем ниже L7NA_LOG_MIN_LEVEL остается в коде (для проверки типов), но отбрасывается оптимизатором
+#define LOG_LEVEL(messages, level)\
+    do {\
+        if (::boost::log::trivial::level >= L7NA_LOG_MIN_LEVEL) {\
+            LOG(messages, level);\
+        }\
+    } while (0)
+
+#define LOG_TRACE(messages) LOG_LEVEL(messages, trace)
+#define LOG_DEBUG(messages) LOG_LEVEL(messages, debug)
+#define LOG_INFO(messages) LOG_LEVEL(messages, info)
+#define LOG_WARN(messages) LOG_LEVEL(messages, warning)
+#define LOG_ERROR(messages) LOG_LEVEL(messages, error)
+#define LOG_FATAL(messages) LOG_LEVEL(messages, fatal)
+
+/*! Логирование из потока реального времени: LOG_RT_*(format, args...).
+ *
+ *  Аргументы (числа, перечисления, строковые литералы - не более common::kRtLogMaxArgs) копируются в
+ *  предвыделенный буфер потока без форматирования, аллокаций и системных вызовов; форматирование и вывод
+ *  в sink'и boost.log выполняет фоновый поток. В format "{}" заменяется очередным аргументом,
+ *  "{x}" - им же в шестнадцатеричном виде. Если буфер потока заполнен, запись теряется и учитывается
+ *  в common::RtLogDropped(). Атрибуты TimeStamp и ThreadID записи - время вызова и поток, вызвавший LOG_RT,
+ *  а не момент и поток вывода.
+ *
+ *  @attention Строковые аргументы и format должны жить до вывода записи (литералы).
+ */
+#define LOG_RT(level, ...)\
+    do {\
+        if (::boost::log::trivial::level >= L7NA_LOG_MIN_LEVEL) {\
+            ::common::RtLog(::boost::log::trivial::level, __VA_ARGS__);\
+        }\
+    } while (0)
+
+#define LOG_RT_TRACE(...) LOG_RT(trace, __VA_ARGS__)
+#define LOG_RT_DEBUG(...) LOG_RT(debug, __VA_ARGS__)
+#define LOG_RT_INFO(...) LOG_RT(info, __VA_ARGS__)
+#define LOG_RT_WARN(...) LOG_RT(warning, __VA_ARGS__)
+#define LOG_RT_ERROR(...) LOG_RT(error, __VA_ARGS__)
+#define LOG_RT_FATAL(...) LOG_RT(fatal, __VA_ARGS__)
 
 namespace common {
 
+constexpr uint32_t kRtLogMaxArgs = 8;
+
+//! \brief Аргумент записи LOG_RT
+struct RtLogArg {
+    enum Type : uint8_t {
+        kInt,
+        kUInt,
+        kDouble,
+        kStr
+    };
+
+    Type type;
+    union {
+        int64_t     i;
+        uint64_t    u;
+        double      d;
+        const char* s;
+    };
+};
+
+//! \brief Запись LOG_RT до форматирования
+struct RtLogRecord {
+    const char*                         format;
+    boost::log::trivial::severity_level level;
+    uint64_t                            time_ns;    //!< Время вызова LOG_RT (CLOCK_REALTIME) [наносекунды с начала Epoch]
+    uint32_t                            arg_count;
+    RtLogArg                            args[kRtLogMaxArgs];
+};
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, RtLogArg>::type
+MakeRtLogArg(const T& value) {
+    RtLogArg arg;
+    if (std::is_signed<T>::value || std::is_enum<T>::value) {
+        arg.type = RtLogArg::kInt;
+        arg.i = static_cast<int64_t>(value);
+    } else {
+        arg.type = RtLogArg::kUInt;
+        arg.u = static_cast<uint64_t>(value);
+    }
+    return arg;
+}
+
+inline RtLogArg MakeRtLogArg(double value) {
+    RtLogArg arg;
+    arg.type = RtLogArg::kDouble;
+    arg.d = value;
+    return arg;
+}
+
+inline RtLogArg MakeRtLogArg(const char* value) {
+    RtLogArg arg;
+    arg.type = RtLogArg::kStr;
+    arg.s = value;
+    return arg;
+}
+
+inline void FillRtLogArgs(RtLogRecord& /* record */) {}
+
+template<typename T, typename... Args>
+inline void FillRtLogArgs(RtLogRecord& record, const T& value, const Args&... rest) {
+    record.args[record.arg_count++] = MakeRtLogArg(value);
+    FillRtLogArgs(record, rest...);
+}
+
+/*! \brief Запись в буфер текущего потока для заполнения. Буфер создается при первом вызове в потоке
+ *  (или в RtLogRegisterThread()). \return NULL, если уровень отфильтрован или буфер заполнен.
+ */
+RtLogRecord* RtLogClaim(boost::log::trivial::severity_level level);
+
+//! \brief Публикует запись, полученную RtLogClaim().
+void RtLogPublish();
+
+template<typename... Args>
+inline void RtLog(boost::log::trivial::severity_level level, const char* format, const Args&... args) {
+    static_assert(sizeof...(Args) <= kRtLogMaxArgs, "Too many LOG_RT arguments");
+
+    RtLogRecord* record = RtLogClaim(level);
+    if (! record) {
+        return;
+    }
+    record->format = format;
+    record->level = level;
+    record->arg_count = 0;
+    FillRtLogArgs(*record, args...);
+    RtLogPublish();
+}
+
+/*! \brief Создает буфер LOG_RT текущего потока заранее.
+ *  Вызывается потоком реального времени до начала работы, чтобы первая запись не выделяла память.
+ */
+void RtLogRegisterThread();
+
+//! \brief Выводит все накопленные записи LOG_RT (синхронно, в вызывающем потоке).
+void RtLogFlush();
+
+//! \brief Количество записей LOG_RT, потерянных из-за заполнения буферов.
+uint64_t RtLogDropped();
+
+//! \brief Форматирует запись LOG_RT.
+std::string FormatRtLogRecord(const RtLogRecord& record);
+
 std::string DefaultLogFormat();
 
 void InitLogger(const boost::log::trivial::severity_level& level, const std::string& format, const std::string& filename = std::string());
 
+//! \brief Уровень, ниже которого записи LOG_RT отбрасываются без постановки в буфер (выставляется InitLogger).
+void SetRtLogLevel(const boost::log::trivial::severity_level& level);
+
 //! \brief Оператор ввода severity_level. Благодаря ему в командной строке вместо цифр нужно явно задавать уровень логирования.
 template<typename TChar, typename TTraits>
 inline std::basic_istream<TChar, TTraits>& operator>>(std::basic_istream<TChar, TTraits>& stream, boost::log::trivial::severity_level& lvl)
@@ -61,6 +213,7 @@ inline std::basic_istream<TChar, TTraits>& operator>>(std::basic_istream<TChar,
 #else
 
 #define LOG(messages, level)
+#define LOG_RT(level, ...)
 
 #define LOG_TRACE(messages) LOG(messages, trace)
 #define LOG_DEBUG(messages) LOG(messages, debug)
@@ -69,5 +222,12 @@ inline std::basic_istream<TChar, TTraits>& operator>>(std::basic_istream<TChar,
 #define LOG_ERROR(messages) LOG(messages, error)
 #define LOG_FATAL(messages) LOG(messages, fatal)
 
+#define LOG_RT_TRACE(...)
+#define LOG_RT_DEBUG(...)
+#define LOG_RT_INFO(...)
+#define LOG_RT_WARN(...)
+#define LOG_RT_ERROR(...)
+#define LOG_RT_FATAL(...)
+
 #endif
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "recordfile.h"
+
+namespace Drives {
+
+/*! @brief Снимок образа PDO для прямого доступа (ControlOptions::pdo_image).
+ *
+ *  Раз в цикл поток обмена копирует образ PDO - быстрый домен (fast_image_size байт), затем медленный -
+ *  в один из двух буферов области PdoImageRegion и публикует его номером publish_count. Следующий цикл
+ *  пишет в другой буфер, поэтому у читателя есть целый период на чтение без повторов. Смещения объектов
+ *  PDO по осям - entries (как в файле записи циклов).
+ *
+ *  Область лежит в памяти процесса (Control::GetPdoImage) или в разделяемой памяти POSIX
+ *  (ControlOptions::pdo_image_shm): читателю из другого процесса нужен только этот заголовок -
+ *  OpenPdoImage и функции ниже не используют libl7na.
+ *
+ *  Все числа хранятся в порядке байт хоста, значения объектов PDO в образе - в порядке байт EtherCAT.
+ */
+constexpr uint32_t kPdoImageVersion = 1;
+constexpr uint32_t kPdoImageBufferCount = 2;
+constexpr uint32_t kPdoImageMaxSize = kRecordMaxImageSize;
+
+constexpr char kPdoImageMagic[8] = { 'L', '7', 'N', 'A', 'P', 'D', 'O', '\0' };
+
+//! @brief Цикл обмена, к которому относится снимок
+struct PdoImageFrame {
+    uint64_t    cycle;          //!< Номер цикла с перехода в OP
+    uint64_t    app_time_ns;    //!< Application time цикла [наносекунды с 2000 года]
+    uint8_t     wc_state[2];    //!< Состояние рабочего счетчика доменов (ec_wc_state_t)
+    uint8_t     slow_received;  //!< Медленный домен получен в этом цикле
+    uint8_t     reserved[5];
+};
+
+//! @brief Буфер снимка: образ одного цикла обмена
+struct PdoImageBuffer {
+    std::atomic<uint64_t>   seq;        //!< Счетчик записей буфера: нечетный во время записи
+    PdoImageFrame           frame;
+    uint8_t                 image[kPdoImageMaxSize];
+};
+
+struct PdoImageRegion {
+    char                    magic[8];           //!< kPdoImageMagic
+    uint32_t                version;            //!< kPdoImageVersion
+    uint32_t                region_size;        //!< sizeof(PdoImageRegion)
+    uint32_t                image_size;         //!< Размер образа PDO [байты]
+    uint32_t                fast_image_size;    //!< Размер образа быстрого домена [байты]
+    uint32_t                cycle_period_ns;
+    uint32_t                slow_pdo_divider;
+    uint32_t                pdo_layout;         //!< Флаги PdoLayoutFlags
+    uint32_t                axis_count;
+    uint32_t                entry_count;        //!< Количество заполненных entries
+    int32_t                 publisher_pid;      //!< Процесс, публикующий снимки (владелец объекта разделяемой памяти)
+    std::atomic<uint64_t>   publish_count;      //!< Опубликовано снимков (последний - в buffers[(publish_count - 1) % 2])
+    RecordPdoEntry          entries[kRecordMaxPdoEntries];
+    PdoImageBuffer          buffers[kPdoImageBufferCount];
+};
+// Счетчики читаются из другого процесса: атомарность не должна зависеть от блокировок внутри процесса
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "PDO image counters must be lock-free");
+
+/*! @brief Последний опубликованный буфер без копирования.
+ *
+ *  @param  seq     Номер записи буфера: после чтения данных его нужно сверить PdoImageUnchanged
+ *  @return NULL, если снимков еще нет или буфер пишется прямо сейчас
+ */
+inline const PdoImageBuffer* PdoImageLatest(const PdoImageRegion& region, uint64_t* seq) {
+    const uint64_t count = region.publish_count.load(std::memory_order_acquire);
+    if (! count) {
+        return NULL;
+    }
+    const PdoImageBuffer* buffer = &region.buffers[(count - 1) % kPdoImageBufferCount];
+    *seq = buffer->seq.load(std::memory_order_acquire);
+    return (*seq & 1) ? NULL : buffer;
+}
+
+//! @brief Данные, прочитанные из буфера PdoImageLatest, согласованы (буфер не перезаписывался).
+inline bool PdoImageUnchanged(const PdoImageBuffer& buffer, uint64_t seq) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return buffer.seq.load(std::memory_order_relaxed) == seq;
+}
+
+/*! @brief Согласованная копия последнего снимка.
+ *
+ *  @param  image   Образ PDO (не менее region.image_size байт)
+ *  @param  frame   Цикл снимка (может быть NULL)
+ *  @return false, если снимков еще нет
+ */
+inline bool PdoImageCopy(const PdoImageRegion& region, uint8_t* image, PdoImageFrame* frame) {
+    for (;;) {
+        if (! region.publish_count.load(std::memory_order_acquire)) {
+            return false;
+        }
+        uint64_t seq = 0;
+        const PdoImageBuffer* buffer = PdoImageLatest(region, &seq);
+        if (! buffer) {
+            continue;
+        }
+        std::memcpy(image, buffer->image, region.image_size);
+        if (frame) {
+            std::memcpy(frame, &buffer->frame, sizeof(PdoImageFrame));
+        }
+        if (PdoImageUnchanged(*buffer, seq)) {
+            return true;
+        }
+    }
+}
+
+//! @brief Значение объекта PDO из образа. @param is_signed Расширить знак до int64_t
+inline int64_t PdoImageReadEntry(const uint8_t* image, const RecordPdoEntry& entry, bool is_signed) {
+    return RecordPdoEntryValue(image, entry, is_signed);
+}
+
+//! @brief Первый объект PDO оси axis с индексом index:subindex. @return NULL - объекта нет в образе
+inline const RecordPdoEntry* PdoImageFindEntry(const PdoImageRegion& region, uint8_t axis, uint16_t index,
+                                               uint8_t subindex) {
+    for (uint32_t i = 0; i < region.entry_count; ++i) {
+        const RecordPdoEntry& entry = region.entries[i];
+        if (entry.axis == axis && entry.index == index && entry.subindex == subindex) {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+/*! @brief Отображает область снимков, опубликованную в разделяемой памяти, только для чтения.
+ *
+ *  @param  name    Имя объекта разделяемой памяти (ControlOptions::pdo_image_shm)
+ *  @return NULL, если объекта нет или его заголовок не совпадает с этой версией. Освобождается ClosePdoImage
+ */
+inline const PdoImageRegion* OpenPdoImage(const char* name) {
+    const int fd = ::shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    // Обращение к отображению за концом объекта - SIGBUS: размер проверяется до чтения заголовка
+    struct stat st;
+    if (::fstat(fd, &st) || st.st_size < static_cast<off_t>(sizeof(PdoImageRegion))) {
+        ::close(fd);
+        return NULL;
+    }
+    void* data = ::mmap(NULL, sizeof(PdoImageRegion), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == data) {
+        return NULL;
+    }
+
+    const PdoImageRegion* region = static_cast<const PdoImageRegion*>(data);
+    if (std::memcmp(region->magic, kPdoImageMagic, sizeof(kPdoImageMagic)) || region->version != kPdoImageVersion
+        || region->region_size != sizeof(PdoImageRegion)) {
+        ::munmap(data, sizeof(PdoImageRegion));
+        return NULL;
+    }
+    return region;
+}
+
+inline void ClosePdoImage(const PdoImageRegion* region) {
+    if (region) {
+        ::munmap(const_cast<PdoImageRegion*>(region), sizeof(PdoImageRegion));
+    }
+}
+
+} // namespaces
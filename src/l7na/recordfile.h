@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Drives {
+
+/*! @brief Формат файла записи циклов обмена (ControlOptions::record_path).
+ *
+ *  Файл создается заранее полного размера: заголовок RecordFileHeader (kRecordFileHeaderSize байт) и
+ *  capacity ячеек по record_size байт. Запись с порядковым номером seq хранится в ячейке seq % capacity,
+ *  поэтому файл содержит последние capacity циклов. Каждая запись - CycleRecord, за которым следует
+ *  образ PDO: быстрый домен (fast_image_size байт), затем медленный.
+ *
+ *  Все числа хранятся в порядке байт хоста, значения объектов PDO в образе - в порядке байт EtherCAT.
+ */
+constexpr uint32_t kRecordFileVersion = 1;
+constexpr uint32_t kRecordFileHeaderSize = 4096;
+constexpr uint32_t kRecordMaxPdoEntries = 256;
+constexpr uint32_t kRecordMaxImageSize = 1024;
+
+//! @brief Объект PDO в образе записи
+struct RecordPdoEntry {
+    uint16_t    index;
+    uint8_t     subindex;
+    uint8_t     axis;
+    uint16_t    offset;     //!< Смещение в образе записи [байты]
+    uint8_t     bits;       //!< Размер [биты]
+    uint8_t     domain;     //!< 0 - быстрый домен, 1 - медленный
+};
+
+/*! @brief Значение объекта PDO из образа (порядок байт EtherCAT - little endian).
+ *  @param  is_signed   Расширить знак до int64_t
+ */
+inline int64_t RecordPdoEntryValue(const uint8_t* image, const RecordPdoEntry& entry, bool is_signed) {
+    const uint32_t bytes = (entry.bits + 7) / 8;
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < bytes && i < sizeof(value); ++i) {
+        value |= static_cast<uint64_t>(image[entry.offset + i]) << (8 * i);
+    }
+    if (is_signed && entry.bits && entry.bits < 64 && (value >> (entry.bits - 1)) & 1) {
+        value |= ~uint64_t(0) << entry.bits;
+    }
+    return static_cast<int64_t>(value);
+}
+
+struct RecordFileHeader {
+    char                    magic[8];           //!< kRecordFileMagic
+    uint32_t                version;            //!< kRecordFileVersion
+    uint32_t                header_size;        //!< Смещение первой ячейки [байты]
+    uint32_t                record_size;        //!< Размер ячейки [байты]
+    uint32_t                image_size;         //!< Размер образа PDO в записи [байты]
+    uint32_t                fast_image_size;    //!< Размер образа быстрого домена [байты]
+    uint32_t                cycle_period_ns;
+    uint32_t                slow_pdo_divider;
+    uint32_t                pdo_layout;         //!< Флаги PdoLayoutFlags
+    uint32_t                axis_count;
+    uint32_t                entry_count;        //!< Количество заполненных entries
+    uint64_t                capacity;           //!< Количество ячеек
+    std::atomic<uint64_t>   write_count;        //!< Записано записей с начала работы (номер следующей записи)
+    std::atomic<uint64_t>   dropped_count;      //!< Потеряно записей: писатель не успевал за циклом обмена
+    RecordPdoEntry          entries[kRecordMaxPdoEntries];
+};
+static_assert(sizeof(RecordFileHeader) <= kRecordFileHeaderSize, "Record file header doesn't fit");
+
+constexpr char kRecordFileMagic[8] = { 'L', '7', 'N', 'A', 'R', 'E', 'C', '\0' };
+
+//! @brief Запись одного цикла обмена. За ней следует образ PDO
+struct CycleRecord {
+    uint64_t    cycle;          //!< Номер цикла с перехода в OP
+    uint64_t    app_time_ns;    //!< Application time цикла [наносекунды с 2000 года]
+    uint32_t    latency_ns;     //!< Задержка пробуждения
+    uint32_t    period_ns;      //!< Период относительно предыдущего цикла
+    uint32_t    exec_ns;        //!< Время работы цикла без отправки
+    uint32_t    dcsync;         //!< Оценка рассинхронизации DC
+    uint8_t     wc_state[2];    //!< Состояние рабочего счетчика доменов (ec_wc_state_t)
+    uint8_t     slow_received;  //!< Медленный домен получен в этом цикле
+    uint8_t     reserved[5];
+};
+
+/*! @brief Чтение файла записи.
+ *
+ *  Файл может дописываться во время чтения: самая старая запись при этом может оказаться перезаписанной,
+ *  поэтому ее номер (cycle) стоит сверять с ожидаемым.
+ */
+class RecordFileReader {
+public:
+    RecordFileReader();
+    ~RecordFileReader();
+
+    RecordFileReader(const RecordFileReader&) = delete;
+    RecordFileReader& operator=(const RecordFileReader&) = delete;
+
+    //! @brief Открывает файл и проверяет заголовок. @return false, если файл не открыт или поврежден.
+    bool Open(const std::string& path);
+    void Close();
+
+    const RecordFileHeader& Header() const;
+
+    //! @brief Номер самой старой записи, хранящейся в файле.
+    uint64_t FirstSeq() const;
+    //! @brief Номер следующей записи (последняя хранящаяся - EndSeq() - 1).
+    uint64_t EndSeq() const;
+
+    //! @brief Запись с номером seq из [FirstSeq(), EndSeq()).
+    const CycleRecord& Record(uint64_t seq) const;
+    //! @brief Образ PDO записи.
+    static const uint8_t* Image(const CycleRecord& record);
+
+    //! @brief Значение объекта PDO из образа. @param is_signed Расширить знак до int64_t
+    static int64_t ReadEntry(const uint8_t* image, const RecordPdoEntry& entry, bool is_signed);
+
+private:
+    int         m_fd;
+    uint8_t*    m_data;
+    size_t      m_size;
+};
+
+} // namespaces
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "types.h"
+
+namespace Drives {
+
+/*! @brief Область разделяемой памяти POSIX режима демона (Daemon, Client).
+ *
+ *  Демон владеет мастером EtherCAT (Control) и раз в цикл публикует SystemStatus и CycleTimeInfo под
+ *  счетчиком status_seq (seqlock: нечетный во время записи). Клиенты из других процессов кладут команды в
+ *  кольцо commands без блокировок (несколько писателей, один читатель - демон); результат команды с номером id
+ *  демон записывает в results[(id - 1) % kShmCommandCapacity].
+ *
+ *  Все числа хранятся в порядке байт хоста: демон и клиенты должны быть собраны с одной версией этого заголовка
+ *  (проверяется по version и region_size).
+ */
+constexpr uint32_t kShmRegionVersion = 1;
+constexpr uint32_t kShmCommandCapacity = 64;    //!< Степень двойки
+
+constexpr char kShmRegionMagic[8] = { 'L', '7', 'N', 'A', 'S', 'H', 'M', '\0' };
+
+enum ShmCommandType: uint32_t {
+    SHM_COMMAND_RUN = 1,    //!< Control::SetModeRun(axis, pos, vel)
+    SHM_COMMAND_IDLE = 2,   //!< Control::SetModeIdle(axis)
+};
+
+struct ShmCommand {
+    ShmCommandType  type;
+    Axis            axis;
+    double          pos;    //!< [градусы]
+    double          vel;    //!< [градусы/с]
+};
+
+//! @brief Ячейка кольца команд: seq == позиция - свободна для писателя, позиция + 1 - заполнена
+struct ShmCommandCell {
+    std::atomic<uint64_t>   seq;
+    ShmCommand              command;
+};
+
+//! @brief Результат команды: (номер команды << 1) | успех, одним словом, чтобы не читать результат чужой команды
+struct ShmCommandResult {
+    std::atomic<uint64_t>   value;
+};
+
+struct ShmRegion {
+    char                    magic[8];           //!< kShmRegionMagic
+    uint32_t                version;            //!< kShmRegionVersion
+    uint32_t                region_size;        //!< sizeof(ShmRegion)
+    uint32_t                cycle_period_ns;
+    int32_t                 daemon_pid;
+    std::atomic<uint64_t>   heartbeat;          //!< Время последней публикации статуса [CLOCK_MONOTONIC, наносекунды]
+
+    std::atomic<uint64_t>   status_seq;
+    SystemStatus            status;
+    CycleTimeInfo           timing;
+
+    std::atomic<uint64_t>   command_tail;       //!< Позиция следующей команды (писатели)
+    std::atomic<uint64_t>   command_head;       //!< Позиция следующей необработанной команды (демон)
+    ShmCommandCell          commands[kShmCommandCapacity];
+    ShmCommandResult        results[kShmCommandCapacity];
+};
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory counters must be lock-free");
+static_assert(std::is_trivially_copyable<SystemStatus>::value && std::is_trivially_copyable<CycleTimeInfo>::value,
+              "Status must be trivially copyable to be shared between processes");
+static_assert(! (kShmCommandCapacity & (kShmCommandCapacity - 1)), "Command ring capacity must be a power of two");
+
+//! @brief Публикует статус (только демон).
+inline void ShmStoreStatus(ShmRegion& region, const SystemStatus& status, const CycleTimeInfo& timing) {
+    const uint64_t seq = region.status_seq.load(std::memory_order_relaxed);
+    region.status_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&region.status, &status, sizeof(SystemStatus));
+    std::memcpy(&region.timing, &timing, sizeof(CycleTimeInfo));
+    region.status_seq.store(seq + 2, std::memory_order_release);
+}
+
+//! @brief Согласованная копия статуса. @return Номер версии статуса (0 - статус еще не публиковался)
+inline uint64_t ShmLoadStatus(const ShmRegion& region, SystemStatus* status, CycleTimeInfo* timing) {
+    uint64_t seq_before = 0;
+    uint64_t seq_after = 0;
+    do {
+        seq_before = region.status_seq.load(std::memory_order_acquire);
+        if (seq_before & 1) {
+            continue;
+        }
+        if (status) {
+            std::memcpy(status, &region.status, sizeof(SystemStatus));
+        }
+        if (timing) {
+            std::memcpy(timing, &region.timing, sizeof(CycleTimeInfo));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seq_after = region.status_seq.load(std::memory_order_relaxed);
+    } while ((seq_before & 1) || seq_before != seq_after);
+    return seq_before >> 1;
+}
+
+//! @brief Подготавливает кольцо команд пустым (только демон, до публикации области).
+inline void ShmInitCommands(ShmRegion& region) {
+    for (uint32_t i = 0; i < kShmCommandCapacity; ++i) {
+        region.commands[i].seq.store(i, std::memory_order_relaxed);
+        region.results[i].value.store(0, std::memory_order_relaxed);
+    }
+    region.command_tail.store(0, std::memory_order_relaxed);
+    region.command_head.store(0, std::memory_order_relaxed);
+}
+
+/*! @brief Ставит команду в кольцо (любой процесс, без блокировок).
+ *
+ *  @return Номер команды для ожидания результата, 0 - кольцо заполнено
+ */
+inline uint64_t ShmPushCommand(ShmRegion& region, const ShmCommand& command) {
+    uint64_t pos = region.command_tail.load(std::memory_order_relaxed);
+    for (;;) {
+        ShmCommandCell& cell = region.commands[pos & (kShmCommandCapacity - 1)];
+        const uint64_t seq = cell.seq.load(std::memory_order_acquire);
+        const int64_t diff = static_cast<int64_t>(seq - pos);
+        if (! diff) {
+            if (region.command_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.command = command;
+                cell.seq.store(pos + 1, std::memory_order_release);
+                return pos + 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = region.command_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+//! @brief Забирает следующую команду (только демон). @return Номер команды, 0 - кольцо пусто
+inline uint64_t ShmPopCommand(ShmRegion& region, ShmCommand* command) {
+    const uint64_t pos = region.command_head.load(std::memory_order_relaxed);
+    ShmCommandCell& cell = region.commands[pos & (kShmCommandCapacity - 1)];
+    if (cell.seq.load(std::memory_order_acquire) != pos + 1) {
+        return 0;
+    }
+    *command = cell.command;
+    cell.seq.store(pos + kShmCommandCapacity, std::memory_order_release);
+    region.command_head.store(pos + 1, std::memory_order_relaxed);
+    return pos + 1;
+}
+
+//! @brief Записывает результат команды id (только демон).
+inline void ShmStoreResult(ShmRegion& region, uint64_t id, bool ok) {
+    region.results[(id - 1) & (kShmCommandCapacity - 1)].value.store((id << 1) | ok, std::memory_order_release);
+}
+
+/*! @brief Результат команды id.
+ *
+ *  @return false, пока команда не обработана (или ее результат уже вытеснен более новыми командами)
+ */
+inline bool ShmLoadResult(const ShmRegion& region, uint64_t id, bool* ok) {
+    const uint64_t value = region.results[(id - 1) & (kShmCommandCapacity - 1)].value.load(std::memory_order_acquire);
+    if ((value >> 1) != id) {
+        return false;
+    }
+    *ok = value & 1;
+    return true;
+}
+
+} // namespaces
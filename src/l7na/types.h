@@ -9,7 +9,11 @@
 
 namespace Drives {
 
-//! @brief Индекс двигателя
+/*! @brief Индекс двигателя
+ *
+ *  Количество осей задается при создании Control (ControlOptions::slaves), индексы осей - [AXIS_MIN, количество осей).
+ *  Для конфигурации по умолчанию (азимут и угол места) это AZIMUTH_AXIS и ELEVATION_AXIS.
+ */
 enum Axis: int32_t {
     AXIS_NONE = -1,
 
@@ -18,7 +22,8 @@ enum Axis: int32_t {
     AZIMUTH_AXIS = 0,
     ELEVATION_AXIS = 1,
 
-    AXIS_COUNT
+    AXIS_COUNT,                     //!< Количество осей в конфигурации по умолчанию
+    AXIS_MAX_COUNT = 8              //!< Максимальное количество осей (размер массивов осей)
 };
 
 //! @brief Возможные состояния каждого двигателя
@@ -28,7 +33,8 @@ enum AxisState : int32_t {
     AXIS_IDLE,                      //!< Включен, готов к работе
     AXIS_SCAN,                      //!< Работает в режиме "Сканирование"
     AXIS_POINT,                     //!< Работает в режиме "Установка в точку"
-    AXIS_ERROR                      //!< Состояние ошибки
+    AXIS_ERROR,                     //!< Состояние ошибки
+    AXIS_TRACK                      //!< Работает в режиме "Слежение" (траектория рассчитывается на стороне хоста)
 };
 
 //! @brief Режим установки параметров осей
@@ -44,34 +50,47 @@ enum ParamsMode : int16_t {
  */
 using MoveMode = uint16_t;
 
-//! @brief Текущие значения для одной оси системы
+/*! @brief Текущие значения для одной оси системы.
+ *
+ *  Поток обмена публикует только "сырые" значения PDO [импульсы энкодера]. Значения в градусах вычисляются
+ *  при чтении методами *Deg(), поэтому на потоке обмена нет вычислений с плавающей точкой.
+ */
 struct AxisStatus {
     AxisStatus();
 
     bool IsReady() const;
 
-    double      tgt_pos_deg;            //!< Целевая позиция [градусы]
-    double      cur_pos_deg;            //!< Текущая позиция [градусы]
-    double      dmd_pos_deg;            //!< Запрашиваемая позиция [градусы]
-    double      tgt_vel_deg;            //!< Целевая скорость [градусы/с]
-    double      cur_vel_deg;            //!< Текущая скорость [градусы/с]
-    double      dmd_vel_deg;            //!< Запрашиваемая скорость [импульсы энкодера/c]
-    int32_t     cur_pos_abs;            //!< Текущая позиция абсолютная [импульсы энкодера]
+    double      TgtPosDeg() const;      //!< Целевая позиция [градусы]
+    double      CurPosDeg() const;      //!< Текущая позиция [градусы]
+    double      DmdPosDeg() const;      //!< Запрашиваемая позиция [градусы]
+    double      TgtVelDeg() const;      //!< Целевая скорость [градусы/с]
+    double      CurVelDeg() const;      //!< Текущая скорость [градусы/с]
+    double      DmdVelDeg() const;      //!< Запрашиваемая скорость [градусы/с]
+
+    int32_t     cur_pos_abs;            //!< Текущая позиция абсолютная [импульсы энкодера] (медленные PDO)
     int32_t     cur_pos;                //!< Текущая позиция [импульсы энкодера]
-    int32_t     dmd_pos;                //!< Запрашиваемая позиция [импульсы энкодера]
+    int32_t     dmd_pos;                //!< Запрашиваемая позиция [импульсы энкодера] (PDO_LAYOUT_DEMAND, иначе 0)
     int32_t     tgt_pos;                //!< Целевая позиция [импульсы энкодера]
     int32_t     cur_vel;                //!< Текущая скорость [импульсы энкодера/с]
-    int32_t     dmd_vel;                //!< Запрашиваемая скорость [импульсы энкодера/c]
+    int32_t     dmd_vel;                //!< Запрашиваемая скорость [импульсы энкодера/c] (PDO_LAYOUT_DEMAND, иначе 0)
     int32_t     tgt_vel;                //!< Целевая скорость [импульсы энкодера/с]
-    int32_t     cur_torq;               //!< Текущий момент [единиц 0,1% от _номинального_ момента двигателя]
+    int32_t     following_error;        //!< Ошибка рассогласования [импульсы энкодера] (PDO_LAYOUT_FOLLOWING_ERROR, иначе 0)
+    int32_t     pos_offset;             //!< Смещение нуля позиции в градусах относительно позиции PDO [импульсы энкодера]
     AxisState   state;                  //!< Текущее состояние системы управления осью
-    uint32_t    error_code;             //!< Код ошибки двигателя по CiA402
-    int32_t     cur_temperature;        //!< Текущая температура для сервоусилителя
+    int16_t     cur_torq;               //!< Текущий момент [единиц 0,1% от _номинального_ момента двигателя] (медленные PDO)
+    uint16_t    error_code;             //!< Код ошибки двигателя по CiA402 (медленные PDO, отстает от state до slow_pdo_divider циклов)
+    int16_t     cur_temperature;        //!< Текущая температура для сервоусилителя (медленные PDO)
     uint16_t    ctrlword;               //!< Битовая маска управления приводом (для отладки)
     uint16_t    statusword;             //!< Битовая маска текущего состояния привода (для отладки)
     uint16_t    mode;                   //!< Текущий режим работы (для отладки)
     MoveMode    move_mode;
     ParamsMode  params_mode;
+    bool        signed_pos_deg;         //!< Позиция в градусах в диапазоне [-180, 180) вместо [0, 360)
+    bool        params_pending;         //!< Идет запись набора параметров оси, команды движения ждут ее завершения
+    uint32_t    params_failures;        //!< Количество прерванных (неудачных) транзакций записи параметров оси
+    uint32_t    traj_buffered;          //!< Количество точек в очереди траектории (SubmitTrajectory)
+    uint32_t    traj_underruns;         //!< Количество опустошений очереди траектории во время движения
+    uint64_t    traj_lookahead_ns;      //!< Запас точек траектории по времени [наносекунды]
 };
 
 enum SystemState : int32_t {
@@ -82,15 +101,36 @@ enum SystemState : int32_t {
     SYSTEM_FATAL_ERROR,
 };
 
+/*! @brief Этап инициализации системы (для состояния SYSTEM_INIT)
+ *
+ *  Инициализация выполняется асинхронно: конструктор Control возвращается после настройки конфигурации
+ *  подчиненных, остальные этапы выполняются в отдельном потоке (см. Control::GetInitFuture()).
+ */
+enum InitStage : int32_t {
+    INIT_STAGE_NONE = 0,            //!< Инициализация не начата
+    INIT_STAGE_SLAVE_CONFIG,        //!< Конфигурация подчиненных и PDO
+    INIT_STAGE_SDO_SETUP,           //!< Чтение информации и запись конфигурации по SDO (параллельно по подчиненным)
+    INIT_STAGE_ACTIVATION,          //!< Настройка DC и активация мастера
+    INIT_STAGE_OPERATIONAL_WAIT,    //!< Ожидание перехода подчиненных в OP
+    INIT_STAGE_DONE                 //!< Инициализация завершена
+};
+
 //! @brief Текущие значения, возвращаемые системой управления
 struct SystemStatus {
     SystemStatus() noexcept;
 
-    AxisStatus axes[AXIS_COUNT];    //!< Статус двигателей по осям
+    AxisStatus axes[AXIS_MAX_COUNT];    //!< Статус двигателей по осям
+    int32_t axis_count;             //!< Количество осей (действительных элементов axes)
+    uint32_t pdo_layout;            //!< Флаги PdoLayoutFlags: поля статуса осей из отсутствующих объектов равны 0
     SystemState state;              //!< Состояние системы
     uint64_t reftime;               //!< Время привязки координат в системном времени [наносекунды с начала Epoch]
     uint64_t apptime;               //!< Текущее системное время [наносекунды с начала Epoch]
     uint32_t dcsync;                //!< Оценка сверху разницы во времени между хостом и двигателем [наносекунды]
+    InitStage init_stage;           //!< Этап инициализации
+    uint32_t init_sdo_total;        //!< Количество записей конфигурации для этапа INIT_STAGE_SDO_SETUP
+    uint32_t init_sdo_done;         //!< Обработано записей конфигурации
+    uint32_t init_sdo_skipped;      //!< Из них не записано: значение в подчиненном уже совпадало
+    uint32_t watchdog_trips;        //!< Сколько раз сторожевой таймер потока обмена останавливал оси
 };
 
 //! @brief Статическая информация для одной оси. Заполняется один раз при инициализации.
@@ -100,20 +140,24 @@ struct AxisInfo {
         , dev_name()
         , hw_version()
         , sw_version()
+        , serial_number(0)
     {}
 
     uint16_t        encoder_resolution; //!< Разрешение энкодера
     std::string     dev_name;           //!< Название устройства
     std::string     hw_version;         //!< Версия аппаратного обепечения
     std::string     sw_version;         //!< Версия программного обеспечения
+    uint32_t        serial_number;      //!< Серийный номер (0x1018:04), 0 - не поддерживается
 };
 
 //! @brief Статическая информация для системы
 struct SystemInfo {
     SystemInfo()
+        : axis_count(0)
     {}
 
-    AxisInfo axes[AXIS_COUNT];
+    AxisInfo axes[AXIS_MAX_COUNT];
+    int32_t axis_count;             //!< Количество осей (действительных элементов axes)
 };
 
 //! @brief Параметры настройки оси
@@ -146,6 +190,412 @@ struct CycleTimeInfo {
     {}
 };
 
+//! @brief Типы событий, флаги маски подписки (Control::Subscribe)
+enum EventType : uint32_t {
+    EVENT_AXIS_STATE        = 0x1,  //!< Изменилось состояние оси (AxisStatus::state)
+    EVENT_TARGET_REACHED    = 0x2,  //!< Ось достигла цели (statusword, бит 10 "Target reached")
+    EVENT_FAULT_RAISED      = 0x4,  //!< Сервоусилитель перешел в состояние ошибки (statusword, бит 3 "Fault"), см. Event::error_code
+    EVENT_FAULT_CLEARED     = 0x8,  //!< Ошибка сервоусилителя сброшена
+    EVENT_OVERRUN           = 0x10, //!< Цикл обмена закончился позже запланированного начала следующего
+    EVENT_WATCHDOG          = 0x20, //!< Сторожевой таймер потока обмена остановил оси (ControlOptions::watchdog_cycles)
+    EVENT_DIAGNOSTICS       = 0x40, //!< Изменилась диагностика оси (Control::GetDiagnostics)
+    EVENT_COMMAND_TIMEOUT   = 0x80, //!< Привод не подтвердил команду позиционирования за отведенное число циклов
+
+    EVENT_ALL               = 0xFF
+};
+
+//! @brief Событие, обнаруженное потоком обмена
+struct Event {
+    EventType   type;
+    Axis        axis;           //!< Ось, AXIS_NONE для событий системы (EVENT_OVERRUN, EVENT_WATCHDOG)
+    AxisState   state;          //!< Состояние оси после события
+    AxisState   prev_state;     //!< Состояние оси до события
+    uint16_t    statusword;
+    /*! Код ошибки из медленных PDO. EVENT_FAULT_RAISED передается с ближайшим обменом медленного домена после
+     *  появления бита Fault (до ControlOptions::slow_pdo_divider циклов), поэтому код в нем уже соответствует
+     *  ошибке; time_ns при этом - время цикла, в котором появился бит Fault.
+     */
+    uint16_t    error_code;
+    uint32_t    exec_ns;        //!< Время работы цикла (EVENT_OVERRUN)
+    uint64_t    time_ns;        //!< Application time цикла, в котором обнаружено событие [наносекунды с начала Epoch]
+};
+
+//! @brief Наибольшее количество диагностических объектов на ось (SlaveConfig::diagnostics)
+constexpr uint32_t kMaxDiagRegisters = 8;
+
+//! @brief Последнее прочитанное значение диагностического объекта
+struct DiagValue {
+    uint16_t    index;
+    uint8_t     subindex;
+    bool        valid;                  //!< Последнее чтение успешно (иначе value - значение до ошибки)
+    int64_t     value;
+    uint64_t    time_ns;                //!< Время изменения value или valid в базе SystemStatus::apptime [наносекунды с начала Epoch]
+};
+
+//! @brief Снимок диагностики всех осей (Control::GetDiagnostics)
+struct DiagnosticsSnapshot {
+    uint32_t    counts[AXIS_MAX_COUNT];                     //!< Количество объектов по осям
+    DiagValue   values[AXIS_MAX_COUNT][kMaxDiagRegisters];  //!< Порядок - как в SlaveConfig::diagnostics
+    uint64_t    time_ns;                                    //!< Время последнего изменения [наносекунды с начала Epoch]
+};
+
+/*! @brief Гистограмма длительностей с лог-линейными интервалами (по аналогии с HDR histogram).
+ *
+ *  Значения меньше kSubBucketCount наносекунд учитываются точно, далее каждая октава [2^k, 2^(k+1))
+ *  разбита на kSubBucketCount равных интервалов, т.е. относительная погрешность не превышает 1/kSubBucketCount.
+ *  Значения больше 2^kMaxValueBits наносекунд попадают в последний интервал.
+ */
+struct DurationHistogram {
+    constexpr static uint32_t kSubBucketBits    = 4;
+    constexpr static uint32_t kSubBucketCount   = 1 << kSubBucketBits;
+    constexpr static uint32_t kMaxValueBits     = 36;   // ~68 секунд
+    constexpr static uint32_t kBucketCount      = kSubBucketCount * (kMaxValueBits - kSubBucketBits + 2);
+
+    DurationHistogram();
+
+    //! @brief Индекс интервала для значения
+    static uint32_t BucketIndex(uint64_t value_ns);
+    //! @brief Нижняя граница интервала (включительно) [наносекунды]
+    static uint64_t BucketLowerBound(uint32_t index);
+    //! @brief Верхняя граница интервала (не включительно) [наносекунды]
+    static uint64_t BucketUpperBound(uint32_t index);
+
+    /*! @brief Оценка перцентиля: верхняя граница интервала, в который попадает заданная доля измерений.
+     *
+     *  @param  quantile    Доля измерений из [0, 1], например 0.5, 0.99, 0.999
+     *  @return Оценка значения [наносекунды], не больше max_ns. 0, если измерений нет.
+     */
+    uint64_t Percentile(double quantile) const;
+
+    //! @brief Среднее значение [наносекунды]
+    double Mean() const;
+
+    uint64_t counts[kBucketCount];  //!< Количество измерений в интервалах
+    uint64_t total;                 //!< Общее количество измерений
+    uint64_t sum_ns;                //!< Сумма измерений [наносекунды]
+    uint64_t min_ns;                //!< Минимальное измерение [наносекунды]
+    uint64_t max_ns;                //!< Максимальное измерение [наносекунды]
+};
+
+//! @brief Распределения временных характеристик цикла обмена за окно наблюдения
+struct CycleHistogram {
+    CycleHistogram()
+        : cycles(0)
+        , overruns(0)
+        , skipped_slots(0)
+        , deferred_cycles(0)
+        , window_start_ns(0)
+        , window_end_ns(0)
+    {}
+
+    DurationHistogram latency;      //!< Задержка пробуждения относительно запланированного времени
+    DurationHistogram period;       //!< Период между началами соседних циклов
+    DurationHistogram exec;         //!< Время работы цикла
+    DurationHistogram receive;      //!< Этап приема данных от подчиненных
+    DurationHistogram process;      //!< Этап обработки принятых данных
+    DurationHistogram prepare;      //!< Этап подготовки новых команд
+    DurationHistogram send;         //!< Этап синхронизации часов и отправки данных
+    uint64_t cycles;                //!< Количество циклов в окне
+    uint64_t overruns;              //!< Количество циклов, завершившихся позже начала следующего цикла
+    uint64_t skipped_slots;         //!< Пропущено периодов после переполнения (OVERRUN_POLICY_SKIP)
+    uint64_t deferred_cycles;       //!< Циклов, в которых некритичная работа отложена из-за бюджета времени
+    uint64_t window_start_ns;       //!< Начало окна наблюдения [наносекунды CLOCK_MONOTONIC]
+    uint64_t window_end_ns;         //!< Время последнего учтенного цикла [наносекунды CLOCK_MONOTONIC]
+};
+
+//! @brief Политика планирования потока циклического обмена
+enum SchedPolicy : int32_t {
+    SCHED_POLICY_OTHER,             //!< Обычный поток (SCHED_OTHER)
+    SCHED_POLICY_FIFO,              //!< Реальное время, SCHED_FIFO
+    SCHED_POLICY_RR                 //!< Реальное время, SCHED_RR
+};
+
+//! @brief Поведение потока обмена после цикла, закончившегося позже начала следующего
+enum OverrunPolicy : int32_t {
+    OVERRUN_POLICY_SKIP,            //!< Пропустить прошедшие периоды: следующий цикл начинается в ближайший период сетки
+    OVERRUN_POLICY_CATCH_UP         //!< Выполнить опоздавшие циклы подряд без ожидания
+};
+
+//! @brief Способ синхронизации часов DC хоста и подчиненных
+enum DcSyncMode : int32_t {
+    //! Референсные часы подстраиваются под application time хоста (ecrt_master_sync_reference_clock)
+    DC_SYNC_MASTER_SHIFT,
+    /*! Application time и фаза цикла хоста следуют за референсными часами (ПИ-регулятор), референсные часы
+     *  не подстраиваются: время шины не зависит от нестабильности часов хоста, датаграмм в цикле меньше
+     */
+    DC_SYNC_BUS_SHIFT
+};
+
+/*! @brief Необязательные объекты в раскладке PDO (флаги ControlOptions::pdo_layout)
+ *
+ *  Обязательные объекты (controlword, statusword, режим, целевые и текущие позиция и скорость) есть всегда.
+ */
+enum PdoLayoutFlags : uint32_t {
+    PDO_LAYOUT_DEMAND           = 1 << 0,   //!< Запрашиваемые позиция и скорость (0x6062, 0x606B)
+    PDO_LAYOUT_FOLLOWING_ERROR  = 1 << 1,   //!< Ошибка рассогласования (0x60F4)
+
+    PDO_LAYOUT_ALL              = PDO_LAYOUT_DEMAND | PDO_LAYOUT_FOLLOWING_ERROR
+};
+
+//! @brief Точка траектории, передаваемая в SubmitTrajectory
+struct TrajectoryPoint {
+    uint64_t    time_ns;                //!< Время точки в шкале SystemStatus::apptime [наносекунды с начала Epoch]
+    double      pos_deg;                //!< Позиция [градусы]
+    double      vel_deg;                //!< Скорость [градусы/с]
+};
+
+//! @brief Точка пути согласованного перемещения осей (MoveCoordinated)
+struct CoordinatedWaypoint {
+    double      pos_deg[AXIS_MAX_COUNT];    //!< Позиции осей [градусы]; используются только оси перемещения
+};
+
+//! @brief Ограничения траектории для режима "Слежение" (SetModeTrack)
+struct TrackLimits {
+    double      max_vel_deg;            //!< Максимальная скорость [градусы/с]
+    double      max_acc_deg;            //!< Максимальное ускорение [градусы/с^2]
+    double      max_jerk_deg;           //!< Максимальный рывок [градусы/с^3]
+};
+
+//! @brief Бюджет ациклического обмена (запросы SDO во время работы)
+struct MailboxBudget {
+    uint32_t    per_slave;              //!< Одновременно выполняемых запросов на подчиненного (1..4)
+    uint32_t    per_cycle;              //!< Новых запросов за цикл на всех подчиненных
+};
+
+//! @brief Диагностический объект подчиненного, опрашиваемый по SDO во время работы
+struct DiagRegister {
+    uint16_t    index;
+    uint8_t     subindex;
+    uint8_t     size;                   //!< Размер значения [байты]: 1, 2 или 4
+    bool        is_signed;
+    uint32_t    period_ms;              //!< Период опроса [миллисекунды]
+};
+
+/*! @brief Диагностика L7NA по умолчанию.
+ *
+ *  Напряжение звена постоянного тока, накопленная перегрузка (нагрузка двигателя), ошибка рассогласования
+ *  и код предупреждения.
+ */
+inline std::vector<DiagRegister> L7naDiagnostics() {
+    return {
+        { 0x2605, 0, 2, false, 1000 },  // DC-link voltage [В]
+        { 0x2603, 0, 2, false, 200 },   // Accumulated operation overload [0.1 %]
+        { 0x60F4, 0, 4, true, 100 },    // Following error actual value [импульсы энкодера]
+        { 0x2614, 0, 2, false, 200 }    // Warning code
+    };
+}
+
+//! @brief Подчиненный EtherCAT (сервоусилитель), управляющий одной осью
+struct SlaveConfig {
+    uint16_t    alias;                  //!< Алиас подчиненного
+    uint16_t    position;               //!< Позиция подчиненного в сети (относительно алиаса)
+    uint32_t    vendor_id;
+    uint32_t    product_code;
+    bool        signed_pos_deg;         //!< Позиция в градусах отображается в [-180, 180) вместо [0, 360)
+
+    /*! @brief Объекты, опрашиваемые по SDO во время работы (не более kMaxDiagRegisters).
+     *
+     *  Запросы выполняются с приоритетом MAILBOX_PRIORITY_DIAGNOSTICS в пределах ControlOptions::mailbox_budget,
+     *  значения публикуются в Control::GetDiagnostics() при изменении.
+     */
+    std::vector<DiagRegister> diagnostics;
+};
+
+//! @brief Сервоусилитель L7NA на позиции position
+inline SlaveConfig L7naSlave(uint16_t position, bool signed_pos_deg = false) {
+    return { 0, position, 0x00007595, 0x00000000, signed_pos_deg, L7naDiagnostics() };
+}
+
+//! @brief Реализация EtherCAT-мастера, с которой работает Control
+enum EcBackendType : int32_t {
+    EC_BACKEND_HARDWARE,            //!< IgH EtherCAT master и реальные подчиненные
+    EC_BACKEND_SIM                  //!< Имитация подчиненных в процессе (без сети и сервоусилителей)
+};
+
+/*! @brief Параметры имитации подчиненных (EC_BACKEND_SIM).
+ *
+ *  Каждый подчиненный - конечный автомат CiA402 с режимами Profile position, Profile velocity и Cyclic
+ *  synchronous position и двигатель как апериодическое звено первого порядка. Модель продвигается на step_ns
+ *  за каждый цикл обмена, поэтому при step_ns больше периода цикла время модели идет быстрее реального.
+ */
+struct SimOptions {
+    SimOptions()
+        : step_ns(0)
+        , motor_time_constant_ns(2000000)
+        , op_delay_cycles(10)
+    {}
+
+    uint32_t    step_ns;                //!< Шаг модели за цикл обмена [наносекунды], 0 - период цикла
+    uint32_t    motor_time_constant_ns; //!< Постоянная времени отработки позиции двигателем [наносекунды]
+    uint32_t    op_delay_cycles;        //!< Циклов обмена от активации мастера до перехода подчиненных в OP
+};
+
+//! @brief Параметры работы системы управления, задаваемые при создании объекта Control
+struct ControlOptions {
+    ControlOptions()
+        : cycle_period_ns(10000000)
+        , sync0_shift_ns(-1)
+        , sched_policy(SCHED_POLICY_RR)
+        , sched_priority(5)
+        , cpu_affinity(-1)
+        , lock_memory(false)
+        , stack_prefault_bytes(0)
+        , spin_ns(0)
+        , dc_drift_compensation(false)
+        , dc_sync_mode(DC_SYNC_MASTER_SHIFT)
+        , ref_clock_sync_divider(1)
+        , sync_monitor_divider(1)
+        , overrun_policy(OVERRUN_POLICY_SKIP)
+        , noncritical_budget_ns(0)
+        , watchdog_cycles(0)
+        , op_timeout_ms(30000)
+        , track_limits({ 10.0, 10.0, 50.0 })
+        , mailbox_budget({ 1, 2 })
+        , slaves({ L7naSlave(AZIMUTH_AXIS), L7naSlave(ELEVATION_AXIS, true) })
+        , slow_pdo_divider(10)
+        , pdo_layout(PDO_LAYOUT_DEMAND)
+        , record_path()
+        , record_capacity(600000)
+        , pdo_image(false)
+        , pdo_image_shm()
+        , backend(EC_BACKEND_HARDWARE)
+        , sim()
+    {}
+
+    /*! @brief Профиль для жесткого реального времени.
+     *
+     *  SCHED_FIFO с высоким приоритетом, привязка потока обмена к (изолированному) ядру,
+     *  блокировка памяти процесса, предварительное выделение стека потока, активное ожидание
+     *  последних 20 мкс перед пробуждением и остановка осей после 5 пропущенных подряд сроков цикла.
+     *
+     *  @param  cpu             Номер ядра, к которому привязывается поток обмена
+     *  @param  period_ns       Период цикла обмена [наносекунды]
+     */
+    static ControlOptions RealtimeProfile(int32_t cpu, uint32_t period_ns = 1000000) {
+        ControlOptions opts;
+        opts.cycle_period_ns = period_ns;
+        opts.sched_policy = SCHED_POLICY_FIFO;
+        opts.sched_priority = 80;
+        opts.cpu_affinity = cpu;
+        opts.lock_memory = true;
+        opts.stack_prefault_bytes = 512 * 1024;
+        opts.spin_ns = 20000;
+        opts.watchdog_cycles = 5;
+        return opts;
+    }
+
+    uint32_t    cycle_period_ns;        //!< Период цикла обмена, он же период SYNC0 [наносекунды]
+    int32_t     sync0_shift_ns;         //!< Сдвиг SYNC0 относительно начала цикла [наносекунды], отрицательный - 1/8 периода
+    SchedPolicy sched_policy;           //!< Политика планирования потока обмена
+    int32_t     sched_priority;         //!< Приоритет потока обмена (для SCHED_POLICY_FIFO/SCHED_POLICY_RR)
+    int32_t     cpu_affinity;           //!< Ядро, к которому привязывается поток обмена (-1 - не привязывать)
+    bool        lock_memory;            //!< Блокировать всю память процесса в ОЗУ (mlockall)
+    uint32_t    stack_prefault_bytes;   //!< Объем стека потока обмена, выделяемый заранее [байты]
+    uint32_t    spin_ns;                //!< Активное ожидание перед пробуждением вместо сна [наносекунды], 0 - не использовать
+    bool        dc_drift_compensation;  //!< Подстраивать фазу цикла и application time под референсные часы DC (DC_SYNC_MASTER_SHIFT)
+    DcSyncMode  dc_sync_mode;           //!< Способ синхронизации часов DC
+
+    /*! @brief Период подстройки референсных часов под application time [циклы обмена] (DC_SYNC_MASTER_SHIFT).
+     *
+     *  Часы подчиненных синхронизируются с референсными каждый цикл независимо от этого периода.
+     */
+    uint32_t    ref_clock_sync_divider;
+
+    /*! @brief Период опроса монитора синхронизации DC [циклы обмена], 0 - не опрашивать.
+     *
+     *  SystemStatus::dcsync обновляется с этим периодом (без опроса остается 0).
+     */
+    uint32_t    sync_monitor_divider;
+    OverrunPolicy overrun_policy;       //!< Поведение после переполнения цикла
+
+    /*! @brief Бюджет времени цикла до некритичной работы [наносекунды], 0 - половина периода.
+     *
+     *  Если к началу этапа подготовки команд или отправки цикл уже длится дольше бюджета, некритичная работа
+     *  этапа (передача мастеру запросов SDO, отправка медленного домена с диагностикой)
+     *  откладывается до следующего цикла. Уставки и controlword передаются всегда.
+     */
+    uint32_t    noncritical_budget_ns;
+
+    /*! @brief Сторожевой таймер потока обмена [периоды цикла], 0 - отключен.
+     *
+     *  Если watchdog_cycles циклов подряд завершились позже срока или поток обмена не завершил ни одного
+     *  цикла за watchdog_cycles периодов (проверяет отдельный поток), оси останавливаются: очереди команд
+     *  очищаются, приводам передается Quick stop. Пока поток обмена не отвечает, останавливают оси
+     *  сторожевые таймеры самих подчиненных (потеря обмена); Quick stop передается, как только поток
+     *  вернется к работе. Движение после остановки возобновляется обычными командами.
+     */
+    uint32_t    watchdog_cycles;
+
+    /*! @brief Время ожидания перехода подчиненных в OP после активации мастера [миллисекунды], 0 - без ограничения.
+     *
+     *  По истечении времени система переходит в SYSTEM_FATAL_ERROR, future инициализации завершается
+     *  с false, поток обмена останавливается.
+     */
+    uint32_t    op_timeout_ms;
+
+    TrackLimits track_limits;           //!< Ограничения траектории режима "Слежение" (общие для всех осей)
+
+    /*! @brief Бюджет запросов SDO во время работы.
+     *
+     *  Запросы потока обмена (запись параметров, опрос диагностики) распределяются по циклам: классы
+     *  приоритета обслуживаются по порядку, подчиненные внутри класса - по кругу.
+     */
+    MailboxBudget mailbox_budget;
+
+    /*! @brief Подчиненные по осям: i-й элемент управляет осью с индексом i (не более AXIS_MAX_COUNT).
+     *
+     *  Первый столбец ключей файла конфигурации - индекс оси. Наборы параметров режимов перемещения
+     *  по умолчанию есть только для осей AZIMUTH_AXIS и ELEVATION_AXIS, для остальных они задаются AddMoveMode.
+     */
+    std::vector<SlaveConfig> slaves;
+
+    /*! @brief Период обмена медленными PDO [циклы обмена].
+     *
+     *  Данные для управления (controlword, целевые и текущие позиция и скорость, режим) передаются в быстром
+     *  домене каждый цикл. Диагностика (момент, код ошибки, абсолютная позиция, температура) - в отдельном
+     *  медленном домене раз в slow_pdo_divider циклов; поля статуса (медленные PDO) обновляются с этим периодом.
+     *  В частности, бит Fault в statusword приходит в быстром домене, а AxisStatus::error_code становится
+     *  актуальным только с очередным обменом медленного домена, то есть с задержкой до slow_pdo_divider циклов.
+     */
+    uint32_t    slow_pdo_divider;
+
+    /*! @brief Раскладка PDO: набор флагов PdoLayoutFlags.
+     *
+     *  Объекты, не вошедшие в раскладку, не передаются, и соответствующие поля статуса осей равны 0
+     *  (без PDO_LAYOUT_DEMAND - dmd_pos и dmd_vel, без PDO_LAYOUT_FOLLOWING_ERROR - following_error).
+     *  Действующая раскладка передается в SystemStatus::pdo_layout.
+     */
+    uint32_t    pdo_layout;
+
+    /*! @brief Файл записи циклов обмена (пустая строка - запись не ведется).
+     *
+     *  Каждый цикл поток обмена сохраняет образ PDO обоих доменов и временные характеристики цикла;
+     *  фоновый поток переносит записи в файл (формат - RecordFileHeader, чтение - RecordFileReader,
+     *  утилита servorecdump). Файл хранит последние record_capacity циклов.
+     */
+    std::string record_path;
+    uint32_t    record_capacity;        //!< Количество хранимых циклов
+
+    /*! @brief Публиковать снимки необработанного образа PDO (Control::GetPdoImage, формат - PdoImageRegion).
+     *
+     *  Каждый цикл поток обмена копирует образ обоих доменов в двойной буфер: клиенты читают объекты PDO,
+     *  в том числе не входящие в AxisStatus, по таблице смещений без декодирования статуса.
+     */
+    bool        pdo_image;
+
+    /*! @brief Объект разделяемой памяти POSIX для снимков образа PDO (например, "/l7na_pdo").
+     *
+     *  Непустое имя включает снимки (как pdo_image) и размещает их в разделяемой памяти: другие процессы
+     *  читают их через OpenPdoImage из l7na/pdoimage.h без libl7na. Объект удаляется (shm_unlink) вместе с Control:
+     *  открывшие его читатели сохраняют отображение, но новых снимков в нем нет. Объект, снимки в котором
+     *  публикует другой работающий процесс, не пересоздается - создание Control завершается ошибкой.
+     */
+    std::string pdo_image_shm;
+
+    EcBackendType   backend;            //!< Реализация EtherCAT-мастера
+    SimOptions      sim;                //!< Параметры имитации (EC_BACKEND_SIM)
+};
+
 using AxisParams = std::vector<AxisParam>;
 using AxisParamIndexMap = std::map<uint16_t, uint16_t>;
 using AxisParamValueMap = std::map<uint16_t, int64_t>;
@@ -2,6 +2,7 @@
 #include <chrono>
 #include <fstream>
 #include <atomic>
+#include <future>
 
 #include <boost/tokenizer.hpp>
 #include <boost/program_options.hpp>
@@ -25,6 +26,7 @@ struct Command {
     Drives::Axis axis;
     double pos;
     double vel;
+    bool track;
     bool idle;
     bool reset;
     bool update_params;
@@ -34,6 +36,7 @@ struct Command {
         : axis(Drives::AZIMUTH_AXIS)
         , pos(0.0)
         , vel(0.0)
+        , track(false)
         , idle(false)
         , reset(false)
         , update_params(false)
@@ -44,6 +47,7 @@ struct Command {
         axis = Drives::AZIMUTH_AXIS;
         pos = 0.0;
         vel = 0.0;
+        track = false;
         idle = false;
         reset = false;
         update_params = false;
@@ -104,6 +108,14 @@ bool parse_args(const std::string& cmd_str, Command& result) {
             }
 
             result.update_params = true;
+        } else if (cmd_vec[1] == "t") {
+            if (cmd_vec.size() < 3) {
+                std::cerr << "Invalid input for command 'a t'" << std::endl;
+                return false;
+            }
+
+            result.pos = std::atof(cmd_vec[2].c_str());
+            result.track = true;
         } else if (cmd_vec[1] == "i") {
             result.idle = true;
         } else if (cmd_vec[1] == "r") {
@@ -151,6 +163,14 @@ bool parse_args(const std::string& cmd_str, Command& result) {
             }
 
             result.pos = std::atof(cmd_vec[2].c_str());
+        } else if (cmd_vec[1] == "t") {
+            if (cmd_vec.size() < 3) {
+                std::cerr << "Invalid input for command 'e t'" << std::endl;
+                return false;
+            }
+
+            result.pos = std::atof(cmd_vec[2].c_str());
+            result.track = true;
         } else if (cmd_vec[1] == "i") {
             result.idle = true;
         } else if (cmd_vec[1] == "r") {
@@ -180,18 +200,25 @@ void print_status(const Drives::SystemStatus& status, std::ostream& os) {
     static uint64_t i = 0;
     // os << i;
     os << boost::posix_time::to_simple_string(boost::posix_time::microsec_clock::local_time());
-    for (int32_t axis = Drives::AXIS_MIN; axis < Drives::AXIS_COUNT; ++axis) {
+    for (int32_t axis = Drives::AXIS_MIN; axis < status.axis_count; ++axis) {
          os << "|" << axis << "|" << status.axes[axis].state << "|" << std::hex << "0x" << status.axes[axis].statusword << "|" << status.axes[axis].ctrlword
                   << std::dec << "|" << status.axes[axis].mode
-                  << "|" << status.axes[axis].cur_pos_deg  << "|" << status.axes[axis].tgt_pos_deg << "|" << status.axes[axis].dmd_pos_deg
-                  << "|" << status.axes[axis].cur_vel_deg  << "|" << status.axes[axis].tgt_vel_deg << "|" << status.axes[axis].dmd_vel_deg
+                  << "|" << status.axes[axis].CurPosDeg()  << "|" << status.axes[axis].TgtPosDeg() << "|" << status.axes[axis].DmdPosDeg()
+                  << "|" << status.axes[axis].CurVelDeg()  << "|" << status.axes[axis].TgtVelDeg() << "|" << status.axes[axis].DmdVelDeg()
                   << "|" << status.axes[axis].cur_torq << "|" << status.axes[axis].cur_temperature;
     }
     os << std::endl;
     ++i;
 }
 
-void print_status_cerr(const Drives::SystemStatus& status, const Drives::CycleTimeInfo& timing_info) {
+void print_histogram_cerr(const char* name, const Drives::DurationHistogram& hist) {
+    std::cerr << "\t" << std::left << std::setw(26) << name << std::right << ": "
+              << std::setw(8) << (hist.Percentile(0.5) / 1e6) << ":" << std::setw(8) << (hist.Percentile(0.99) / 1e6)
+              << ":" << std::setw(8) << (hist.Percentile(0.999) / 1e6) << ":" << std::setw(8) << (hist.max_ns / 1e6)
+              << std::endl;
+}
+
+void print_status_cerr(const Drives::SystemStatus& status, const Drives::CycleTimeInfo& timing_info, const Drives::CycleHistogram& hist) {
     std::cerr << "System > state: " << status.state << " dcsync: " << status.dcsync
               << std::endl << "\t"
               << "apptime                   : " << status.apptime << std::hex << " = 0x" << status.apptime << std::dec
@@ -203,15 +230,29 @@ void print_status_cerr(const Drives::SystemStatus& status, const Drives::CycleTi
               << "latency_ms (min/max)      : " << std::setw(4) << (timing_info.latency_min_ns / 1e6) << ":" << std::setw(4) << (timing_info.latency_max_ns / 1e6)
               << std::endl << "\t"
               << "exec_ms (min/max)         : " << std::setw(4) << (timing_info.exec_min_ns / 1e6) << ":" << std::setw(4) << (timing_info.exec_max_ns / 1e6)
+              << std::endl << "\t"
+              << "cycles/overruns           : " << hist.cycles << "/" << hist.overruns
+              << std::endl << "\t"
+              << "skipped/deferred/watchdog : " << hist.skipped_slots << "/" << hist.deferred_cycles
+              << "/" << status.watchdog_trips
+              << std::endl << "\t"
+              << "histograms, ms            : p50:p99:p99.9:max"
               << std::endl;
-
-    for (int32_t axis = Drives::AXIS_MIN; axis < Drives::AXIS_COUNT; ++axis) {
+    print_histogram_cerr("latency", hist.latency);
+    print_histogram_cerr("period", hist.period);
+    print_histogram_cerr("exec", hist.exec);
+    print_histogram_cerr("exec.receive", hist.receive);
+    print_histogram_cerr("exec.process", hist.process);
+    print_histogram_cerr("exec.prepare", hist.prepare);
+    print_histogram_cerr("exec.send", hist.send);
+
+    for (int32_t axis = Drives::AXIS_MIN; axis < status.axis_count; ++axis) {
         std::cerr << "Axis " << axis << " > state: " << status.axes[axis].state << " statusword: " << std::hex << "0x" << status.axes[axis].statusword << " ctrlword: 0x" << status.axes[axis].ctrlword
                   << std::dec << " mode: " << status.axes[axis].mode
                   << std::endl << "\t"
-                  << " cur/dmd/tgt_pos_deg     = " << status.axes[axis].cur_pos_deg << "/" << status.axes[axis].dmd_pos_deg << "/" << status.axes[axis].tgt_pos_deg
+                  << " cur/dmd/tgt_pos_deg     = " << status.axes[axis].CurPosDeg() << "/" << status.axes[axis].DmdPosDeg() << "/" << status.axes[axis].TgtPosDeg()
                   << std::endl << "\t"
-                  << " cur/dmd_vel_deg         = " << status.axes[axis].cur_vel_deg << "/" << status.axes[axis].dmd_vel_deg
+                  << " cur/dmd_vel_deg         = " << status.axes[axis].CurVelDeg() << "/" << status.axes[axis].DmdVelDeg()
                   << std::endl << "\t"
                   << " abs/cur/dmd/tgt_pos = " << status.axes[axis].cur_pos_abs << "/"  << status.axes[axis].cur_pos << "/" << status.axes[axis].dmd_pos << "/" << status.axes[axis].tgt_pos
                   << std::endl << "\t"
@@ -221,14 +262,17 @@ void print_status_cerr(const Drives::SystemStatus& status, const Drives::CycleTi
                   << std::endl << "\t"
                   << " params_mode: " << (status.axes[axis].params_mode == Drives::PARAMS_MODE_AUTOMATIC ? "auto" : "manual")
                   << " move_mode: " << status.axes[axis].move_mode
+                  << " params_pending: " << status.axes[axis].params_pending
+                  << " params_failures: " << status.axes[axis].params_failures
                   << std::endl;
     }
 }
 
 void print_info(const Drives::SystemInfo& info) {
-    for (int32_t axis = Drives::AXIS_MIN; axis < Drives::AXIS_COUNT; ++axis) {
+    for (int32_t axis = Drives::AXIS_MIN; axis < info.axis_count; ++axis) {
         std::cerr << "Axis " << axis << " > dev_name: " << info.axes[axis].dev_name << " encoder_resolution: " << info.axes[axis].encoder_resolution
-                  << " hw_version: " << info.axes[axis].hw_version << " sw_version: " << info.axes[axis].sw_version << std::endl;
+                  << " hw_version: " << info.axes[axis].hw_version << " sw_version: " << info.axes[axis].sw_version
+                  << " serial: " << info.axes[axis].serial_number << std::endl;
     }
 }
 
@@ -239,16 +283,18 @@ void print_available_commands() {
     std::cerr << kLevelIndent << "q                 - quit" << std::endl;
     std::cerr << kLevelIndent << "s                 - print system status" << std::endl;
     std::cerr << kLevelIndent << "i                 - print system info" << std::endl;
+    std::cerr << kLevelIndent << "c                 - reload config file and apply changed parameters" << std::endl;
     std::cerr << kLevelIndent << "a|e v <vel>       - set (a)zimuth or (e)levation drive to 'scan' mode with <vel> velocity [pulses/sec]" << std::endl;
     std::cerr << kLevelIndent << "a|e p <pos>       - set (a)zimuth or (e)levation drive to 'point' mode with <pos> position [pulses]" << std::endl;
+    std::cerr << kLevelIndent << "a|e t <pos>       - set (a)zimuth or (e)levation drive to 'track' mode with <pos> target position [degrees]" << std::endl;
     std::cerr << kLevelIndent << "a|e r             - reset (a)zimuth or (e)levation drive fault state" << std::endl;
     std::cerr << kLevelIndent << "a|e u <idx> <val> - set (a)zimuth or (e)levation drive parameter" << std::endl;
 }
 
 struct StatReader {
-    StatReader(const std::atomic<Drives::SystemStatus>& status, const fs::path& outfilepath, uint32_t lograte_us)
+    StatReader(const Drives::Control& control, const fs::path& outfilepath, uint32_t lograte_us)
         : stop_(false)
-        , status_(status)
+        , control_(control)
         , outfilepath_(outfilepath)
         , lograte_us_(lograte_us)
     {}
@@ -263,23 +309,25 @@ struct StatReader {
             return;
         }
         while (! stop_) {
-            print_status(status_.load(std::memory_order_acquire), ofs);
+            print_status(control_.GetStatusCopy(), ofs);
             boost::this_thread::sleep_for(boost::chrono::microseconds(lograte_us_));
         }
         ofs.close();
     }
 
     volatile bool stop_;
-    const std::atomic<Drives::SystemStatus>& status_;
+    const Drives::Control& control_;
     const fs::path outfilepath_;
     const uint32_t lograte_us_;
 };
 
 int main(int argc, char* argv[]) {
     blog::trivial::severity_level loglevel;
-    fs::path cfg_file_path, log_file_path;
+    fs::path cfg_file_path, log_file_path, record_path;
     uint32_t log_rate_us;
     int32_t pos_abs_offset_azim, pos_abs_offset_elev;
+    uint32_t cycle_period_us;
+    int32_t rt_cpu;
 
     po::options_description options("options");
     options.add_options()
@@ -290,6 +338,10 @@ int main(int argc, char* argv[]) {
         ("config,c", po::value<decltype(cfg_file_path)>(&cfg_file_path)->required(), "path to config file")
         ("logfile,f", po::value<decltype(log_file_path)>(&log_file_path), "path to output log file. If specified engine real time data will be written to this file")
         ("lograte,r", po::value<decltype(log_rate_us)>(&log_rate_us), "period in microseconds (us) between samples written to log file. Ignored without 'logfile' option")
+        ("period", po::value<decltype(cycle_period_us)>(&cycle_period_us)->default_value(10000), "EtherCAT cycle period [us]")
+        ("rt_cpu", po::value<decltype(rt_cpu)>(&rt_cpu)->default_value(-1), "CPU to pin the cyclic thread to. Enables real-time profile (SCHED_FIFO, mlockall)")
+        ("record", po::value<decltype(record_path)>(&record_path), "path to binary file recording every cycle (PDO image and timing). Read it with servorecdump")
+        ("sim", "run against simulated drives instead of EtherCAT hardware")
     ;
 
     po::variables_map vm;
@@ -318,27 +370,61 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    Drives::Control control(config);
+    Drives::ControlOptions control_options;
+    if (rt_cpu >= 0) {
+        control_options = Drives::ControlOptions::RealtimeProfile(rt_cpu, cycle_period_us * 1000);
+    } else {
+        control_options.cycle_period_ns = cycle_period_us * 1000;
+    }
+    control_options.record_path = record_path.string();
+    if (vm.count("sim")) {
+        control_options.backend = Drives::EC_BACKEND_SIM;
+    }
+
+    Drives::Control control(config, Drives::PARAMS_MODE_AUTOMATIC, control_options);
     control.SetPosAbsPulseOffset(Drives::AZIMUTH_AXIS, pos_abs_offset_azim);
     control.SetPosAbsPulseOffset(Drives::ELEVATION_AXIS, pos_abs_offset_elev);
 
-    const std::atomic<Drives::SystemStatus>& sys_status = control.GetStatusRef();
-    const std::atomic<Drives::CycleTimeInfo>& timing_info = control.GetCycleTimeInfoRef();
-
     std::cerr << "Waiting for system initialization..." << std::endl;
 
-    while (1) {
-        const Drives::SystemStatus sys_status_copy = sys_status.load(std::memory_order_acquire);
-        if ((Drives::AxisState::AXIS_IDLE == sys_status_copy.axes[0].state)
-            && (Drives::AxisState::AXIS_IDLE == sys_status_copy.axes[1].state)) {
-            break;
+    const std::shared_future<bool> init_future = control.GetInitFuture();
+    while (init_future.wait_for(std::chrono::milliseconds(500)) != std::future_status::ready) {
+        const Drives::SystemStatus sys_status_copy = control.GetStatusCopy();
+        std::cerr << "\tinit stage: " << sys_status_copy.init_stage
+                  << ", sdo entries: " << sys_status_copy.init_sdo_done << "/" << sys_status_copy.init_sdo_total
+                  << " (" << sys_status_copy.init_sdo_skipped << " up to date)" << std::endl;
+    }
+    if (! init_future.get()) {
+        std::cerr << "System initialization failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    {
+        // Ждем перехода обеих осей в IDLE по событиям, а не опросом статуса
+        boost::mutex idle_mutex;
+        boost::condition_variable idle_cv;
+        const auto all_idle = [&control]() {
+            const Drives::SystemStatus sys_status_copy = control.GetStatusCopy();
+            return (Drives::AxisState::AXIS_IDLE == sys_status_copy.axes[0].state)
+                   && (Drives::AxisState::AXIS_IDLE == sys_status_copy.axes[1].state);
+        };
+        const uint32_t subscription = control.Subscribe(Drives::EVENT_AXIS_STATE, [&](const Drives::Event&) {
+            boost::lock_guard<boost::mutex> guard(idle_mutex);
+            idle_cv.notify_all();
+        });
+
+        // Состояние проверяется и после подписки: оси могли перейти в IDLE до нее
+        boost::unique_lock<boost::mutex> lock(idle_mutex);
+        while (! all_idle()) {
+            idle_cv.wait(lock);
         }
-        boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
+        lock.unlock();
+        control.Unsubscribe(subscription);
     }
     std::cerr << "System is ready" << std::endl;
     std::cerr << "Please, specify your commands here:" << std::endl;
 
-    StatReader statreader(sys_status, log_file_path, log_rate_us);
+    StatReader statreader(control, log_file_path, log_rate_us);
     boost::thread statthread(boost::bind(&StatReader::CycleRead, &statreader));
 
     std::string cmd_str;
@@ -353,12 +439,23 @@ int main(int argc, char* argv[]) {
             print_available_commands();
             continue;
         } else if (cmd_str == "s") {
-            print_status_cerr(sys_status.load(std::memory_order_acquire), timing_info.load(std::memory_order_acquire));
+            print_status_cerr(control.GetStatusCopy(), control.GetCycleTimeInfo(), control.GetCycleHistogram());
             control.ResetCycleTimeInfo();
+            control.ResetCycleHistogram();
             continue;
         } else if (cmd_str == "i") {
             print_info(sys_info);
             continue;
+        } else if (cmd_str == "c") {
+            Config::Storage new_config;
+            try {
+                new_config.ReadFile(cfg_file_path.string());
+            } catch (const Config::Exception& e) {
+                std::cerr << "Failed to read config file: " << e.what() << std::endl;
+                continue;
+            }
+            std::cerr << "Config reload " << (control.ReloadConfig(new_config) ? "succeeded" : "failed") << std::endl;
+            continue;
         } else if (cmd_str.empty()) {
             continue;
         }
@@ -375,6 +472,8 @@ int main(int argc, char* argv[]) {
             control.ResetFault(cmd.axis);
         } else if (cmd.update_params) {
             control.SetAxisParams(cmd.axis, cmd.params);
+        } else if (cmd.track) {
+            control.SetModeTrack(cmd.axis, cmd.pos);
         } else {
             control.SetModeRun(cmd.axis, cmd.pos, cmd.vel);
         }
@@ -382,6 +481,7 @@ int main(int argc, char* argv[]) {
         std::cerr << "Command axis: " << cmd.axis
                   << " pos: " << cmd.pos
                   << " vel: " << cmd.vel
+                  << " track: " << cmd.track
                   << " idle: " << cmd.idle
                   << " reset: " << cmd.reset
                   << " update_params: " << cmd.update_params
@@ -0,0 +1,150 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "l7na/recordfile.h"
+
+namespace po = boost::program_options;
+
+namespace {
+
+//! Имена и знаковость известных объектов PDO
+struct PdoObjectName {
+    uint16_t    index;
+    const char* name;
+    bool        is_signed;
+};
+
+const PdoObjectName kPdoObjectNames[] = {
+    { 0x6040, "ctrl", false }
+    , { 0x6041, "status", false }
+    , { 0x6060, "mode", true }
+    , { 0x607A, "tgt_pos", true }
+    , { 0x6062, "dmd_pos", true }
+    , { 0x6064, "cur_pos", true }
+    , { 0x60FF, "tgt_vel", true }
+    , { 0x606B, "dmd_vel", true }
+    , { 0x606C, "cur_vel", true }
+    , { 0x60F4, "follow_err", true }
+    , { 0x260D, "pos_abs", true }
+    , { 0x6077, "torq", true }
+    , { 0x603F, "err_code", false }
+    , { 0x2610, "temperature", true }
+};
+
+const PdoObjectName* find_name(uint16_t index) {
+    for (const PdoObjectName& name: kPdoObjectNames) {
+        if (name.index == index) {
+            return &name;
+        }
+    }
+    return NULL;
+}
+
+void print_header(const Drives::RecordFileHeader& header, uint64_t first, uint64_t end) {
+    std::cout << "# version=" << header.version
+              << " capacity=" << header.capacity
+              << " record_size=" << header.record_size
+              << " image_size=" << header.image_size << " (fast " << header.fast_image_size << ")"
+              << " cycle_period_ns=" << header.cycle_period_ns
+              << " slow_pdo_divider=" << header.slow_pdo_divider
+              << " pdo_layout=" << header.pdo_layout
+              << " axis_count=" << header.axis_count << std::endl;
+    std::cout << "# records=[" << first << ", " << end << ")"
+              << " dropped=" << header.dropped_count.load(std::memory_order_acquire) << std::endl;
+}
+
+void print_record(const Drives::RecordFileHeader& header, uint64_t seq, const Drives::CycleRecord& record) {
+    std::cout << seq
+              << " cycle=" << record.cycle
+              << " app_time=" << record.app_time_ns
+              << " latency=" << record.latency_ns
+              << " period=" << record.period_ns
+              << " exec=" << record.exec_ns
+              << " dcsync=" << record.dcsync
+              << " wc=" << uint32_t(record.wc_state[0]) << "/" << uint32_t(record.wc_state[1])
+              << " slow=" << uint32_t(record.slow_received);
+
+    const uint8_t* image = Drives::RecordFileReader::Image(record);
+    int32_t axis = -1;
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        const Drives::RecordPdoEntry& entry = header.entries[i];
+        if (entry.axis != axis) {
+            axis = entry.axis;
+            std::cout << " | a" << axis;
+        }
+
+        const PdoObjectName* name = find_name(entry.index);
+        const int64_t value = Drives::RecordFileReader::ReadEntry(image, entry, name && name->is_signed);
+        if (name) {
+            std::cout << " " << name->name << "=";
+        } else {
+            std::cout << " " << std::hex << entry.index << std::dec << ":" << uint32_t(entry.subindex) << "=";
+        }
+        if (name && ! name->is_signed) {
+            std::cout << "0x" << std::hex << value << std::dec;
+        } else {
+            std::cout << value;
+        }
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string record_path;
+    uint64_t last_count;
+    bool header_only = false;
+
+    po::options_description options("options");
+    options.add_options()
+        ("help,h", "display this message")
+        ("file,f", po::value<decltype(record_path)>(&record_path)->required(), "path to record file")
+        ("last,n", po::value<decltype(last_count)>(&last_count)->default_value(0), "print only the last N records (0 - all)")
+        ("header", po::bool_switch(&header_only), "print only the file header")
+    ;
+    po::positional_options_description positional;
+    positional.add("file", 1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(options).positional(positional).run(), vm);
+        if (vm.count("help")) {
+            std::cerr << options << std::endl;
+            return EXIT_FAILURE;
+        }
+        po::notify(vm);
+    } catch(const po::error& ex) {
+        std::cerr << "Failed to parse command line options: " << ex.what() << std::endl;
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Drives::RecordFileReader reader;
+    if (! reader.Open(record_path)) {
+        std::cerr << "Failed to open record file " << record_path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const Drives::RecordFileHeader& header = reader.Header();
+    const uint64_t end = reader.EndSeq();
+    uint64_t first = reader.FirstSeq();
+    if (last_count && end - first > last_count) {
+        first = end - last_count;
+    }
+
+    print_header(header, first, end);
+    if (header_only) {
+        return EXIT_SUCCESS;
+    }
+
+    for (uint64_t seq = first; seq < end; ++seq) {
+        print_record(header, seq, reader.Record(seq));
+    }
+
+    return EXIT_SUCCESS;
+}
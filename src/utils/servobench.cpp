@@ -0,0 +1,50 @@
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include "l7na/drives.h"
+#include "l7na/logger.h"
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[]) {
+    std::string out_path, filter;
+
+    po::options_description options("options");
+    options.add_options()
+        ("help,h", "display this message")
+        ("out,o", po::value<decltype(out_path)>(&out_path), "path to JSON output file (stdout if not specified)")
+        ("filter", po::value<decltype(filter)>(&filter), "run only benchmarks whose name contains this substring")
+    ;
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, options), vm);
+        po::notify(vm);
+    } catch(const po::error& ex) {
+        std::cerr << "Failed to parse command line options: " << ex.what() << std::endl;
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (vm.count("help")) {
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Лог выводится в stdout: в выводе замеров остаются только ошибки
+    common::InitLogger(boost::log::trivial::error, "[%Severity%] : %Message%");
+
+    if (out_path.empty()) {
+        Drives::Control::RunBenchmarks(std::cout, filter);
+    } else {
+        std::ofstream out(out_path.c_str());
+        if (! out) {
+            std::cerr << "Failed to open " << out_path << std::endl;
+            return EXIT_FAILURE;
+        }
+        Drives::Control::RunBenchmarks(out, filter);
+    }
+    return EXIT_SUCCESS;
+}
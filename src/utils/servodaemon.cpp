@@ -0,0 +1,93 @@
+#include <signal.h>
+
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include "l7na/daemon.h"
+#include "l7na/configfile.h"
+#include "l7na/logger.h"
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[]) {
+    boost::log::trivial::severity_level loglevel;
+    std::string cfg_file_path, shm_name, record_path;
+    uint32_t cycle_period_us;
+    int32_t rt_cpu;
+
+    po::options_description options("options");
+    options.add_options()
+        ("help,h", "display this message")
+        ("loglevel,l", po::value<decltype(loglevel)>(&loglevel)->default_value(boost::log::trivial::info), "global loglevel (trace, debug, info, warning, error or fatal)")
+        ("config,c", po::value<decltype(cfg_file_path)>(&cfg_file_path)->required(), "path to config file")
+        ("shm", po::value<decltype(shm_name)>(&shm_name)->default_value("/l7na"), "name of the shared memory object clients connect to")
+        ("period", po::value<decltype(cycle_period_us)>(&cycle_period_us)->default_value(10000), "EtherCAT cycle period [us]")
+        ("rt_cpu", po::value<decltype(rt_cpu)>(&rt_cpu)->default_value(-1), "CPU to pin the cyclic thread to. Enables real-time profile (SCHED_FIFO, mlockall)")
+        ("record", po::value<decltype(record_path)>(&record_path), "path to binary file recording every cycle (PDO image and timing). Read it with servorecdump")
+        ("sim", "run against simulated drives instead of EtherCAT hardware")
+    ;
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, options), vm);
+        po::notify(vm);
+    } catch(const po::error& ex) {
+        std::cerr << "Failed to parse command line options: " << ex.what() << std::endl;
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (vm.count("help")) {
+        std::cerr << options << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const char* kLogFormat = "%LineID% %TimeStamp% (%ProcessID%:%ThreadID%) [%Severity%] : %Message%";
+    common::InitLogger(loglevel, kLogFormat);
+
+    Config::Storage config;
+    try {
+        config.ReadFile(cfg_file_path);
+    } catch(const Config::Exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Drives::ControlOptions control_options;
+    if (rt_cpu >= 0) {
+        control_options = Drives::ControlOptions::RealtimeProfile(rt_cpu, cycle_period_us * 1000);
+    } else {
+        control_options.cycle_period_ns = cycle_period_us * 1000;
+    }
+    control_options.record_path = record_path;
+    if (vm.count("sim")) {
+        control_options.backend = Drives::EC_BACKEND_SIM;
+    }
+
+    // Сигналы завершения ждет только main: потоки Control и демона создаются с заблокированными сигналами
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    try {
+        Drives::Control control(config, Drives::PARAMS_MODE_AUTOMATIC, control_options);
+        if (! control.GetInitFuture().get()) {
+            std::cerr << "System initialization failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        Drives::Daemon daemon(control, shm_name, control_options.cycle_period_ns);
+        std::cerr << "Serving " << shm_name << ", press Ctrl+C to stop" << std::endl;
+
+        int signal = 0;
+        sigwait(&stop_signals, &signal);
+        std::cerr << "Stopping on signal " << signal << " after " << daemon.CommandCount() << " commands" << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}